@@ -52,23 +52,7 @@ int uMod_FileHandler::Add(TextureFileStruct* file)
 
   if (Number/FieldLength==FieldCounter) // get more memory
   {
-    TextureFileStruct*** temp = NULL;
-    try {temp = new TextureFileStruct**[FieldCounter+10];}
-    catch (...)
-    {
-      gl_ErrorState |= uMod_ERROR_MEMORY | uMod_ERROR_TEXTURE;
-      return (RETURN_NO_MEMORY);
-    }
-
-    for (int i=0; i<FieldCounter; i++) temp[i] = Files[i]; //copy to new allocated memory
-
-    for (int i=FieldCounter; i<FieldCounter+10; i++) temp[i] = NULL; // initialize unused parts to zero
-
-    FieldCounter += 10;
-
-    if (Files!=NULL) delete [] Files;
-
-    Files = temp;
+    if (int ret = AllocateFields( FieldCounter+10)) return (ret);
   }
   if (Number%FieldLength==0) // maybe we need to get more memory
   {
@@ -81,6 +65,8 @@ int uMod_FileHandler::Add(TextureFileStruct* file)
     }
   }
 
+  if (int ret = Index.Insert( file->Hash, Number)) return (ret);
+
   Files[Number/FieldLength][Number%FieldLength] = file;
   file->Reference = Number++; //set the reference for a fast deleting
 
@@ -96,11 +82,46 @@ int uMod_FileHandler::Remove(TextureFileStruct* file)
 
   if (ref<0) return (RETURN_OK); // returning if no Reference is set
   file->Reference = -1; //set reference outside of bound
+  Index.Remove( file->Hash);
   if (ref<(--Number)) //if reference is unequal to Number-1 we copy the last entry to the index "ref"
   {
     Files[ref/FieldLength][ref%FieldLength] = Files[Number/FieldLength][Number%FieldLength];
     Files[ref/FieldLength][ref%FieldLength]->Reference = ref; //set the new reference entry
+    Index.Set( Files[ref/FieldLength][ref%FieldLength]->Hash, ref);
   }
   return (RETURN_OK);
 }
 
+int uMod_FileHandler::Reserve( int number)
+{
+  Message("uMod_FileHandler::Reserve(%d): %lu\n", number, this);
+  if (gl_ErrorState & uMod_ERROR_FATAL) return (RETURN_FATAL_ERROR);
+
+  if (int ret = AllocateFields( (number+FieldLength-1)/FieldLength)) return (ret);
+  return (Index.Reserve( number));
+}
+
+int uMod_FileHandler::AllocateFields( int field_counter)
+{
+  if (field_counter>FieldCounter)
+  {
+    TextureFileStruct*** temp = NULL;
+    try {temp = new TextureFileStruct**[field_counter];}
+    catch (...)
+    {
+      gl_ErrorState |= uMod_ERROR_MEMORY | uMod_ERROR_TEXTURE;
+      return (RETURN_NO_MEMORY);
+    }
+
+    for (int i=0; i<FieldCounter; i++) temp[i] = Files[i]; //copy to new allocated memory
+
+    for (int i=FieldCounter; i<field_counter; i++) temp[i] = NULL; // initialize unused parts to zero
+
+    FieldCounter = field_counter;
+
+    if (Files!=NULL) delete [] Files;
+
+    Files = temp;
+  }
+  return (RETURN_OK);
+}
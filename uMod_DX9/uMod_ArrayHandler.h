@@ -21,40 +21,71 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 #ifndef uMod_FIELDHANDLER_H_
 #define uMod_FIELDHANDLER_H_
 
-#include "..\uMod_GlobalDefines.h"
+#include "../uMod_GlobalDefines.h"
+#include "uMod_PayloadArena.h"
 #include "uMod_IDirect3DTexture9.h"
+#include "uMod_HashIndex.h"
 
 typedef struct
 {
   bool ForceReload; // to force a reload of the texture (if it is already modded)
   char* pData; // store texture file as file in memory
   unsigned int Size; // size of file
-  int NumberOfTextures;
+  int NumberOfTextures; // not used by the client (see FakeTextureListStruct)
   int Reference; // for a fast delete in the FileHandler
-  IDirect3DBaseTexture9 **Textures; // pointer to the fake textures
+  IDirect3DBaseTexture9 **Textures; // not used by the client (see FakeTextureListStruct)
   MyTypeHash Hash; // hash value
+  unsigned int Generation; // is changed by the server, whenever the file content is replaced (key of the decode cache)
+  int Version; // only used by the server for files in OldMod: the first version of the update, which does not contain this file anymore
+  uMod_Slab* Slab; // only used by the server: the slab which holds pData
+  DWORD Requested; // only used by the client: tick count of the last fetch request, if pData is NULL (lazy mode)
 } TextureFileStruct;
 
+typedef struct
+{
+  int Number;
+  int Length; // number of allocated entries, grows by doubling
+  IDirect3DBaseTexture9 **Textures; // pointer to the fake textures, all of them share the same d3d texture (per type)
+} FakeTextureListStruct; // the client stores this side table parallel to the TextureFileStruct array
+
+
+#define uMod_CHANGE_ADD 1
+#define uMod_CHANGE_REMOVE 2
+#define uMod_CHANGE_FORCE_RELOAD 3
+#define uMod_CHANGE_FETCHED 4 // the file content of a lazy entry has arrived
+
+typedef struct
+{
+  int Type; // uMod_CHANGE_ADD, uMod_CHANGE_REMOVE, uMod_CHANGE_FORCE_RELOAD or uMod_CHANGE_FETCHED
+  TextureFileStruct File; // copy of the entry of the server, only the hash is used for uMod_CHANGE_REMOVE
+} TextureChangeStruct; // the server sends a list of these changes to the clients (delta update)
+
 
 
-class uMod_FileHandler  // array to store TextureFileStruct
+class uMod_FileHandler  // array to store TextureFileStruct, the entries are indexed by their hash
 {
 public:
   uMod_FileHandler(void);
   ~uMod_FileHandler(void);
 
-  int Add( TextureFileStruct* file);
+  int Add( TextureFileStruct* file); // the Hash of the file must be set before and must not change while it is added
   int Remove( TextureFileStruct* file);
+  int Reserve( int number); // allocates memory for number entries at once (bulk add)
+
+  TextureFileStruct *Find( MyTypeHash hash) {return ((*this)[Index.Find(hash)]);} // returns NULL if the hash is not added
 
   int GetNumber(void) {return (Number);}
 
   TextureFileStruct *operator [] (int i) {if (i<0||i>=Number) return (NULL); else return (Files[i/FieldLength][i%FieldLength]);}
 
 protected:
+  int AllocateFields( int field_counter); // the pointer array to the fields is enlarged, the fields itself are allocated in Add()
+
   static const int FieldLength = 1024;
   long Number;
   int FieldCounter;
   TextureFileStruct*** Files;
+  uMod_HashIndex Index; // maps the hash onto the Reference of the file
 };
 
 
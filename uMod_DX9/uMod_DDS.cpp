@@ -0,0 +1,288 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Main.h"
+
+
+// the part of the dds header, which is needed
+typedef struct
+{
+  DWORD Size;
+  DWORD Flags;
+  DWORD Height;
+  DWORD Width;
+  DWORD PitchOrLinearSize;
+  DWORD Depth;
+  DWORD MipMapCount;
+  DWORD Reserved1[11];
+  DWORD PFSize;
+  DWORD PFFlags;
+  DWORD FourCC;
+  DWORD RGBBitCount;
+  DWORD RBitMask;
+  DWORD GBitMask;
+  DWORD BBitMask;
+  DWORD ABitMask;
+  DWORD Caps;
+  DWORD Caps2;
+  DWORD Caps3;
+  DWORD Caps4;
+  DWORD Reserved2;
+} uMod_DDSHeader;
+
+#define DDS_MAGIC 0x20534444 // "DDS "
+#define DDSD_MIPMAPCOUNT 0x00020000
+#define DDSD_DEPTH 0x00800000
+#define DDSCAPS2_CUBEMAP 0x00000200
+#define DDSCAPS2_VOLUME 0x00200000
+#define DDPF_ALPHAPIXELS 0x00000001
+#define DDPF_ALPHA 0x00000002
+#define DDPF_FOURCC 0x00000004
+#define DDPF_RGB 0x00000040
+#define DDPF_LUMINANCE 0x00020000
+#define DDSCAPS2_CUBEMAP_ALLFACES 0x0000FC00
+
+
+// returns D3DFMT_UNKNOWN, if the format is not supported
+static D3DFORMAT GetFormat( uMod_DDSHeader *header)
+{
+  DWORD flags = header->PFFlags;
+  DWORD r = header->RBitMask, g = header->GBitMask, b = header->BBitMask, a = header->ABitMask;
+  if (flags & DDPF_FOURCC)
+  {
+    switch (header->FourCC)
+    {
+      case D3DFMT_DXT1: return (D3DFMT_DXT1);
+      case D3DFMT_DXT2: return (D3DFMT_DXT2);
+      case D3DFMT_DXT3: return (D3DFMT_DXT3);
+      case D3DFMT_DXT4: return (D3DFMT_DXT4);
+      case D3DFMT_DXT5: return (D3DFMT_DXT5);
+      case D3DFMT_A16B16G16R16: return (D3DFMT_A16B16G16R16);
+      case D3DFMT_R16F: return (D3DFMT_R16F);
+      case D3DFMT_G16R16F: return (D3DFMT_G16R16F);
+      case D3DFMT_A16B16G16R16F: return (D3DFMT_A16B16G16R16F);
+      case D3DFMT_R32F: return (D3DFMT_R32F);
+      case D3DFMT_G32R32F: return (D3DFMT_G32R32F);
+      case D3DFMT_A32B32G32R32F: return (D3DFMT_A32B32G32R32F);
+      default: return (D3DFMT_UNKNOWN);
+    }
+  }
+  if (!(flags & DDPF_ALPHAPIXELS)) a = 0u;
+  if (flags & DDPF_RGB)
+  {
+    switch (header->RGBBitCount)
+    {
+      case 32:
+        if (r==0xFF0000 && g==0xFF00 && b==0xFF) return (a==0xFF000000 ? D3DFMT_A8R8G8B8 : D3DFMT_X8R8G8B8);
+        if (r==0xFF && g==0xFF00 && b==0xFF0000) return (a==0xFF000000 ? D3DFMT_A8B8G8R8 : D3DFMT_X8B8G8R8);
+        return (D3DFMT_UNKNOWN);
+      case 24:
+        if (r==0xFF0000 && g==0xFF00 && b==0xFF) return (D3DFMT_R8G8B8);
+        return (D3DFMT_UNKNOWN);
+      case 16:
+        if (r==0xF800 && g==0x7E0 && b==0x1F) return (D3DFMT_R5G6B5);
+        if (r==0x7C00 && g==0x3E0 && b==0x1F) return (a==0x8000 ? D3DFMT_A1R5G5B5 : D3DFMT_X1R5G5B5);
+        if (r==0xF00 && g==0xF0 && b==0xF) return (a==0xF000 ? D3DFMT_A4R4G4B4 : D3DFMT_X4R4G4B4);
+        return (D3DFMT_UNKNOWN);
+      default: return (D3DFMT_UNKNOWN);
+    }
+  }
+  if (flags & DDPF_LUMINANCE)
+  {
+    if (header->RGBBitCount==8 && r==0xFF) return (D3DFMT_L8);
+    if (header->RGBBitCount==16 && r==0xFF && a==0xFF00) return (D3DFMT_A8L8);
+    if (header->RGBBitCount==16 && r==0xFFFF) return (D3DFMT_L16);
+    return (D3DFMT_UNKNOWN);
+  }
+  if ((flags & DDPF_ALPHA) && header->RGBBitCount==8 && header->ABitMask==0xFF) return (D3DFMT_A8); // an alpha only file has no DDPF_ALPHAPIXELS
+  return (D3DFMT_UNKNOWN);
+}
+
+unsigned int uMod_GetFormatSize( D3DFORMAT format, bool &compressed)
+{
+  compressed = false;
+  switch (format)
+  {
+    case D3DFMT_DXT1: compressed = true; return (8u);
+    case D3DFMT_DXT2:
+    case D3DFMT_DXT3:
+    case D3DFMT_DXT4:
+    case D3DFMT_DXT5: compressed = true; return (16u);
+    case D3DFMT_A32B32G32R32F: return (16u);
+    case D3DFMT_A16B16G16R16:
+    case D3DFMT_A16B16G16R16F:
+    case D3DFMT_G32R32F: return (8u);
+    case D3DFMT_A8R8G8B8:
+    case D3DFMT_X8R8G8B8:
+    case D3DFMT_A8B8G8R8:
+    case D3DFMT_X8B8G8R8:
+    case D3DFMT_A2R10G10B10:
+    case D3DFMT_A2B10G10R10:
+    case D3DFMT_G16R16:
+    case D3DFMT_G16R16F:
+    case D3DFMT_R32F: return (4u);
+    case D3DFMT_R8G8B8: return (3u);
+    case D3DFMT_R5G6B5:
+    case D3DFMT_A1R5G5B5:
+    case D3DFMT_X1R5G5B5:
+    case D3DFMT_A4R4G4B4:
+    case D3DFMT_X4R4G4B4:
+    case D3DFMT_A8L8:
+    case D3DFMT_L16:
+    case D3DFMT_R16F: return (2u);
+    case D3DFMT_L8:
+    case D3DFMT_A8: return (1u);
+    default: return (0u);
+  }
+}
+
+void uMod_SetLevelSizes( uMod_DDSLayout &layout, unsigned int bytes, bool compressed)
+{
+  UINT w = layout.Width, h = layout.Height, d = layout.Depth;
+  for (UINT l=0u; l<layout.Levels; l++)
+  {
+    if (compressed)
+    {
+      layout.Pitch[l] = ((w+3u)/4u)*bytes;
+      layout.Rows[l] = (h+3u)/4u;
+    }
+    else
+    {
+      layout.Pitch[l] = w*bytes;
+      layout.Rows[l] = h;
+    }
+    layout.Slices[l] = d;
+    w = w>1u ? w/2u : 1u;
+    h = h>1u ? h/2u : 1u;
+    d = d>1u ? d/2u : 1u;
+  }
+}
+
+// box filter, as used by D3DX for the mipmap levels (D3DX_DEFAULT)
+static void BoxFilter( const unsigned char *src, UINT width, UINT height, unsigned char *dst)
+{
+  UINT w = width>1u ? width/2u : 1u;
+  UINT h = height>1u ? height/2u : 1u;
+  UINT dx = width>1u ? 4u : 0u; // offset of the right pixel
+  UINT dy = height>1u ? width*4u : 0u; // offset of the lower pixel
+  for (UINT y=0u; y<h; y++)
+  {
+    const unsigned char *row = src + (height>1u ? 2u*y : y)*width*4u;
+    for (UINT x=0u; x<w; x++)
+    {
+      const unsigned char *p = row + (width>1u ? 2u*x : x)*4u;
+      for (int c=0; c<4; c++) *dst++ = (unsigned char) ((p[c] + p[dx+c] + p[dy+c] + p[dx+dy+c] + 2u) >> 2);
+    }
+  }
+}
+
+int uMod_ParseDDS( char* data, unsigned int size, uMod_DDSLayout &layout)
+{
+  if (data==NULL || size<4u+sizeof(uMod_DDSHeader)) return (RETURN_TEXTURE_NOT_LOADED);
+  if (*(DWORD*)data!=DDS_MAGIC) return (RETURN_TEXTURE_NOT_LOADED);
+  uMod_DDSHeader *header = (uMod_DDSHeader*) (data + 4);
+  if (header->Size!=sizeof(uMod_DDSHeader) || header->PFSize!=32u) return (RETURN_TEXTURE_NOT_LOADED);
+
+  layout.Type = uMod_DDS_TEXTURE;
+  layout.Faces = 1u;
+  UINT width = header->Width;
+  UINT height = header->Height;
+  UINT depth = 1u;
+  if (header->Caps2 & DDSCAPS2_CUBEMAP)
+  {
+    if ((header->Caps2 & DDSCAPS2_CUBEMAP_ALLFACES)!=DDSCAPS2_CUBEMAP_ALLFACES || width!=height) return (RETURN_TEXTURE_NOT_LOADED);
+    layout.Type = uMod_DDS_CUBE_TEXTURE;
+    layout.Faces = 6u;
+  }
+  else if ((header->Caps2 & DDSCAPS2_VOLUME) && (header->Flags & DDSD_DEPTH))
+  {
+    layout.Type = uMod_DDS_VOLUME_TEXTURE;
+    depth = header->Depth;
+  }
+
+  // D3DX_DEFAULT rounds the size up to a power of two, in this case the levels must be resized
+  if (width==0u || height==0u || depth==0u) return (RETURN_TEXTURE_NOT_LOADED);
+  if ((width & (width-1u)) || (height & (height-1u)) || (depth & (depth-1u))) return (RETURN_TEXTURE_NOT_LOADED);
+
+  layout.Format = GetFormat( header);
+  bool compressed;
+  unsigned int bytes = uMod_GetFormatSize( layout.Format, compressed);
+  if (bytes==0u) return (RETURN_TEXTURE_NOT_LOADED);
+
+  // D3DX_DEFAULT creates the full mipmap chain
+  UINT levels = 1u;
+  UINT max = width>height ? width : height;
+  if (depth>max) max = depth;
+  for (; max>1u; max/=2u) levels++;
+  if (levels>uMod_DDS_MAX_LEVELS) return (RETURN_TEXTURE_NOT_LOADED);
+  UINT in_file = (header->Flags & DDSD_MIPMAPCOUNT) ? header->MipMapCount : 1u;
+  if (in_file==0u) in_file = 1u;
+  if (in_file>levels) in_file = levels;
+
+  // missing levels are only generated for 2D textures with 8 bits per channel, the others are left to D3DX
+  if (in_file<levels)
+  {
+    if (layout.Type!=uMod_DDS_TEXTURE || bytes!=4u || compressed) return (RETURN_TEXTURE_NOT_LOADED);
+    if (layout.Format==D3DFMT_G16R16F || layout.Format==D3DFMT_R32F) return (RETURN_TEXTURE_NOT_LOADED);
+  }
+
+  layout.Width = width;
+  layout.Height = height;
+  layout.Depth = depth;
+  layout.Levels = levels;
+  uMod_SetLevelSizes( layout, bytes, compressed);
+
+  // the faces of a cube texture are stored one after another, each with all its levels
+  unsigned int offset = 4u + sizeof(uMod_DDSHeader);
+  for (UINT f=0u; f<layout.Faces; f++) for (UINT l=0u; l<in_file; l++)
+  {
+    unsigned long long level_size = (unsigned long long) layout.Pitch[l]*layout.Rows[l]*layout.Slices[l]; // might exceed 32 bits for a malformed header
+    if (level_size>size-offset) return (RETURN_TEXTURE_NOT_LOADED); // file is truncated
+    layout.Bits[f][l] = data + offset;
+    offset += (unsigned int) level_size;
+  }
+
+  layout.InFile = in_file;
+  return (RETURN_OK);
+}
+
+unsigned int uMod_GetStagingSize( const uMod_DDSLayout &layout)
+{
+  unsigned int size = 0u;
+  for (UINT l=layout.InFile; l<layout.Levels; l++) size += layout.Pitch[l]*layout.Rows[l]*layout.Slices[l];
+  return (size*layout.Faces);
+}
+
+void uMod_GenerateMipMaps( uMod_DDSLayout &layout, char* staging)
+{
+  // only 2D textures with 4 bytes per pixel have missing levels (see uMod_ParseDDS())
+  UINT w = layout.Width, h = layout.Height; // size of the previous level
+  for (UINT l=1u; l<layout.Levels; l++)
+  {
+    if (l>=layout.InFile)
+    {
+      layout.Bits[0][l] = staging;
+      BoxFilter( (unsigned char*) layout.Bits[0][l-1u], w, h, (unsigned char*) staging);
+      staging += layout.Pitch[l]*layout.Rows[l];
+    }
+    w = w>1u ? w/2u : 1u;
+    h = h>1u ? h/2u : 1u;
+  }
+}
@@ -0,0 +1,76 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef uMod_DDS_H_
+#define uMod_DDS_H_
+
+/*
+ *  Parser for dds files, whose levels can be copied directly into a texture (without D3DX).
+ *
+ *  The fake textures were created by D3DX with D3DX_DEFAULT for the size, the format and the mipmap levels.
+ *  Thus a file is usable, if the size is a power of two (else D3DX would round it up), the format is stored unchanged
+ *  and the full mipmap chain is available. Missing levels of 2D textures with 8 bits per channel are generated
+ *  with a box filter (the default mipmap filter of D3DX), all other files must contain the full chain.
+ *
+ *  These functions do not call d3d9, the levels are copied into the locked texture by the texture client.
+ */
+
+#define uMod_DDS_MAX_LEVELS 16
+
+#define uMod_DDS_TEXTURE 0
+#define uMod_DDS_VOLUME_TEXTURE 1
+#define uMod_DDS_CUBE_TEXTURE 2
+
+typedef struct
+{
+  int Type; // uMod_DDS_TEXTURE, uMod_DDS_VOLUME_TEXTURE or uMod_DDS_CUBE_TEXTURE
+  D3DFORMAT Format;
+  UINT Width;
+  UINT Height;
+  UINT Depth; // 1 for 2D and cube textures
+  UINT Levels; // full mipmap chain
+  UINT InFile; // number of levels stored in the file
+  UINT Faces; // 6 for cube textures, else 1
+  char* Bits[6][uMod_DDS_MAX_LEVELS]; // [face][level], points into the file or into the staging memory
+  unsigned int Pitch[uMod_DDS_MAX_LEVELS]; // bytes per row (per row of blocks for compressed formats)
+  unsigned int Rows[uMod_DDS_MAX_LEVELS];
+  unsigned int Slices[uMod_DDS_MAX_LEVELS]; // depth of volume textures, else 1
+} uMod_DDSLayout;
+
+
+int uMod_ParseDDS( char* data, unsigned int size, uMod_DDSLayout &layout); // returns RETURN_OK, if the levels can be copied directly
+unsigned int uMod_GetStagingSize( const uMod_DDSLayout &layout); // size of the levels, which are not stored in the file
+void uMod_GenerateMipMaps( uMod_DDSLayout &layout, char* staging); // staging must have uMod_GetStagingSize() bytes
+unsigned int uMod_GetFormatSize( D3DFORMAT format, bool &compressed); // bytes per pixel (per 4x4 block for compressed formats), 0 if unknown
+void uMod_SetLevelSizes( uMod_DDSLayout &layout, unsigned int bytes, bool compressed); // sets Pitch, Rows and Slices from the size of level 0
+
+inline void uMod_CopyRows( const char* src, unsigned int pitch, unsigned int rows, char* dst, int dst_pitch)
+{
+  if ((unsigned int) dst_pitch==pitch) memcpy( dst, src, pitch*rows);
+  else for (unsigned int r=0u; r<rows; r++, src+=pitch, dst+=dst_pitch) memcpy( dst, src, pitch);
+}
+
+inline void uMod_ReadRows( const char* src, int src_pitch, unsigned int rows, char* dst, unsigned int pitch) // the reverse of uMod_CopyRows()
+{
+  if ((unsigned int) src_pitch==pitch) memcpy( dst, src, pitch*rows);
+  else for (unsigned int r=0u; r<rows; r++, src+=src_pitch, dst+=pitch) memcpy( dst, src, pitch);
+}
+
+#endif /* uMod_DDS_H_ */
@@ -112,6 +112,8 @@ void InitInstance(HINSTANCE hModule)
     OpenMessage();
     Message("InitInstance: %lu\n", hModule);
 
+    InitCRC32(); // build the crc tables before any texture is hashed
+
     gl_TextureServer = new uMod_TextureServer(game); //create the server which listen on the pipe and prepare the update for the texture clients
 
     LoadOriginalDll();
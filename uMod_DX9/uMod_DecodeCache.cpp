@@ -0,0 +1,254 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Main.h"
+
+
+uMod_DecodeCache::uMod_DecodeCache(void)
+{
+  Message("uMod_DecodeCache(void): %lu\n", this);
+  Mutex = CreateMutex(NULL, false, NULL);
+  Entries = NULL;
+  NumberOfEntries = 0;
+  LengthOfEntries = 0;
+  First = NULL;
+  Last = NULL;
+  Budget = uMod_DECODE_CACHE_BUDGET;
+  UsedBytes = 0u;
+}
+
+uMod_DecodeCache::~uMod_DecodeCache(void)
+{
+  Message("~uMod_DecodeCache(void): %lu\n", this);
+  // the clients are deleted before the server, thus no entry is acquired anymore
+  for (int i=0; i<NumberOfEntries; i++) DeleteEntry( Entries[i]);
+  if (Entries!=NULL) delete [] Entries;
+  if (Mutex != NULL) CloseHandle(Mutex);
+}
+
+uMod_DecodedTexture* uMod_DecodeCache::Acquire( MyTypeHash hash, unsigned int generation, int type)
+{
+  if (LockMutex()) return (NULL);
+  uMod_DecodedTexture* entry = NULL;
+  int pos = Index.Find( hash);
+  if (pos>=0 && Entries[pos]->Generation==generation && Entries[pos]->Layout.Type==type)
+  {
+    entry = Entries[pos];
+    entry->Reference++;
+    if (entry!=First) // move it to the front
+    {
+      entry->Prev->Next = entry->Next;
+      if (entry->Next!=NULL) entry->Next->Prev = entry->Prev;
+      else Last = entry->Prev;
+      entry->Prev = NULL;
+      entry->Next = First;
+      First->Prev = entry;
+      First = entry;
+    }
+  }
+  UnlockMutex();
+  return (entry);
+}
+
+int uMod_DecodeCache::Release( uMod_DecodedTexture* entry)
+{
+  if (entry==NULL) return (RETURN_OK);
+  if (int ret = LockMutex()) return (ret); // the entry stays pinned until the cache is deleted
+  entry->Reference--;
+  bool remove = (entry->Reference==0 && entry->Index<0); // it was replaced or evicted while it was acquired
+  Evict();
+  UnlockMutex();
+  if (remove) DeleteEntry( entry);
+  return (RETURN_OK);
+}
+
+bool uMod_DecodeCache::Contains( MyTypeHash hash, unsigned int generation, int type)
+{
+  if (LockMutex()) return (false);
+  int pos = Index.Find( hash);
+  bool ret = (pos>=0 && Entries[pos]->Generation==generation && Entries[pos]->Layout.Type==type);
+  UnlockMutex();
+  return (ret);
+}
+
+bool uMod_DecodeCache::FirstLoad( TextureFileStruct* file)
+{
+  if (LockMutex()) return (true); // the texture is not cached
+  int generation = (int) (file->Generation & 0x7FFFFFFFu); // -1 marks an empty slot of the index
+  int pos = Loaded.Find( file->Hash);
+  bool ret = (pos!=generation);
+  if (pos<0) Loaded.Insert( file->Hash, generation);
+  else if (ret) Loaded.Set( file->Hash, generation); // the file content has changed
+  UnlockMutex();
+  return (ret);
+}
+
+uMod_DecodedTexture* uMod_DecodeCache::NewEntry( TextureFileStruct* file, const uMod_DDSLayout &layout)
+{
+  unsigned int size = 0u;
+  for (UINT l=0u; l<layout.Levels; l++) size += layout.Pitch[l]*layout.Rows[l]*layout.Slices[l];
+  size *= layout.Faces;
+  if (size==0u || size>Budget) return (NULL); // would evict everything else
+
+  uMod_DecodedTexture* entry = NULL;
+  try
+  {
+    entry = new uMod_DecodedTexture;
+    entry->Data = new char[size];
+  }
+  catch (...)
+  {
+    if (entry!=NULL) delete entry;
+    return (NULL);
+  }
+  entry->Hash = file->Hash;
+  entry->Generation = file->Generation;
+  entry->Layout = layout;
+  entry->Layout.InFile = layout.Levels;
+  entry->Size = size;
+  entry->Reference = 0;
+  entry->Index = -1;
+  entry->Prev = NULL;
+  entry->Next = NULL;
+
+  char* bits = entry->Data;
+  for (UINT f=0u; f<layout.Faces; f++) for (UINT l=0u; l<layout.Levels; l++)
+  {
+    entry->Layout.Bits[f][l] = bits;
+    bits += layout.Pitch[l]*layout.Rows[l]*layout.Slices[l];
+  }
+  return (entry);
+}
+
+int uMod_DecodeCache::Insert( uMod_DecodedTexture* entry)
+{
+  if (int ret = LockMutex()) {DeleteEntry( entry); return (ret);}
+
+  uMod_DecodedTexture* old = NULL;
+  int pos = Index.Find( entry->Hash);
+  if (pos>=0)
+  {
+    old = Entries[pos];
+    Unlink( old);
+    if (old->Reference>0) old = NULL; // is deleted on its release
+  }
+
+  if (NumberOfEntries>=LengthOfEntries)
+  {
+    uMod_DecodedTexture** temp = NULL;
+    try {temp = new uMod_DecodedTexture*[LengthOfEntries + 64];}
+    catch (...)
+    {
+      UnlockMutex();
+      DeleteEntry( entry);
+      if (old!=NULL) DeleteEntry( old);
+      return (RETURN_NO_MEMORY);
+    }
+    for (int i=0; i<NumberOfEntries; i++) temp[i] = Entries[i];
+    if (Entries!=NULL) delete [] Entries;
+    Entries = temp;
+    LengthOfEntries += 64;
+  }
+  if (int ret = Index.Insert( entry->Hash, NumberOfEntries))
+  {
+    UnlockMutex();
+    DeleteEntry( entry);
+    if (old!=NULL) DeleteEntry( old);
+    return (ret);
+  }
+  entry->Index = NumberOfEntries;
+  Entries[NumberOfEntries++] = entry;
+
+  entry->Prev = NULL;
+  entry->Next = First;
+  if (First!=NULL) First->Prev = entry;
+  else Last = entry;
+  First = entry;
+  UsedBytes += entry->Size;
+
+  Evict();
+  UnlockMutex();
+  if (old!=NULL) DeleteEntry( old);
+  return (RETURN_OK);
+}
+
+void uMod_DecodeCache::DeleteEntry( uMod_DecodedTexture* entry)
+{
+  if (entry==NULL) return;
+  if (entry->Data!=NULL) delete [] entry->Data;
+  delete entry;
+}
+
+int uMod_DecodeCache::SetBudget( unsigned int bytes)
+{
+  if (int ret = LockMutex()) return (ret);
+  Budget = bytes;
+  Evict();
+  return (UnlockMutex());
+}
+
+void uMod_DecodeCache::Unlink( uMod_DecodedTexture* entry)
+{
+  int pos = entry->Index;
+  Index.Remove( entry->Hash);
+  if (pos < --NumberOfEntries) // the last entry fills the gap
+  {
+    Entries[pos] = Entries[NumberOfEntries];
+    Entries[pos]->Index = pos;
+    Index.Set( Entries[pos]->Hash, pos);
+  }
+  entry->Index = -1;
+
+  if (entry->Prev!=NULL) entry->Prev->Next = entry->Next;
+  else First = entry->Next;
+  if (entry->Next!=NULL) entry->Next->Prev = entry->Prev;
+  else Last = entry->Prev;
+  entry->Prev = NULL;
+  entry->Next = NULL;
+  UsedBytes -= entry->Size;
+}
+
+void uMod_DecodeCache::Evict(void)
+{
+  uMod_DecodedTexture* entry = Last;
+  while (UsedBytes>Budget && entry!=NULL)
+  {
+    uMod_DecodedTexture* prev = entry->Prev;
+    if (entry->Reference==0)
+    {
+      Unlink( entry);
+      DeleteEntry( entry);
+    }
+    entry = prev;
+  }
+}
+
+int uMod_DecodeCache::LockMutex(void)
+{
+  if (( gl_ErrorState & (uMod_ERROR_FATAL | uMod_ERROR_MUTEX) )) return (RETURN_NO_MUTEX);
+  if (WAIT_OBJECT_0!=WaitForSingleObject( Mutex, 100)) return (RETURN_MUTEX_LOCK); //waiting 100ms, to wait infinite pass INFINITE
+  return (RETURN_OK);
+}
+
+int uMod_DecodeCache::UnlockMutex(void)
+{
+  if (ReleaseMutex( Mutex) == 0) return (RETURN_MUTEX_UNLOCK);
+  return (RETURN_OK);
+}
@@ -0,0 +1,96 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef uMod_DECODECACHE_H_
+#define uMod_DECODECACHE_H_
+
+#include "../uMod_GlobalDefines.h"
+#include "uMod_ArrayHandler.h"
+#include "uMod_DDS.h"
+
+/*
+ *  An object of this class is owned by the texture server and shared by all texture clients (devices).
+ *
+ *  It holds the decoded levels of fake textures in system memory, so that a texture, which is created again
+ *  (e.g. after a Reset() or for each original texture with the same hash), is only copied into a new texture.
+ *  An entry is valid for one file content, the file content is identified by the hash and the generation.
+ *
+ *  The entries are ordered by their last use, the least recently used entries are deleted if the budget is exceeded.
+ *  An acquired entry is not deleted before it is released.
+ *
+ *  Reading a texture created by D3DX back is expensive, thus such a texture is only cached, when its file content
+ *  is loaded the second time (FirstLoad() remembers the file contents loaded so far).
+ */
+
+#define uMod_DECODE_CACHE_BUDGET (32u<<20) // 32 MB
+
+typedef struct uMod_DecodedTexture
+{
+  MyTypeHash Hash;
+  unsigned int Generation; // of the file content
+  uMod_DDSLayout Layout; // Layout.Bits point into Data, all levels are available (InFile == Levels)
+  char* Data;
+  unsigned int Size;
+  int Reference; // number of clients, which have acquired this entry
+  int Index; // position in Entries, -1 if the entry was removed while it was acquired
+  struct uMod_DecodedTexture* Prev; // the first entry is the most recently used one
+  struct uMod_DecodedTexture* Next;
+} uMod_DecodedTexture;
+
+
+class uMod_DecodeCache
+{
+public:
+  uMod_DecodeCache(void);
+  ~uMod_DecodeCache(void);
+
+  uMod_DecodedTexture* Acquire( MyTypeHash hash, unsigned int generation, int type); // returns NULL, if the file content is not cached
+  int Release( uMod_DecodedTexture* entry);
+  bool Contains( MyTypeHash hash, unsigned int generation, int type);
+  bool FirstLoad( TextureFileStruct* file); // true, if this file content is loaded the first time (it is remembered from now on)
+
+  uMod_DecodedTexture* NewEntry( TextureFileStruct* file, const uMod_DDSLayout &layout); // allocates the memory for all levels and sets Layout.Bits, the caller fills the levels
+  int Insert( uMod_DecodedTexture* entry); // the cache takes the ownership, an entry of an older file content is replaced
+  static void DeleteEntry( uMod_DecodedTexture* entry);
+
+  int SetBudget( unsigned int bytes);
+  unsigned int GetUsedBytes(void) {return (UsedBytes);}
+
+private:
+  void Unlink( uMod_DecodedTexture* entry); // removes the entry from Entries, Index and the list
+  void Evict(void); // deletes the least recently used entries, which are not acquired, until the budget is met
+
+  int LockMutex();
+  int UnlockMutex();
+  HANDLE Mutex;
+
+  uMod_DecodedTexture** Entries;
+  int NumberOfEntries;
+  int LengthOfEntries;
+  uMod_HashIndex Index; // maps the hash onto the position in Entries
+  uMod_HashIndex Loaded; // maps the hash onto the generation (lower 31 bits) of the last loaded file content
+  uMod_DecodedTexture* First; // most recently used
+  uMod_DecodedTexture* Last; // least recently used
+
+  unsigned int Budget; // in bytes
+  unsigned int UsedBytes;
+};
+
+#endif /* uMod_DECODECACHE_H_ */
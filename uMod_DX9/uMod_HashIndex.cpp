@@ -0,0 +1,178 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Main.h"
+
+
+uMod_HashIndex::uMod_HashIndex(void)
+{
+  Message("uMod_HashIndex(void): %lu\n", this);
+  Slots = NULL;
+  Mask = 0u;
+  Shift = 32u;
+  Size = 0;
+  Number = 0;
+}
+
+uMod_HashIndex::~uMod_HashIndex(void)
+{
+  Message("~uMod_HashIndex(void): %lu\n", this);
+  if (Slots!=NULL) delete [] Slots;
+}
+
+void uMod_HashIndex::Clear(void)
+{
+  Number = 0;
+  if (Slots!=NULL) for (unsigned int i=0u; i<=Mask; i++) Slots[i].Index = -1;
+}
+
+int uMod_HashIndex::Resize( int number)
+{
+  // the table is at most half filled, thus an unsuccessful search stops after very few probes
+  unsigned int bits = 4u;
+  while (bits<30u && (1<<bits) < 2*number) bits++;
+  int size = 1<<bits;
+
+  if (size>Size)
+  {
+    SlotStruct* temp = NULL;
+    try {temp = new SlotStruct[size];}
+    catch (...)
+    {
+      Number = 0;
+      gl_ErrorState |= uMod_ERROR_MEMORY;
+      return (RETURN_NO_MEMORY);
+    }
+    if (Slots!=NULL) delete [] Slots;
+    Slots = temp;
+    Size = size;
+  }
+  Mask = (unsigned int) size - 1u;
+  Shift = 32u - bits;
+  Clear();
+  return (RETURN_OK);
+}
+
+int uMod_HashIndex::Build( MyTypeHash* hashes, int number, int num_index_list, int *index_list)
+{
+  Message("uMod_HashIndex::Build( %lu, %d, %d): %lu\n", hashes, number, num_index_list, this);
+  int num = (index_list!=NULL) ? num_index_list : number;
+
+  if (int ret = Resize( num)) return (ret);
+
+  for (int i=0; i<num; i++)
+  {
+    int index = (index_list!=NULL) ? index_list[i] : i;
+    MyTypeHash hash = hashes[index];
+    unsigned int pos = ((unsigned int) hash * 2654435761u) >> Shift;
+    while (Slots[pos].Index>=0 && Slots[pos].Hash!=hash) pos = (pos+1u) & Mask;
+    if (Slots[pos].Index>=0) continue; // the hash is already indexed, the first entry wins
+    Slots[pos].Hash = hash;
+    Slots[pos].Index = index;
+    Number++;
+  }
+  return (RETURN_OK);
+}
+
+int uMod_HashIndex::Grow( int number)
+{
+  SlotStruct* old = Slots;
+  int old_size = (Slots!=NULL) ? (int) Mask+1 : 0;
+  int old_allocated = Size;
+  int old_number = Number;
+  Slots = NULL; // Resize() must not delete the old table, we still need its entries
+  Size = 0;
+  if (int ret = Resize( number))
+  {
+    Slots = old;
+    Size = old_allocated;
+    Number = old_number;
+    return (ret);
+  }
+  for (int i=0; i<old_size; i++) if (old[i].Index>=0)
+  {
+    unsigned int pos = ((unsigned int) old[i].Hash * 2654435761u) >> Shift;
+    while (Slots[pos].Index>=0) pos = (pos+1u) & Mask;
+    Slots[pos] = old[i];
+    Number++;
+  }
+  if (old!=NULL) delete [] old;
+  return (RETURN_OK);
+}
+
+int uMod_HashIndex::Reserve( int number)
+{
+  if (Slots!=NULL && 2*number <= (int) Mask+1) return (RETURN_OK);
+  return (Grow( number));
+}
+
+int uMod_HashIndex::Insert( MyTypeHash hash, int index)
+{
+  if (Slots==NULL || 2*(Number+1) > (int) Mask+1) // the table would be more than half filled
+  {
+    if (int ret = Grow( 2*(Number+1))) return (ret);
+  }
+
+  unsigned int pos = ((unsigned int) hash * 2654435761u) >> Shift;
+  while (Slots[pos].Index>=0 && Slots[pos].Hash!=hash) pos = (pos+1u) & Mask;
+  if (Slots[pos].Index<0) Number++;
+  Slots[pos].Hash = hash;
+  Slots[pos].Index = index;
+  return (RETURN_OK);
+}
+
+int uMod_HashIndex::Remove( MyTypeHash hash)
+{
+  if (Number==0) return (RETURN_OK);
+  unsigned int pos = ((unsigned int) hash * 2654435761u) >> Shift;
+  while (Slots[pos].Index>=0 && Slots[pos].Hash!=hash) pos = (pos+1u) & Mask;
+  if (Slots[pos].Index<0) return (RETURN_OK); // not indexed
+
+  // Backward shift deletion: the following entries of the cluster are moved into the gap,
+  // if their home slot does not lie cyclically between the gap and their actual slot.
+  unsigned int gap = pos;
+  unsigned int next = (pos+1u) & Mask;
+  while (Slots[next].Index>=0)
+  {
+    unsigned int home = ((unsigned int) Slots[next].Hash * 2654435761u) >> Shift;
+    if (((next - home) & Mask) >= ((next - gap) & Mask))
+    {
+      Slots[gap] = Slots[next];
+      gap = next;
+    }
+    next = (next+1u) & Mask;
+  }
+  Slots[gap].Index = -1;
+  Number--;
+  return (RETURN_OK);
+}
+
+int uMod_HashIndex::Set( MyTypeHash hash, int index)
+{
+  if (Number==0) return (RETURN_TEXTURE_NOT_FOUND);
+  unsigned int pos = ((unsigned int) hash * 2654435761u) >> Shift;
+  while (Slots[pos].Index>=0)
+  {
+    if (Slots[pos].Hash==hash) {Slots[pos].Index = index; return (RETURN_OK);}
+    pos = (pos+1u) & Mask;
+  }
+  return (RETURN_TEXTURE_NOT_FOUND);
+}
+
@@ -0,0 +1,69 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef uMod_HASHINDEX_H_
+#define uMod_HASHINDEX_H_
+
+class uMod_HashIndex  // open addressing hash table (linear probing), which maps the hash of a TextureFileStruct onto its index in an array
+{
+public:
+  uMod_HashIndex(void);
+  ~uMod_HashIndex(void);
+
+  int Build( MyTypeHash* hashes, int number, int num_index_list=0, int *index_list=NULL); // if index_list is given, only these entries of hashes are indexed
+  void Clear(void);
+
+  int Insert( MyTypeHash hash, int index); // the table grows if needed
+  int Reserve( int number); // grows the table in one step, so that number entries can be inserted without rehashing
+  int Remove( MyTypeHash hash);
+  int Set( MyTypeHash hash, int index); // change the index of an already indexed hash
+
+  int Find( MyTypeHash hash) // returns the index or -1
+  {
+    if (Number==0) return (-1);
+    unsigned int pos = ((unsigned int) hash * 2654435761u) >> Shift; // the crc32 is already well distributed, but this protects against clustered hashes
+    while (Slots[pos].Index>=0)
+    {
+      if (Slots[pos].Hash==hash) return (Slots[pos].Index);
+      pos = (pos+1u) & Mask;
+    }
+    return (-1);
+  }
+
+  int GetNumber(void) {return (Number);}
+
+private:
+  typedef struct
+  {
+    MyTypeHash Hash;
+    int Index; // -1 marks an empty slot
+  } SlotStruct; // 8 bytes, thus 8 slots share one cache line
+
+  int Resize( int number); // allocates an empty table for at least number entries
+  int Grow( int number); // rehashes all entries into a table for at least number entries
+
+  SlotStruct* Slots;
+  unsigned int Mask;
+  unsigned int Shift;
+  int Size; // number of allocated slots
+  int Number;
+};
+
+#endif /* uMod_HASHINDEX_H_ */
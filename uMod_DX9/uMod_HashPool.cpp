@@ -0,0 +1,170 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Main.h"
+
+
+uMod_HashPool::uMod_HashPool(void)
+{
+  Message("uMod_HashPool(void): %lu\n", this);
+  NumberOfThreads = 0;
+  Stop = 0;
+  Semaphore = NULL;
+  for (int i=0; i<uMod_HASH_MAX_THREADS; i++) Threads[i] = NULL;
+
+  // the list headers must be aligned
+  Pending = (PSLIST_HEADER) _aligned_malloc( sizeof(SLIST_HEADER), MEMORY_ALLOCATION_ALIGNMENT);
+  Finished = (PSLIST_HEADER) _aligned_malloc( sizeof(SLIST_HEADER), MEMORY_ALLOCATION_ALIGNMENT);
+  if (Pending!=NULL) InitializeSListHead(Pending);
+  if (Finished!=NULL) InitializeSListHead(Finished);
+}
+
+uMod_HashPool::~uMod_HashPool(void)
+{
+  Message("~uMod_HashPool(void): %lu\n", this);
+  Shutdown();
+  if (Semaphore!=NULL) CloseHandle(Semaphore);
+
+  // delete all jobs which are not collected
+  uMod_HashJob* job;
+  if (Pending!=NULL)
+  {
+    while ((job = (uMod_HashJob*) InterlockedPopEntrySList(Pending)) != NULL) DeleteJob(job);
+    _aligned_free(Pending);
+  }
+  if (Finished!=NULL)
+  {
+    while ((job = (uMod_HashJob*) InterlockedPopEntrySList(Finished)) != NULL) DeleteJob(job);
+    _aligned_free(Finished);
+  }
+}
+
+int uMod_HashPool::Start(void)
+{
+  if (NumberOfThreads>0) return (RETURN_OK);
+  if (Pending==NULL || Finished==NULL) return (RETURN_NO_MEMORY);
+
+  // one core is left for the render thread, on a single core machine the hash is calculated directly
+  SYSTEM_INFO info;
+  GetSystemInfo( &info);
+  int num = (int) info.dwNumberOfProcessors - 1;
+  if (num>uMod_HASH_MAX_THREADS) num = uMod_HASH_MAX_THREADS;
+  if (num<=0) return (RETURN_OK);
+
+  Semaphore = CreateSemaphore( NULL, 0, 0x7FFFFFFF, NULL);
+  if (Semaphore==NULL) return (RETURN_FATAL_ERROR);
+
+  for (int i=0; i<num; i++)
+  {
+    Threads[NumberOfThreads] = CreateThread( NULL, 0, WorkerThread, this, 0, NULL);
+    if (Threads[NumberOfThreads]!=NULL) NumberOfThreads++;
+  }
+  Message("uMod_HashPool::Start(): %d threads: %lu\n", NumberOfThreads, this);
+  return (RETURN_OK);
+}
+
+void uMod_HashPool::Shutdown(void)
+{
+  if (NumberOfThreads<=0) return;
+  InterlockedExchange( &Stop, 1);
+  ReleaseSemaphore( Semaphore, NumberOfThreads, NULL); // wake up all workers
+
+  for (int i=0; i<NumberOfThreads; i++)
+  {
+    // on process exit the threads are already terminated, else a worker might still hash a job and push it into Finished
+    DWORD code;
+    if (!GetExitCodeThread( Threads[i], &code) || code==STILL_ACTIVE) WaitForSingleObject( Threads[i], INFINITE);
+    CloseHandle(Threads[i]);
+    Threads[i] = NULL;
+  }
+  NumberOfThreads = 0;
+  Message("uMod_HashPool::Shutdown(): %lu\n", this);
+}
+
+uMod_HashJob* uMod_HashPool::NewJob( void* texture, int type)
+{
+  uMod_HashJob* job = (uMod_HashJob*) _aligned_malloc( sizeof(uMod_HashJob), MEMORY_ALLOCATION_ALIGNMENT);
+  if (job==NULL) return (NULL);
+  job->Entry.Next = NULL;
+  job->Texture = texture;
+  job->Type = type;
+  job->pData = NULL;
+  job->Size = 0u;
+  job->Hash = 0u;
+  return (job);
+}
+
+int uMod_HashPool::Submit( uMod_HashJob* job)
+{
+  InterlockedPushEntrySList( Pending, &job->Entry);
+  ReleaseSemaphore( Semaphore, 1, NULL);
+  return (RETURN_OK);
+}
+
+uMod_HashJob* uMod_HashPool::GetFinished(void)
+{
+  if (Finished==NULL) return (NULL);
+  return ((uMod_HashJob*) InterlockedFlushSList(Finished));
+}
+
+int uMod_HashPool::SetData( uMod_HashJob* job, char* data, unsigned int size)
+{
+  try {job->pData = new char[size];}
+  catch (...)
+  {
+    job->pData = NULL;
+    gl_ErrorState |= uMod_ERROR_MEMORY;
+    return (RETURN_NO_MEMORY);
+  }
+  memcpy( job->pData, data, size);
+  job->Size = size;
+  return (RETURN_OK);
+}
+
+void uMod_HashPool::DeleteJob( uMod_HashJob* job)
+{
+  if (job->pData!=NULL) delete [] job->pData;
+  _aligned_free(job);
+}
+
+DWORD WINAPI uMod_HashPool::WorkerThread( LPVOID lpParam)
+{
+  ((uMod_HashPool*) lpParam)->Work();
+  return (0);
+}
+
+int uMod_HashPool::Work(void)
+{
+  while (1)
+  {
+    WaitForSingleObject( Semaphore, INFINITE);
+    if (Stop) break;
+
+    uMod_HashJob* job = (uMod_HashJob*) InterlockedPopEntrySList(Pending);
+    if (job==NULL) continue;
+
+    job->Hash = GetCRC32( job->pData, job->Size); //calculate the crc32 of the texture
+    delete [] job->pData; // the copy is not needed anymore
+    job->pData = NULL;
+
+    InterlockedPushEntrySList( Finished, &job->Entry);
+  }
+  return (RETURN_OK);
+}
@@ -0,0 +1,94 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef uMod_HASHPOOL_H_
+#define uMod_HASHPOOL_H_
+
+#include "../uMod_GlobalDefines.h"
+
+/*
+ *  An object of this class is owned by each texture client.
+ *
+ *  The render thread only copies the raw data of a newly created texture into a job (uMod_TextureClient::AddTexture(...))
+ *  and pushes it into the pending list. The worker threads calculate the crc32 and push the job into the finished list.
+ *  The render thread collects the finished jobs in uMod_TextureClient::MergeHashes(), which is called from BeginScene().
+ *
+ *  Both lists are lock-free singly linked lists (SLIST) of the windows api.
+ */
+
+#define uMod_HASH_TEXTURE 0
+#define uMod_HASH_VOLUME_TEXTURE 1
+#define uMod_HASH_CUBE_TEXTURE 2
+
+#define uMod_HASH_MIN_SIZE (1<<16) // smaller textures are hashed directly, the hand off would cost more than the hash
+#define uMod_HASH_MAX_THREADS 4
+
+typedef struct uMod_HashJob
+{
+  SLIST_ENTRY Entry; // must be the first member
+  void* Texture; // is set to NULL by the render thread, if the texture is released before the job is finished
+  int Type; // uMod_HASH_TEXTURE, uMod_HASH_VOLUME_TEXTURE or uMod_HASH_CUBE_TEXTURE
+  char* pData; // copy of the raw data of the texture (level 0), deleted by the worker thread
+  unsigned int Size;
+  MyTypeHash Hash;
+} uMod_HashJob;
+
+
+class uMod_HashPool
+{
+public:
+  uMod_HashPool(void);
+  ~uMod_HashPool(void);
+
+  int Start(void); // called from the texture client
+  void Shutdown(void); // waits until all workers have exited, called from the destructor
+  bool IsRunning(void) {return (NumberOfThreads>0);}
+
+  uMod_HashJob* NewJob( void* texture, int type); // called from the render thread
+  int Submit( uMod_HashJob* job); // called from the render thread
+  uMod_HashJob* GetFinished(void); // called from the render thread, returns a linked list (Entry.Next) of all finished jobs
+
+  static int SetData( uMod_HashJob* job, char* data, unsigned int size); // called from GetHash(...) of the textures
+  static void DeleteJob( uMod_HashJob* job);
+
+private:
+  static DWORD WINAPI WorkerThread( LPVOID lpParam);
+  int Work(void); // is executed by each worker thread
+
+  PSLIST_HEADER Pending;
+  PSLIST_HEADER Finished;
+  HANDLE Semaphore;
+  HANDLE Threads[uMod_HASH_MAX_THREADS];
+  int NumberOfThreads;
+  volatile LONG Stop;
+};
+
+
+template <class T>
+inline void CancelHashJob( T* pTexture) // the result of a pending job is discarded
+{
+  if (pTexture->HashJob!=NULL)
+  {
+    pTexture->HashJob->Texture = NULL;
+    pTexture->HashJob = NULL;
+  }
+}
+
+#endif /* uMod_HASHPOOL_H_ */
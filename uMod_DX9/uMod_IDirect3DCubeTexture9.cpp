@@ -24,19 +24,19 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 
 #include "uMod_Main.h"
 
+void *uMod_IDirect3DCubeTexture9::VTable = NULL;
+
 //this function yields for the non switched texture object
 HRESULT APIENTRY uMod_IDirect3DCubeTexture9::QueryInterface(REFIID riid, void** ppvObj)
 {
   if (riid==IID_IDirect3D9)
   {
     // This function should never be called with IID_IDirect3D9 by the game
-    // thus this call comes from our own dll to ask for the texture type
-    // 0x01000000L == uMod_IDirect3DTexture9
-    // 0x01000001L == uMod_IDirect3DVolumeTexture9
-    // 0x01000002L == uMod_IDirect3DCubeTexture9
+    // thus this call comes from our own dll to ask for the texture type (see uMod_TextureType.h),
+    // our dll uses uMod_GetTextureType() instead
 
     *ppvObj = this;
-    return (0x01000002L);
+    return (uMod_TYPE_CUBE_TEXTURE);
   }
   HRESULT hRes;
   if (CrossRef_D3Dtex!=NULL)
@@ -68,14 +68,12 @@ ULONG APIENTRY uMod_IDirect3DCubeTexture9::Release()
 {
   Message("uMod_IDirect3DCubeTexture9::Release(): %lu\n", this);
 
-  void *cpy;
-  long ret = m_D3Ddev->QueryInterface( IID_IDirect3DTexture9, &cpy);
-
   ULONG count;
   if (FAKE)
   {
     UnswitchTextures( this);
-    count = m_D3Dtex->Release(); //count must be zero, cause we don't call AddRef of fake_textures
+    m_D3Dtex->Release(); // the d3d texture might be shared by several fake textures (same hash), it is deleted with the last one
+    count = 0; // but this object is not used anymore
   }
   else
   {
@@ -86,7 +84,7 @@ ULONG APIENTRY uMod_IDirect3DCubeTexture9::Release()
       if (count==0) //if texture is released we switch the textures back
       {
         UnswitchTextures(this);
-        if (ret == 0x01000000L)
+        if (!DeviceEx)
         {
           if (((uMod_IDirect3DDevice9*) m_D3Ddev)->GetSingleCubeTexture()!=fake_texture) fake_texture->Release(); // we release the fake texture
         }
@@ -106,7 +104,7 @@ ULONG APIENTRY uMod_IDirect3DCubeTexture9::Release()
   {
     // if this texture is the LastCreatedTexture, the next time LastCreatedTexture would be added,
     // the hash of a non existing texture would be calculated
-    if (ret == 0x01000000L)
+    if (!DeviceEx)
     {
       if (((uMod_IDirect3DDevice9*) m_D3Ddev)->GetLastCreatedCubeTexture()==this) ((uMod_IDirect3DDevice9*) m_D3Ddev)->SetLastCreatedCubeTexture( NULL);
       else ((uMod_IDirect3DDevice9*) m_D3Ddev)->GetuMod_Client()->RemoveTexture(this); // remove this texture from the texture client
@@ -236,7 +234,7 @@ HRESULT APIENTRY uMod_IDirect3DCubeTexture9::UnlockRect( D3DCUBEMAP_FACES FaceTy
 
 
 
-int uMod_IDirect3DCubeTexture9::GetHash(MyTypeHash &hash)
+int uMod_IDirect3DCubeTexture9::GetHash(MyTypeHash &hash, uMod_HashJob *job)
 {
   hash=0u;
   if (FAKE) return (RETURN_BAD_ARGUMENT);
@@ -336,7 +334,9 @@ int uMod_IDirect3DCubeTexture9::GetHash(MyTypeHash &hash)
 
   int size = (GetBitsFromFormat( desc.Format) * desc.Width*desc.Height)/8;
 
-  hash = GetCRC32( (char*) d3dlr.pBits, size); //calculate the crc32 of the texture
+  int ret = RETURN_OK;
+  if (job!=NULL && size>=uMod_HASH_MIN_SIZE) ret = uMod_HashPool::SetData( job, (char*) d3dlr.pBits, size); // the crc32 is calculated by a worker thread
+  else hash = GetCRC32( (char*) d3dlr.pBits, size); //calculate the crc32 of the texture
 /*
   if (pOffscreenSurface!=NULL)
   {
@@ -358,7 +358,7 @@ int uMod_IDirect3DCubeTexture9::GetHash(MyTypeHash &hash)
   }
 
   Message("uMod_IDirect3DCubeTexture9::GetHash() %#lX (%d %d) %d = %d\n", hash, desc.Width, desc.Height, desc.Format, size);
-  return (RETURN_OK);
+  return (ret);
 }
 
 
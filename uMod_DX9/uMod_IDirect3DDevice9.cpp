@@ -24,6 +24,10 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 #define RETURN_QueryInterface 0x01000000L
 #endif
 
+#ifndef DEVICE_EX
+#define DEVICE_EX false
+#endif
+
 #ifndef PRE_MESSAGE
 #define PRE_MESSAGE "uMod_IDirect3DDevice9"
 #endif
@@ -136,7 +140,7 @@ uMod_IDirect3DDevice9::uMod_IDirect3DDevice9( IDirect3DDevice9* pOriginal, uMod_
   NormalRendering = true;
 
   uMod_Server = server;
-  uMod_Client = new uMod_TextureClient(  uMod_Server, this); //get a new texture client for this device
+  uMod_Client = new uMod_TextureClient(  uMod_Server, this, DEVICE_EX); //get a new texture client for this device
 
   LastCreatedTexture = NULL;
   LastCreatedVolumeTexture = NULL;
@@ -328,7 +332,7 @@ HRESULT uMod_IDirect3DDevice9::CreateTexture(UINT Width,UINT Height,UINT Levels,
 	if(ret != D3D_OK) return (ret);
 
 	//create fake texture
-	uMod_IDirect3DTexture9 *texture  = new uMod_IDirect3DTexture9( ppTexture, this);
+	uMod_IDirect3DTexture9 *texture  = new uMod_IDirect3DTexture9( ppTexture, this, DEVICE_EX);
 	if (texture) *ppTexture = texture;
 	
 	if (LastCreatedTexture!=NULL) //if a texture was loaded before, hopefully this texture contains now the data, so we can add it
@@ -347,7 +351,7 @@ HRESULT uMod_IDirect3DDevice9::CreateVolumeTexture(UINT Width,UINT Height,UINT D
   if(ret != D3D_OK) return (ret);
 
   //create fake texture
-  uMod_IDirect3DVolumeTexture9 *texture  = new uMod_IDirect3DVolumeTexture9( ppVolumeTexture, this);
+  uMod_IDirect3DVolumeTexture9 *texture  = new uMod_IDirect3DVolumeTexture9( ppVolumeTexture, this, DEVICE_EX);
   if (texture) *ppVolumeTexture = texture;
 
   if (LastCreatedVolumeTexture!=NULL) //if a texture was loaded before, hopefully this texture contains now the data, so we can add it
@@ -366,7 +370,7 @@ HRESULT uMod_IDirect3DDevice9::CreateCubeTexture(UINT EdgeLength,UINT Levels,DWO
   if(ret != D3D_OK) return (ret);
 
   //create fake texture
-  uMod_IDirect3DCubeTexture9 *texture  = new uMod_IDirect3DCubeTexture9( ppCubeTexture, this);
+  uMod_IDirect3DCubeTexture9 *texture  = new uMod_IDirect3DCubeTexture9( ppCubeTexture, this, DEVICE_EX);
   if (texture) *ppCubeTexture = texture;
 
   if (LastCreatedCubeTexture!=NULL) //if a texture was loaded before, hopefully this texture contains now the data, so we can add it
@@ -411,18 +415,17 @@ HRESULT uMod_IDirect3DDevice9::UpdateTexture(IDirect3DBaseTexture9* pSourceTextu
   uMod_IDirect3DTexture9* pSource = NULL;
   uMod_IDirect3DVolumeTexture9* pSourceVolume = NULL;
   uMod_IDirect3DCubeTexture9* pSourceCube = NULL;
-  IDirect3DBaseTexture9* cpy;
   if( pSourceTexture != NULL )
   {
-    long int ret = pSourceTexture->QueryInterface( IID_IDirect3D9, (void**) &cpy);
-    switch (ret)
+    switch (uMod_GetTextureType( pSourceTexture))
     {
-      case 0x01000000L:
+      case uMod_TYPE_TEXTURE:
       {
         MyTypeHash hash;
         pSource = (uMod_IDirect3DTexture9*)(pSourceTexture);
         if (pSource->GetHash( hash) == RETURN_OK)
         {
+          CancelHashJob(pSource); // we have the actual hash
           if (hash != pSource->Hash) // this hash has changed !!
           {
             pSource->Hash = hash;
@@ -437,12 +440,13 @@ HRESULT uMod_IDirect3DDevice9::UpdateTexture(IDirect3DBaseTexture9* pSourceTextu
         else pSourceTexture = pSource->m_D3Dtex;
         break;
       }
-      case 0x01000001L:
+      case uMod_TYPE_VOLUME_TEXTURE:
       {
         MyTypeHash hash;
         pSourceVolume = (uMod_IDirect3DVolumeTexture9*)(pSourceTexture);
         if (pSourceVolume->GetHash( hash) == RETURN_OK)
         {
+          CancelHashJob(pSourceVolume); // we have the actual hash
           if (hash != pSourceVolume->Hash) // this hash has changed !!
           {
             pSourceVolume->Hash = hash;
@@ -457,12 +461,13 @@ HRESULT uMod_IDirect3DDevice9::UpdateTexture(IDirect3DBaseTexture9* pSourceTextu
         else pSourceTexture = pSourceVolume->m_D3Dtex;
         break;
       }
-      case 0x01000002L:
+      case uMod_TYPE_CUBE_TEXTURE:
       {
         MyTypeHash hash;
         pSourceCube = (uMod_IDirect3DCubeTexture9*)(pSourceTexture);
         if (pSourceCube->GetHash( hash) == RETURN_OK)
         {
+          CancelHashJob(pSourceCube); // we have the actual hash
           if (hash != pSourceCube->Hash) // this hash has changed !!
           {
             pSourceCube->Hash = hash;
@@ -478,22 +483,22 @@ HRESULT uMod_IDirect3DDevice9::UpdateTexture(IDirect3DBaseTexture9* pSourceTextu
         break;
       }
       default:
-        break; // this is no fake texture and QueryInterface failed, because IDirect3DBaseTexture9 object cannot be a IDirect3D9 object ;)
+        break; // this texture was not created by our device
     }
   }
 
 
   if (pDestinationTexture != NULL)
   {
-    long int ret = pSourceTexture->QueryInterface( IID_IDirect3D9, (void**) &cpy);
-    switch (ret)
+    switch (uMod_GetTextureType( pDestinationTexture))
     {
-      case 0x01000000L:
+      case uMod_TYPE_TEXTURE:
       {
         uMod_IDirect3DTexture9* pDest = (uMod_IDirect3DTexture9*)(pDestinationTexture);
 
         if (pSource!=NULL && pDest->Hash!=pSource->Hash)
         {
+          CancelHashJob(pDest);
           pDest->Hash = pSource->Hash; // take over the hash
           UnswitchTextures(pDest);
           if (pSource->CrossRef_D3Dtex!=NULL)
@@ -507,12 +512,13 @@ HRESULT uMod_IDirect3DDevice9::UpdateTexture(IDirect3DBaseTexture9* pSourceTextu
         else pDestinationTexture = pDest->m_D3Dtex;
         break;
       }
-      case 0x01000001L:
+      case uMod_TYPE_VOLUME_TEXTURE:
       {
         uMod_IDirect3DVolumeTexture9* pDest = (uMod_IDirect3DVolumeTexture9*)(pDestinationTexture);
 
         if (pSourceVolume!=NULL && pDest->Hash!=pSourceVolume->Hash)
         {
+          CancelHashJob(pDest);
           pDest->Hash = pSourceVolume->Hash; // take over the hash
           UnswitchTextures(pDest);
           if (pSourceVolume->CrossRef_D3Dtex!=NULL)
@@ -526,12 +532,13 @@ HRESULT uMod_IDirect3DDevice9::UpdateTexture(IDirect3DBaseTexture9* pSourceTextu
         else pDestinationTexture = pDest->m_D3Dtex;
         break;
       }
-      case 0x01000002L:
+      case uMod_TYPE_CUBE_TEXTURE:
       {
         uMod_IDirect3DCubeTexture9* pDest = (uMod_IDirect3DCubeTexture9*)(pDestinationTexture);
 
         if (pSourceCube!=NULL && pDest->Hash!=pSourceCube->Hash)
         {
+          CancelHashJob(pDest);
           pDest->Hash = pSourceCube->Hash; // take over the hash
           UnswitchTextures(pDest);
           if (pSourceCube->CrossRef_D3Dtex!=NULL)
@@ -622,6 +629,8 @@ HRESULT uMod_IDirect3DDevice9::BeginScene(void)
       uMod_Client->AddTexture( LastCreatedCubeTexture);
     }
     uMod_Client->MergeUpdate(); // merge an update, if present
+    uMod_Client->MergeHashes(); // look up the textures, whose hash was calculated in the meantime
+    uMod_Client->MergeLoads(); // switch the fake textures, which were prepared in the meantime
 
     if (uMod_Client->BoolSaveSingleTexture)
     {
@@ -929,20 +938,18 @@ HRESULT uMod_IDirect3DDevice9::SetTexture(DWORD Stage, IDirect3DBaseTexture9* pT
   // if (dev != this) this texture was not initialized through our device and is thus no fake texture object
 
 	//IDirect3DDevice9 *dev = NULL;
-  IDirect3DBaseTexture9* cpy;
 	if( pTexture != NULL )
 	{
-	  long int ret = pTexture->QueryInterface( IID_IDirect3D9, (void**) &cpy);
-	  switch (ret)
+	  switch (uMod_GetTextureType( pTexture))
 	  {
-	    case 0x01000000L:
+	    case uMod_TYPE_TEXTURE:
 	      pTexture = ((uMod_IDirect3DTexture9*)(pTexture))->m_D3Dtex; break;
-      case 0x01000001L:
+      case uMod_TYPE_VOLUME_TEXTURE:
         pTexture = ((uMod_IDirect3DVolumeTexture9*)(pTexture))->m_D3Dtex; break;
-      case 0x01000002L:
+      case uMod_TYPE_CUBE_TEXTURE:
         pTexture = ((uMod_IDirect3DCubeTexture9*)(pTexture))->m_D3Dtex; break;
 	    default:
-	      break; // this is no fake texture and QueryInterface failed, because IDirect3DBaseTexture9 object cannot be a IDirect3D9 object ;)
+	      break; // this texture was not created by our device
 	  }
 	}
 	/*
@@ -25,6 +25,7 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 #define m_pIDirect3DDevice9 m_pIDirect3DDevice9Ex
 
 #define RETURN_QueryInterface 0x01000001L
+#define DEVICE_EX true
 #define PRE_MESSAGE "uMod_IDirect3DDevice9Ex"
 
 
@@ -33,14 +33,17 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 
 #include "uMod_Defines.h"
 
+struct uMod_HashJob;
+
 
 
 interface uMod_IDirect3DVolumeTexture9 : public IDirect3DVolumeTexture9
 {
-	uMod_IDirect3DVolumeTexture9(IDirect3DVolumeTexture9 **ppTex, IDirect3DDevice9 *pIDirect3DDevice9)
+	uMod_IDirect3DVolumeTexture9(IDirect3DVolumeTexture9 **ppTex, IDirect3DDevice9 *pIDirect3DDevice9, bool device_ex)
 	{
 		m_D3Dtex = *ppTex; //Texture which will be displayed and will be passed to the game
 		m_D3Ddev = pIDirect3DDevice9; //device pointer
+		DeviceEx = device_ex;
 		CrossRef_D3Dtex = NULL; //cross reference
 		// fake texture: store the pointer to the original uMod_IDirect3DVolumeTexture9 object, needed if a fake texture is unselected
 		// original texture: stores the pointer to the fake texture object, is needed if original texture is deleted,
@@ -48,15 +51,21 @@ interface uMod_IDirect3DVolumeTexture9 : public IDirect3DVolumeTexture9
 		Reference = -1; //need for fast deleting
     Hash = 0u;
     FAKE = false;
+    HashJob = NULL;
+    VTable = *(void**) this; // is the same for all objects of this class
 	}
 
 	// callback interface
 	IDirect3DVolumeTexture9 *m_D3Dtex;
 	uMod_IDirect3DVolumeTexture9 *CrossRef_D3Dtex;
 	IDirect3DDevice9 *m_D3Ddev;
+  bool DeviceEx; // m_D3Ddev is a uMod_IDirect3DDevice9Ex object
 	int Reference;
 	MyTypeHash Hash;
   bool FAKE;
+  uMod_HashJob *HashJob; // is set while the hash is calculated by a worker thread
+
+  static void *VTable; // identifies objects of this class, see uMod_GetTextureType()
 
 	// original interface
     STDMETHOD(QueryInterface) (REFIID riid, void** ppvObj);
@@ -83,7 +92,7 @@ interface uMod_IDirect3DVolumeTexture9 : public IDirect3DVolumeTexture9
     STDMETHOD(UnlockBox)(UINT Level);
 
 
-    int GetHash(MyTypeHash &hash);
+    int GetHash(MyTypeHash &hash, uMod_HashJob *job=NULL); // if job!=NULL, the data is copied into the job and the hash is calculated by a worker thread
 };
 
 
@@ -0,0 +1,173 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Main.h"
+
+
+uMod_LoadPool::uMod_LoadPool(void)
+{
+  Message("uMod_LoadPool(void): %lu\n", this);
+  NumberOfThreads = 0;
+  Stop = 0;
+  Semaphore = NULL;
+  for (int i=0; i<uMod_LOAD_MAX_THREADS; i++) Threads[i] = NULL;
+
+  // the list headers must be aligned
+  Pending = (PSLIST_HEADER) _aligned_malloc( sizeof(SLIST_HEADER), MEMORY_ALLOCATION_ALIGNMENT);
+  Finished = (PSLIST_HEADER) _aligned_malloc( sizeof(SLIST_HEADER), MEMORY_ALLOCATION_ALIGNMENT);
+  if (Pending!=NULL) InitializeSListHead(Pending);
+  if (Finished!=NULL) InitializeSListHead(Finished);
+}
+
+uMod_LoadPool::~uMod_LoadPool(void)
+{
+  Message("~uMod_LoadPool(void): %lu\n", this);
+  Shutdown();
+  if (Semaphore!=NULL) CloseHandle(Semaphore);
+
+  // delete all jobs which are not collected
+  uMod_LoadJob* job;
+  if (Pending!=NULL)
+  {
+    while ((job = (uMod_LoadJob*) InterlockedPopEntrySList(Pending)) != NULL) DeleteJob(job);
+    _aligned_free(Pending);
+  }
+  if (Finished!=NULL)
+  {
+    while ((job = (uMod_LoadJob*) InterlockedPopEntrySList(Finished)) != NULL) DeleteJob(job);
+    _aligned_free(Finished);
+  }
+}
+
+int uMod_LoadPool::Start(void)
+{
+  if (NumberOfThreads>0) return (RETURN_OK);
+  if (Pending==NULL || Finished==NULL) return (RETURN_NO_MEMORY);
+
+  // one core is left for the render thread, on a single core machine the fake textures are loaded directly
+  SYSTEM_INFO info;
+  GetSystemInfo( &info);
+  int num = (int) info.dwNumberOfProcessors - 1;
+  if (num>uMod_LOAD_MAX_THREADS) num = uMod_LOAD_MAX_THREADS;
+  if (num<=0) return (RETURN_OK);
+
+  Semaphore = CreateSemaphore( NULL, 0, 0x7FFFFFFF, NULL);
+  if (Semaphore==NULL) return (RETURN_FATAL_ERROR);
+
+  for (int i=0; i<num; i++)
+  {
+    Threads[NumberOfThreads] = CreateThread( NULL, 0, WorkerThread, this, 0, NULL);
+    if (Threads[NumberOfThreads]!=NULL) NumberOfThreads++;
+  }
+  Message("uMod_LoadPool::Start(): %d threads: %lu\n", NumberOfThreads, this);
+  return (RETURN_OK);
+}
+
+void uMod_LoadPool::Shutdown(void)
+{
+  if (NumberOfThreads<=0) return;
+  InterlockedExchange( &Stop, 1);
+  ReleaseSemaphore( Semaphore, NumberOfThreads, NULL); // wake up all workers
+
+  for (int i=0; i<NumberOfThreads; i++)
+  {
+    // on process exit the threads are already terminated, else a worker might still stage a job (it reads the file content)
+    DWORD code;
+    if (!GetExitCodeThread( Threads[i], &code) || code==STILL_ACTIVE) WaitForSingleObject( Threads[i], INFINITE);
+    CloseHandle(Threads[i]);
+    Threads[i] = NULL;
+  }
+  NumberOfThreads = 0;
+  Message("uMod_LoadPool::Shutdown(): %lu\n", this);
+}
+
+uMod_LoadJob* uMod_LoadPool::NewJob( void* texture, TextureFileStruct* file)
+{
+  uMod_LoadJob* job = (uMod_LoadJob*) _aligned_malloc( sizeof(uMod_LoadJob), MEMORY_ALLOCATION_ALIGNMENT);
+  if (job==NULL) return (NULL);
+  job->Entry.Next = NULL;
+  job->Texture = texture;
+  job->Hash = file->Hash;
+  job->pData = file->pData;
+  job->Size = file->Size;
+  job->Staged = false;
+  job->Staging = NULL;
+  job->Version = 0;
+  job->Next = NULL;
+  job->Older = NULL;
+  job->Newer = NULL;
+  return (job);
+}
+
+int uMod_LoadPool::Submit( uMod_LoadJob* job)
+{
+  InterlockedPushEntrySList( Pending, &job->Entry);
+  ReleaseSemaphore( Semaphore, 1, NULL);
+  return (RETURN_OK);
+}
+
+uMod_LoadJob* uMod_LoadPool::GetFinished(void)
+{
+  if (Finished==NULL) return (NULL);
+  return ((uMod_LoadJob*) InterlockedFlushSList(Finished));
+}
+
+void uMod_LoadPool::DeleteJob( uMod_LoadJob* job)
+{
+  if (job->Staging!=NULL) delete [] job->Staging;
+  _aligned_free(job);
+}
+
+DWORD WINAPI uMod_LoadPool::WorkerThread( LPVOID lpParam)
+{
+  ((uMod_LoadPool*) lpParam)->Work();
+  return (0);
+}
+
+int uMod_LoadPool::Work(void)
+{
+  while (1)
+  {
+    WaitForSingleObject( Semaphore, INFINITE);
+    if (Stop) break;
+
+    uMod_LoadJob* job = (uMod_LoadJob*) InterlockedPopEntrySList(Pending);
+    if (job==NULL) continue;
+
+    // the job is not staged, if the file needs D3DX (no dds, no power of two, conversion, ...)
+    if (job->Texture!=NULL) job->Staged = (Stage( job)==RETURN_OK);
+
+    InterlockedPushEntrySList( Finished, &job->Entry);
+  }
+  return (RETURN_OK);
+}
+
+int uMod_LoadPool::Stage( uMod_LoadJob* job)
+{
+  if (int ret = uMod_ParseDDS( job->pData, job->Size, job->Layout)) return (ret);
+  if (job->Layout.Type!=uMod_DDS_TEXTURE) return (RETURN_TEXTURE_NOT_LOADED);
+
+  unsigned int size = uMod_GetStagingSize( job->Layout);
+  if (size==0u) return (RETURN_OK);
+  try {job->Staging = new char[size];}
+  catch (...) {job->Staging = NULL; return (RETURN_NO_MEMORY);}
+  uMod_GenerateMipMaps( job->Layout, job->Staging);
+  return (RETURN_OK);
+}
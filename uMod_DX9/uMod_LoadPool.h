@@ -0,0 +1,106 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef uMod_LOADPOOL_H_
+#define uMod_LOADPOOL_H_
+
+#include "../uMod_GlobalDefines.h"
+#include "uMod_ArrayHandler.h"
+#include "uMod_DDS.h"
+
+/*
+ *  An object of this class is owned by each texture client.
+ *
+ *  If a texture should be modded, the render thread only pushes a job into the pending list
+ *  (uMod_TextureClient::LookUpToMod(...)) and the original texture stays visible.
+ *  The worker threads parse the dds file and prepare the missing mipmap levels in system memory.
+ *  The render thread collects the finished jobs in uMod_TextureClient::MergeLoads(), which is called from BeginScene(),
+ *  and creates and switches the fake textures until uMod_LOAD_BUDGET is used up, the rest waits for the next frame.
+ *
+ *  Jobs of files, which cannot be copied directly into a texture, are not staged (Staged==false),
+ *  their fake texture is created by D3DX on the render thread.
+ *
+ *  A job references the file content of the client, thus the client does not acknowledge a new version to the server
+ *  as long as jobs are in flight, and the client shuts down the pool before it is removed from the server.
+ */
+
+#define uMod_LOAD_MAX_THREADS 2
+#define uMod_LOAD_BUDGET 4 // in ms, time per frame for the creation of fake textures (at least one texture is created per frame)
+
+typedef struct uMod_LoadJob
+{
+  SLIST_ENTRY Entry; // must be the first member
+  void* Texture; // the original texture, is set to NULL by the render thread, if the texture is released or looked up again
+  MyTypeHash Hash;
+  char* pData; // file content (not a copy), as long as the job is in flight the client does not acknowledge a newer version than Version
+  unsigned int Size;
+  int Version; // merged version of the client, when the job was submitted (pData is valid in this version)
+
+  // is filled by the worker thread
+  bool Staged; // the levels can be copied directly into a texture
+  uMod_DDSLayout Layout; // points into pData or into Staging
+  char* Staging; // mipmap levels, which are not stored in the file
+  struct uMod_LoadJob* Next; // the ready queue of the render thread
+  struct uMod_LoadJob* Older; // list of the jobs in flight (only used by the render thread), ordered by Version
+  struct uMod_LoadJob* Newer;
+} uMod_LoadJob;
+
+
+class uMod_LoadPool
+{
+public:
+  uMod_LoadPool(void);
+  ~uMod_LoadPool(void);
+
+  int Start(void); // called from the texture client
+  void Shutdown(void); // waits until all workers have exited, called from the destructor of the texture client before the file content is released
+  bool IsRunning(void) {return (NumberOfThreads>0);}
+
+  uMod_LoadJob* NewJob( void* texture, TextureFileStruct* file); // called from the render thread
+  int Submit( uMod_LoadJob* job); // called from the render thread
+  uMod_LoadJob* GetFinished(void); // called from the render thread, returns a linked list (Entry.Next) of all finished jobs
+
+  static void DeleteJob( uMod_LoadJob* job);
+
+private:
+  static DWORD WINAPI WorkerThread( LPVOID lpParam);
+  int Work(void); // is executed by each worker thread
+  static int Stage( uMod_LoadJob* job); // parses the dds file (uMod_ParseDDS()) and generates the missing mipmap levels
+
+  PSLIST_HEADER Pending;
+  PSLIST_HEADER Finished;
+  HANDLE Semaphore;
+  HANDLE Threads[uMod_LOAD_MAX_THREADS];
+  int NumberOfThreads;
+  volatile LONG Stop;
+};
+
+
+template <class T>
+inline void CancelLoadJob( T* pTexture) // the result of a pending job is discarded
+{
+  if (pTexture->LoadJob!=NULL)
+  {
+    pTexture->LoadJob->Texture = NULL;
+    pTexture->LoadJob = NULL;
+  }
+}
+
+#endif /* uMod_LOADPOOL_H_ */
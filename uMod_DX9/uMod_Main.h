@@ -41,10 +41,13 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 
 
 #include "../uMod_GlobalDefines.h"
+#include "../uMod_FrameDecoder.h"
 #include "../uMod_Error.h"
 #include "uMod_Defines.h"
 #include "uMod_DX9_dll.h"
 #include "uMod_TextureFunction.h"
+#include "uMod_HashPool.h"
+#include "uMod_PayloadArena.h"
 
 #include "uMod_IDirect3D9.h"
 #include "uMod_IDirect3D9Ex.h"
@@ -55,8 +58,11 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 #include "uMod_IDirect3DCubeTexture9.h"
 #include "uMod_IDirect3DTexture9.h"
 #include "uMod_IDirect3DVolumeTexture9.h"
+#include "uMod_TextureType.h"
 
 #include "uMod_ArrayHandler.h"
+#include "uMod_LoadPool.h"
+#include "uMod_DecodeCache.h"
 #include "uMod_TextureServer.h"
 #include "uMod_TextureClient.h"
 
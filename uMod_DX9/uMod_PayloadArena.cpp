@@ -0,0 +1,130 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Main.h"
+
+
+uMod_Slab* NewSlab( unsigned int size, bool mapped)
+{
+  uMod_Slab* slab = NULL;
+  try {slab = new uMod_Slab;}
+  catch (...)
+  {
+    gl_ErrorState |= uMod_ERROR_MEMORY;
+    return (NULL);
+  }
+
+  slab->Reference = 1;
+  slab->Mapped = mapped;
+  slab->Section = NULL;
+  slab->Size = size;
+  if (mapped)
+  {
+    slab->Data = (char*) VirtualAlloc( NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE); // page aligned
+  }
+  else
+  {
+    try {slab->Data = new char[size];}
+    catch (...) {slab->Data = NULL;}
+  }
+
+  if (slab->Data==NULL)
+  {
+    delete slab;
+    gl_ErrorState |= uMod_ERROR_MEMORY;
+    return (NULL);
+  }
+  Message("NewSlab( %u, %d): %lu\n", size, mapped, slab);
+  return (slab);
+}
+
+void AddRefSlab( uMod_Slab* slab)
+{
+  if (slab!=NULL) InterlockedIncrement( &slab->Reference);
+}
+
+void ReleaseSlab( uMod_Slab* slab)
+{
+  if (slab==NULL) return;
+  if (InterlockedDecrement( &slab->Reference) > 0) return;
+
+  Message("ReleaseSlab( %u, %d): %lu\n", slab->Size, slab->Mapped, slab);
+  if (slab->Section!=NULL)
+  {
+    UnmapViewOfFile( slab->Data);
+    CloseHandle( slab->Section);
+  }
+  else if (slab->Mapped) VirtualFree( slab->Data, 0, MEM_RELEASE);
+  else delete [] slab->Data;
+  delete slab;
+}
+
+void TrimSlab( uMod_Slab* slab, unsigned int used)
+{
+  if (slab==NULL || !slab->Mapped || slab->Section!=NULL) return;
+
+  static unsigned int page_size = 0u;
+  if (page_size==0u)
+  {
+    SYSTEM_INFO info;
+    GetSystemInfo( &info);
+    page_size = info.dwPageSize;
+  }
+
+  used = (used + page_size - 1u) / page_size * page_size;
+  if (used>=slab->Size) return;
+  VirtualFree( slab->Data + used, slab->Size - used, MEM_DECOMMIT); // the address space stays reserved, but the memory is returned
+  slab->Size = used;
+}
+
+uMod_Slab* OpenSharedSlab( const wchar_t* name, unsigned int size)
+{
+  if (name==NULL || size==0u) return (NULL);
+  HANDLE section = OpenFileMappingW( FILE_MAP_READ, FALSE, name);
+  if (section==NULL)
+  {
+    Message("OpenSharedSlab( %ls): OpenFileMappingW failed\n", name);
+    return (NULL);
+  }
+
+  uMod_Slab* slab = NULL;
+  try {slab = new uMod_Slab;}
+  catch (...)
+  {
+    CloseHandle( section);
+    gl_ErrorState |= uMod_ERROR_MEMORY;
+    return (NULL);
+  }
+
+  slab->Data = (char*) MapViewOfFile( section, FILE_MAP_READ, 0, 0, size);
+  if (slab->Data==NULL)
+  {
+    Message("OpenSharedSlab( %ls, %u): MapViewOfFile failed\n", name, size);
+    CloseHandle( section);
+    delete slab;
+    return (NULL);
+  }
+  slab->Reference = 1;
+  slab->Mapped = false;
+  slab->Section = section;
+  slab->Size = size;
+  Message("OpenSharedSlab( %ls, %u): %lu\n", name, size, slab);
+  return (slab);
+}
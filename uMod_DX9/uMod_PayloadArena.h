@@ -0,0 +1,58 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef uMod_PAYLOADARENA_H_
+#define uMod_PAYLOADARENA_H_
+
+#include "../uMod_GlobalDefines.h"
+#include "../uMod_SharedRegion.h"
+
+/*
+ *  The file content of the textures is held in reference counted slabs.
+ *
+ *  The server thread reads each message from the pipe directly into a slab (uMod_TextureServer::MainLoop()),
+ *  the TextureFileStruct::pData of the textures point into this slab, thus the file content is never copied.
+ *  Each TextureFileStruct holds one reference and the pipe reader holds one reference as long as it uses the slab.
+ *  The slab is freed when the last reference is released (the last texture in it is freed by the garbage collection of the server).
+ *
+ *  Slabs for the pipe are allocated with VirtualAlloc (page aligned), the unused pages at the end are decommitted after
+ *  the message is read. Small slabs (e.g. for a single file loaded from disk) are allocated on the heap.
+ *
+ *  A slab can also be a view of a shared memory region of uMod_GUI (OpenSharedSlab()), in that case
+ *  uMod_GUI writes the file content directly into the region and only its position is sent over the pipe.
+ */
+
+typedef struct uMod_Slab
+{
+  volatile LONG Reference;
+  bool Mapped; // allocated with VirtualAlloc
+  HANDLE Section; // not NULL, if Data is a view of a shared region
+  unsigned int Size; // size of Data
+  char* Data;
+} uMod_Slab;
+
+
+uMod_Slab* NewSlab( unsigned int size, bool mapped); // the slab is returned with one reference
+void AddRefSlab( uMod_Slab* slab);
+void ReleaseSlab( uMod_Slab* slab);
+void TrimSlab( uMod_Slab* slab, unsigned int used); // decommits the unused pages of a mapped slab, the slab must not grow afterwards
+uMod_Slab* OpenSharedSlab( const wchar_t* name, unsigned int size); // maps the shared region (read only), the slab is returned with one reference
+
+#endif /* uMod_PAYLOADARENA_H_ */
@@ -21,11 +21,12 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 #include "uMod_Main.h"
 
 
-uMod_TextureClient::uMod_TextureClient(uMod_TextureServer* server, IDirect3DDevice9* device)
+uMod_TextureClient::uMod_TextureClient(uMod_TextureServer* server, IDirect3DDevice9* device, bool device_ex)
 {
   Message("uMod_TextureClient::uMod_TextureClient(void): %lu\n", this);
   Server = server;
   D3D9Device = device;
+  DeviceEx = device_ex;
   BoolSaveAllTextures = false;
   BoolSaveSingleTexture = false;
   KeyBack = 0;
@@ -35,25 +36,49 @@ uMod_TextureClient::uMod_TextureClient(uMod_TextureServer* server, IDirect3DDevi
   GameName[0]=0;
 
   NumberToMod = 0;
+  LengthToMod = 0;
   FileToMod = NULL;
+  FileToModHash = NULL;
+  FileToModTextures = NULL;
+  Version = 0;
+  MergedVersion = 0; // the server might read it, before AddClient() returns
 
   if (Server!=NULL)
   {
-    if (Server->AddClient( this, &FileToMod, &NumberToMod))
+    if (Server->AddClient( this, &FileToMod, &NumberToMod, &Version))
     {
       Server=NULL;
       NumberToMod = 0;
       FileToMod = NULL;
     }
-    else
+    else if (NewColumns( FileToMod, NumberToMod, FileToModHash, FileToModTextures))
     {
-      for (int i=0; i<NumberToMod; i++) {FileToMod[i].NumberOfTextures=0; FileToMod[i].Textures = NULL;}
+      if (FileToMod!=NULL) delete [] FileToMod;
+      NumberToMod = 0;
+      FileToMod = NULL;
     }
+    else FileToModIndex.Build( FileToModHash, NumberToMod);
   }
+  LengthToMod = NumberToMod;
+  InterlockedExchange( &MergedVersion, Version);
   Mutex = CreateMutex(NULL, false, NULL);
+  HashPool.Start();
+  LoadPool.Start();
+  LoadsInFlight = 0;
+  ReadyFirst = NULL;
+  ReadyLast = NULL;
+  OldestLoad = NULL;
+  NewestLoad = NULL;
 
   Update = NULL;
+  UpdateHash = NULL;
+  UpdateTextures = NULL;
   NumberOfUpdate = -1;
+  UpdateVersion = 0;
+  Delta = NULL;
+  NumberOfDelta = -1;
+  DeltaVersion = 0;
+  MergedDelta = 0;
   FontColour = D3DCOLOR_ARGB(255,255,0,0);
   TextureColour = D3DCOLOR_ARGB(255,0,255,0);
 }
@@ -61,24 +86,35 @@ uMod_TextureClient::uMod_TextureClient(uMod_TextureServer* server, IDirect3DDevi
 uMod_TextureClient::~uMod_TextureClient(void)
 {
   Message("uMod_TextureClient::~uMod_TextureClient(void): %lu\n", this);
+  LoadPool.Shutdown(); // the workers read the file content, which the server may free, as soon as we are removed
   if (Server!=NULL) Server->RemoveClient(this);
 
   if (Mutex!=NULL) CloseHandle(Mutex);
 
+  while (ReadyFirst!=NULL)
+  {
+    uMod_LoadJob *job = ReadyFirst;
+    ReadyFirst = job->Next;
+    uMod_LoadPool::DeleteJob(job);
+  }
+
   if (Update!=NULL) delete [] Update;
-  if (FileToMod!=NULL)
+  if (UpdateHash!=NULL) delete [] UpdateHash;
+  if (UpdateTextures!=NULL) delete [] UpdateTextures;
+  if (Delta!=NULL) delete [] Delta;
+  if (FileToMod!=NULL) delete [] FileToMod;
+  if (FileToModHash!=NULL) delete [] FileToModHash;
+  if (FileToModTextures!=NULL)
   {
-    for (int i=0; i<NumberToMod; i++) if (FileToMod[i].Textures!=NULL) delete [] FileToMod[i].Textures;
-    delete [] FileToMod;
+    for (int i=0; i<NumberToMod; i++) if (FileToModTextures[i].Textures!=NULL) delete [] FileToModTextures[i].Textures;
+    delete [] FileToModTextures;
   }
 }
 
 
 int uMod_TextureClient::AddTexture( uMod_IDirect3DTexture9* pTexture)
 {
-  void *cpy;
-  long ret = D3D9Device->QueryInterface( IID_IDirect3DTexture9, &cpy);
-  if (ret == 0x01000000L) ((uMod_IDirect3DDevice9*)D3D9Device)->SetLastCreatedTexture(NULL); //this texture must no be added twice
+  if (!DeviceEx) ((uMod_IDirect3DDevice9*)D3D9Device)->SetLastCreatedTexture(NULL); //this texture must no be added twice
   else  ((uMod_IDirect3DDevice9Ex*) D3D9Device)->SetLastCreatedTexture(NULL); //this texture must no be added twice
 
   if (pTexture->FAKE) return (RETURN_OK); // this is a fake texture
@@ -86,7 +122,21 @@ int uMod_TextureClient::AddTexture( uMod_IDirect3DTexture9* pTexture)
   Message("uMod_TextureClient::AddTexture( %lu): %lu (thread: %lu)\n", pTexture, this, GetCurrentThreadId());
 
   MyTypeHash hash;
-  if (int ret = pTexture->GetHash( hash)) return (ret);
+  if (HashPool.IsRunning() && !BoolSaveAllTextures) // the crc32 is calculated by a worker thread
+  {
+    uMod_HashJob *job = HashPool.NewJob( pTexture, uMod_HASH_TEXTURE);
+    if (job==NULL) {gl_ErrorState |= uMod_ERROR_MEMORY; return (RETURN_NO_MEMORY);}
+    if (int ret = pTexture->GetHash( hash, job)) {uMod_HashPool::DeleteJob(job); return (ret);}
+    if (job->pData!=NULL)
+    {
+      if (gl_ErrorState & uMod_ERROR_FATAL) {uMod_HashPool::DeleteJob(job); return (RETURN_FATAL_ERROR);}
+      pTexture->HashJob = job;
+      OriginalTextures.Add( pTexture); // add the texture to the list of original texture
+      return (HashPool.Submit( job)); // LookUpToMod(...) is called from MergeHashes(), when the hash is calculated
+    }
+    uMod_HashPool::DeleteJob(job); // the texture is small and the hash was calculated directly
+  }
+  else if (int ret = pTexture->GetHash( hash)) return (ret);
 
   pTexture->Hash = hash;
 
@@ -101,9 +151,7 @@ int uMod_TextureClient::AddTexture( uMod_IDirect3DTexture9* pTexture)
 
 int uMod_TextureClient::AddTexture( uMod_IDirect3DVolumeTexture9* pTexture)
 {
-  void *cpy;
-  long ret = D3D9Device->QueryInterface( IID_IDirect3DTexture9, &cpy);
-  if (ret == 0x01000000L) ((uMod_IDirect3DDevice9*)D3D9Device)->SetLastCreatedVolumeTexture(NULL); //this texture must no be added twice
+  if (!DeviceEx) ((uMod_IDirect3DDevice9*)D3D9Device)->SetLastCreatedVolumeTexture(NULL); //this texture must no be added twice
   else  ((uMod_IDirect3DDevice9Ex*) D3D9Device)->SetLastCreatedVolumeTexture(NULL); //this texture must no be added twice
 
   if (pTexture->FAKE) return (RETURN_OK); // this is a fake texture
@@ -111,7 +159,21 @@ int uMod_TextureClient::AddTexture( uMod_IDirect3DVolumeTexture9* pTexture)
   Message("uMod_TextureClient::AddTexture( Volume: %lu): %lu (thread: %lu)\n", pTexture, this, GetCurrentThreadId());
 
   MyTypeHash hash;
-  if (int ret = pTexture->GetHash( hash)) return (ret);
+  if (HashPool.IsRunning() && !BoolSaveAllTextures) // the crc32 is calculated by a worker thread
+  {
+    uMod_HashJob *job = HashPool.NewJob( pTexture, uMod_HASH_VOLUME_TEXTURE);
+    if (job==NULL) {gl_ErrorState |= uMod_ERROR_MEMORY; return (RETURN_NO_MEMORY);}
+    if (int ret = pTexture->GetHash( hash, job)) {uMod_HashPool::DeleteJob(job); return (ret);}
+    if (job->pData!=NULL)
+    {
+      if (gl_ErrorState & uMod_ERROR_FATAL) {uMod_HashPool::DeleteJob(job); return (RETURN_FATAL_ERROR);}
+      pTexture->HashJob = job;
+      OriginalVolumeTextures.Add( pTexture); // add the texture to the list of original texture
+      return (HashPool.Submit( job)); // LookUpToMod(...) is called from MergeHashes(), when the hash is calculated
+    }
+    uMod_HashPool::DeleteJob(job); // the texture is small and the hash was calculated directly
+  }
+  else if (int ret = pTexture->GetHash( hash)) return (ret);
 
   pTexture->Hash = hash;
 
@@ -126,9 +188,7 @@ int uMod_TextureClient::AddTexture( uMod_IDirect3DVolumeTexture9* pTexture)
 
 int uMod_TextureClient::AddTexture( uMod_IDirect3DCubeTexture9* pTexture)
 {
-  void *cpy;
-  long ret = D3D9Device->QueryInterface( IID_IDirect3DTexture9, &cpy);
-  if (ret == 0x01000000L) ((uMod_IDirect3DDevice9*)D3D9Device)->SetLastCreatedCubeTexture(NULL); //this texture must no be added twice
+  if (!DeviceEx) ((uMod_IDirect3DDevice9*)D3D9Device)->SetLastCreatedCubeTexture(NULL); //this texture must no be added twice
   else  ((uMod_IDirect3DDevice9Ex*) D3D9Device)->SetLastCreatedCubeTexture(NULL); //this texture must no be added twice
 
   if (pTexture->FAKE) return (RETURN_OK); // this is a fake texture
@@ -136,7 +196,21 @@ int uMod_TextureClient::AddTexture( uMod_IDirect3DCubeTexture9* pTexture)
   Message("uMod_TextureClient::AddTexture( Cube: %lu): %lu (thread: %lu)\n", pTexture, this, GetCurrentThreadId());
 
   MyTypeHash hash;
-  if (int ret = pTexture->GetHash( hash)) return (ret);
+  if (HashPool.IsRunning() && !BoolSaveAllTextures) // the crc32 is calculated by a worker thread
+  {
+    uMod_HashJob *job = HashPool.NewJob( pTexture, uMod_HASH_CUBE_TEXTURE);
+    if (job==NULL) {gl_ErrorState |= uMod_ERROR_MEMORY; return (RETURN_NO_MEMORY);}
+    if (int ret = pTexture->GetHash( hash, job)) {uMod_HashPool::DeleteJob(job); return (ret);}
+    if (job->pData!=NULL)
+    {
+      if (gl_ErrorState & uMod_ERROR_FATAL) {uMod_HashPool::DeleteJob(job); return (RETURN_FATAL_ERROR);}
+      pTexture->HashJob = job;
+      OriginalCubeTextures.Add( pTexture); // add the texture to the list of original texture
+      return (HashPool.Submit( job)); // LookUpToMod(...) is called from MergeHashes(), when the hash is calculated
+    }
+    uMod_HashPool::DeleteJob(job); // the texture is small and the hash was calculated directly
+  }
+  else if (int ret = pTexture->GetHash( hash)) return (ret);
 
   pTexture->Hash = hash;
 
@@ -162,17 +236,19 @@ int uMod_TextureClient::RemoveTexture( uMod_IDirect3DTexture9* pTexture) // is c
     int ref = pTexture->Reference;
     if (ref>=0 && ref<NumberToMod)
     {
-      for (int i=0; i<FileToMod[ref].NumberOfTextures; i++) if (FileToMod[ref].Textures[i] == pTexture)
+      for (int i=0; i<FileToModTextures[ref].Number; i++) if (FileToModTextures[ref].Textures[i] == pTexture)
       {
-        FileToMod[ref].NumberOfTextures--;
-        for (int j=i; j<FileToMod[ref].NumberOfTextures; j++) FileToMod[ref].Textures[j] = FileToMod[ref].Textures[j+1];
-        FileToMod[ref].Textures[FileToMod[ref].NumberOfTextures] = NULL;
+        FileToModTextures[ref].Number--;
+        FileToModTextures[ref].Textures[i] = FileToModTextures[ref].Textures[FileToModTextures[ref].Number]; // the order does not matter
+        FileToModTextures[ref].Textures[FileToModTextures[ref].Number] = NULL;
         break;
       }
     }
   }
   else
   {
+    CancelHashJob(pTexture); // the texture object is deleted, the worker thread must not report a hash for it
+    CancelLoadJob(pTexture); // and the fake texture must not be created
     return (OriginalTextures.Remove( pTexture)); //remove this texture form the list
   }
   return (RETURN_OK);
@@ -189,17 +265,18 @@ int uMod_TextureClient::RemoveTexture( uMod_IDirect3DVolumeTexture9* pTexture) /
     int ref = pTexture->Reference;
     if (ref>=0 && ref<NumberToMod)
     {
-      for (int i=0; i<FileToMod[ref].NumberOfTextures; i++) if (FileToMod[ref].Textures[i] == pTexture)
+      for (int i=0; i<FileToModTextures[ref].Number; i++) if (FileToModTextures[ref].Textures[i] == pTexture)
       {
-        FileToMod[ref].NumberOfTextures--;
-        for (int j=i; j<FileToMod[ref].NumberOfTextures; j++) FileToMod[ref].Textures[j] = FileToMod[ref].Textures[j+1];
-        FileToMod[ref].Textures[FileToMod[ref].NumberOfTextures] = NULL;
+        FileToModTextures[ref].Number--;
+        FileToModTextures[ref].Textures[i] = FileToModTextures[ref].Textures[FileToModTextures[ref].Number]; // the order does not matter
+        FileToModTextures[ref].Textures[FileToModTextures[ref].Number] = NULL;
         break;
       }
     }
   }
   else
   {
+    CancelHashJob(pTexture); // the texture object is deleted, the worker thread must not report a hash for it
     return (OriginalVolumeTextures.Remove( pTexture)); //remove this texture form the list
   }
   return (RETURN_OK);
@@ -216,17 +293,18 @@ int uMod_TextureClient::RemoveTexture( uMod_IDirect3DCubeTexture9* pTexture) //
     int ref = pTexture->Reference;
     if (ref>=0 && ref<NumberToMod)
     {
-      for (int i=0; i<FileToMod[ref].NumberOfTextures; i++) if (FileToMod[ref].Textures[i] == pTexture)
+      for (int i=0; i<FileToModTextures[ref].Number; i++) if (FileToModTextures[ref].Textures[i] == pTexture)
       {
-        FileToMod[ref].NumberOfTextures--;
-        for (int j=i; j<FileToMod[ref].NumberOfTextures; j++) FileToMod[ref].Textures[j] = FileToMod[ref].Textures[j+1];
-        FileToMod[ref].Textures[FileToMod[ref].NumberOfTextures] = NULL;
+        FileToModTextures[ref].Number--;
+        FileToModTextures[ref].Textures[i] = FileToModTextures[ref].Textures[FileToModTextures[ref].Number]; // the order does not matter
+        FileToModTextures[ref].Textures[FileToModTextures[ref].Number] = NULL;
         break;
       }
     }
   }
   else
   {
+    CancelHashJob(pTexture); // the texture object is deleted, the worker thread must not report a hash for it
     return (OriginalCubeTextures.Remove( pTexture)); //remove this texture form the list
   }
   return (RETURN_OK);
@@ -246,9 +324,7 @@ int uMod_TextureClient::SaveSingleTexture(bool val)
   if (BoolSaveSingleTexture && !val) //if BoolSaveSingleTexture is set to false and was previously true we switch the SingleTexture back
   {
     uMod_IDirect3DTexture9* pTexture;
-    void *cpy;
-    long ret = D3D9Device->QueryInterface( IID_IDirect3DTexture9, &cpy);
-    if (ret == 0x01000000L) pTexture = ((uMod_IDirect3DDevice9*)D3D9Device)->GetSingleTexture(); //this texture must no be added twice
+    if (!DeviceEx) pTexture = ((uMod_IDirect3DDevice9*)D3D9Device)->GetSingleTexture(); //this texture must no be added twice
     else pTexture = ((uMod_IDirect3DDevice9Ex*) D3D9Device)->GetSingleTexture(); //this texture must no be added twice
 
     if (pTexture!=NULL) UnswitchTextures(pTexture);
@@ -333,464 +409,1093 @@ int uMod_TextureClient::SaveTexture(uMod_IDirect3DCubeTexture9* pTexture)
 
 
 
-int uMod_TextureClient::AddUpdate(TextureFileStruct* update, int number)  //client must delete the update array
+int uMod_TextureClient::AddUpdate(TextureFileStruct* update, int number, int version)  //client must delete the update array
 {
-  Message("AddUpdate( %lu, %d): %lu\n", update, number, this);
-  if (int ret = LockMutex()) {gl_ErrorState |= uMod_ERROR_TEXTURE; return (ret);}
+  Message("AddUpdate( %lu, %d, %d): %lu\n", update, number, version, this);
+  // the columns are build here in the server thread and not in MergeUpdate(), which is called from the render thread
+  MyTypeHash* hash;
+  FakeTextureListStruct* textures;
+  if (int ret = NewColumns( update, number, hash, textures))
+  {
+    if (update!=NULL) delete [] update;
+    return (ret);
+  }
+
+  if (int ret = LockMutex())
+  {
+    gl_ErrorState |= uMod_ERROR_TEXTURE;
+    if (update!=NULL) delete [] update;
+    if (hash!=NULL) delete [] hash;
+    if (textures!=NULL) delete [] textures;
+    return (ret);
+  }
   if (Update!=NULL) delete [] Update;
+  if (UpdateHash!=NULL) delete [] UpdateHash;
+  if (UpdateTextures!=NULL) delete [] UpdateTextures;
   Update = update;
+  UpdateHash = hash;
+  UpdateTextures = textures;
   NumberOfUpdate = number;
+  UpdateVersion = version;
+
+  if (Delta!=NULL) delete [] Delta; // the full update contains also these changes
+  Delta = NULL;
+  NumberOfDelta = -1;
+  MergedDelta = 0;
   return (UnlockMutex());
 }
 
 
 
+int uMod_TextureClient::AddDelta(TextureChangeStruct* delta, int number, int base_version, int version)  //client must delete the delta array
+{
+  Message("AddDelta( %lu, %d, %d -> %d): %lu\n", delta, number, base_version, version, this);
+  if (int ret = LockMutex())
+  {
+    gl_ErrorState |= uMod_ERROR_TEXTURE;
+    if (delta!=NULL) delete [] delta;
+    return (ret);
+  }
+  if (NumberOfUpdate>=0 || NumberOfDelta>=0 || Version!=base_version) // the last update is not merged, the server must send a full update
+  {
+    if (delta!=NULL) delete [] delta;
+    UnlockMutex();
+    return (RETURN_UPDATE_OUT_OF_DATE);
+  }
+  Delta = delta;
+  NumberOfDelta = number;
+  DeltaVersion = version;
+  MergedDelta = 0;
+  return (UnlockMutex());
+}
+
+
+
+int uMod_TextureClient::NewColumns( TextureFileStruct* files, int number, MyTypeHash* &hash, FakeTextureListStruct* &textures)
+{
+  hash = NULL;
+  textures = NULL;
+  if (number<=0) return (RETURN_OK);
+
+  try
+  {
+    hash = new MyTypeHash[number];
+    textures = new FakeTextureListStruct[number];
+  }
+  catch (...)
+  {
+    if (hash!=NULL) delete [] hash;
+    hash = NULL;
+    textures = NULL;
+    gl_ErrorState |= uMod_ERROR_MEMORY;
+    return (RETURN_NO_MEMORY);
+  }
+
+  for (int i=0; i<number; i++)
+  {
+    hash[i] = files[i].Hash;
+    textures[i].Number = 0;
+    textures[i].Length = 0;
+    textures[i].Textures = NULL;
+  }
+  return (RETURN_OK);
+}
+
+
+
 int uMod_TextureClient::MergeUpdate(void)
 {
-  if (NumberOfUpdate<0) {return (RETURN_OK);}
+  if (NumberOfUpdate<0 && NumberOfDelta<0) {return (RETURN_OK);}
   if (int ret = LockMutex()) {gl_ErrorState |= uMod_ERROR_TEXTURE ; return (ret);}
 
   Message("MergeUpdate(): %lu\n", this);
 
-  for (int i=0; i<NumberOfUpdate; i++) {Update[i].NumberOfTextures=0; Update[i].Textures = NULL;} // this is already done, but safety comes first ^^
+  int ret;
+  if (NumberOfUpdate>=0) ret = MergeFullUpdate();
+  else ret = MergeDelta();
+  AcknowledgeVersion(); // from now on the server might free the file content of textures removed up to this version
+
+  if (ret!=RETURN_OK) {UnlockMutex(); return (ret);}
+  return (UnlockMutex());
+}
+
+int uMod_TextureClient::AcknowledgeVersion(void) // called from MergeUpdate() and the render thread
+{
+  LONG version = OldestLoad!=NULL ? OldestLoad->Version : Version; // a job in flight references the file content of its version
+  if (InterlockedExchange( &MergedVersion, version)==version || Server==NULL) return (RETURN_OK);
+  return (Server->VersionMerged()); // the server frees the file content, once the last client has merged
+}
+
+
+
+int uMod_TextureClient::MergeFullUpdate(void)
+{
+  Message("MergeFullUpdate(): %d -> %d, %lu\n", Version, UpdateVersion, this);
 
-  int pos_old=0;
-  int pos_new=0;
   int *to_lookup = NULL;
-  if (NumberOfUpdate>0) to_lookup = new int[NumberOfUpdate];
+  if (NumberOfUpdate>0)
+  {
+    try {to_lookup = new int[NumberOfUpdate];}
+    catch (...)
+    {
+      gl_ErrorState |= uMod_ERROR_MEMORY;
+      return (RETURN_NO_MEMORY);
+    }
+  }
   int num_to_lookup = 0;
 
   /*
    * FileToMod contains the old files (textures) which should replace the target textures (if they are loaded by the game)
    * Update contains the new files (textures) which should replace the target textures (if they are loaded by the game)
    *
-   * Both arrays (FileToMod and Update) are sorted according to their hash values.
-   *
-   * First we go through both arrays linearly and
-   * 1) take over the old entry if the hash is the same,
-   * 2) release old fake texture (if target texture exist and is not in the Update)
-   * 3) or mark newly added fake texture (if they are not in FileToMod)
+   * Neither array is sorted, the old entries are found through the hash index of FileToMod.
+   * For each entry of the Update we
+   * 1) take over the fake textures of the old entry if the hash is the same,
+   * 2) or mark newly added fake texture (if they are not in FileToMod).
+   * Afterwards the fake textures of all old entries, which are not taken over, are released.
    */
 
-  while (pos_old<NumberToMod && pos_new<NumberOfUpdate)
+  for (int pos_new=0; pos_new<NumberOfUpdate; pos_new++)
   {
-    if (FileToMod[pos_old].Hash > Update[pos_new].Hash) // this fake texture is new
+    int pos_old = FileToModIndex.Find( UpdateHash[pos_new]);
+    if (pos_old<0) // this fake texture is new
     {
-      to_lookup[num_to_lookup++] = pos_new++; // keep this fake texture in mind, we must search later for it through all original textures
-      // we increase only the new counter by one
+      to_lookup[num_to_lookup++] = pos_new; // keep this fake texture in mind, we must search later for it through all original textures
+      continue;
     }
-    else if (FileToMod[pos_old].Hash < Update[pos_new].Hash) // this fake texture is not in the update
+    UpdateTextures[pos_new] = FileToModTextures[pos_old]; // the texture might be loaded or not
+    FileToModTextures[pos_old].Number = 0;
+    FileToModTextures[pos_old].Length = 0;
+    FileToModTextures[pos_old].Textures = NULL;
+    SetFakeReference( UpdateTextures[pos_new], pos_new);
+
+    if (FileToMod[pos_old].pData==NULL) // lazy mode
     {
-      for (int i=FileToMod[pos_old].NumberOfTextures-1; i>=0; i--) FileToMod[pos_old].Textures[i]->Release(); // we release the fake textures
-      if (FileToMod[pos_old].Textures!=NULL) delete [] FileToMod[pos_old].Textures; // we delete the memory
-      FileToMod[pos_old].NumberOfTextures = 0;
-      FileToMod[pos_old].Textures = NULL;
+      if (Update[pos_new].pData!=NULL) to_lookup[num_to_lookup++] = pos_new; // the file content was fetched meanwhile
+      else Update[pos_new].Requested = FileToMod[pos_old].Requested; // the request is still pending
+    }
+  }
+
+  for (int pos_old=0; pos_old<NumberToMod; pos_old++) //this fake textures are not in the Update
+  {
+    ReleaseFakeTextures( FileToModTextures[pos_old]);
+  }
+
+  if (FileToMod!=NULL) delete [] FileToMod;
+  if (FileToModHash!=NULL) delete [] FileToModHash;
+  if (FileToModTextures!=NULL) delete [] FileToModTextures; // all lists are either taken over or deleted
+
+  FileToMod = Update;
+  FileToModHash = UpdateHash;
+  FileToModTextures = UpdateTextures;
+  NumberToMod = NumberOfUpdate;
+  LengthToMod = NumberOfUpdate;
+  Version = UpdateVersion;
+
+  NumberOfUpdate = -1;
+  Update = NULL;
+  UpdateHash = NULL;
+  UpdateTextures = NULL;
+
+  // a full update is also send, if the client missed a delta update, thus it might contain entries which should be reloaded
+  if (FileToModIndex.Build( FileToModHash, NumberToMod)==RETURN_OK)
+  {
+    for (int i=0; i<NumberToMod; i++) if (FileToMod[i].ForceReload && FileToModTextures[i].Number>0) ReloadFakeTextures(i);
+  }
+
+  int ret = LookUpNewEntries( num_to_lookup, to_lookup);
+  if (to_lookup != NULL) delete [] to_lookup;
+  return (ret);
+}
+
+
 
-      pos_old++; // we increase only the old counter by one
+int uMod_TextureClient::MergeDelta(void)
+{
+  Message("MergeDelta( %d, %d): %d -> %d, %lu\n", NumberOfDelta, MergedDelta, Version, DeltaVersion, this);
+
+  int *to_lookup = NULL;
+  if (NumberOfDelta>0)
+  {
+    try {to_lookup = new int[NumberOfDelta];}
+    catch (...)
+    {
+      gl_ErrorState |= uMod_ERROR_MEMORY;
+      return (RETURN_NO_MEMORY);
     }
-    else // the hash value is the same, thus this texture is in the array FileToMod as well as in the array Update
+  }
+  int num_to_lookup = 0;
+
+  // the changes must be applied in the order the server has recorded them, a previous call might have stopped at MergedDelta
+  int ret = RETURN_OK;
+  int i = MergedDelta;
+  for (; i<NumberOfDelta; i++)
+  {
+    int index = FileToModIndex.Find( Delta[i].File.Hash);
+    switch (Delta[i].Type)
     {
-      if (Update[pos_new].ForceReload)
+      case uMod_CHANGE_ADD:
       {
-        if (FileToMod[pos_old].NumberOfTextures>0)
-        {
-          Update[pos_new].Textures = new IDirect3DBaseTexture9*[FileToMod[pos_old].NumberOfTextures];
-        }
-        for (int i=0; i<FileToMod[pos_old].NumberOfTextures; i++)
+        if (index>=0) FileToMod[index] = Delta[i].File; // we know this texture already, only the file content is taken over
+        else if ((ret = AddEntry( &Delta[i].File))!=RETURN_OK) break;
+        else to_lookup[num_to_lookup++] = i;
+        break;
+      }
+      case uMod_CHANGE_REMOVE:
+      {
+        if (index>=0) RemoveEntry( index);
+        break;
+      }
+      case uMod_CHANGE_FORCE_RELOAD:
+      {
+        if (index>=0)
         {
-          IDirect3DBaseTexture9 *base_texture;
-          int ret = FileToMod[pos_old].Textures[i]->QueryInterface( IID_IDirect3D9, (void**)&base_texture);
-          switch (ret)
-          {
-            case 0x01000000L:
-            {
-              uMod_IDirect3DTexture9 *pTexture = (uMod_IDirect3DTexture9*) FileToMod[pos_old].Textures[i];//
-              uMod_IDirect3DTexture9 *pRefTexture = pTexture->CrossRef_D3Dtex;
-              pTexture->Release();
-              i--; //after the Release of the old fake texture FileToMod[pos_old].Textures[i] is overwritten by entries with index greater than i
-
-              uMod_IDirect3DTexture9 *fake_Texture;
-              if (int ret = LoadTexture( & (Update[pos_new]), &fake_Texture)) return (ret);
-              if (SwitchTextures( fake_Texture, pRefTexture))
-              {
-                Message("MergeUpdate(): textures not switched %#lX\n", pRefTexture->Hash);
-                fake_Texture->Release();
-              }
-              else
-              {
-                Update[pos_new].Textures[Update[pos_new].NumberOfTextures++] = fake_Texture;
-                fake_Texture->Reference = pos_new;
-              }
-              break;
-            }
-            case 0x01000001L:
-            {
-              uMod_IDirect3DVolumeTexture9 *pTexture = (uMod_IDirect3DVolumeTexture9*) FileToMod[pos_old].Textures[i];//
-              uMod_IDirect3DVolumeTexture9 *pRefTexture = pTexture->CrossRef_D3Dtex;
-              pTexture->Release();
-              i--; //after the Release of the old fake texture FileToMod[pos_old].Textures[i] is overwritten by entries with index greater than i
-
-              uMod_IDirect3DVolumeTexture9 *fake_Texture;
-              if (int ret = LoadTexture( & (Update[pos_new]), &fake_Texture)) return (ret);
-              if (SwitchTextures( fake_Texture, pRefTexture))
-              {
-                Message("MergeUpdate(): textures not switched %#lX\n", pRefTexture->Hash);
-                fake_Texture->Release();
-              }
-              else
-              {
-                Update[pos_new].Textures[Update[pos_new].NumberOfTextures++] = fake_Texture;
-                fake_Texture->Reference = pos_new;
-              }
-              break;
-            }
-            case 0x01000002L:
-            {
-              uMod_IDirect3DCubeTexture9 *pTexture = (uMod_IDirect3DCubeTexture9*) FileToMod[pos_old].Textures[i];//
-              uMod_IDirect3DCubeTexture9 *pRefTexture = pTexture->CrossRef_D3Dtex;
-              pTexture->Release();
-              i--; //after the Release of the old fake texture FileToMod[pos_old].Textures[i] is overwritten by entries with index greater than i
-
-              uMod_IDirect3DCubeTexture9 *fake_Texture;
-              if (int ret = LoadTexture( & (Update[pos_new]), &fake_Texture)) return (ret);
-              if (SwitchTextures( fake_Texture, pRefTexture))
-              {
-                Message("MergeUpdate(): textures not switched %#lX\n", pRefTexture->Hash);
-                fake_Texture->Release();
-              }
-              else
-              {
-                Update[pos_new].Textures[Update[pos_new].NumberOfTextures++] = fake_Texture;
-                fake_Texture->Reference = pos_new;
-              }
-              break;
-            }
-            default:
-              break; // this is no fake texture and QueryInterface failed, because IDirect3DBaseTexture9 object cannot be a IDirect3D9 object ;)
-          }
+          FileToMod[index] = Delta[i].File;
+          ReloadFakeTextures( index);
         }
+        else if ((ret = AddEntry( &Delta[i].File))!=RETURN_OK) break;
+        else to_lookup[num_to_lookup++] = i;
+        break;
       }
-      else // the texture might be loaded or not
+      case uMod_CHANGE_FETCHED:
       {
-        Update[pos_new].NumberOfTextures = FileToMod[pos_old].NumberOfTextures;
-        Update[pos_new].Textures = FileToMod[pos_old].Textures;
-        FileToMod[pos_old].NumberOfTextures = 0;
-        FileToMod[pos_old].Textures = NULL;
+        if (index<0) break; // we have removed this entry
+        FileToMod[index] = Delta[i].File;
+        to_lookup[num_to_lookup++] = i; // the original textures can be switched now
+        break;
       }
-      // we increase both counters by one
-      pos_old++;
-      pos_new++;
+      default:
+        break;
     }
+    if (ret!=RETURN_OK) break; // AddEntry() has failed
   }
 
-  while (pos_old<NumberToMod) //this fake textures are not in the Update
+  // RemoveEntry() moves entries, thus the indices of the new entries are collected at the end
+  int num = 0;
+  for (int i=0; i<num_to_lookup; i++)
   {
-    for (int i=FileToMod[pos_old].NumberOfTextures-1; i>=0; i--) FileToMod[pos_old].Textures[i]->Release(); // we release the fake textures
-    //for (int i=0; i<FileToMod[pos_old].NumberOfTextures; i++) FileToMod[pos_old].Textures[i]->Release(); // we release the fake textures
-    if (FileToMod[pos_old].Textures!=NULL) delete [] FileToMod[pos_old].Textures; // we delete the memory
-    FileToMod[pos_old].Textures = NULL;
-    pos_old++;
+    int index = FileToModIndex.Find( Delta[to_lookup[i]].File.Hash);
+    if (index>=0) to_lookup[num++] = index;
   }
-  while (pos_new<NumberOfUpdate) //this fake textures are newly added
+
+  if (ret!=RETURN_OK)
   {
-    to_lookup[num_to_lookup++] = pos_new++; //keep this fake texture in mind, we must search later for it through all original textures
+    // the changes before i are applied and stay applied (applying them twice would lose their look up),
+    // Delta is kept and the next MergeUpdate() continues with the change which has failed
+    MergedDelta = i;
+    LookUpNewEntries( num, to_lookup);
+    if (to_lookup != NULL) delete [] to_lookup;
+    return (ret);
   }
 
+  Version = DeltaVersion;
+  delete [] Delta;
+  Delta = NULL;
+  NumberOfDelta = -1;
+  MergedDelta = 0;
 
-  /*
-   * if (num_to_lookup>0) we need to look through all original textures
-   * because there were newly added textures and we don't know
-   * if the corresponding target textures are loaded by the game or not.
-   *
-   * Note: to_lookup[num_to_lookup++] = pos_new++; is in ascending order,
-   * thus Update[to_lookup[pos]].Hash is also sorted ascending!
-   */
-/*
-  uMod_IDirect3DTexture9 *single_texture = ((uMod_IDirect3DDevice9*)D3D9Device)->GetSingleTexture();
-  if (num_to_lookup>0)
+  ret = LookUpNewEntries( num, to_lookup);
+  if (to_lookup != NULL) delete [] to_lookup;
+  return (ret);
+}
+
+
+
+int uMod_TextureClient::LookUpNewEntries( int num_to_lookup, int *to_lookup) // called from MergeFullUpdate() and MergeDelta()
+{
+  if (num_to_lookup<=0) return (RETURN_OK);
+
+  uMod_HashIndex new_index; // contains only the newly added entries
+  if (int ret = new_index.Build( FileToModHash, NumberToMod, num_to_lookup, to_lookup)) return (ret);
+
+  uMod_IDirect3DTexture9* single_texture;
+  if (!DeviceEx) single_texture = ((uMod_IDirect3DDevice9*)D3D9Device)->GetSingleTexture(); //this texture must no be added twice
+  else single_texture = ((uMod_IDirect3DDevice9Ex*) D3D9Device)->GetSingleTexture(); //this texture must no be added twice
+
+  int num = OriginalTextures.GetNumber();
+  for (int i=0; i<num; i++) if (OriginalTextures[i]->CrossRef_D3Dtex==NULL || OriginalTextures[i]->CrossRef_D3Dtex==single_texture)
+  {
+    if (new_index.Find( OriginalTextures[i]->Hash)<0) continue; // not affected by this update
+    UnswitchTextures(OriginalTextures[i]); //this we can do always, so we unswitch the single texture
+    LookUpToMod( OriginalTextures[i], &new_index);
+  }
+
+  uMod_IDirect3DVolumeTexture9 *single_volume_texture;
+  if (!DeviceEx) single_volume_texture = ((uMod_IDirect3DDevice9*)D3D9Device)->GetSingleVolumeTexture(); //this texture must no be added twice
+  else single_volume_texture = ((uMod_IDirect3DDevice9Ex*) D3D9Device)->GetSingleVolumeTexture(); //this texture must no be added twice
+  num = OriginalVolumeTextures.GetNumber();
+  for (int i=0; i<num; i++) if (OriginalVolumeTextures[i]->CrossRef_D3Dtex==NULL || OriginalVolumeTextures[i]->CrossRef_D3Dtex==single_volume_texture)
+  {
+    if (new_index.Find( OriginalVolumeTextures[i]->Hash)<0) continue; // not affected by this update
+    UnswitchTextures(OriginalVolumeTextures[i]); //this we can do always, so we unswitch the single texture
+    LookUpToMod( OriginalVolumeTextures[i], &new_index);
+  }
+
+  uMod_IDirect3DCubeTexture9 *single_cube_texture;
+  if (!DeviceEx) single_cube_texture = ((uMod_IDirect3DDevice9*)D3D9Device)->GetSingleCubeTexture(); //this texture must no be added twice
+  else single_cube_texture = ((uMod_IDirect3DDevice9Ex*) D3D9Device)->GetSingleCubeTexture(); //this texture must no be added twice
+  num = OriginalCubeTextures.GetNumber();
+  for (int i=0; i<num; i++) if (OriginalCubeTextures[i]->CrossRef_D3Dtex==NULL || OriginalCubeTextures[i]->CrossRef_D3Dtex==single_cube_texture)
+  {
+    if (new_index.Find( OriginalCubeTextures[i]->Hash)<0) continue; // not affected by this update
+    UnswitchTextures(OriginalCubeTextures[i]); //this we can do always, so we unswitch the single texture
+    LookUpToMod( OriginalCubeTextures[i], &new_index);
+  }
+  return (RETURN_OK);
+}
+
+
+
+int uMod_TextureClient::AddEntry( TextureFileStruct* file) // called from MergeDelta(), the entry is appended to FileToMod
+{
+  if (NumberToMod==LengthToMod) // get more memory for all columns
   {
-    int num = OriginalTextures.GetNumber();
-    for (int i=0; i<num; i++)
-      if (OriginalTextures[i]->CrossRef_D3Dtex==NULL || OriginalTextures[i]->CrossRef_D3Dtex==single_texture)
-      // We need look only for textures, that are not switched or switched with the single_texture.
-      // The single_texture is a special texture, which you can toggle through all original texture, if save single texture is turned on.
+    int length = LengthToMod<512 ? 1024 : 2*LengthToMod;
+    TextureFileStruct* files = NULL;
+    MyTypeHash* hash = NULL;
+    FakeTextureListStruct* textures = NULL;
+    try
     {
-      MyTypeHash hash = OriginalTextures[i]->Hash;
+      files = new TextureFileStruct[length];
+      hash = new MyTypeHash[length];
+      textures = new FakeTextureListStruct[length];
+    }
+    catch (...)
+    {
+      if (files!=NULL) delete [] files;
+      if (hash!=NULL) delete [] hash;
+      gl_ErrorState |= uMod_ERROR_MEMORY;
+      return (RETURN_NO_MEMORY);
+    }
+    for (int i=0; i<NumberToMod; i++)
+    {
+      files[i] = FileToMod[i];
+      hash[i] = FileToModHash[i];
+      textures[i] = FileToModTextures[i];
+    }
+    if (FileToMod!=NULL) delete [] FileToMod;
+    if (FileToModHash!=NULL) delete [] FileToModHash;
+    if (FileToModTextures!=NULL) delete [] FileToModTextures;
+    FileToMod = files;
+    FileToModHash = hash;
+    FileToModTextures = textures;
+    LengthToMod = length;
+  }
+
+  if (int ret = FileToModIndex.Insert( file->Hash, NumberToMod)) return (ret);
+  FileToMod[NumberToMod] = *file;
+  FileToModHash[NumberToMod] = file->Hash;
+  FileToModTextures[NumberToMod].Number = 0;
+  FileToModTextures[NumberToMod].Length = 0;
+  FileToModTextures[NumberToMod].Textures = NULL;
+  NumberToMod++;
+  return (RETURN_OK);
+}
+
+int uMod_TextureClient::RemoveEntry( int index) // called from MergeDelta(), the last entry is moved to index
+{
+  ReleaseFakeTextures( FileToModTextures[index]);
+  FileToModIndex.Remove( FileToModHash[index]);
+
+  int last = --NumberToMod;
+  if (index<last)
+  {
+    FileToMod[index] = FileToMod[last];
+    FileToModHash[index] = FileToModHash[last];
+    FileToModTextures[index] = FileToModTextures[last];
+    FileToModIndex.Set( FileToModHash[index], index);
+    SetFakeReference( FileToModTextures[index], index);
+  }
+  FileToModTextures[last].Number = 0;
+  FileToModTextures[last].Length = 0;
+  FileToModTextures[last].Textures = NULL;
+  return (RETURN_OK);
+}
+
+int uMod_TextureClient::ReleaseFakeTextures( FakeTextureListStruct &list)
+{
+  for (int i=list.Number-1; i>=0; i--) list.Textures[i]->Release(); // we release the fake textures, the list shrinks through RemoveTexture()
+  if (list.Textures!=NULL) delete [] list.Textures; // we delete the memory
+  list.Number = 0;
+  list.Length = 0;
+  list.Textures = NULL;
+  return (RETURN_OK);
+}
+
+int uMod_TextureClient::AddFakeTexture( FakeTextureListStruct &list, IDirect3DBaseTexture9* fake_Texture)
+{
+  if (list.Number>=list.Length) // the list grows by doubling, many originals might share the same fake texture
+  {
+    int length = list.Length>0 ? 2*list.Length : 4;
+    IDirect3DBaseTexture9 **temp = NULL;
+    try {temp = new IDirect3DBaseTexture9*[length];}
+    catch (...)
+    {
+      gl_ErrorState |= uMod_ERROR_MEMORY;
+      return (RETURN_NO_MEMORY);
+    }
+    for (int j=0; j<list.Number; j++) temp[j] = list.Textures[j];
+    if (list.Textures!=NULL) delete [] list.Textures;
+    list.Textures = temp;
+    list.Length = length;
+  }
+  list.Textures[list.Number++] = fake_Texture;
+  return (RETURN_OK);
+}
 
-      if (hash<Update[to_lookup[0]].Hash || hash>Update[to_lookup[num_to_lookup-1]].Hash) continue;
+int uMod_TextureClient::SetFakeReference( FakeTextureListStruct &list, int ref)
+{
+  for (int i=0; i<list.Number; i++)
+  {
+    switch (uMod_GetTextureType( list.Textures[i]))
+    {
+      case uMod_TYPE_TEXTURE: ((uMod_IDirect3DTexture9*) list.Textures[i])->Reference = ref; break;
+      case uMod_TYPE_VOLUME_TEXTURE: ((uMod_IDirect3DVolumeTexture9*) list.Textures[i])->Reference = ref; break;
+      case uMod_TYPE_CUBE_TEXTURE: ((uMod_IDirect3DCubeTexture9*) list.Textures[i])->Reference = ref; break;
+      default: break;
+    }
+  }
+  return (RETURN_OK);
+}
 
-      int index = -1;
-      int pos = num_to_lookup/2;
-      int begin = 0;
-      int end = num_to_lookup-1;
+int uMod_TextureClient::ReloadFakeTextures( int index) // the file content of FileToMod[index] has changed
+{
+  FakeTextureListStruct old = FileToModTextures[index];
+  FileToModTextures[index].Number = 0;
+  FileToModTextures[index].Length = 0;
+  FileToModTextures[index].Textures = NULL;
+  if (old.Number<=0) {if (old.Textures!=NULL) delete [] old.Textures; return (RETURN_OK);}
+
+  try {FileToModTextures[index].Textures = new IDirect3DBaseTexture9*[old.Number];}
+  catch (...)
+  {
+    FileToModTextures[index] = old;
+    gl_ErrorState |= uMod_ERROR_MEMORY;
+    return (RETURN_NO_MEMORY);
+  }
+  FileToModTextures[index].Length = old.Number;
 
-      // We look in the middle of the interval and each step we halve the interval,
-      // unless we find the texture or the size of the interval is less than 3.
-      // Note: contradicting to normal C-code here the interval includes the index "begin" and "end"!
-      while (begin+1<end) // as long as the interval is longer than two
+  // The old fake textures are not in the list FileToModTextures[index] any more, thus RemoveTexture() does not change the old list.
+  for (int i=0; i<old.Number; i++)
+  {
+    switch (uMod_GetTextureType( old.Textures[i]))
+    {
+      case uMod_TYPE_TEXTURE:
       {
-        if (hash > Update[to_lookup[pos]].Hash) // the new interval is the right half of the actual interval
+        uMod_IDirect3DTexture9 *pTexture = (uMod_IDirect3DTexture9*) old.Textures[i];
+        uMod_IDirect3DTexture9 *pRefTexture = pTexture->CrossRef_D3Dtex;
+        pTexture->Release();
+
+        uMod_IDirect3DTexture9 *fake_Texture;
+        if (pRefTexture==NULL || NewFakeTexture( index, &fake_Texture)) break; // only the first one is loaded, the others share it
+        if (SwitchTextures( fake_Texture, pRefTexture))
         {
-          begin = pos+1; // the new interval does not contain the index "pos"
-          pos = (begin + end)/2; // set "pos" somewhere inside the new intervall
+          Message("ReloadFakeTextures(): textures not switched %#lX\n", pRefTexture->Hash);
+          fake_Texture->Release();
         }
-        else if (hash < Update[to_lookup[pos]].Hash) // the new interval is the left half of the actual interval
+        else
         {
-          end = pos-1; // the new interval does not contain the index "pos"
-          pos = (begin + end)/2; // set "pos" somewhere inside the new intervall
+          FileToModTextures[index].Textures[FileToModTextures[index].Number++] = fake_Texture;
+          fake_Texture->Reference = index;
         }
-        else {index = to_lookup[pos]; break;} // we hit the correct hash
+        break;
       }
-      if (index<0) // if we did not find the hash, it might be in the last interval
+      case uMod_TYPE_VOLUME_TEXTURE:
       {
-        for (int i=begin; i<=end; i++) if (Update[to_lookup[i]].Hash==hash) index = to_lookup[i];
-      }
+        uMod_IDirect3DVolumeTexture9 *pTexture = (uMod_IDirect3DVolumeTexture9*) old.Textures[i];
+        uMod_IDirect3DVolumeTexture9 *pRefTexture = pTexture->CrossRef_D3Dtex;
+        pTexture->Release();
 
-      if (index>=0) // target texture is loaded by the game
+        uMod_IDirect3DVolumeTexture9 *fake_Texture;
+        if (pRefTexture==NULL || NewFakeTexture( index, &fake_Texture)) break; // only the first one is loaded, the others share it
+        if (SwitchTextures( fake_Texture, pRefTexture))
+        {
+          Message("ReloadFakeTextures(): textures not switched %#lX\n", pRefTexture->Hash);
+          fake_Texture->Release();
+        }
+        else
+        {
+          FileToModTextures[index].Textures[FileToModTextures[index].Number++] = fake_Texture;
+          fake_Texture->Reference = index;
+        }
+        break;
+      }
+      case uMod_TYPE_CUBE_TEXTURE:
       {
-        if (OriginalTextures[i]->CrossRef_D3Dtex!=NULL) UnswitchTextures(OriginalTextures[i]); // this texture was switched with the single texture
+        uMod_IDirect3DCubeTexture9 *pTexture = (uMod_IDirect3DCubeTexture9*) old.Textures[i];
+        uMod_IDirect3DCubeTexture9 *pRefTexture = pTexture->CrossRef_D3Dtex;
+        pTexture->Release();
 
-        uMod_IDirect3DTexture9 *fake_Texture;
-        if (int ret = LoadTexture( & (Update[index]), &fake_Texture)) return (ret);
-        if (SwitchTextures( fake_Texture, OriginalTextures[i]))
+        uMod_IDirect3DCubeTexture9 *fake_Texture;
+        if (pRefTexture==NULL || NewFakeTexture( index, &fake_Texture)) break; // only the first one is loaded, the others share it
+        if (SwitchTextures( fake_Texture, pRefTexture))
         {
-          Message("uMod_TextureClient::LookUpToMod(): textures not switched %#lX\n", FileToMod[index].Hash);
+          Message("ReloadFakeTextures(): textures not switched %#lX\n", pRefTexture->Hash);
           fake_Texture->Release();
         }
         else
         {
-          IDirect3DBaseTexture9 **temp = new IDirect3DBaseTexture9*[Update[index].NumberOfTextures+1];
-          for (int j=0; j<Update[index].NumberOfTextures; j++) temp[j] = Update[index].Textures[j];
+          FileToModTextures[index].Textures[FileToModTextures[index].Number++] = fake_Texture;
+          fake_Texture->Reference = index;
+        }
+        break;
+      }
+      default:
+        break; // this texture was not created by our device
+    }
+  }
+  delete [] old.Textures;
+  return (RETURN_OK);
+}
 
-          if (Update[index].Textures!=NULL) delete [] Update[index].Textures;
-          Update[index].Textures = temp;
 
-          Update[index].Textures[Update[index].NumberOfTextures++] = fake_Texture;
-          fake_Texture->Reference = index;
+
+int uMod_TextureClient::MergeHashes(void)
+{
+  uMod_HashJob *job = HashPool.GetFinished();
+  while (job!=NULL)
+  {
+    uMod_HashJob *next = (uMod_HashJob*) job->Entry.Next;
+    if (job->Texture!=NULL) // the texture was not released in the meantime
+    {
+      switch (job->Type)
+      {
+        case uMod_HASH_TEXTURE:
+        {
+          uMod_IDirect3DTexture9 *pTexture = (uMod_IDirect3DTexture9*) job->Texture;
+          pTexture->HashJob = NULL;
+          pTexture->Hash = job->Hash;
+          LookUpToMod(pTexture);
+          break;
+        }
+        case uMod_HASH_VOLUME_TEXTURE:
+        {
+          uMod_IDirect3DVolumeTexture9 *pTexture = (uMod_IDirect3DVolumeTexture9*) job->Texture;
+          pTexture->HashJob = NULL;
+          pTexture->Hash = job->Hash;
+          LookUpToMod(pTexture);
+          break;
+        }
+        case uMod_HASH_CUBE_TEXTURE:
+        {
+          uMod_IDirect3DCubeTexture9 *pTexture = (uMod_IDirect3DCubeTexture9*) job->Texture;
+          pTexture->HashJob = NULL;
+          pTexture->Hash = job->Hash;
+          LookUpToMod(pTexture);
+          break;
         }
       }
     }
+    uMod_HashPool::DeleteJob(job);
+    job = next;
   }
-*/
+  return (RETURN_OK);
+}
+
+int uMod_TextureClient::MergeLoads(void)
+{
+  if (LoadsInFlight==0) return (RETURN_OK);
 
-  if (FileToMod!=NULL)
+  // the finished jobs are appended to the ready queue in the order in which they were finished
+  uMod_LoadJob *job = LoadPool.GetFinished();
+  uMod_LoadJob *first = NULL;
+  while (job!=NULL)
   {
-    //for (int i=0; i<NumberToMod; i++) if (FileToMod[i].Textures!=NULL) delete [] FileToMod[i].Textures;
-    delete [] FileToMod;
+    uMod_LoadJob *next = (uMod_LoadJob*) job->Entry.Next;
+    job->Next = first;
+    first = job;
+    job = next;
+  }
+  if (first!=NULL)
+  {
+    if (ReadyLast!=NULL) ReadyLast->Next = first;
+    else ReadyFirst = first;
+    for (ReadyLast = first; ReadyLast->Next!=NULL; ReadyLast = ReadyLast->Next);
   }
 
-  FileToMod = Update;
-  NumberToMod = NumberOfUpdate;
+  LARGE_INTEGER frequency, start, now;
+  QueryPerformanceFrequency( &frequency);
+  QueryPerformanceCounter( &start);
+  LONGLONG budget = frequency.QuadPart * uMod_LOAD_BUDGET / 1000;
 
-  NumberOfUpdate = -1;
-  Update = NULL;
+  while (ReadyFirst!=NULL)
+  {
+    job = ReadyFirst;
+    ReadyFirst = job->Next;
+    if (ReadyFirst==NULL) ReadyLast = NULL;
 
+    bool created = false;
+    if (job->Texture!=NULL) // else the texture was released or looked up again
+    {
+      FinishLoad( job);
+      created = true;
+    }
+    if (job->Older!=NULL) job->Older->Newer = job->Newer;
+    else OldestLoad = job->Newer;
+    if (job->Newer!=NULL) job->Newer->Older = job->Older;
+    else NewestLoad = job->Older;
+    uMod_LoadPool::DeleteJob(job);
+    LoadsInFlight--;
+
+    if (created)
+    {
+      QueryPerformanceCounter( &now);
+      if (now.QuadPart - start.QuadPart >= budget) break; // the rest is created in the next frame
+    }
+  }
+
+  AcknowledgeVersion(); // a merged version might not be acknowledged yet
+  return (RETURN_OK);
+}
 
-  if (num_to_lookup>0)
+int uMod_TextureClient::SubmitLoad( uMod_IDirect3DTexture9* pTexture, int index)
+{
+  if (pTexture->LoadJob!=NULL)
   {
-    uMod_IDirect3DTexture9* single_texture;
-    void *cpy;
-    long ret = D3D9Device->QueryInterface( IID_IDirect3DTexture9, &cpy);
-    if (ret == 0x01000000L) single_texture = ((uMod_IDirect3DDevice9*)D3D9Device)->GetSingleTexture(); //this texture must no be added twice
-    else single_texture = ((uMod_IDirect3DDevice9Ex*) D3D9Device)->GetSingleTexture(); //this texture must no be added twice
+    if (pTexture->LoadJob->Hash==pTexture->Hash && pTexture->LoadJob->pData==FileToMod[index].pData) return (RETURN_OK); // is already on its way
+    CancelLoadJob(pTexture);
+  }
 
-    int num = OriginalTextures.GetNumber();
-    for (int i=0; i<num; i++) if (OriginalTextures[i]->CrossRef_D3Dtex==NULL || OriginalTextures[i]->CrossRef_D3Dtex==single_texture)
+  uMod_LoadJob *job = LoadPool.NewJob( pTexture, & (FileToMod[index]));
+  if (job==NULL) {gl_ErrorState |= uMod_ERROR_MEMORY; return (RETURN_NO_MEMORY);}
+  pTexture->LoadJob = job;
+  job->Version = Version; // versions only grow, thus the list stays ordered
+  job->Older = NewestLoad;
+  if (NewestLoad!=NULL) NewestLoad->Newer = job;
+  else OldestLoad = job;
+  NewestLoad = job;
+  LoadsInFlight++;
+  return (LoadPool.Submit( job));
+}
+
+int uMod_TextureClient::FinishLoad( uMod_LoadJob* job)
+{
+  uMod_IDirect3DTexture9 *pTexture = (uMod_IDirect3DTexture9*) job->Texture;
+  pTexture->LoadJob = NULL;
+  if (pTexture->CrossRef_D3Dtex!=NULL) return (RETURN_OK); // the texture was switched in the meantime
+
+  int index = FileToModIndex.Find( pTexture->Hash);
+  if (index<0) return (RETURN_OK); // the texture is not modded anymore
+  if (job->Hash!=pTexture->Hash || job->pData!=FileToMod[index].pData) return (LookUpToMod( pTexture)); // the hash or the file content has changed
+
+  Message("uMod_TextureClient::FinishLoad( %lu, %#lX): staged: %d\n", pTexture, pTexture->Hash, job->Staged);
+  uMod_IDirect3DTexture9 *fake_Texture = NULL;
+  if (ShareFakeTexture( index, &fake_Texture)!=RETURN_OK) // else an original with the same hash was switched meanwhile
+  {
+    if (!job->Staged || UploadTexture( job->Layout, &fake_Texture))
     {
-      UnswitchTextures(OriginalTextures[i]); //this we can do always, so we unswitch the single texture
-      LookUpToMod( OriginalTextures[i], num_to_lookup, to_lookup);
+      if (int ret = LoadTexture( & (FileToMod[index]), &fake_Texture)) return (ret); // D3DX must load this file
     }
+    else if (job->Staging!=NULL) StoreDecoded( & (FileToMod[index]), job->Layout); // only the generated levels are worth to be cached
+  }
+  return (SwitchFakeTexture( fake_Texture, pTexture, index));
+}
+
+int uMod_TextureClient::UploadTexture( uMod_DDSLayout &layout, uMod_IDirect3DTexture9 **ppTexture)
+{
+  if (D3D_OK != D3D9Device->CreateTexture( layout.Width, layout.Height, layout.Levels, 0, layout.Format, D3DPOOL_MANAGED, (IDirect3DTexture9 **) ppTexture, NULL))
+  {
+    *ppTexture=NULL;
+    return (RETURN_TEXTURE_NOT_LOADED); // e.g. the format is not supported by the device
+  }
+  (*ppTexture)->FAKE = true;
 
-    uMod_IDirect3DVolumeTexture9 *single_volume_texture;
-    if (ret == 0x01000000L) single_volume_texture = ((uMod_IDirect3DDevice9*)D3D9Device)->GetSingleVolumeTexture(); //this texture must no be added twice
-    else single_volume_texture = ((uMod_IDirect3DDevice9Ex*) D3D9Device)->GetSingleVolumeTexture(); //this texture must no be added twice
-    num = OriginalVolumeTextures.GetNumber();
-    for (int i=0; i<num; i++) if (OriginalVolumeTextures[i]->CrossRef_D3Dtex==NULL || OriginalVolumeTextures[i]->CrossRef_D3Dtex==single_volume_texture)
+  if (!DeviceEx) ((uMod_IDirect3DDevice9*)D3D9Device)->SetLastCreatedTexture(NULL); //this texture must no be added twice
+  else  ((uMod_IDirect3DDevice9Ex*) D3D9Device)->SetLastCreatedTexture(NULL); //this texture must no be added twice
+
+  IDirect3DTexture9 *pD3Dtex = (*ppTexture)->m_D3Dtex;
+  for (UINT l=0u; l<layout.Levels; l++)
+  {
+    D3DLOCKED_RECT d3dlr;
+    if (D3D_OK!=pD3Dtex->LockRect( l, &d3dlr, NULL, 0))
     {
-      UnswitchTextures(OriginalVolumeTextures[i]); //this we can do always, so we unswitch the single texture
-      LookUpToMod( OriginalVolumeTextures[i], num_to_lookup, to_lookup);
+      (*ppTexture)->Release();
+      *ppTexture=NULL;
+      return (RETURN_TEXTURE_NOT_LOADED);
     }
+    uMod_CopyRows( layout.Bits[0][l], layout.Pitch[l], layout.Rows[l], (char*) d3dlr.pBits, d3dlr.Pitch);
+    pD3Dtex->UnlockRect(l);
+  }
+  return (RETURN_OK);
+}
 
-    uMod_IDirect3DCubeTexture9 *single_cube_texture;
-    if (ret == 0x01000000L) single_cube_texture = ((uMod_IDirect3DDevice9*)D3D9Device)->GetSingleCubeTexture(); //this texture must no be added twice
-    else single_cube_texture = ((uMod_IDirect3DDevice9Ex*) D3D9Device)->GetSingleCubeTexture(); //this texture must no be added twice
-    num = OriginalCubeTextures.GetNumber();
-    for (int i=0; i<num; i++) if (OriginalCubeTextures[i]->CrossRef_D3Dtex==NULL || OriginalCubeTextures[i]->CrossRef_D3Dtex==single_cube_texture)
+int uMod_TextureClient::UploadTexture( uMod_DDSLayout &layout, uMod_IDirect3DVolumeTexture9 **ppTexture)
+{
+  if (D3D_OK != D3D9Device->CreateVolumeTexture( layout.Width, layout.Height, layout.Depth, layout.Levels, 0, layout.Format, D3DPOOL_MANAGED, (IDirect3DVolumeTexture9 **) ppTexture, NULL))
+  {
+    *ppTexture=NULL;
+    return (RETURN_TEXTURE_NOT_LOADED); // e.g. the format is not supported by the device
+  }
+  (*ppTexture)->FAKE = true;
+
+  if (!DeviceEx) ((uMod_IDirect3DDevice9*)D3D9Device)->SetLastCreatedVolumeTexture(NULL); //this texture must no be added twice
+  else  ((uMod_IDirect3DDevice9Ex*) D3D9Device)->SetLastCreatedVolumeTexture(NULL); //this texture must no be added twice
+
+  IDirect3DVolumeTexture9 *pD3Dtex = (*ppTexture)->m_D3Dtex;
+  for (UINT l=0u; l<layout.Levels; l++)
+  {
+    D3DLOCKED_BOX d3dlr;
+    if (D3D_OK!=pD3Dtex->LockBox( l, &d3dlr, NULL, 0))
     {
-      UnswitchTextures(OriginalCubeTextures[i]); //this we can do always, so we unswitch the single texture
-      LookUpToMod( OriginalCubeTextures[i], num_to_lookup, to_lookup);
+      (*ppTexture)->Release();
+      *ppTexture=NULL;
+      return (RETURN_TEXTURE_NOT_LOADED);
     }
+    unsigned int slice = layout.Pitch[l]*layout.Rows[l];
+    for (UINT s=0u; s<layout.Slices[l]; s++)
+      uMod_CopyRows( layout.Bits[0][l] + s*slice, layout.Pitch[l], layout.Rows[l], (char*) d3dlr.pBits + s*d3dlr.SlicePitch, d3dlr.RowPitch);
+    pD3Dtex->UnlockBox(l);
   }
+  return (RETURN_OK);
+}
 
+int uMod_TextureClient::UploadTexture( uMod_DDSLayout &layout, uMod_IDirect3DCubeTexture9 **ppTexture)
+{
+  if (D3D_OK != D3D9Device->CreateCubeTexture( layout.Width, layout.Levels, 0, layout.Format, D3DPOOL_MANAGED, (IDirect3DCubeTexture9 **) ppTexture, NULL))
+  {
+    *ppTexture=NULL;
+    return (RETURN_TEXTURE_NOT_LOADED); // e.g. the format is not supported by the device
+  }
+  (*ppTexture)->FAKE = true;
 
+  if (!DeviceEx) ((uMod_IDirect3DDevice9*)D3D9Device)->SetLastCreatedCubeTexture(NULL); //this texture must no be added twice
+  else  ((uMod_IDirect3DDevice9Ex*) D3D9Device)->SetLastCreatedCubeTexture(NULL); //this texture must no be added twice
 
-  if (to_lookup != NULL) delete [] to_lookup;
+  IDirect3DCubeTexture9 *pD3Dtex = (*ppTexture)->m_D3Dtex;
+  for (UINT f=0u; f<6u; f++) for (UINT l=0u; l<layout.Levels; l++)
+  {
+    D3DLOCKED_RECT d3dlr;
+    if (D3D_OK!=pD3Dtex->LockRect( (D3DCUBEMAP_FACES) f, l, &d3dlr, NULL, 0))
+    {
+      (*ppTexture)->Release();
+      *ppTexture=NULL;
+      return (RETURN_TEXTURE_NOT_LOADED);
+    }
+    uMod_CopyRows( layout.Bits[f][l], layout.Pitch[l], layout.Rows[l], (char*) d3dlr.pBits, d3dlr.Pitch);
+    pD3Dtex->UnlockRect( (D3DCUBEMAP_FACES) f, l);
+  }
+  return (RETURN_OK);
+}
 
-  return (UnlockMutex());
+int uMod_TextureClient::ShareFakeTexture( int index, uMod_IDirect3DTexture9 **ppTexture)
+{
+  *ppTexture=NULL;
+  FakeTextureListStruct &list = FileToModTextures[index];
+  for (int i=0; i<list.Number; i++) if (uMod_GetTextureType( list.Textures[i])==uMod_TYPE_TEXTURE)
+  {
+    uMod_IDirect3DTexture9 *pTexture = (uMod_IDirect3DTexture9*) list.Textures[i];
+    // a switched fake texture holds the d3d texture of its original, the fake d3d texture is held by the original
+    IDirect3DTexture9 *pD3Dtex = pTexture->CrossRef_D3Dtex!=NULL ? pTexture->CrossRef_D3Dtex->m_D3Dtex : pTexture->m_D3Dtex;
+    try {*ppTexture = new uMod_IDirect3DTexture9( &pD3Dtex, D3D9Device, DeviceEx);}
+    catch (...)
+    {
+      gl_ErrorState |= uMod_ERROR_MEMORY;
+      return (RETURN_NO_MEMORY);
+    }
+    pD3Dtex->AddRef(); // is released by the new fake texture
+    (*ppTexture)->FAKE = true;
+    (*ppTexture)->Hash = pTexture->Hash;
+    return (RETURN_OK);
+  }
+  return (RETURN_TEXTURE_NOT_FOUND);
 }
 
+int uMod_TextureClient::NewFakeTexture( int index, uMod_IDirect3DTexture9 **ppTexture)
+{
+  if (ShareFakeTexture( index, ppTexture)==RETURN_OK) return (RETURN_OK);
+  return (LoadTexture( & (FileToMod[index]), ppTexture));
+}
 
+int uMod_TextureClient::ShareFakeTexture( int index, uMod_IDirect3DVolumeTexture9 **ppTexture)
+{
+  *ppTexture=NULL;
+  FakeTextureListStruct &list = FileToModTextures[index];
+  for (int i=0; i<list.Number; i++) if (uMod_GetTextureType( list.Textures[i])==uMod_TYPE_VOLUME_TEXTURE)
+  {
+    uMod_IDirect3DVolumeTexture9 *pTexture = (uMod_IDirect3DVolumeTexture9*) list.Textures[i];
+    // a switched fake texture holds the d3d texture of its original, the fake d3d texture is held by the original
+    IDirect3DVolumeTexture9 *pD3Dtex = pTexture->CrossRef_D3Dtex!=NULL ? pTexture->CrossRef_D3Dtex->m_D3Dtex : pTexture->m_D3Dtex;
+    try {*ppTexture = new uMod_IDirect3DVolumeTexture9( &pD3Dtex, D3D9Device, DeviceEx);}
+    catch (...)
+    {
+      gl_ErrorState |= uMod_ERROR_MEMORY;
+      return (RETURN_NO_MEMORY);
+    }
+    pD3Dtex->AddRef(); // is released by the new fake texture
+    (*ppTexture)->FAKE = true;
+    (*ppTexture)->Hash = pTexture->Hash;
+    return (RETURN_OK);
+  }
+  return (RETURN_TEXTURE_NOT_FOUND);
+}
 
-int uMod_TextureClient::LockMutex(void)
+int uMod_TextureClient::NewFakeTexture( int index, uMod_IDirect3DVolumeTexture9 **ppTexture)
 {
-  if (( gl_ErrorState & (uMod_ERROR_FATAL | uMod_ERROR_MUTEX) )) return (RETURN_NO_MUTEX);
-  if (WAIT_OBJECT_0!=WaitForSingleObject( Mutex, 100)) return (RETURN_MUTEX_LOCK); //waiting 100ms, to wait infinite pass INFINITE
-  return  (RETURN_OK);
+  if (ShareFakeTexture( index, ppTexture)==RETURN_OK) return (RETURN_OK);
+  return (LoadTexture( & (FileToMod[index]), ppTexture));
 }
 
-int uMod_TextureClient::UnlockMutex(void)
+int uMod_TextureClient::ShareFakeTexture( int index, uMod_IDirect3DCubeTexture9 **ppTexture)
 {
-  if (ReleaseMutex(Mutex)==0) return (RETURN_MUTEX_UNLOCK);
-  return  (RETURN_OK);
+  *ppTexture=NULL;
+  FakeTextureListStruct &list = FileToModTextures[index];
+  for (int i=0; i<list.Number; i++) if (uMod_GetTextureType( list.Textures[i])==uMod_TYPE_CUBE_TEXTURE)
+  {
+    uMod_IDirect3DCubeTexture9 *pTexture = (uMod_IDirect3DCubeTexture9*) list.Textures[i];
+    // a switched fake texture holds the d3d texture of its original, the fake d3d texture is held by the original
+    IDirect3DCubeTexture9 *pD3Dtex = pTexture->CrossRef_D3Dtex!=NULL ? pTexture->CrossRef_D3Dtex->m_D3Dtex : pTexture->m_D3Dtex;
+    try {*ppTexture = new uMod_IDirect3DCubeTexture9( &pD3Dtex, D3D9Device, DeviceEx);}
+    catch (...)
+    {
+      gl_ErrorState |= uMod_ERROR_MEMORY;
+      return (RETURN_NO_MEMORY);
+    }
+    pD3Dtex->AddRef(); // is released by the new fake texture
+    (*ppTexture)->FAKE = true;
+    (*ppTexture)->Hash = pTexture->Hash;
+    return (RETURN_OK);
+  }
+  return (RETURN_TEXTURE_NOT_FOUND);
+}
+
+int uMod_TextureClient::NewFakeTexture( int index, uMod_IDirect3DCubeTexture9 **ppTexture)
+{
+  if (ShareFakeTexture( index, ppTexture)==RETURN_OK) return (RETURN_OK);
+  return (LoadTexture( & (FileToMod[index]), ppTexture));
 }
 
+uMod_DecodedTexture* uMod_TextureClient::AcquireDecoded( TextureFileStruct* file, int type)
+{
+  if (Server==NULL) return (NULL);
+  return (Server->DecodeCache.Acquire( file->Hash, file->Generation, type));
+}
 
+int uMod_TextureClient::ReleaseDecoded( uMod_DecodedTexture* entry)
+{
+  if (Server==NULL) return (RETURN_OK);
+  return (Server->DecodeCache.Release( entry));
+}
 
+bool uMod_TextureClient::FirstLoad( TextureFileStruct* file)
+{
+  if (Server==NULL) return (true);
+  return (Server->DecodeCache.FirstLoad( file));
+}
 
+int uMod_TextureClient::StoreDecoded( TextureFileStruct* file, uMod_DDSLayout &layout)
+{
+  if (Server==NULL) return (RETURN_OK);
+  uMod_DecodedTexture* entry = Server->DecodeCache.NewEntry( file, layout);
+  if (entry==NULL) return (RETURN_OK); // too large for the cache
+  for (UINT f=0u; f<layout.Faces; f++) for (UINT l=0u; l<layout.Levels; l++)
+    memcpy( entry->Layout.Bits[f][l], layout.Bits[f][l], layout.Pitch[l]*layout.Rows[l]*layout.Slices[l]);
+  return (Server->DecodeCache.Insert( entry));
+}
 
-int uMod_TextureClient::LookUpToMod( MyTypeHash hash, int num_index_list, int *index_list)
+int uMod_TextureClient::StoreDecoded( TextureFileStruct* file, uMod_IDirect3DTexture9* pTexture)
 {
-  if(NumberToMod>0)
+  if (Server==NULL) return (RETURN_OK);
+  IDirect3DTexture9 *pD3Dtex = pTexture->m_D3Dtex;
+  D3DSURFACE_DESC desc;
+  if (D3D_OK!=pD3Dtex->GetLevelDesc( 0, &desc)) return (RETURN_TEXTURE_NOT_LOADED);
+
+  uMod_DDSLayout layout;
+  bool compressed;
+  unsigned int bytes = uMod_GetFormatSize( desc.Format, compressed);
+  layout.Type = uMod_DDS_TEXTURE;
+  layout.Format = desc.Format;
+  layout.Width = desc.Width;
+  layout.Height = desc.Height;
+  layout.Depth = 1u;
+  layout.Levels = pD3Dtex->GetLevelCount();
+  layout.Faces = 1u;
+  if (bytes==0u || layout.Levels>uMod_DDS_MAX_LEVELS) return (RETURN_OK); // this texture is not cached
+  uMod_SetLevelSizes( layout, bytes, compressed);
+
+  uMod_DecodedTexture* entry = Server->DecodeCache.NewEntry( file, layout);
+  if (entry==NULL) return (RETURN_OK); // too large for the cache
+  for (UINT l=0u; l<layout.Levels; l++)
   {
-    if (index_list==NULL || num_index_list==0)
-    {
-      if (hash<FileToMod[0].Hash || hash>FileToMod[NumberToMod-1].Hash) return (-1);
-      int pos = NumberToMod/2;
-      int begin = 0;
-      int end = NumberToMod-1;
+    D3DLOCKED_RECT d3dlr;
+    if (D3D_OK!=pD3Dtex->LockRect( l, &d3dlr, NULL, D3DLOCK_READONLY)) {uMod_DecodeCache::DeleteEntry( entry); return (RETURN_TEXTURE_NOT_LOADED);}
+    uMod_ReadRows( (char*) d3dlr.pBits, d3dlr.Pitch, layout.Rows[l], entry->Layout.Bits[0][l], layout.Pitch[l]);
+    pD3Dtex->UnlockRect(l);
+  }
+  return (Server->DecodeCache.Insert( entry));
+}
 
-      // We look in the middle of the interval and each step we halve the interval,
-      // unless we find the texture or the size of the interval is less than 3.
-      // Note: contradicting to normal C-code here the interval includes the index "begin" and "end"!
-      while (begin+1<end) // as long as the interval is longer than two
-      {
-        if (hash > FileToMod[pos].Hash) // the new interval is the right half of the actual interval
-        {
-          begin = pos+1; // the new interval does not contain the index "pos"
-          pos = (begin + end)/2; // set "pos" somewhere inside the new interval
-        }
-        else if (hash < FileToMod[pos].Hash) // the new interval is the left half of the actual interval
-        {
-          end = pos-1; // the new interval does not contain the index "pos"
-          pos = (begin + end)/2; // set "pos" somewhere inside the new interval
-        }
-        else {return (pos); break;} // we hit the correct hash
-      }
-      for ( pos=begin; pos<=end; pos++) if (FileToMod[pos].Hash==hash) return (pos);
-    }
-    else
-    {
-      if (hash<FileToMod[index_list[0]].Hash || hash>FileToMod[index_list[num_index_list-1]].Hash) return (-1);
-      int pos = num_index_list/2;
-      int begin = 0;
-      int end = num_index_list-1;
+int uMod_TextureClient::StoreDecoded( TextureFileStruct* file, uMod_IDirect3DVolumeTexture9* pTexture)
+{
+  if (Server==NULL) return (RETURN_OK);
+  IDirect3DVolumeTexture9 *pD3Dtex = pTexture->m_D3Dtex;
+  D3DVOLUME_DESC desc;
+  if (D3D_OK!=pD3Dtex->GetLevelDesc( 0, &desc)) return (RETURN_TEXTURE_NOT_LOADED);
+
+  uMod_DDSLayout layout;
+  bool compressed;
+  unsigned int bytes = uMod_GetFormatSize( desc.Format, compressed);
+  layout.Type = uMod_DDS_VOLUME_TEXTURE;
+  layout.Format = desc.Format;
+  layout.Width = desc.Width;
+  layout.Height = desc.Height;
+  layout.Depth = desc.Depth;
+  layout.Levels = pD3Dtex->GetLevelCount();
+  layout.Faces = 1u;
+  if (bytes==0u || layout.Levels>uMod_DDS_MAX_LEVELS) return (RETURN_OK); // this texture is not cached
+  uMod_SetLevelSizes( layout, bytes, compressed);
+
+  uMod_DecodedTexture* entry = Server->DecodeCache.NewEntry( file, layout);
+  if (entry==NULL) return (RETURN_OK); // too large for the cache
+  for (UINT l=0u; l<layout.Levels; l++)
+  {
+    D3DLOCKED_BOX d3dlr;
+    if (D3D_OK!=pD3Dtex->LockBox( l, &d3dlr, NULL, D3DLOCK_READONLY)) {uMod_DecodeCache::DeleteEntry( entry); return (RETURN_TEXTURE_NOT_LOADED);}
+    unsigned int slice = layout.Pitch[l]*layout.Rows[l];
+    for (UINT s=0u; s<layout.Slices[l]; s++)
+      uMod_ReadRows( (char*) d3dlr.pBits + s*d3dlr.SlicePitch, d3dlr.RowPitch, layout.Rows[l], entry->Layout.Bits[0][l] + s*slice, layout.Pitch[l]);
+    pD3Dtex->UnlockBox(l);
+  }
+  return (Server->DecodeCache.Insert( entry));
+}
 
-      // We look in the middle of the interval and each step we halve the interval,
-      // unless we find the texture or the size of the interval is less than 3.
-      // Note: contradicting to normal C-code here the interval includes the index "begin" and "end"!
-      while (begin+1<end) // as long as the interval is longer than two
-      {
-        if (hash > FileToMod[index_list[pos]].Hash) // the new interval is the right half of the actual interval
-        {
-          begin = pos+1; // the new interval does not contain the index "pos"
-          pos = (begin + end)/2; // set "pos" somewhere inside the new interval
-        }
-        else if (hash < FileToMod[index_list[pos]].Hash) // the new interval is the left half of the actual interval
-        {
-          end = pos-1; // the new interval does not contain the index "pos"
-          pos = (begin + end)/2; // set "pos" somewhere inside the new interval
-        }
-        else {return (index_list[pos]); break;} // we hit the correct hash
-      }
-      for ( pos=begin; pos<=end; pos++) if (FileToMod[index_list[pos]].Hash==hash) return (index_list[pos]);
-    }
+int uMod_TextureClient::StoreDecoded( TextureFileStruct* file, uMod_IDirect3DCubeTexture9* pTexture)
+{
+  if (Server==NULL) return (RETURN_OK);
+  IDirect3DCubeTexture9 *pD3Dtex = pTexture->m_D3Dtex;
+  D3DSURFACE_DESC desc;
+  if (D3D_OK!=pD3Dtex->GetLevelDesc( 0, &desc)) return (RETURN_TEXTURE_NOT_LOADED);
+
+  uMod_DDSLayout layout;
+  bool compressed;
+  unsigned int bytes = uMod_GetFormatSize( desc.Format, compressed);
+  layout.Type = uMod_DDS_CUBE_TEXTURE;
+  layout.Format = desc.Format;
+  layout.Width = desc.Width;
+  layout.Height = desc.Height;
+  layout.Depth = 1u;
+  layout.Levels = pD3Dtex->GetLevelCount();
+  layout.Faces = 6u;
+  if (bytes==0u || layout.Levels>uMod_DDS_MAX_LEVELS) return (RETURN_OK); // this texture is not cached
+  uMod_SetLevelSizes( layout, bytes, compressed);
+
+  uMod_DecodedTexture* entry = Server->DecodeCache.NewEntry( file, layout);
+  if (entry==NULL) return (RETURN_OK); // too large for the cache
+  for (UINT f=0u; f<6u; f++) for (UINT l=0u; l<layout.Levels; l++)
+  {
+    D3DLOCKED_RECT d3dlr;
+    if (D3D_OK!=pD3Dtex->LockRect( (D3DCUBEMAP_FACES) f, l, &d3dlr, NULL, D3DLOCK_READONLY)) {uMod_DecodeCache::DeleteEntry( entry); return (RETURN_TEXTURE_NOT_LOADED);}
+    uMod_ReadRows( (char*) d3dlr.pBits, d3dlr.Pitch, layout.Rows[l], entry->Layout.Bits[f][l], layout.Pitch[l]);
+    pD3Dtex->UnlockRect( (D3DCUBEMAP_FACES) f, l);
   }
-  return (-1);
+  return (Server->DecodeCache.Insert( entry));
+}
+
+
+
+int uMod_TextureClient::LockMutex(void)
+{
+  if (( gl_ErrorState & (uMod_ERROR_FATAL | uMod_ERROR_MUTEX) )) return (RETURN_NO_MUTEX);
+  if (WAIT_OBJECT_0!=WaitForSingleObject( Mutex, 100)) return (RETURN_MUTEX_LOCK); //waiting 100ms, to wait infinite pass INFINITE
+  return  (RETURN_OK);
 }
 
-int uMod_TextureClient::LookUpToMod( uMod_IDirect3DTexture9* pTexture, int num_index_list, int *index_list) // should only be called for original textures
+int uMod_TextureClient::UnlockMutex(void)
+{
+  if (ReleaseMutex(Mutex)==0) return (RETURN_MUTEX_UNLOCK);
+  return  (RETURN_OK);
+}
+
+
+
+
+
+int uMod_TextureClient::LookUpToMod( uMod_IDirect3DTexture9* pTexture, uMod_HashIndex *hash_index) // should only be called for original textures
 {
   Message("uMod_TextureClient::LookUpToMod( %lu): hash: %#lX,  %lu\n", pTexture, pTexture->Hash, this);
   if (pTexture->CrossRef_D3Dtex!=NULL) return (RETURN_OK); // bug, this texture is already switched
-  int index = LookUpToMod( pTexture->Hash, num_index_list, index_list);
+  if (pTexture->HashJob!=NULL) return (RETURN_OK); // the hash is not calculated yet, MergeHashes() will call this function again
+  if (hash_index==NULL) hash_index = &FileToModIndex; // look through all entries
+  int index = hash_index->Find( pTexture->Hash);
+  if (index>=0 && FileToMod[index].pData==NULL) return (RequestFile( &FileToMod[index])); // lazy mode, the fetched file content triggers a new look up
   if (index>=0)
   {
     uMod_IDirect3DTexture9 *fake_Texture;
+    if (ShareFakeTexture( index, &fake_Texture)==RETURN_OK) return (SwitchFakeTexture( fake_Texture, pTexture, index)); // another original has the same hash
+    // the fake texture is created in MergeLoads(), unless it is only a copy out of the decode cache
+    if (LoadPool.IsRunning() && (Server==NULL || !Server->DecodeCache.Contains( FileToMod[index].Hash, FileToMod[index].Generation, uMod_DDS_TEXTURE)))
+      return (SubmitLoad( pTexture, index));
     if (int ret = LoadTexture( & (FileToMod[index]), &fake_Texture)) return (ret);
-    if (SwitchTextures( fake_Texture, pTexture))
-    {
-      Message("uMod_TextureClient::LookUpToMod(): textures not switched %#lX\n", FileToMod[index].Hash);
-      fake_Texture->Release();
-    }
-    else
-    {
-      IDirect3DBaseTexture9 **temp = new IDirect3DBaseTexture9*[FileToMod[index].NumberOfTextures+1];
-      for (int j=0; j<FileToMod[index].NumberOfTextures; j++) temp[j] = FileToMod[index].Textures[j];
-
-      if (FileToMod[index].Textures!=NULL) delete [] FileToMod[index].Textures;
-      FileToMod[index].Textures = temp;
+    return (SwitchFakeTexture( fake_Texture, pTexture, index));
+  }
+  return (RETURN_OK);
+}
 
-      FileToMod[index].Textures[FileToMod[index].NumberOfTextures++] = fake_Texture;
-      fake_Texture->Reference = index;
-    }
+int uMod_TextureClient::SwitchFakeTexture( uMod_IDirect3DTexture9* fake_Texture, uMod_IDirect3DTexture9* pTexture, int index)
+{
+  if (SwitchTextures( fake_Texture, pTexture))
+  {
+    Message("uMod_TextureClient::SwitchFakeTexture(): textures not switched %#lX\n", FileToModHash[index]);
+    fake_Texture->Release();
+  }
+  else if (int ret = AddFakeTexture( FileToModTextures[index], fake_Texture))
+  {
+    fake_Texture->Release(); // switches the textures back
+    return (ret);
   }
+  else fake_Texture->Reference = index;
   return (RETURN_OK);
 }
 
-int uMod_TextureClient::LookUpToMod( uMod_IDirect3DVolumeTexture9* pTexture, int num_index_list, int *index_list) // should only be called for original textures
+int uMod_TextureClient::LookUpToMod( uMod_IDirect3DVolumeTexture9* pTexture, uMod_HashIndex *hash_index) // should only be called for original textures
 {
   Message("uMod_TextureClient::LookUpToMod( Volume %lu): hash: %#lX,  %lu\n", pTexture, pTexture->Hash, this);
   if (pTexture->CrossRef_D3Dtex!=NULL) return (RETURN_OK); // bug, this texture is already switched
-  int index = LookUpToMod( pTexture->Hash, num_index_list, index_list);
+  if (pTexture->HashJob!=NULL) return (RETURN_OK); // the hash is not calculated yet, MergeHashes() will call this function again
+  if (hash_index==NULL) hash_index = &FileToModIndex; // look through all entries
+  int index = hash_index->Find( pTexture->Hash);
+  if (index>=0 && FileToMod[index].pData==NULL) return (RequestFile( &FileToMod[index])); // lazy mode, the fetched file content triggers a new look up
   if (index>=0)
   {
     uMod_IDirect3DVolumeTexture9 *fake_Texture;
-    if (int ret = LoadTexture( & (FileToMod[index]), &fake_Texture)) return (ret);
+    if (int ret = NewFakeTexture( index, &fake_Texture)) return (ret);
     if (SwitchTextures( fake_Texture, pTexture))
     {
-      Message("uMod_TextureClient::LookUpToMod(): textures not switched %#lX\n", FileToMod[index].Hash);
+      Message("uMod_TextureClient::LookUpToMod(): textures not switched %#lX\n", FileToModHash[index]);
       fake_Texture->Release();
     }
-    else
+    else if (int ret = AddFakeTexture( FileToModTextures[index], fake_Texture))
     {
-      IDirect3DBaseTexture9 **temp = new IDirect3DBaseTexture9*[FileToMod[index].NumberOfTextures+1];
-      for (int j=0; j<FileToMod[index].NumberOfTextures; j++) temp[j] = FileToMod[index].Textures[j];
-
-      if (FileToMod[index].Textures!=NULL) delete [] FileToMod[index].Textures;
-      FileToMod[index].Textures = temp;
-
-      FileToMod[index].Textures[FileToMod[index].NumberOfTextures++] = fake_Texture;
-      fake_Texture->Reference = index;
+      fake_Texture->Release(); // switches the textures back
+      return (ret);
     }
+    else fake_Texture->Reference = index;
   }
   return (RETURN_OK);
 }
 
-int uMod_TextureClient::LookUpToMod( uMod_IDirect3DCubeTexture9* pTexture, int num_index_list, int *index_list) // should only be called for original textures
+int uMod_TextureClient::LookUpToMod( uMod_IDirect3DCubeTexture9* pTexture, uMod_HashIndex *hash_index) // should only be called for original textures
 {
   Message("uMod_TextureClient::LookUpToMod( Cube %lu): hash: %#lX,  %lu\n", pTexture, pTexture->Hash, this);
   if (pTexture->CrossRef_D3Dtex!=NULL) return (RETURN_OK); // bug, this texture is already switched
-  int index = LookUpToMod( pTexture->Hash, num_index_list, index_list);
+  if (pTexture->HashJob!=NULL) return (RETURN_OK); // the hash is not calculated yet, MergeHashes() will call this function again
+  if (hash_index==NULL) hash_index = &FileToModIndex; // look through all entries
+  int index = hash_index->Find( pTexture->Hash);
+  if (index>=0 && FileToMod[index].pData==NULL) return (RequestFile( &FileToMod[index])); // lazy mode, the fetched file content triggers a new look up
   if (index>=0)
   {
     uMod_IDirect3DCubeTexture9 *fake_Texture;
-    if (int ret = LoadTexture( & (FileToMod[index]), &fake_Texture)) return (ret);
+    if (int ret = NewFakeTexture( index, &fake_Texture)) return (ret);
     if (SwitchTextures( fake_Texture, pTexture))
     {
-      Message("uMod_TextureClient::LookUpToMod(): textures not switched %#lX\n", FileToMod[index].Hash);
+      Message("uMod_TextureClient::LookUpToMod(): textures not switched %#lX\n", FileToModHash[index]);
       fake_Texture->Release();
     }
-    else
+    else if (int ret = AddFakeTexture( FileToModTextures[index], fake_Texture))
     {
-      IDirect3DBaseTexture9 **temp = new IDirect3DBaseTexture9*[FileToMod[index].NumberOfTextures+1];
-      for (int j=0; j<FileToMod[index].NumberOfTextures; j++) temp[j] = FileToMod[index].Textures[j];
-
-      if (FileToMod[index].Textures!=NULL) delete [] FileToMod[index].Textures;
-      FileToMod[index].Textures = temp;
-
-      FileToMod[index].Textures[FileToMod[index].NumberOfTextures++] = fake_Texture;
-      fake_Texture->Reference = index;
+      fake_Texture->Release(); // switches the textures back
+      return (ret);
     }
+    else fake_Texture->Reference = index;
   }
   return (RETURN_OK);
 }
@@ -798,9 +1503,61 @@ int uMod_TextureClient::LookUpToMod( uMod_IDirect3DCubeTexture9* pTexture, int n
 
 
 
+int uMod_TextureClient::RequestFile( TextureFileStruct* file) // lazy mode, the file content is fetched from uMod_GUI
+{
+  DWORD now = GetTickCount();
+  // each entry is requested only once, unless the answer exceeds the latency budget (the request is repeated on the next look up)
+  if (file->Requested!=0 && now - file->Requested < uMod_FETCH_TIMEOUT) return (RETURN_OK);
+  file->Requested = now | 1u; // 0 means not requested
+  Message("RequestFile( %#lX): %lu\n", file->Hash, this);
+  if (Server==NULL) return (RETURN_OK);
+  return (Server->RequestFile( file->Hash));
+}
+
 int uMod_TextureClient::LoadTexture( TextureFileStruct* file_in_memory, uMod_IDirect3DTexture9 **ppTexture) // to load fake texture from a file in memory
 {
   Message("LoadTexture( %lu, %lu, %#lX): %lu\n", file_in_memory, ppTexture, file_in_memory->Hash, this);
+  if (file_in_memory->pData==NULL) // lazy mode, the file content is not fetched yet
+  {
+    *ppTexture=NULL;
+    RequestFile( file_in_memory);
+    return (RETURN_TEXTURE_NOT_LOADED);
+  }
+
+  uMod_DecodedTexture* decoded = AcquireDecoded( file_in_memory, uMod_DDS_TEXTURE);
+  if (decoded!=NULL) // the texture was decoded before, e.g. by another device or before a Reset()
+  {
+    int ret = UploadTexture( decoded->Layout, ppTexture);
+    ReleaseDecoded( decoded);
+    if (ret==RETURN_OK)
+    {
+      Message("LoadTexture( %lu, %#lX): DONE (cached)\n", *ppTexture, file_in_memory->Hash);
+      return (RETURN_OK);
+    }
+  }
+
+  uMod_DDSLayout layout;
+  if (uMod_ParseDDS( file_in_memory->pData, file_in_memory->Size, layout)==RETURN_OK && layout.Type==uMod_DDS_TEXTURE)
+  {
+    unsigned int size = uMod_GetStagingSize( layout);
+    char *staging = NULL;
+    if (size>0u)
+    {
+      try {staging = new char[size];}
+      catch (...) {staging = NULL;}
+      if (staging!=NULL) uMod_GenerateMipMaps( layout, staging);
+    }
+    int ret = RETURN_TEXTURE_NOT_LOADED;
+    if (size==0u || staging!=NULL) ret = UploadTexture( layout, ppTexture);
+    if (ret==RETURN_OK && staging!=NULL) StoreDecoded( file_in_memory, layout); // only the generated levels are worth to be cached
+    if (staging!=NULL) delete [] staging;
+    if (ret==RETURN_OK)
+    {
+      Message("LoadTexture( %lu, %#lX): DONE (dds)\n", *ppTexture, file_in_memory->Hash);
+      return (RETURN_OK);
+    }
+  }
+
   if (D3D_OK != D3DXCreateTextureFromFileInMemoryEx( D3D9Device, file_in_memory->pData, file_in_memory->Size, D3DX_DEFAULT, D3DX_DEFAULT, D3DX_DEFAULT, 0, D3DFMT_UNKNOWN, D3DPOOL_MANAGED, D3DX_DEFAULT, D3DX_DEFAULT, 0, NULL, NULL, (IDirect3DTexture9 **) ppTexture))
   //if (D3D_OK != D3DXCreateTextureFromFileInMemory( D3D9Device, file_in_memory->pData, file_in_memory->Size, (IDirect3DTexture9 **) ppTexture))
   {
@@ -809,11 +1566,10 @@ int uMod_TextureClient::LoadTexture( TextureFileStruct* file_in_memory, uMod_IDi
   }
   (*ppTexture)->FAKE = true;
 
-  void *cpy;
-  long ret = D3D9Device->QueryInterface( IID_IDirect3DTexture9, &cpy);
-  if (ret == 0x01000000L) ((uMod_IDirect3DDevice9*)D3D9Device)->SetLastCreatedTexture(NULL); //this texture must no be added twice
+  if (!DeviceEx) ((uMod_IDirect3DDevice9*)D3D9Device)->SetLastCreatedTexture(NULL); //this texture must no be added twice
   else  ((uMod_IDirect3DDevice9Ex*) D3D9Device)->SetLastCreatedTexture(NULL); //this texture must no be added twice
 
+  if (!FirstLoad( file_in_memory)) StoreDecoded( file_in_memory, *ppTexture); // it is created again, the next instance is only a copy
   Message("LoadTexture( %lu, %#lX): DONE\n", *ppTexture, file_in_memory->Hash);
   return (RETURN_OK);
 }
@@ -821,6 +1577,33 @@ int uMod_TextureClient::LoadTexture( TextureFileStruct* file_in_memory, uMod_IDi
 int uMod_TextureClient::LoadTexture( TextureFileStruct* file_in_memory, uMod_IDirect3DVolumeTexture9 **ppTexture) // to load fake texture from a file in memory
 {
   Message("LoadTexture( Volume %lu, %lu, %#lX): %lu\n", file_in_memory, ppTexture, file_in_memory->Hash, this);
+  if (file_in_memory->pData==NULL) // lazy mode, the file content is not fetched yet
+  {
+    *ppTexture=NULL;
+    RequestFile( file_in_memory);
+    return (RETURN_TEXTURE_NOT_LOADED);
+  }
+
+  uMod_DecodedTexture* decoded = AcquireDecoded( file_in_memory, uMod_DDS_VOLUME_TEXTURE);
+  if (decoded!=NULL) // the texture was decoded before, e.g. by another device or before a Reset()
+  {
+    int ret = UploadTexture( decoded->Layout, ppTexture);
+    ReleaseDecoded( decoded);
+    if (ret==RETURN_OK)
+    {
+      Message("LoadTexture( Volume %lu, %#lX): DONE (cached)\n", *ppTexture, file_in_memory->Hash);
+      return (RETURN_OK);
+    }
+  }
+
+  uMod_DDSLayout layout;
+  if (uMod_ParseDDS( file_in_memory->pData, file_in_memory->Size, layout)==RETURN_OK && layout.Type==uMod_DDS_VOLUME_TEXTURE
+      && UploadTexture( layout, ppTexture)==RETURN_OK)
+  {
+    Message("LoadTexture( Volume %lu, %#lX): DONE (dds)\n", *ppTexture, file_in_memory->Hash);
+    return (RETURN_OK);
+  }
+
   if (D3D_OK != D3DXCreateVolumeTextureFromFileInMemoryEx( D3D9Device, file_in_memory->pData, file_in_memory->Size, D3DX_DEFAULT, D3DX_DEFAULT, D3DX_DEFAULT, D3DX_DEFAULT, 0, D3DFMT_UNKNOWN, D3DPOOL_MANAGED, D3DX_DEFAULT, D3DX_DEFAULT, 0, NULL, NULL, (IDirect3DVolumeTexture9 **) ppTexture))
   //if (D3D_OK != D3DXCreateVolumeTextureFromFileInMemory( D3D9Device, file_in_memory->pData, file_in_memory->Size, (IDirect3DVolumeTexture9 **) ppTexture))
   {
@@ -829,11 +1612,10 @@ int uMod_TextureClient::LoadTexture( TextureFileStruct* file_in_memory, uMod_IDi
   }
   (*ppTexture)->FAKE = true;
 
-  void *cpy;
-  long ret = D3D9Device->QueryInterface( IID_IDirect3DTexture9, &cpy);
-  if (ret == 0x01000000L) ((uMod_IDirect3DDevice9*)D3D9Device)->SetLastCreatedVolumeTexture(NULL); //this texture must no be added twice
+  if (!DeviceEx) ((uMod_IDirect3DDevice9*)D3D9Device)->SetLastCreatedVolumeTexture(NULL); //this texture must no be added twice
   else  ((uMod_IDirect3DDevice9Ex*) D3D9Device)->SetLastCreatedVolumeTexture(NULL); //this texture must no be added twice
 
+  if (!FirstLoad( file_in_memory)) StoreDecoded( file_in_memory, *ppTexture); // it is created again, the next instance is only a copy
   Message("LoadTexture( Volume %lu, %#lX): DONE\n", *ppTexture, file_in_memory->Hash);
   return (RETURN_OK);
 }
@@ -841,6 +1623,33 @@ int uMod_TextureClient::LoadTexture( TextureFileStruct* file_in_memory, uMod_IDi
 int uMod_TextureClient::LoadTexture( TextureFileStruct* file_in_memory, uMod_IDirect3DCubeTexture9 **ppTexture) // to load fake texture from a file in memory
 {
   Message("LoadTexture( Cube %lu, %lu, %#lX): %lu\n", file_in_memory, ppTexture, file_in_memory->Hash, this);
+  if (file_in_memory->pData==NULL) // lazy mode, the file content is not fetched yet
+  {
+    *ppTexture=NULL;
+    RequestFile( file_in_memory);
+    return (RETURN_TEXTURE_NOT_LOADED);
+  }
+
+  uMod_DecodedTexture* decoded = AcquireDecoded( file_in_memory, uMod_DDS_CUBE_TEXTURE);
+  if (decoded!=NULL) // the texture was decoded before, e.g. by another device or before a Reset()
+  {
+    int ret = UploadTexture( decoded->Layout, ppTexture);
+    ReleaseDecoded( decoded);
+    if (ret==RETURN_OK)
+    {
+      Message("LoadTexture( Cube %lu, %#lX): DONE (cached)\n", *ppTexture, file_in_memory->Hash);
+      return (RETURN_OK);
+    }
+  }
+
+  uMod_DDSLayout layout;
+  if (uMod_ParseDDS( file_in_memory->pData, file_in_memory->Size, layout)==RETURN_OK && layout.Type==uMod_DDS_CUBE_TEXTURE
+      && UploadTexture( layout, ppTexture)==RETURN_OK)
+  {
+    Message("LoadTexture( Cube %lu, %#lX): DONE (dds)\n", *ppTexture, file_in_memory->Hash);
+    return (RETURN_OK);
+  }
+
   if (D3D_OK != D3DXCreateCubeTextureFromFileInMemoryEx( D3D9Device, file_in_memory->pData, file_in_memory->Size, D3DX_DEFAULT, D3DX_DEFAULT, 0, D3DFMT_UNKNOWN, D3DPOOL_MANAGED, D3DX_DEFAULT, D3DX_DEFAULT, 0, NULL, NULL, (IDirect3DCubeTexture9 **) ppTexture))
   //if (D3D_OK != D3DXCreateCubeTextureFromFileInMemory( D3D9Device, file_in_memory->pData, file_in_memory->Size, (IDirect3DCubeTexture9 **) ppTexture))
   {
@@ -849,11 +1658,10 @@ int uMod_TextureClient::LoadTexture( TextureFileStruct* file_in_memory, uMod_IDi
   }
   (*ppTexture)->FAKE = true;
 
-  void *cpy;
-  long ret = D3D9Device->QueryInterface( IID_IDirect3DTexture9, &cpy);
-  if (ret == 0x01000000L) ((uMod_IDirect3DDevice9*)D3D9Device)->SetLastCreatedCubeTexture(NULL); //this texture must no be added twice
+  if (!DeviceEx) ((uMod_IDirect3DDevice9*)D3D9Device)->SetLastCreatedCubeTexture(NULL); //this texture must no be added twice
   else  ((uMod_IDirect3DDevice9Ex*) D3D9Device)->SetLastCreatedCubeTexture(NULL); //this texture must no be added twice
 
+  if (!FirstLoad( file_in_memory)) StoreDecoded( file_in_memory, *ppTexture); // it is created again, the next instance is only a copy
   Message("LoadTexture( Cube %lu, %#lX): DONE\n", *ppTexture, file_in_memory->Hash);
   return (RETURN_OK);
 }
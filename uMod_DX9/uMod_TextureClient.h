@@ -23,11 +23,14 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 
 #include "uMod_IDirect3DTexture9.h"
 #include "uMod_IDirect3DDevice9.h"
+#include "uMod_LoadPool.h"
 #include "..\uMod_Error.h"
 
 
 class uMod_TextureServer;
 
+#define uMod_FETCH_TIMEOUT 2000 // in ms, latency budget of a fetch request (lazy mode), afterwards the file content is requested again
+
 /*
  *  An object of this class is owned by each d3d9 device.
  *  functions called by the Server are called from the server thread instance.
@@ -37,7 +40,7 @@ class uMod_TextureServer;
 class uMod_TextureClient
 {
 public:
-  uMod_TextureClient(uMod_TextureServer* server, IDirect3DDevice9* device);
+  uMod_TextureClient(uMod_TextureServer* server, IDirect3DDevice9* device, bool device_ex);
   ~uMod_TextureClient(void);
 
   int AddTexture( uMod_IDirect3DTexture9* tex); //called from uMod_IDirect3DDevice9::CreateTexture(...) or uMod_IDirect3DDevice9::BeginScene()
@@ -68,12 +71,16 @@ public:
   int SetTextureColour( DWORD r, DWORD g, DWORD b) {TextureColour = D3DCOLOR_ARGB(255, r,g,b); return (RETURN_OK);} //called from the Server
 
 
-  int AddUpdate(TextureFileStruct* update, int number);  //called from the Server, client object must delete update array
+  int AddUpdate(TextureFileStruct* update, int number, int version);  //called from the Server, client object must delete update array
+  int AddDelta(TextureChangeStruct* delta, int number, int base_version, int version);  //called from the Server, client object must delete delta array, returns RETURN_UPDATE_OUT_OF_DATE if a full update is needed
   int MergeUpdate(void); //called from uMod_IDirect3DDevice9::BeginScene()
+  int MergeHashes(void); //called from uMod_IDirect3DDevice9::BeginScene(), collects the hashes calculated by the worker threads
+  int MergeLoads(void); //called from uMod_IDirect3DDevice9::BeginScene(), creates the fake textures prepared by the worker threads
+  int GetMergedVersion(void) {return (MergedVersion);} //called from the Server, the client does not reference file content, which was removed before this version
 
-  int LookUpToMod( uMod_IDirect3DTexture9* pTexture, int num_index_list=0, int *index_list=NULL); // called at the end AddTexture(...) and from Device->UpdateTexture(...)
-  int LookUpToMod( uMod_IDirect3DVolumeTexture9* pTexture, int num_index_list=0, int *index_list=NULL); // called at the end AddTexture(...) and from Device->UpdateTexture(...)
-  int LookUpToMod( uMod_IDirect3DCubeTexture9* pTexture, int num_index_list=0, int *index_list=NULL); // called at the end AddTexture(...) and from Device->UpdateTexture(...)
+  int LookUpToMod( uMod_IDirect3DTexture9* pTexture, uMod_HashIndex *hash_index=NULL); // called at the end AddTexture(...) and from Device->UpdateTexture(...)
+  int LookUpToMod( uMod_IDirect3DVolumeTexture9* pTexture, uMod_HashIndex *hash_index=NULL); // called at the end AddTexture(...) and from Device->UpdateTexture(...)
+  int LookUpToMod( uMod_IDirect3DCubeTexture9* pTexture, uMod_HashIndex *hash_index=NULL); // called at the end AddTexture(...) and from Device->UpdateTexture(...)
 
   uMod_TextureHandler<uMod_IDirect3DTexture9> OriginalTextures; // stores the pointer to the uMod_IDirect3DTexture9 objects created by the game
   uMod_TextureHandler<uMod_IDirect3DVolumeTexture9> OriginalVolumeTextures; // stores the pointer to the uMod_IDirect3DVolumeTexture9 objects created by the game
@@ -91,24 +98,83 @@ public:
 private:
   uMod_TextureServer* Server;
   IDirect3DDevice9* D3D9Device;
+  bool DeviceEx; // D3D9Device is a uMod_IDirect3DDevice9Ex object
   wchar_t SavePath[MAX_PATH];
   wchar_t GameName[MAX_PATH];
 
   TextureFileStruct* Update;
+  MyTypeHash* UpdateHash;
+  FakeTextureListStruct* UpdateTextures;
   int NumberOfUpdate;
+  int UpdateVersion;
+
+  TextureChangeStruct* Delta; // changes since the last update
+  int NumberOfDelta;
+  int DeltaVersion;
+  int MergedDelta; // number of changes of Delta, which are already applied (if MergeDelta() has failed in between)
 
   int LockMutex();
   int UnlockMutex();
   HANDLE Mutex;
 
-  int NumberToMod; // number of texture to be modded
-  TextureFileStruct* FileToMod; // array which stores the file in memory and the hash of each texture to be modded
+  uMod_HashPool HashPool; // worker threads, which calculate the hash of newly added textures
+  uMod_LoadPool LoadPool; // worker threads, which prepare the fake textures
+  int LoadsInFlight; // number of load jobs, which are not deleted yet (they reference the file content)
+  uMod_LoadJob* ReadyFirst; // finished load jobs, which wait for MergeLoads()
+  uMod_LoadJob* ReadyLast;
+  uMod_LoadJob* OldestLoad; // jobs in flight, ordered by their version (the oldest one limits the acknowledged version)
+  uMod_LoadJob* NewestLoad;
 
-
-  int LookUpToMod( MyTypeHash hash, int num_index_list, int *index_list); // called from LookUpToMod(...);
+  // The table of textures to be modded is stored column wise, the hot hash column is separated from the cold data.
+  // The entries are not sorted, they are found through FileToModIndex.
+  int NumberToMod; // number of texture to be modded
+  int LengthToMod; // number of allocated entries
+  int Version; // version of the last merged update
+  volatile LONG MergedVersion; // is set to Version after each merge (acknowledge for the server)
+  MyTypeHash* FileToModHash; // hash of each texture to be modded
+  TextureFileStruct* FileToMod; // array which stores the file in memory of each texture to be modded
+  FakeTextureListStruct* FileToModTextures; // the fake textures of each texture to be modded
+  uMod_HashIndex FileToModIndex; // maps the hash onto the index in FileToMod, is rebuild whenever FileToMod changes
+
+
+  int NewColumns( TextureFileStruct* files, int number, MyTypeHash* &hash, FakeTextureListStruct* &textures); // allocates and fills the hash and fake texture column
+
+  int MergeFullUpdate(void); // called from MergeUpdate()
+  int MergeDelta(void); // called from MergeUpdate()
+  int LookUpNewEntries( int num_to_lookup, int *to_lookup); // called from MergeFullUpdate() and MergeDelta()
+  int AddEntry( TextureFileStruct* file); // called from MergeDelta()
+  int RemoveEntry( int index); // called from MergeDelta()
+  int ReleaseFakeTextures( FakeTextureListStruct &list);
+  int AddFakeTexture( FakeTextureListStruct &list, IDirect3DBaseTexture9* fake_Texture);
+  int SetFakeReference( FakeTextureListStruct &list, int ref);
+  int ReloadFakeTextures( int index); // called if the file content of an entry has changed
+  int RequestFile( TextureFileStruct* file); // called from LookUpToMod() and LoadTexture(), if the file content is not fetched yet (lazy mode)
   int LoadTexture( TextureFileStruct* file_in_memory, uMod_IDirect3DTexture9 **ppTexture); // called if a target texture is found
   int LoadTexture( TextureFileStruct* file_in_memory, uMod_IDirect3DVolumeTexture9 **ppTexture); // called if a target texture is found
   int LoadTexture( TextureFileStruct* file_in_memory, uMod_IDirect3DCubeTexture9 **ppTexture); // called if a target texture is found
+  int SubmitLoad( uMod_IDirect3DTexture9* pTexture, int index); // called from LookUpToMod(), if the load pool is running
+  int FinishLoad( uMod_LoadJob* job); // called from MergeLoads()
+  int UploadTexture( uMod_DDSLayout &layout, uMod_IDirect3DTexture9 **ppTexture); // copies the levels into a new texture (without D3DX)
+  int UploadTexture( uMod_DDSLayout &layout, uMod_IDirect3DVolumeTexture9 **ppTexture);
+  int UploadTexture( uMod_DDSLayout &layout, uMod_IDirect3DCubeTexture9 **ppTexture);
+  int SwitchFakeTexture( uMod_IDirect3DTexture9* fake_Texture, uMod_IDirect3DTexture9* pTexture, int index);
+
+  // All originals with the same hash share one d3d texture, each of them is switched with its own fake texture object.
+  int ShareFakeTexture( int index, uMod_IDirect3DTexture9 **ppTexture); // returns RETURN_OK, if an other fake texture of this entry exists
+  int ShareFakeTexture( int index, uMod_IDirect3DVolumeTexture9 **ppTexture);
+  int ShareFakeTexture( int index, uMod_IDirect3DCubeTexture9 **ppTexture);
+  int NewFakeTexture( int index, uMod_IDirect3DTexture9 **ppTexture); // shares or loads the fake texture
+  int NewFakeTexture( int index, uMod_IDirect3DVolumeTexture9 **ppTexture);
+  int NewFakeTexture( int index, uMod_IDirect3DCubeTexture9 **ppTexture);
+
+  uMod_DecodedTexture* AcquireDecoded( TextureFileStruct* file, int type); // returns NULL, if the file content is not in the decode cache of the server
+  int ReleaseDecoded( uMod_DecodedTexture* entry);
+  int StoreDecoded( TextureFileStruct* file, uMod_DDSLayout &layout); // copies the levels into the decode cache
+  bool FirstLoad( TextureFileStruct* file); // a texture created by D3DX is only read back, if its file content is loaded again
+  int StoreDecoded( TextureFileStruct* file, uMod_IDirect3DTexture9* pTexture); // reads the levels of a texture created by D3DX back
+  int StoreDecoded( TextureFileStruct* file, uMod_IDirect3DVolumeTexture9* pTexture);
+  int StoreDecoded( TextureFileStruct* file, uMod_IDirect3DCubeTexture9* pTexture);
+  int AcknowledgeVersion(void); // a job in flight references the file content of its version
 
   // and the corresponding fake texture should be loaded
 
@@ -19,6 +19,11 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 
 #include "uMod_Main.h"
 
+#include <intrin.h>
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+
 /*
 MyTypeHash GetHash(unsigned char *str, int len) // estimate the hash
 {
@@ -46,7 +51,13 @@ The problem is that it doesn't take the pitch into account and BytesPerPixel may
 #define CRC32POLY 0xEDB88320u /* CRC-32 Polynom */
 #define ulCrc_in 0xffffffff
 
-unsigned int GetCRC32( char *pcDatabuf, unsigned int ulDatalen)
+/*
+ * The original bit serial implementation. It is kept as reference,
+ * all other implementations must return exactly the same value,
+ * otherwise the hashes of existing mods would not match anymore.
+ * Note: there is no final xor, the hash is the raw crc register.
+ */
+unsigned int GetCRC32_BitSerial( char *pcDatabuf, unsigned int ulDatalen)
 {
   unsigned int crc = ulCrc_in;
   for (unsigned int idx = 0u; idx<ulDatalen; idx++)
@@ -60,3 +71,195 @@ unsigned int GetCRC32( char *pcDatabuf, unsigned int ulDatalen)
   return (crc);
 }
 
+
+/*
+ * slice-by-8: CRC32_Table[0] is the normal byte wise table,
+ * CRC32_Table[k][i] is the crc of byte i followed by k zero bytes.
+ * Thus 8 bytes can be processed with 8 independent table lookups.
+ */
+static unsigned int CRC32_Table[8][256];
+static bool CRC32_Initialized = false;
+static bool CRC32_UseCLMUL = false;
+
+static unsigned int CRC32_Slice8( unsigned int crc, const unsigned char *buf, unsigned int len)
+{
+  while (len>0u && (((size_t) buf) & 3u)) // align to 4 bytes
+  {
+    crc = (crc >> 8) ^ CRC32_Table[0][(crc ^ *buf++) & 0xFF];
+    len--;
+  }
+
+  while (len>=8u)
+  {
+    unsigned int one = *(const unsigned int*) buf ^ crc; // x86 is little endian
+    unsigned int two = *(const unsigned int*) (buf+4);
+    crc = CRC32_Table[7][ one        & 0xFF] ^
+          CRC32_Table[6][(one >>  8) & 0xFF] ^
+          CRC32_Table[5][(one >> 16) & 0xFF] ^
+          CRC32_Table[4][ one >> 24        ] ^
+          CRC32_Table[3][ two        & 0xFF] ^
+          CRC32_Table[2][(two >>  8) & 0xFF] ^
+          CRC32_Table[1][(two >> 16) & 0xFF] ^
+          CRC32_Table[0][ two >> 24        ];
+    buf += 8;
+    len -= 8u;
+  }
+
+  while (len>0u)
+  {
+    crc = (crc >> 8) ^ CRC32_Table[0][(crc ^ *buf++) & 0xFF];
+    len--;
+  }
+  return (crc);
+}
+
+
+/*
+ * Folding with carry-less multiplication (PCLMULQDQ), see
+ * "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction" (Intel, 2009).
+ * The constants are the bit reflected values for the polynomial 0xEDB88320.
+ *
+ * Note: the SSE4.2 crc32 instruction cannot be used, it calculates the CRC-32C (Castagnoli) polynomial.
+ *
+ * len must be at least 64 and a multiple of 16.
+ */
+static unsigned int CRC32_CLMUL( unsigned int crc, const unsigned char *buf, unsigned int len)
+{
+  static const __declspec(align(16)) unsigned __int64 k1k2[] = { 0x0154442bd4ull, 0x01c6e41596ull };
+  static const __declspec(align(16)) unsigned __int64 k3k4[] = { 0x01751997d0ull, 0x00ccaa009eull };
+  static const __declspec(align(16)) unsigned __int64 k5k0[] = { 0x0163cd6124ull, 0x0000000000ull };
+  static const __declspec(align(16)) unsigned __int64 poly[] = { 0x01db710641ull, 0x01f7011641ull };
+
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+  x1 = _mm_loadu_si128((const __m128i*) (buf + 0x00));
+  x2 = _mm_loadu_si128((const __m128i*) (buf + 0x10));
+  x3 = _mm_loadu_si128((const __m128i*) (buf + 0x20));
+  x4 = _mm_loadu_si128((const __m128i*) (buf + 0x30));
+
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+  x0 = _mm_load_si128((const __m128i*) k1k2);
+
+  buf += 64;
+  len -= 64u;
+
+  while (len>=64u) // fold 4 blocks of 128 bit in parallel
+  {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+    y5 = _mm_loadu_si128((const __m128i*) (buf + 0x00));
+    y6 = _mm_loadu_si128((const __m128i*) (buf + 0x10));
+    y7 = _mm_loadu_si128((const __m128i*) (buf + 0x20));
+    y8 = _mm_loadu_si128((const __m128i*) (buf + 0x30));
+
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+    buf += 64;
+    len -= 64u;
+  }
+
+  // fold the 4 blocks into one block of 128 bit
+  x0 = _mm_load_si128((const __m128i*) k3k4);
+
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+  while (len>=16u) // fold the remaining blocks of 128 bit
+  {
+    x2 = _mm_loadu_si128((const __m128i*) buf);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    buf += 16;
+    len -= 16u;
+  }
+
+  // fold 128 bit to 64 bit
+  x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+  x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+  x1 = _mm_srli_si128(x1, 8);
+  x1 = _mm_xor_si128(x1, x2);
+
+  x0 = _mm_loadl_epi64((const __m128i*) k5k0);
+
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, x3);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  // Barrett reduction to 32 bit
+  x0 = _mm_load_si128((const __m128i*) poly);
+
+  x2 = _mm_and_si128(x1, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+  x2 = _mm_and_si128(x2, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  return ((unsigned int) _mm_extract_epi32(x1, 1));
+}
+
+
+void InitCRC32(void)
+{
+  if (CRC32_Initialized) return;
+
+  for (unsigned int i=0u; i<256u; i++)
+  {
+    unsigned int crc = i;
+    for (unsigned int bit = 0u; bit<8u; bit++) crc = (crc >> 1) ^ ((crc & 1) ? CRC32POLY : 0);
+    CRC32_Table[0][i] = crc;
+  }
+  for (unsigned int i=0u; i<256u; i++)
+  {
+    for (unsigned int k=1u; k<8u; k++) CRC32_Table[k][i] = (CRC32_Table[k-1][i] >> 8) ^ CRC32_Table[0][CRC32_Table[k-1][i] & 0xFF];
+  }
+
+  // the folding path needs PCLMULQDQ (ecx bit 1) and SSE4.1 (ecx bit 19) for _mm_extract_epi32
+  int info[4];
+  __cpuid( info, 1);
+  CRC32_UseCLMUL = (info[2] & (1<<1)) && (info[2] & (1<<19));
+
+  Message("InitCRC32(): PCLMULQDQ %d\n", CRC32_UseCLMUL);
+  CRC32_Initialized = true;
+}
+
+
+unsigned int GetCRC32( char *pcDatabuf, unsigned int ulDatalen)
+{
+  if (!CRC32_Initialized) InitCRC32();
+
+  unsigned int crc = ulCrc_in;
+  const unsigned char *buf = (const unsigned char*) pcDatabuf;
+
+  if (CRC32_UseCLMUL && ulDatalen>=64u)
+  {
+    unsigned int len = ulDatalen & ~15u;
+    crc = CRC32_CLMUL( crc, buf, len);
+    buf += len;
+    ulDatalen -= len;
+  }
+  return (CRC32_Slice8( crc, buf, ulDatalen));
+}
@@ -19,7 +19,9 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 #define uMod_TEXTUREFUNCTION_H_
 
 
-unsigned int GetCRC32( char *pcDatabuf, unsigned int ulDatalen);
+void InitCRC32(void); // build the lookup tables and check the cpu, called from InitInstance()
+unsigned int GetCRC32( char *pcDatabuf, unsigned int ulDatalen); // table driven (slice-by-8) or PCLMULQDQ folding if supported by the cpu
+unsigned int GetCRC32_BitSerial( char *pcDatabuf, unsigned int ulDatalen); // original implementation, only for reference
 /*
     case D3DFMT_MULTI2_ARGB8:
     case D3DFMT_VERTEXDATA:
@@ -29,6 +29,20 @@ uMod_TextureServer::uMod_TextureServer(wchar_t *game)
   Clients = NULL;
   NumberOfClients = 0;
   LenghtOfClients = 0;
+  Changes = NULL;
+  NumberOfChanges = 0;
+  LengthOfChanges = 0;
+  ChangesLost = false;
+  Version = 0;
+  Generation = 0u;
+  Retired = NULL;
+  NumberOfRetired = 0;
+  LengthOfRetired = 0;
+  MemoryBudget = uMod_DEFAULT_MEMORY_BUDGET;
+  RetainedBytes = 0u;
+  ReportedBytes = 0u;
+  CollectedVersion = 0;
+  CollectRequested = 0;
   BoolSaveAllTextures = false;
   BoolSaveSingleTexture = false;
   SavePath[0] = 0;
@@ -59,6 +73,14 @@ uMod_TextureServer::uMod_TextureServer(wchar_t *game)
 
   Pipe.In = INVALID_HANDLE_VALUE;
   Pipe.Out = INVALID_HANDLE_VALUE;
+
+  memset( &Overlapped, 0, sizeof(OVERLAPPED));
+  Overlapped.hEvent = CreateEvent( NULL, TRUE, FALSE, NULL); // manual reset, ReadFile() resets it
+
+  // the list header must be aligned
+  Requests = (PSLIST_HEADER) _aligned_malloc( sizeof(SLIST_HEADER), MEMORY_ALLOCATION_ALIGNMENT);
+  if (Requests!=NULL) InitializeSListHead(Requests);
+  RequestEvent = CreateEvent( NULL, FALSE, FALSE, NULL); // auto reset
 }
 
 uMod_TextureServer::~uMod_TextureServer(void)
@@ -68,18 +90,33 @@ uMod_TextureServer::~uMod_TextureServer(void)
 
   //delete the files in memory
   int num = CurrentMod.GetNumber();
-  for (int i = 0; i < num; i++) delete[] CurrentMod[i]->pData; //delete the file content of the texture
+  for (int i = 0; i < num; i++) ReleaseSlab( CurrentMod[i]->Slab); //release the file content of the texture
 
   num = OldMod.GetNumber();
-  for (int i = 0; i < num; i++) delete[] OldMod[i]->pData; //delete the file content of the texture
+  for (int i = 0; i < num; i++) ReleaseSlab( OldMod[i]->Slab); //release the file content of the texture
+
+  for (int i=0; i<NumberOfRetired; i++) ReleaseSlab( Retired[i].Slab);
+  if (Retired!=NULL) delete [] Retired;
+
+  if (Changes!=NULL) delete [] Changes;
 
   if (Pipe.In != INVALID_HANDLE_VALUE ) CloseHandle(Pipe.In);
   Pipe.In = INVALID_HANDLE_VALUE;
   if (Pipe.Out != INVALID_HANDLE_VALUE) CloseHandle(Pipe.Out);
   Pipe.Out = INVALID_HANDLE_VALUE;
+
+  if (Overlapped.hEvent != NULL) CloseHandle(Overlapped.hEvent);
+
+  if (Requests!=NULL)
+  {
+    FetchRequestStruct* request;
+    while ((request = (FetchRequestStruct*) InterlockedPopEntrySList(Requests)) != NULL) _aligned_free(request);
+    _aligned_free(Requests);
+  }
+  if (RequestEvent != NULL) CloseHandle(RequestEvent);
 }
 
-int uMod_TextureServer::AddClient(uMod_TextureClient *client, TextureFileStruct** update, int* number) // called from a client
+int uMod_TextureServer::AddClient(uMod_TextureClient *client, TextureFileStruct** update, int* number, int* version) // called from a client
 {
   Message("AddClient(%lu): %lu\n", client, this);
   if (int ret = LockMutex())
@@ -116,6 +153,7 @@ int uMod_TextureServer::AddClient(uMod_TextureClient *client, TextureFileStruct*
 
 
   if (int ret = PrepareUpdate( update, number)) return (ret); // get a copy of all texture to be modded
+  *version = Version; // the next delta update is based on this version
 
 
   if (NumberOfClients == LenghtOfClients) //allocate more memory
@@ -153,39 +191,35 @@ int uMod_TextureServer::RemoveClient(uMod_TextureClient *client) // called from
     Clients[i] = Clients[NumberOfClients];
     break;
   }
+  VersionMerged(); // this client does not hold back the file content of removed textures anymore
   return (UnlockMutex());
 }
 
-int uMod_TextureServer::AddFile( char* buffer, unsigned int size,  MyTypeHash hash, bool force) // called from Mainloop()
+int uMod_TextureServer::AddFile( char* buffer, unsigned int size,  MyTypeHash hash, bool force, uMod_Slab* slab) // called from Mainloop()
 {
-  Message("uMod_TextureServer::AddFile( %lu %lu, %#lX, %d): %lu\n", buffer, size, hash, force, this);
+  Message("uMod_TextureServer::AddFile( %lu %lu, %#lX, %d, %lu): %lu\n", buffer, size, hash, force, slab, this);
 
-  TextureFileStruct* temp = NULL;
+  bool was_current = false; // the clients know this texture already
 
-  int num = CurrentMod.GetNumber();
-  for (int i=0; i<num; i++) if (CurrentMod[i]->Hash == hash) //look through all current textures
+  TextureFileStruct* temp = CurrentMod.Find( hash); //look through all current textures
+  if (temp!=NULL)
   {
-    if (force) {temp = CurrentMod[i]; break;} // we need to reload it
+    if (force) was_current = true; // we need to reload it
     else return (RETURN_OK); // we still have added this texture
   }
-  if (temp==NULL) // if not found, look through all old textures
+  else if ((temp = OldMod.Find( hash)) != NULL) // if not found, look through all old textures
   {
-    num = OldMod.GetNumber();
-    for (int i=0; i<num; i++) if (OldMod[i]->Hash == hash)
-    {
-      temp = OldMod[i];
-      OldMod.Remove(temp);
-      CurrentMod.Add(temp);
-      if (force) break; // we must reload it
-      else return (RETURN_OK); // we should not reload it
-    }
+    OldMod.Remove(temp);
+    CurrentMod.Add(temp);
+    if (!force) return (AddChange( uMod_CHANGE_ADD, temp)); // we should not reload it
   }
 
   bool new_file = true;
-  if (temp!=NULL) //if it was found, we delete the old file content
+  if (temp!=NULL) //if it was found, we retire the old file content (a client might still use it)
   {
     new_file = false;
-    if (temp->pData!=NULL) delete [] temp->pData;
+    if (temp->Slab!=NULL) RetireData( temp->Slab, temp->Size);
+    temp->Slab = NULL;
     temp->pData = NULL;
   }
   else //if it was not found, we need to create a new object
@@ -195,32 +229,115 @@ int uMod_TextureServer::AddFile( char* buffer, unsigned int size,  MyTypeHash ha
     temp->Reference = -1;
   }
 
-  try
+  if (slab!=NULL) // the file content stays in the slab of the pipe reader
   {
-    temp->pData = new char[size];
+    AddRefSlab( slab);
+    temp->Slab = slab;
+    temp->pData = buffer;
   }
-  catch (...)
+  else if (buffer==NULL) // lazy mode, the file content is fetched, when a client needs it
+  {
+    temp->Slab = NULL;
+    temp->pData = NULL;
+    size = 0u;
+  }
+  else if ((temp->Slab = NewSlab( size, false)) != NULL)
+  {
+    temp->pData = temp->Slab->Data;
+    memcpy( temp->pData, buffer, size);
+  }
+  else
   {
-    if (!new_file) CurrentMod.Remove( temp); // if this is a not a new file it is in the list of the CurrentMod
+    if (!new_file) {CurrentMod.Remove( temp); AddChange( uMod_CHANGE_REMOVE, temp);} // if this is a not a new file it is in the list of the CurrentMod
     delete temp;
     gl_ErrorState |= uMod_ERROR_MEMORY | uMod_ERROR_SERVER;
     return (RETURN_NO_MEMORY);
   }
 
-  for (unsigned int i=0; i<size; i++) temp->pData[i] = buffer[i];
-
   temp->Size = size;
   temp->NumberOfTextures = 0;
   temp->Textures = NULL;
   temp->Hash = hash;
+  temp->Generation = ++Generation;
+  temp->Requested = 0;
 
   //if (new_file) temp->ForceReload = false; // no need to force a load of the texture
   //else
   temp->ForceReload = force;
 
   Message("End AddFile(%#lX)\n", hash);
-  if (new_file) return (CurrentMod.Add(temp)); // new files must be added to the list of the CurrentMod
-  else return (RETURN_OK);
+  if (new_file) // new files must be added to the list of the CurrentMod
+  {
+    if (int ret = CurrentMod.Add(temp)) return (ret);
+    return (AddChange( uMod_CHANGE_ADD, temp));
+  }
+  else return (AddChange( was_current ? uMod_CHANGE_FORCE_RELOAD : uMod_CHANGE_ADD, temp));
+}
+
+int uMod_TextureServer::FetchedFile( char* buffer, unsigned int size, MyTypeHash hash, uMod_Slab* slab) // called from Mainloop()
+{
+  Message("uMod_TextureServer::FetchedFile( %lu %lu, %#lX, %lu): %lu\n", buffer, size, hash, slab, this);
+
+  TextureFileStruct* temp = CurrentMod.Find( hash);
+  if (temp==NULL || temp->pData!=NULL) return (RETURN_OK); // the texture was removed meanwhile or is already fetched (e.g. requested by two clients)
+
+  if (slab!=NULL)
+  {
+    AddRefSlab( slab);
+    temp->Slab = slab;
+    temp->pData = buffer;
+  }
+  else if ((temp->Slab = NewSlab( size, false)) != NULL)
+  {
+    temp->pData = temp->Slab->Data;
+    memcpy( temp->pData, buffer, size);
+  }
+  else
+  {
+    gl_ErrorState |= uMod_ERROR_MEMORY | uMod_ERROR_SERVER;
+    return (RETURN_NO_MEMORY);
+  }
+  temp->Size = size;
+  temp->ForceReload = false;
+  return (AddChange( uMod_CHANGE_FETCHED, temp));
+}
+
+int uMod_TextureServer::RequestFile( MyTypeHash hash) // called from a client
+{
+  if (Requests==NULL || RequestEvent==NULL) return (RETURN_NO_MEMORY);
+  FetchRequestStruct* request = (FetchRequestStruct*) _aligned_malloc( sizeof(FetchRequestStruct), MEMORY_ALLOCATION_ALIGNMENT);
+  if (request==NULL)
+  {
+    gl_ErrorState |= uMod_ERROR_MEMORY;
+    return (RETURN_NO_MEMORY);
+  }
+  request->Entry.Next = NULL;
+  request->Hash = hash;
+  InterlockedPushEntrySList( Requests, &request->Entry);
+  SetEvent( RequestEvent); // the server thread sends the request, the render thread must not wait on the pipe
+  return (RETURN_OK);
+}
+
+int uMod_TextureServer::VersionMerged(void) // called from a client
+{
+  if (RequestEvent==NULL) return (RETURN_OK); // the garbage is collected with the next update
+  InterlockedExchange( &CollectRequested, 1);
+  SetEvent( RequestEvent); // the render thread must not collect the garbage itself
+  return (RETURN_OK);
+}
+
+int uMod_TextureServer::SendRequests(void) // called from EndRead()
+{
+  FetchRequestStruct* request = (FetchRequestStruct*) InterlockedFlushSList(Requests);
+  while (request!=NULL)
+  {
+    FetchRequestStruct* next = (FetchRequestStruct*) request->Entry.Next;
+    Message("SendRequests( %#lX): %lu\n", request->Hash, this);
+    SendToGUI( CONTROL_FETCH_TEXTURE, 0u, request->Hash);
+    _aligned_free(request);
+    request = next;
+  }
+  return (RETURN_OK);
 }
 
 int uMod_TextureServer::AddFile(wchar_t* file_name, MyTypeHash hash, bool force) // called from Mainloop
@@ -228,25 +345,19 @@ int uMod_TextureServer::AddFile(wchar_t* file_name, MyTypeHash hash, bool force)
 {
   Message("uMod_TextureServer::AddFile( %ls, %#lX, %d): %lu\n", file_name, hash, force, this);
 
-  TextureFileStruct* temp = NULL;
+  bool was_current = false;
 
-  int num = CurrentMod.GetNumber();
-  for (int i = 0; i < num; i++) if (CurrentMod[i]->Hash == hash)
+  TextureFileStruct* temp = CurrentMod.Find( hash);
+  if (temp!=NULL)
   {
-    if (force) {temp = CurrentMod[i]; break;}
+    if (force) was_current = true;
     else return (RETURN_OK);
   }
-  if (temp==NULL)
+  else if ((temp = OldMod.Find( hash)) != NULL)
   {
-    num = OldMod.GetNumber();
-    for (int i = 0; i < num; i++) if (OldMod[i]->Hash == hash)
-    {
-      temp = OldMod[i];
-      OldMod.Remove(temp);
-      CurrentMod.Add(temp);
-      if (force) break;
-      else return (RETURN_OK);
-    }
+    OldMod.Remove(temp);
+    CurrentMod.Add(temp);
+    if (!force) return (AddChange( uMod_CHANGE_ADD, temp));
   }
 
   FILE* file;
@@ -264,7 +375,8 @@ int uMod_TextureServer::AddFile(wchar_t* file_name, MyTypeHash hash, bool force)
   if (temp!=NULL)
   {
     new_file = false;
-    if (temp->pData!=NULL) delete [] temp->pData;
+    if (temp->Slab!=NULL) RetireData( temp->Slab, temp->Size);
+    temp->Slab = NULL;
     temp->pData = NULL;
   }
   else
@@ -274,23 +386,21 @@ int uMod_TextureServer::AddFile(wchar_t* file_name, MyTypeHash hash, bool force)
     temp->Reference = -1;
   }
 
-  try
+  if ((temp->Slab = NewSlab( size, false)) == NULL)
   {
-    temp->pData = new char[size];
-  }
-  catch (...)
-  {
-    if (!new_file) CurrentMod.Remove( temp);
+    fclose(file);
+    if (!new_file) {CurrentMod.Remove( temp); AddChange( uMod_CHANGE_REMOVE, temp);}
     delete temp;
     gl_ErrorState |= uMod_ERROR_MEMORY | uMod_ERROR_SERVER;
     return (RETURN_NO_MEMORY);
   }
+  temp->pData = temp->Slab->Data;
   int result = fread(temp->pData, 1, size, file);
   fclose(file);
   if (result != size)
   {
-    delete[] temp->pData;
-    if (!new_file) CurrentMod.Remove( temp);
+    ReleaseSlab( temp->Slab);
+    if (!new_file) {CurrentMod.Remove( temp); AddChange( uMod_CHANGE_REMOVE, temp);}
     delete temp;
     return (RETURN_FILE_NOT_LOADED);
   }
@@ -299,27 +409,39 @@ int uMod_TextureServer::AddFile(wchar_t* file_name, MyTypeHash hash, bool force)
   temp->NumberOfTextures = 0;
   temp->Textures = NULL;
   temp->Hash = hash;
+  temp->Generation = ++Generation;
+  temp->Requested = 0;
 
   if (new_file) temp->ForceReload = false;
   else temp->ForceReload = force;
 
   Message("End AddFile(%#lX)\n", hash);
-  if (new_file) return (CurrentMod.Add(temp));
-  else return (RETURN_OK);
+  if (new_file)
+  {
+    if (int ret = CurrentMod.Add(temp)) return (ret);
+    return (AddChange( uMod_CHANGE_ADD, temp));
+  }
+  else return (AddChange( was_current ? uMod_CHANGE_FORCE_RELOAD : uMod_CHANGE_ADD, temp));
 }
 
 int uMod_TextureServer::RemoveFile(MyTypeHash hash) // called from Mainloop()
 {
   Message("RemoveFile( %lu): %lu\n", hash, this);
 
-  int num = CurrentMod.GetNumber();
-  for (int i = 0; i < num; i++) if (CurrentMod[i]->Hash == hash)
-  {
-    TextureFileStruct* temp = CurrentMod[i];
-    CurrentMod.Remove(temp);
-    return (OldMod.Add(temp));
-  }
-  return (RETURN_OK);
+  TextureFileStruct* temp = CurrentMod.Find( hash);
+  if (temp==NULL) return (RETURN_OK);
+
+  CurrentMod.Remove(temp);
+  AddChange( uMod_CHANGE_REMOVE, temp);
+  temp->Version = Version + 1; // the next update does not contain this file anymore
+  return (OldMod.Add(temp));
+}
+
+int uMod_TextureServer::ReserveFiles( int number) // called from Mainloop()
+{
+  Message("ReserveFiles( %d): %lu\n", number, this);
+  if (int ret = CurrentMod.Reserve( CurrentMod.GetNumber() + number)) return (ret);
+  return (ReserveChanges( NumberOfChanges + number));
 }
 
 int uMod_TextureServer::SaveAllTextures(bool val) // called from Mainloop()
@@ -468,6 +590,20 @@ int uMod_TextureServer::SetTextureColour(DWORD colour) // called from Mainloop()
   return (UnlockMutex());
 }
 
+int uMod_TextureServer::SetMemoryBudget(unsigned int mega_bytes) // called from Mainloop()
+{
+  Message("uMod_TextureServer::SetMemoryBudget( %u): %lu\n", mega_bytes, this);
+  if (int ret = LockMutex())
+  {
+    gl_ErrorState |= uMod_ERROR_SERVER;
+    return (ret);
+  }
+  if (mega_bytes >= 4096u) MemoryBudget = 0xFFFFFFFF;
+  else MemoryBudget = mega_bytes<<20;
+  CollectGarbage(); // a smaller budget is applied at once
+  return (UnlockMutex());
+}
+
 int uMod_TextureServer::PropagateUpdate(uMod_TextureClient* client) // called from Mainloop(), send the update to all clients
 {
   Message("PropagateUpdate(%lu): %lu\n", client, this);
@@ -480,22 +616,183 @@ int uMod_TextureServer::PropagateUpdate(uMod_TextureClient* client) // called fr
   {
     TextureFileStruct* update;
     int number;
-    if (int ret = PrepareUpdate( &update, &number)) return (ret);
-    client->AddUpdate(update, number);
+    if (int ret = PrepareUpdate( &update, &number)) {UnlockMutex(); return (ret);}
+    client->AddUpdate(update, number, Version);
   }
   else
   {
+    CollectGarbage(); // the clients might have merged the last update in the mean time
+
+    if (NumberOfChanges==0 && !ChangesLost) return (UnlockMutex()); // nothing has changed
+
+    Version++;
     for (int i=0; i<NumberOfClients; i++)
     {
+      if (!ChangesLost && NumberOfChanges>0)
+      {
+        TextureChangeStruct* delta = NULL;
+        try {delta = new TextureChangeStruct[NumberOfChanges];}
+        catch (...) {delta = NULL;}
+        if (delta!=NULL)
+        {
+          for (int j=0; j<NumberOfChanges; j++) delta[j] = Changes[j];
+          // the client deletes the array, it refuses the delta if it has not yet merged the last update
+          if (Clients[i]->AddDelta( delta, NumberOfChanges, Version-1, Version)==RETURN_OK) continue;
+        }
+      }
+
+      // the client needs a full update
       TextureFileStruct* update;
       int number;
-      if (int ret = PrepareUpdate( &update, &number)) return (ret);
-      Clients[i]->AddUpdate(update, number);
+      if (int ret = PrepareUpdate( &update, &number)) {UnlockMutex(); return (ret);}
+      Clients[i]->AddUpdate(update, number, Version);
     }
+    NumberOfChanges = 0;
+    ChangesLost = false;
+  }
+  return (UnlockMutex());
+}
+
+int uMod_TextureServer::ReserveChanges( int number)
+{
+  if (number <= LengthOfChanges) return (RETURN_OK);
+
+  TextureChangeStruct* temp = NULL;
+  try {temp = new TextureChangeStruct[number];}
+  catch (...)
+  {
+    gl_ErrorState |= uMod_ERROR_MEMORY | uMod_ERROR_SERVER;
+    return (RETURN_NO_MEMORY);
+  }
+  for (int i=0; i<NumberOfChanges; i++) temp[i] = Changes[i];
+  if (Changes!=NULL) delete [] Changes;
+  Changes = temp;
+  LengthOfChanges = number;
+  return (RETURN_OK);
+}
+
+int uMod_TextureServer::RetireData( uMod_Slab* slab, unsigned int size) // called from AddFile()
+{
+  if (NumberOfRetired == LengthOfRetired) //allocate more memory
+  {
+    RetiredDataStruct* temp = NULL;
+    try {temp = new RetiredDataStruct[LengthOfRetired + 64];}
+    catch (...)
+    {
+      ReleaseSlab( slab); // we cannot keep it
+      gl_ErrorState |= uMod_ERROR_MEMORY | uMod_ERROR_SERVER;
+      return (RETURN_NO_MEMORY);
+    }
+    for (int i=0; i<NumberOfRetired; i++) temp[i] = Retired[i];
+    if (Retired!=NULL) delete [] Retired;
+    Retired = temp;
+    LengthOfRetired += 64;
+  }
+  Retired[NumberOfRetired].Slab = slab;
+  Retired[NumberOfRetired].Size = size;
+  Retired[NumberOfRetired].Version = Version + 1; // the next update contains the new file content
+  NumberOfRetired++;
+  return (RETURN_OK);
+}
+
+int OldModVersion_Compare( const void * elem1, const void * elem2 )
+{
+  TextureFileStruct *file1 = *(TextureFileStruct**)elem1;
+  TextureFileStruct *file2 = *(TextureFileStruct**)elem2;
+  return (file1->Version - file2->Version);
+}
+
+int uMod_TextureServer::CollectMerged(void) // called from EndRead()
+{
+  if (InterlockedExchange( &CollectRequested, 0)==0) return (RETURN_OK);
+  if (int ret = LockMutex())
+  {
+    gl_ErrorState |= uMod_ERROR_SERVER;
+    return (ret);
   }
+  CollectGarbage( true);
   return (UnlockMutex());
 }
 
+int uMod_TextureServer::CollectGarbage( bool merged) // called from PropagateUpdate() and CollectMerged()
+{
+  // a client, which has merged the version v, does not reference file content which was removed up to the version v
+  int min_version = Version + 1;
+  for (int i=0; i<NumberOfClients; i++)
+  {
+    int version = Clients[i]->GetMergedVersion();
+    if (version<min_version) min_version = version;
+  }
+  if (merged && min_version<=CollectedVersion) return (RETURN_OK); // the last client has not merged a newer version yet
+  CollectedVersion = min_version;
+
+  unsigned int retained = 0u;
+  int num = 0;
+  for (int i=0; i<NumberOfRetired; i++)
+  {
+    if (Retired[i].Version<=min_version) ReleaseSlab( Retired[i].Slab);
+    else
+    {
+      retained += Retired[i].Size;
+      Retired[num++] = Retired[i];
+    }
+  }
+  NumberOfRetired = num;
+
+  num = OldMod.GetNumber();
+  int num_free = 0;
+  for (int i=0; i<num; i++)
+  {
+    retained += OldMod[i]->Size;
+    if (OldMod[i]->Version<=min_version) num_free++;
+  }
+
+  if (retained>MemoryBudget && num_free>0) // the oldest files, which are not referenced anymore, are deleted first
+  {
+    TextureFileStruct** to_free = NULL;
+    try {to_free = new TextureFileStruct*[num_free];}
+    catch (...)
+    {
+      RetainedBytes = retained;
+      gl_ErrorState |= uMod_ERROR_MEMORY | uMod_ERROR_SERVER;
+      return (RETURN_NO_MEMORY);
+    }
+    num_free = 0;
+    for (int i=0; i<num; i++) if (OldMod[i]->Version<=min_version) to_free[num_free++] = OldMod[i];
+    qsort( to_free, num_free, sizeof(TextureFileStruct*), OldModVersion_Compare);
+
+    for (int i=0; i<num_free && retained>MemoryBudget; i++)
+    {
+      OldMod.Remove( to_free[i]);
+      retained -= to_free[i]->Size;
+      ReleaseSlab( to_free[i]->Slab);
+      delete to_free[i];
+    }
+    delete [] to_free;
+  }
+
+  RetainedBytes = retained;
+  Message("uMod_TextureServer::CollectGarbage(): version %d, retained %u bytes (%d old, %d retired): %lu\n", min_version, RetainedBytes, OldMod.GetNumber(), NumberOfRetired, this);
+  if ((RetainedBytes>>10)!=(ReportedBytes>>10) && SendToGUI( CONTROL_RETAINED_MEMORY, RetainedBytes>>10)==RETURN_OK) ReportedBytes = RetainedBytes;
+  return (RETURN_OK);
+}
+
+int uMod_TextureServer::AddChange( int type, TextureFileStruct* file) // called from AddFile() and RemoveFile()
+{
+  if (NumberOfChanges == LengthOfChanges) //allocate more memory, the length is doubled to keep a large package linear
+  {
+    if (ReserveChanges( LengthOfChanges<1024 ? 1024 : 2*LengthOfChanges))
+    {
+      ChangesLost = true; // the clients will get a full update
+      return (RETURN_OK);
+    }
+  }
+  Changes[NumberOfChanges].Type = type;
+  Changes[NumberOfChanges].File = *file;
+  NumberOfChanges++;
+  return (RETURN_OK);
+}
+
 #define cpy_file_struct( a, b) \
 {  \
   a.ForceReload = b.ForceReload; \
@@ -504,16 +801,8 @@ int uMod_TextureServer::PropagateUpdate(uMod_TextureClient* client) // called fr
   a.NumberOfTextures = b.NumberOfTextures; \
   a.Reference = b.Reference; \
   a.Textures = b.Textures; \
-  a.Hash = b.Hash; }
-
-int TextureFileStruct_Compare( const void * elem1, const void * elem2 )
-{
-  TextureFileStruct *tex1 = (TextureFileStruct*)elem1;
-  TextureFileStruct *tex2 = (TextureFileStruct*)elem2;
-  if (tex1->Hash < tex2->Hash) return (-1);
-  if (tex1->Hash > tex2->Hash) return (+1);
-  return (0);
-}
+  a.Hash = b.Hash; \
+  a.Generation = b.Generation; }
 
 int uMod_TextureServer::PrepareUpdate(TextureFileStruct** update, int* number) // called from the PropagateUpdate() and AddClient.
 // Prepare an update for one client. The allocated memory must deleted by the client.
@@ -531,8 +820,7 @@ int uMod_TextureServer::PrepareUpdate(TextureFileStruct** update, int* number) /
       return (RETURN_NO_MEMORY);
     }
 
-    for (int i=0; i<num; i++) cpy_file_struct(temp[i], (*(CurrentMod[i])));
-    qsort( temp, num, sizeof(TextureFileStruct), TextureFileStruct_Compare);
+    for (int i=0; i<num; i++) cpy_file_struct(temp[i], (*(CurrentMod[i]))); // the array needs not to be sorted, the client uses a hash index
   }
 
 
@@ -559,143 +847,365 @@ int uMod_TextureServer::MainLoop(void) // run as a separated thread
 {
   Message("MainLoop: begin\n");
   if (Pipe.In == INVALID_HANDLE_VALUE) return (RETURN_PIPE_NOT_OPENED);
-  char *buffer;
-  try {buffer = new char[BIG_BUFSIZE];}
-  catch (...) {return (RETURN_NO_MEMORY);}
+
+  if (int ret = ReadHandshake())
+  {
+    ClosePipe();
+    return (ret);
+  }
+
+  uMod_Slab *slab = NULL; // the stream is read into slabs, the textures keep pointers into them
+  uMod_FrameDecoder decoder; // a record might be spread over several reads
+  uMod_Slab *region = NULL; // view of the current shared region of uMod_GUI
+  unsigned int region_generation = 0u;
 
   unsigned long num;
+  unsigned int offset;
+  unsigned int size;
 
   Message("MainLoop: started\n");
   bool update_textures = false;
-  bool more_textures = false;
+  bool more_textures = false; // is true between CONTROL_MORE_TEXTURES and CONTROL_END_TEXTURES
+
+  // the next bytes are read (overlapped) while the records of the last read are processed
+  int ret = PrepareSlab( slab, decoder);
+  if (ret==RETURN_OK) ret = BeginRead( &slab->Data[decoder.GetEnd()], slab->Size - decoder.GetEnd());
+  if (ret)
+  {
+    ReleaseSlab( slab);
+    ClosePipe();
+    return (ret);
+  }
+
   while (1)
   {
     Message("MainLoop: run\n");
-    bool ret = ReadFile(Pipe.In, // pipe handle
-        buffer, // buffer to receive reply
-        BIG_BUFSIZE, // size of buffer
-        &num, // number of bytes read
-        NULL); // not overlapped
-
+    if (EndRead( num))
+    {
+      Message("MainLoop: error in ReadFile()\n");
+      ReleaseSlab( region);
+      ReleaseSlab( slab);
+      ClosePipe();
+      return (RETURN_OK);
+    }
     Message("MainLoop: read something (%lu)\n", num);
-    if (ret || GetLastError() == ERROR_MORE_DATA)
+    decoder.Received( num);
+
+    // the decoder skips the complete records, they are processed afterwards with a copy of the decoder
+    uMod_FrameDecoder records = decoder;
+    uMod_Slab *current = slab; // the complete records stay in this slab, even if the next bytes are read into a new one
+    AddRefSlab( current);
+
+    // count the textures of the complete records, thus the memory for all of them is allocated at once
+    int number = 0;
+    int result;
+    while ((result = decoder.Next( current->Data, offset, size))==1) if (size>=sizeof(MsgStruct))
     {
-      unsigned int pos = 0;
-      MsgStruct *commands;
-      more_textures = false;
-      while (pos <= num - sizeof(MsgStruct))
+      switch (((MsgStruct*) &current->Data[offset])->Control)
       {
-        commands = (MsgStruct*) &buffer[pos];
-        unsigned int size = 0u;
-        bool force = false;
+      case CONTROL_FORCE_RELOAD_TEXTURE:
+      case CONTROL_ADD_TEXTURE:
+      case CONTROL_FORCE_RELOAD_TEXTURE_DATA:
+      case CONTROL_ADD_TEXTURE_DATA:
+      case CONTROL_FORCE_RELOAD_TEXTURE_SHARED:
+      case CONTROL_ADD_TEXTURE_SHARED:
+      case CONTROL_FORCE_RELOAD_TEXTURE_LAZY:
+      case CONTROL_ADD_TEXTURE_LAZY: number++;
+      }
+    }
+    unsigned int last = decoder.GetBegin(); // end of the complete records
 
-        switch (commands->Control)
-        {
-        case CONTROL_MORE_TEXTURES:
+    if (result<0)
+    {
+      Message("MainLoop: corrupt stream\n");
+      ret = RETURN_PIPE_PROTOCOL;
+    }
+    else
+    {
+      ret = PrepareSlab( slab, decoder);
+      if (ret==RETURN_OK) ret = BeginRead( &slab->Data[decoder.GetEnd()], slab->Size - decoder.GetEnd());
+    }
+    if (ret)
+    {
+      ReleaseSlab( current);
+      ReleaseSlab( region);
+      ReleaseSlab( slab);
+      ClosePipe();
+      return (ret);
+    }
+
+    if (number>1) ReserveFiles( number);
+    while (records.GetBegin()<last && records.Next( current->Data, offset, size)==1)
+    {
+      if (size<sizeof(MsgStruct)) continue;
+      MsgStruct *commands = (MsgStruct*) &current->Data[offset];
+      char *data = &current->Data[offset + sizeof(MsgStruct)];
+      size -= sizeof(MsgStruct); // size of the data behind the MsgStruct
+      bool force = false;
+
+      switch (commands->Control)
+      {
+      case CONTROL_MORE_TEXTURES:
+      {
+        more_textures = true;
+        break;
+      }
+      case CONTROL_END_TEXTURES:
+      {
+        more_textures = false;
+        break;
+      }
+      case CONTROL_FORCE_RELOAD_TEXTURE: force=true;
+      case CONTROL_ADD_TEXTURE:
+      {
+        Message("MainLoop: CONTROL_ADD_TEXTURE (%#lX  %u,  %u %u): %lu\n", commands->Hash, size, sizeof(MsgStruct), sizeof(char), this);
+        if (size>=sizeof(wchar_t)) // the file name must be terminated
         {
-          more_textures=true;
-          break;
+          ((wchar_t*) data)[size/sizeof(wchar_t)-1] = 0;
+          AddFile( (wchar_t*) data, commands->Hash, force);
         }
-        case CONTROL_FORCE_RELOAD_TEXTURE: force=true;
-        case CONTROL_ADD_TEXTURE:
+        update_textures = true;
+        force = false;
+        break;
+      }
+      case CONTROL_FORCE_RELOAD_TEXTURE_DATA: force=true;
+      case CONTROL_ADD_TEXTURE_DATA:
+      {
+        Message("MainLoop: CONTROL_FORCE_RELOAD_TEXTURE_DATA (%#lX  %u,  %u %u): %lu\n", commands->Hash, size, sizeof(MsgStruct), sizeof(char), this);
+        AddFile( data, size, commands->Hash, force, current);
+        update_textures = true;
+        force = false;
+        break;
+      }
+
+      case CONTROL_SHARED_REGION:
+      {
+        if (size>=sizeof(SharedRegionStruct)+sizeof(wchar_t))
         {
-          size = commands->Value;
-          Message("MainLoop: CONTROL_ADD_TEXTURE (%#lX  %u,  %u %u): %lu\n", commands->Hash, size, sizeof(MsgStruct), sizeof(char), this);
-          if (pos + sizeof(MsgStruct) + size <= num) AddFile( (wchar_t*) &buffer[pos + sizeof(MsgStruct)], commands->Hash, force);
-          update_textures = true;
-          force = false;
-          break;
+          SharedRegionStruct *shared = (SharedRegionStruct*) data;
+          wchar_t *name = (wchar_t*) &data[sizeof(SharedRegionStruct)];
+          name[(size-sizeof(SharedRegionStruct))/sizeof(wchar_t)-1] = 0;
+          Message("MainLoop: CONTROL_SHARED_REGION (%u %u): %lu\n", shared->Generation, shared->Size, this);
+
+          ReleaseSlab( region); // the textures in the last region keep their own reference
+          region = OpenSharedSlab( name, shared->Size);
+          region_generation = shared->Generation;
+          if (region!=NULL) SendToGUI( CONTROL_REGION_MAPPED, shared->Generation); // our view keeps the region alive, uMod_GUI can close its handle
+          else SendToGUI( CONTROL_REGION_FAILED, shared->Generation); // uMod_GUI sends the next textures over the pipe
         }
-        case CONTROL_FORCE_RELOAD_TEXTURE_DATA: force=true;
-        case CONTROL_ADD_TEXTURE_DATA:
+        break;
+      }
+      case CONTROL_FORCE_RELOAD_TEXTURE_SHARED: force=true;
+      case CONTROL_ADD_TEXTURE_SHARED:
+      {
+        SharedPayloadStruct *payload = (SharedPayloadStruct*) data;
+        if (size>=sizeof(SharedPayloadStruct) && region!=NULL && uMod_CheckPayload( payload, region_generation, region->Size))
         {
-          size = commands->Value;
-          Message("MainLoop: CONTROL_FORCE_RELOAD_TEXTURE_DATA (%#lX  %u,  %u %u): %lu\n", commands->Hash, size, sizeof(MsgStruct), sizeof(char), this);
-          if (pos + sizeof(MsgStruct) + size <= num) AddFile( &buffer[pos + sizeof(MsgStruct)], size, commands->Hash, force);
+          Message("MainLoop: CONTROL_ADD_TEXTURE_SHARED (%#lX  %u %u): %lu\n", commands->Hash, payload->Offset, payload->Size, this);
+          AddFile( &region->Data[payload->Offset], payload->Size, commands->Hash, force, region);
           update_textures = true;
-          force = false;
-          break;
         }
-
-        case CONTROL_REMOVE_TEXTURE:
+        else if (size>=sizeof(SharedPayloadStruct) && region==NULL && payload->Generation==region_generation)
         {
-          Message("MainLoop: CONTROL_REMOVE_TEXTURE (%#lX): %lu\n", commands->Hash, this);
-          RemoveFile(commands->Hash);
+          // the region could not be mapped, the file content is fetched over the pipe (like CONTROL_ADD_TEXTURE_LAZY)
+          Message("MainLoop: CONTROL_ADD_TEXTURE_SHARED (%#lX): region is not mapped, fetch it: %lu\n", commands->Hash, this);
+          AddFile( (char*) NULL, 0u, commands->Hash, force);
           update_textures = true;
-          break;
         }
+        else Message("MainLoop: CONTROL_ADD_TEXTURE_SHARED (%#lX): region is not mapped: %lu\n", commands->Hash, this);
+        force = false;
+        break;
+      }
 
-        case CONTROL_SAVE_SINGLE:
-        {
-          Message("MainLoop: CONTROL_SAVE_SINGLE (%d): %lu\n", commands->Value, this);
-          if (commands->Value == 0) SaveSingleTexture(false);
-          else SaveSingleTexture(true);
-          break;
-        }
-        case CONTROL_SAVE_ALL:
-        {
-          Message("MainLoop: CONTROL_SAVE_ALL (%d): %lu\n", commands->Value, this);
-          if (commands->Value == 0) SaveAllTextures(false);
-          else SaveAllTextures(true);
-          break;
-        }
-        case CONTROL_SET_DIR:
-        {
-          size = commands->Value;
-          if (pos + sizeof(MsgStruct) +size <= num) SetSaveDirectory( (wchar_t*) &buffer[pos + sizeof(MsgStruct)]);
-          break;
-        }
+      case CONTROL_FORCE_RELOAD_TEXTURE_LAZY: force=true;
+      case CONTROL_ADD_TEXTURE_LAZY:
+      {
+        Message("MainLoop: CONTROL_ADD_TEXTURE_LAZY (%#lX): %lu\n", commands->Hash, this);
+        AddFile( (char*) NULL, 0u, commands->Hash, force);
+        update_textures = true;
+        force = false;
+        break;
+      }
+      case CONTROL_FETCHED_TEXTURE_DATA:
+      {
+        Message("MainLoop: CONTROL_FETCHED_TEXTURE_DATA (%#lX  %u): %lu\n", commands->Hash, size, this);
+        FetchedFile( data, size, commands->Hash, current);
+        update_textures = true;
+        break;
+      }
 
-        case CONTROL_KEY_BACK:
-        {
-          Message("MainLoop: CONTROL_KEY_BACK (%#X): %lu\n", commands->Value, this);
-          SetKeyBack(commands->Value);
-          break;
-        }
-        case CONTROL_KEY_SAVE:
-        {
-          Message("MainLoop: CONTROL_KEY_SAVE (%#X): %lu\n", commands->Value, this);
-          SetKeySave(commands->Value);
-          break;
-        }
-        case CONTROL_KEY_NEXT:
-        {
-          Message("MainLoop: CONTROL_KEY_NEXT (%#X): %lu\n", commands->Value, this);
-          SetKeyNext(commands->Value);
-          break;
-        }
-        case CONTROL_FONT_COLOUR:
-        {
-          Message("MainLoop: CONTROL_FONT_COLOUR (%#X): %lu\n", commands->Value, this);
-          SetFontColour(commands->Value);
-          break;
-        }
-        case CONTROL_TEXTURE_COLOUR:
-        {
-          Message("MainLoop: CONTROL_TEXTURE_COLOUR (%#X): %lu\n", commands->Value, this);
-          SetTextureColour(commands->Value);
-          break;
-        }
-        default:
+      case CONTROL_REMOVE_TEXTURE:
+      {
+        Message("MainLoop: CONTROL_REMOVE_TEXTURE (%#lX): %lu\n", commands->Hash, this);
+        RemoveFile(commands->Hash);
+        update_textures = true;
+        break;
+      }
+
+      case CONTROL_SAVE_SINGLE:
+      {
+        Message("MainLoop: CONTROL_SAVE_SINGLE (%d): %lu\n", commands->Value, this);
+        if (commands->Value == 0) SaveSingleTexture(false);
+        else SaveSingleTexture(true);
+        break;
+      }
+      case CONTROL_SAVE_ALL:
+      {
+        Message("MainLoop: CONTROL_SAVE_ALL (%d): %lu\n", commands->Value, this);
+        if (commands->Value == 0) SaveAllTextures(false);
+        else SaveAllTextures(true);
+        break;
+      }
+      case CONTROL_SET_DIR:
+      {
+        if (size>=sizeof(wchar_t))
         {
-          Message("MainLoop: DEFAULT: %lu  %lu  %#lX\n", commands->Control, commands->Value, commands->Hash, this);
-          break;
-        }
+          ((wchar_t*) data)[size/sizeof(wchar_t)-1] = 0;
+          SetSaveDirectory( (wchar_t*) data);
         }
-        pos += sizeof(MsgStruct) + size;
+        break;
+      }
+
+      case CONTROL_KEY_BACK:
+      {
+        Message("MainLoop: CONTROL_KEY_BACK (%#X): %lu\n", commands->Value, this);
+        SetKeyBack(commands->Value);
+        break;
+      }
+      case CONTROL_KEY_SAVE:
+      {
+        Message("MainLoop: CONTROL_KEY_SAVE (%#X): %lu\n", commands->Value, this);
+        SetKeySave(commands->Value);
+        break;
+      }
+      case CONTROL_KEY_NEXT:
+      {
+        Message("MainLoop: CONTROL_KEY_NEXT (%#X): %lu\n", commands->Value, this);
+        SetKeyNext(commands->Value);
+        break;
+      }
+      case CONTROL_FONT_COLOUR:
+      {
+        Message("MainLoop: CONTROL_FONT_COLOUR (%#X): %lu\n", commands->Value, this);
+        SetFontColour(commands->Value);
+        break;
+      }
+      case CONTROL_TEXTURE_COLOUR:
+      {
+        Message("MainLoop: CONTROL_TEXTURE_COLOUR (%#X): %lu\n", commands->Value, this);
+        SetTextureColour(commands->Value);
+        break;
+      }
+      case CONTROL_MEMORY_BUDGET:
+      {
+        Message("MainLoop: CONTROL_MEMORY_BUDGET (%u): %lu\n", commands->Value, this);
+        SetMemoryBudget(commands->Value);
+        break;
+      }
+      default:
+      {
+        Message("MainLoop: DEFAULT: %lu  %lu  %#lX\n", commands->Control, commands->Value, commands->Hash, this);
+        break;
+      }
       }
-      if (!more_textures && update_textures) {PropagateUpdate(); update_textures=false;}
     }
-    else
+    ReleaseSlab( current);
+
+    // the clients are updated, if no record is pending and no batch of textures is sent
+    if (!more_textures && update_textures && decoder.GetPending()==0) {PropagateUpdate(); update_textures=false;}
+  }
+
+  ReleaseSlab( region);
+  ReleaseSlab( slab);
+  return (RETURN_OK);
+}
+
+int uMod_TextureServer::PrepareSlab( uMod_Slab* &slab, uMod_FrameDecoder &decoder) // called from Mainloop()
+{
+  unsigned int needed = BIG_BUFSIZE;
+  if (slab!=NULL)
+  {
+    // A slab is never read again from its beginning, the records of the last read are processed while the next read is pending.
+    // We continue to read into the slab if the pending record fits into it.
+    if (decoder.GetBegin() + decoder.GetNeeded( slab->Data) <= slab->Size
+        && (decoder.GetPending()>0 || decoder.GetEnd() + SMALL_BUFSIZE <= slab->Size)) return (RETURN_OK);
+
+    if (decoder.GetNeeded( slab->Data) > needed) needed = decoder.GetNeeded( slab->Data); // the record is bigger than our default slab
+  }
+
+  uMod_Slab* temp = NewSlab( needed, true);
+  if (temp==NULL) return (RETURN_NO_MEMORY);
+
+  if (slab!=NULL)
+  {
+    unsigned int begin = decoder.GetBegin();
+    // only the pending bytes of the incomplete record are copied
+    if (decoder.GetPending()>0) memcpy( temp->Data, &slab->Data[begin], decoder.GetPending());
+    decoder.Rebase();
+    TrimSlab( slab, begin); // the rest of the slab is not used anymore
+    ReleaseSlab( slab);
+  }
+  else decoder.Reset();
+  slab = temp;
+  return (RETURN_OK);
+}
+
+int uMod_TextureServer::BeginRead( char* buffer, unsigned int size) // called from Mainloop()
+{
+  if (Overlapped.hEvent==NULL) return (RETURN_FATAL_ERROR);
+  Overlapped.Offset = 0;
+  Overlapped.OffsetHigh = 0;
+  if (ReadFile( Pipe.In, buffer, size, NULL, &Overlapped)) return (RETURN_OK); // the event is also set, if the read finishes immediately
+  if (GetLastError()==ERROR_IO_PENDING) return (RETURN_OK);
+  return (RETURN_PIPE_NOT_OPENED);
+}
+
+int uMod_TextureServer::EndRead( unsigned long &num) // called from Mainloop()
+{
+  num = 0;
+  // the fetch requests of the clients are sent, while we wait for the next bytes
+  HANDLE events[2] = {Overlapped.hEvent, RequestEvent};
+  while (WaitForMultipleObjects( RequestEvent!=NULL ? 2 : 1, events, FALSE, INFINITE) == WAIT_OBJECT_0+1)
+  {
+    SendRequests();
+    CollectMerged();
+  }
+  if (GetOverlappedResult( Pipe.In, &Overlapped, &num, TRUE)) return (RETURN_OK);
+  if (GetLastError()==ERROR_MORE_DATA) return (RETURN_OK);
+  return (RETURN_PIPE_NOT_OPENED); // also if the pipe is closed by ClosePipe()
+}
+
+int uMod_TextureServer::SendToGUI( unsigned int control, unsigned int value, MyTypeHash hash) // called from Mainloop()
+{
+  if (Pipe.Out == INVALID_HANDLE_VALUE) return (RETURN_PIPE_NOT_OPENED);
+  MsgStruct msg;
+  msg.Control = control;
+  msg.Value = value;
+  msg.Hash = hash;
+  unsigned long num;
+  if (!WriteFile( Pipe.Out, (const void*) &msg, sizeof(MsgStruct), &num, NULL) || num!=sizeof(MsgStruct)) return (RETURN_PIPE_NOT_OPENED);
+  return (RETURN_OK);
+}
+
+int uMod_TextureServer::ReadHandshake(void) // called from Mainloop()
+{
+  HandshakeStruct handshake;
+  unsigned int pos = 0u;
+  while (pos<sizeof(HandshakeStruct))
+  {
+    unsigned long num = 0;
+    if (BeginRead( &((char*) &handshake)[pos], sizeof(HandshakeStruct) - pos) || EndRead( num) || num==0)
     {
-      Message("MainLoop: error in ReadFile()\n");
-      delete [] buffer;
-      ClosePipe();
-      return (RETURN_OK);
+      Message("ReadHandshake: error in ReadFile()\n");
+      return (RETURN_PIPE_NOT_OPENED);
     }
+    pos += num;
+  }
+  if (handshake.Magic!=uMod_PROTOCOL_MAGIC || handshake.Version!=uMod_PROTOCOL_VERSION)
+  {
+    Message("ReadHandshake: wrong protocol (%#X %d), expected (%#X %d)\n", handshake.Magic, handshake.Version, uMod_PROTOCOL_MAGIC, uMod_PROTOCOL_VERSION);
+    return (RETURN_PIPE_PROTOCOL);
   }
-
-  delete [] buffer;
   return (RETURN_OK);
 }
 
@@ -715,11 +1225,21 @@ int uMod_TextureServer::OpenPipe(wchar_t *game) // called from InitInstance()
   if (Pipe.Out == INVALID_HANDLE_VALUE) return (RETURN_PIPE_NOT_OPENED);
 
   unsigned int len = 0u;
-  while (game[len]) len++;
+  while (game[len] && len<MAX_PATH-1) len++;
   len++; //to send also the zero
+
+  //send the protocol version and the name of this game to uMod_GUI (in one message)
+  char buffer[sizeof(HandshakeStruct) + MAX_PATH*sizeof(wchar_t)];
+  HandshakeStruct *handshake = (HandshakeStruct*) buffer;
+  handshake->Magic = uMod_PROTOCOL_MAGIC;
+  handshake->Version = uMod_PROTOCOL_VERSION;
+  wchar_t *name = (wchar_t*) &buffer[sizeof(HandshakeStruct)];
+  for (unsigned int i=0u; i<len-1; i++) name[i] = game[i];
+  name[len-1] = 0;
+
   unsigned long num;
-  //send name of this game to uMod_GUI
-  WriteFile(Pipe.Out, (const void*) game, len * sizeof(wchar_t), &num, NULL);
+  WriteFile(Pipe.Out, (const void*) buffer, sizeof(HandshakeStruct) + len * sizeof(wchar_t), &num, NULL);
+  // the answer of uMod_GUI is read in MainLoop(), we must not block here (we are called from DllMain)
 
   // now we can open the pipe for reading
   Message("OpenPipe: In\n");
@@ -728,7 +1248,7 @@ int uMod_TextureServer::OpenPipe(wchar_t *game) // called from InitInstance()
       0, // no sharing
       NULL, // default security attributes
       OPEN_EXISTING, // opens existing pipe
-      0, // default attributes
+      FILE_FLAG_OVERLAPPED, // the Mainloop() reads the next bytes while it processes the last ones
       NULL); // no template file
 
   if (Pipe.In == INVALID_HANDLE_VALUE)
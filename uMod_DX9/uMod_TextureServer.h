@@ -22,6 +22,7 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 
 #include "../uMod_GlobalDefines.h"
 #include "uMod_ArrayHandler.h"
+#include "uMod_DecodeCache.h"
 
 
 /*
@@ -36,14 +37,31 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 
 class uMod_TextureClient;
 
+#define uMod_DEFAULT_MEMORY_BUDGET (((unsigned int) uMod_DEFAULT_MEMORY_BUDGET_MB)<<20)
+
+typedef struct
+{
+  SLIST_ENTRY Entry; // must be the first member
+  MyTypeHash Hash;
+} FetchRequestStruct; // the clients push their fetch requests (lazy mode) into a lock-free list
+
+typedef struct
+{
+  uMod_Slab* Slab;
+  unsigned int Size;
+  int Version; // the first version of the update, which does not contain this file content
+} RetiredDataStruct; // file content which was replaced, but might still be referenced by a client
+
 class uMod_TextureServer
 {
 public:
   uMod_TextureServer(wchar_t *name);
   ~uMod_TextureServer(void);
 
-  int AddClient(uMod_TextureClient *client, TextureFileStruct** update, int* number); // called from a Client
+  int AddClient(uMod_TextureClient *client, TextureFileStruct** update, int* number, int* version); // called from a Client
   int RemoveClient(uMod_TextureClient *client); // called from a Client
+  int RequestFile( MyTypeHash hash); // called from a Client, if the file content of a lazy entry is needed (does not block)
+  int VersionMerged(void); // called from a Client, if it has acknowledged a newer version (does not block), the server thread collects the garbage
 
   int OpenPipe(wchar_t *name); // called on initialization of our d3d9 fake dll
   int ClosePipe(void); // called on exit of our d3d9 fake dll
@@ -53,9 +71,13 @@ public:
   // following functions are only public for testing purpose !!
   // they should be private and only be called from the Mainloop
 
-  int AddFile( char* buffer, unsigned int size,  MyTypeHash hash, bool force); // called from Mainloop(), if the content of the texture is sent
+  int AddFile( char* buffer, unsigned int size,  MyTypeHash hash, bool force, uMod_Slab* slab=NULL); // called from Mainloop(), if the content of the texture is sent
+  // if the buffer lies in a slab, the file content is not copied, the texture takes a reference to the slab
+  // if buffer is NULL, only the hash is added and the file content is fetched later (lazy mode)
+  int FetchedFile( char* buffer, unsigned int size,  MyTypeHash hash, uMod_Slab* slab=NULL); // called from Mainloop(), the file content of a lazy entry
   int AddFile( wchar_t* file_name, MyTypeHash hash, bool force); // called from Mainloop(), if the name and the path to the file is sent
   int RemoveFile( MyTypeHash hash); // called from Mainloop()
+  int ReserveFiles( int number); // called from Mainloop(), before a batch of number textures is added
 
   int SaveAllTextures(bool val); // called from Mainloop()
   int SaveSingleTexture(bool val); // called from Mainloop()
@@ -70,18 +92,44 @@ public:
   int SetFontColour(DWORD colour); // called from Mainloop()
   int SetTextureColour(DWORD colour); // called from Mainloop()
 
+  int SetMemoryBudget(unsigned int mega_bytes); // called from Mainloop()
+  unsigned int GetRetainedBytes(void) {return (RetainedBytes);} // size of the file content of removed textures, which is still held in memory (also sent to uMod_GUI)
+
+  uMod_DecodeCache DecodeCache; // decoded fake textures, used by all clients
+
 private:
   bool BoolSaveAllTextures;
   bool BoolSaveSingleTexture;
   wchar_t SavePath[MAX_PATH];
   wchar_t GameName[MAX_PATH];
 
+  int BeginRead( char* buffer, unsigned int size); // called from Mainloop(), starts an overlapped read
+  int EndRead( unsigned long &num); // called from Mainloop(), waits until the read is finished
+  int ReadHandshake(void); // called from Mainloop(), checks the protocol version of uMod_GUI
+  int SendToGUI( unsigned int control, unsigned int value, MyTypeHash hash=0u); // called from Mainloop(), the messages to uMod_GUI are not framed
+  int SendRequests(void); // called from EndRead(), sends the fetch requests of the clients
+  int CollectMerged(void); // called from EndRead(), collects the garbage, if a client has acknowledged a newer version
+  int PrepareSlab( uMod_Slab* &slab, uMod_FrameDecoder &decoder); // called from Mainloop(), before the next bytes are read
+  // a new slab is allocated, if the pending record does not fit into the current slab (or the slab is full),
+  // the old slab is released by the reader and freed, when the last texture in it is freed
+
   int PropagateUpdate(uMod_TextureClient* client=NULL); // called from Mainloop() if texture are loaded or removed
+  // the clients get only the changes since the last update (delta update),
+  // a full update is only send, if a client has not merged the last update
   int PrepareUpdate(TextureFileStruct** update, int* number); // called from PropagateUpdate() and AddClient()
   // generate a copy of the current texture to be modded
   // the file content of the textures are not copied, the clients get the pointer to the file content
   // but the arrays allocate by this function, must be deleted by the client
 
+  int AddChange( int type, TextureFileStruct* file); // called from AddFile() and RemoveFile()
+  int ReserveChanges( int number);
+
+  int RetireData( uMod_Slab* slab, unsigned int size); // called from AddFile(), if the file content of a known texture is replaced
+  int CollectGarbage( bool merged=false); // called from PropagateUpdate() and CollectMerged()
+  // frees the file content, which cannot be referenced by any client anymore (all clients have merged a newer update),
+  // unreferenced files in OldMod are kept as long as they fit into the MemoryBudget
+  // if merged is true, nothing is done unless the oldest version merged by all clients has grown since the last call
+
   int LockMutex();
   int UnlockMutex();
   HANDLE Mutex;
@@ -96,14 +144,34 @@ private:
 
 
   PipeStruct Pipe;
+  OVERLAPPED Overlapped; // only one read is pending at once
+  PSLIST_HEADER Requests; // fetch requests of the clients (FetchRequestStruct)
+  HANDLE RequestEvent; // is set, if a request is pushed
 
   uMod_TextureClient** Clients;
   int NumberOfClients;
   int LenghtOfClients;
 
+  TextureChangeStruct* Changes; // changes of CurrentMod since the last update
+  int NumberOfChanges;
+  int LengthOfChanges;
+  bool ChangesLost; // if a change could not be stored, all clients get a full update
+  int Version; // is increased with each update
+  unsigned int Generation; // is increased for each new file content
+
   uMod_FileHandler CurrentMod;  // hold the file content of texture
   uMod_FileHandler OldMod; // hold the file content of texture which were added previously but are not needed any more
   // this is needed, because a texture clients might not have merged the last update and thus hold pointers to the file content of old textures
+
+  RetiredDataStruct* Retired; // replaced file content of textures in CurrentMod
+  int NumberOfRetired;
+  int LengthOfRetired;
+
+  unsigned int MemoryBudget; // in bytes
+  unsigned int RetainedBytes; // is updated by CollectGarbage()
+  unsigned int ReportedBytes; // last RetainedBytes sent to uMod_GUI
+  int CollectedVersion; // oldest version merged by all clients during the last CollectGarbage()
+  volatile LONG CollectRequested; // is set by VersionMerged() and RemoveClient()
 };
 
 
@@ -0,0 +1,46 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef uMod_TEXTURETYPE_H_
+#define uMod_TEXTURETYPE_H_
+
+// these values are also returned by QueryInterface( IID_IDirect3D9, ...) of our texture objects
+#define uMod_TYPE_NONE 0L
+#define uMod_TYPE_TEXTURE 0x01000000L
+#define uMod_TYPE_VOLUME_TEXTURE 0x01000001L
+#define uMod_TYPE_CUBE_TEXTURE 0x01000002L
+
+/*
+ *  Returns the type of our texture object or uMod_TYPE_NONE, if the texture was not created by our device.
+ *
+ *  SetTexture() is called for each draw call, thus the type is identified by the vtable pointer
+ *  (the first member of each COM object) and not by a call of QueryInterface().
+ *  The vtable pointers are stored by the constructors, they are NULL as long as no object of a type exists.
+ */
+inline long uMod_GetTextureType( IDirect3DBaseTexture9 *pTexture)
+{
+  void *vtable = *(void**) pTexture;
+  if (vtable==uMod_IDirect3DTexture9::VTable) return (uMod_TYPE_TEXTURE);
+  if (vtable==uMod_IDirect3DVolumeTexture9::VTable) return (uMod_TYPE_VOLUME_TEXTURE);
+  if (vtable==uMod_IDirect3DCubeTexture9::VTable) return (uMod_TYPE_CUBE_TEXTURE);
+  return (uMod_TYPE_NONE);
+}
+
+#endif /* uMod_TEXTURETYPE_H_ */
@@ -47,8 +47,10 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 
 #define RETURN_UPDATE_ALLREADY_ADDED -50
 #define RETURN_FILE_NOT_LOADED -51
+#define RETURN_UPDATE_OUT_OF_DATE -52
 
 #define RETURN_PIPE_NOT_OPENED 60
+#define RETURN_PIPE_PROTOCOL 61
 
 
 
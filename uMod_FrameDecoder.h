@@ -0,0 +1,82 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef uMod_FRAMEDECODER_H_
+#define uMod_FRAMEDECODER_H_
+
+/*
+ *  Splits the byte stream of a pipe into records (FrameHeaderStruct + record).
+ *
+ *  The decoder does not own any memory, the caller reads into its buffer behind GetEnd() and calls Received().
+ *  Next() returns the complete records one after another. An incomplete record stays pending
+ *  (from GetBegin() to GetEnd()) until more bytes are received. If the record does not fit into
+ *  the buffer, the caller moves the pending bytes to the beginning of a buffer with at least GetNeeded() bytes and calls Rebase().
+ *
+ *  It depends only on uMod_GlobalDefines.h, thus it is used by the game and can be tested on its own.
+ */
+
+class uMod_FrameDecoder
+{
+public:
+  uMod_FrameDecoder(void) {Reset();}
+
+  void Reset(void) {Begin = 0u; End = 0u;}
+  void Received( unsigned int num) {End += num;}
+  void Rebase(void) {End -= Begin; Begin = 0u;} // the pending bytes were moved to the beginning of the buffer
+
+  unsigned int GetBegin(void) const {return (Begin);} // begin of the pending bytes
+  unsigned int GetEnd(void) const {return (End);} // the next bytes must be read to this position
+  unsigned int GetPending(void) const {return (End - Begin);}
+
+  // returns 1 if the next record is complete (offset and size of the record inside the buffer),
+  // 0 if more bytes are needed and -1 if the stream is corrupt
+  int Next( const char* buffer, unsigned int &offset, unsigned int &size)
+  {
+    if (End - Begin < sizeof(FrameHeaderStruct)) return (0);
+    unsigned int len = GetSize( buffer);
+    if (len > uMod_MAX_RECORD_SIZE) return (-1);
+    if (End - Begin - sizeof(FrameHeaderStruct) < len) return (0);
+
+    offset = Begin + sizeof(FrameHeaderStruct);
+    size = len;
+    Begin = offset + len;
+    return (1);
+  }
+
+  unsigned int GetNeeded( const char* buffer) const // number of bytes the pending record needs in total (including the header)
+  {
+    if (End - Begin < sizeof(FrameHeaderStruct)) return (sizeof(FrameHeaderStruct));
+    unsigned int len = GetSize( buffer);
+    if (len > uMod_MAX_RECORD_SIZE) return (sizeof(FrameHeaderStruct)); // Next() will report the corrupt stream
+    return (sizeof(FrameHeaderStruct) + len);
+  }
+
+private:
+  unsigned int GetSize( const char* buffer) const // the header might not be aligned
+  {
+    const unsigned char* header = (const unsigned char*) &buffer[Begin];
+    return (header[0] | (header[1]<<8) | (header[2]<<16) | ((unsigned int) header[3]<<24));
+  }
+
+  unsigned int Begin;
+  unsigned int End;
+};
+
+#endif /* uMod_FRAMEDECODER_H_ */
@@ -0,0 +1,360 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Main.h"
+
+
+static unsigned long long GetIndexOffset( const CacheHeaderStruct &header)
+{
+  unsigned long long offset = sizeof(CacheHeaderStruct) + (header.PathLength + header.CommentLength) * sizeof(wchar_t);
+  return ((offset + 7u) & ~7ull); // the index is aligned to 8 bytes
+}
+
+volatile LONG uMod_Cache::Stored = 0;
+volatile LONG uMod_Cache::Pruning = 0;
+
+uMod_Cache::uMod_Cache(void)
+{
+  OpenResult = -1;
+  Mapping = NULL;
+  View = NULL;
+  ViewSize = 0ull;
+  Header = NULL;
+  Entries = NULL;
+}
+
+uMod_Cache::~uMod_Cache(void)
+{
+  Close();
+}
+
+
+int uMod_Cache::Open( const wxString &file)
+{
+  if (file.Len()>0 && file==OpenedFile) return OpenResult; // GetComment and GetContent are called one after the other
+
+  Unmap();
+  OpenedFile = file;
+  OpenResult = -1;
+
+  unsigned long long size, time;
+  if (GetKey( file, size, time)) return -1;
+
+  wxString name = GetCacheName( file);
+  HANDLE handle = CreateFileW( name.wc_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (handle==INVALID_HANDLE_VALUE) return -1;
+
+  LARGE_INTEGER len;
+  if (!GetFileSizeEx( handle, &len) || (unsigned long long) len.QuadPart<sizeof(CacheHeaderStruct) || (unsigned long long) len.QuadPart>(SIZE_T) -1)
+  {
+    CloseHandle( handle);
+    return -1;
+  }
+  Mapping = CreateFileMappingW( handle, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle( handle); // the mapping keeps the file open
+  if (Mapping==NULL) return -1;
+
+  View = (char*) MapViewOfFile( Mapping, FILE_MAP_READ, 0, 0, 0);
+  if (View==NULL) {Unmap(); return -1;}
+  ViewSize = len.QuadPart;
+
+  Header = (CacheHeaderStruct*) View;
+  if (Header->Magic!=uMod_CACHE_MAGIC || Header->Version!=uMod_CACHE_VERSION) {Unmap(); return -1;}
+  if (Header->FileSize!=size || Header->FileTime!=time) {Unmap(); return -1;} // the package has been changed
+
+  unsigned long long offset = GetIndexOffset( *Header);
+  if (offset + (unsigned long long) Header->Number * sizeof(CacheEntryStruct) > ViewSize) {Unmap(); return -1;}
+
+  wxString path( (wchar_t*) &View[sizeof(CacheHeaderStruct)], Header->PathLength);
+  if (path.CmpNoCase( file)!=0) {Unmap(); return -1;} // two paths share the same cache name
+
+  Entries = (CacheEntryStruct*) &View[offset];
+  for (unsigned int i=0; i<Header->Number; i++)
+  {
+    if (Entries[i].Offset>ViewSize || Entries[i].Size>ViewSize - Entries[i].Offset) {Unmap(); return -1;} // truncated file
+  }
+
+  Touch( name);
+  OpenResult = 0;
+  return 0;
+}
+
+void uMod_Cache::Close(void)
+{
+  Unmap();
+  OpenedFile.Empty();
+  OpenResult = -1;
+}
+
+void uMod_Cache::Unmap(void)
+{
+  if (View!=NULL) UnmapViewOfFile( View);
+  if (Mapping!=NULL) CloseHandle( Mapping);
+  Mapping = NULL;
+  View = NULL;
+  ViewSize = 0ull;
+  Header = NULL;
+  Entries = NULL;
+}
+
+
+int uMod_Cache::GetComment( wxString &comment)
+{
+  if (View==NULL) return -1;
+  comment = wxString( (wchar_t*) &View[sizeof(CacheHeaderStruct) + Header->PathLength * sizeof(wchar_t)], Header->CommentLength);
+  return 0;
+}
+
+int uMod_Cache::GetContent( AddTextureClass &tex, bool add)
+{
+  if (View==NULL) return -1;
+
+  unsigned int num = Header->Number;
+  if (tex.SetSize(num)) return -1;
+
+  for (unsigned int i=0; i<num; i++)
+  {
+    tex.Hash[i] = Entries[i].Hash;
+    if (add)
+    {
+      if (GetMemory( tex.Textures[i], Entries[i].Size)) {tex.Num = i; return -1;}
+      memcpy( tex.Textures[i], &View[Entries[i].Offset], Entries[i].Size);
+      tex.Size[i] = Entries[i].Size;
+    }
+    else
+    {
+      tex.Textures[i] = NULL;
+      tex.Size[i] = 0;
+    }
+  }
+  tex.Num = num;
+  return 0;
+}
+
+
+int uMod_Cache::Store( const wxString &file, const wxString &comment, AddTextureClass &tex)
+{
+  Close();
+
+  CacheHeaderStruct header;
+  header.Magic = uMod_CACHE_MAGIC;
+  header.Version = uMod_CACHE_VERSION;
+  if (GetKey( file, header.FileSize, header.FileTime)) return -1;
+  header.PathLength = file.Len();
+  header.CommentLength = comment.Len();
+  header.Number = tex.Num;
+  header.Reserved = 0u;
+
+  unsigned long long index = GetIndexOffset( header);
+  unsigned long long offset = index + (unsigned long long) tex.Num * sizeof(CacheEntryStruct);
+
+  CacheEntryStruct *entries = NULL;
+  if (GetMemory( entries, tex.Num>0 ? tex.Num : 1)) return -1;
+  for (unsigned int i=0; i<tex.Num; i++)
+  {
+    if (tex.Textures[i]==NULL) {delete [] entries; return -1;} // only completely loaded packages are cached
+    entries[i].Hash = tex.Hash[i];
+    entries[i].Size = tex.Size[i];
+    entries[i].Offset = offset;
+    offset += tex.Size[i];
+  }
+  if (offset>uMod_CACHE_MAX_SIZE) {delete [] entries; return -1;}
+
+  wchar_t *app_path = _wgetenv( L"APPDATA");
+  wxString dir;
+  dir.Printf("%ls\\%ls", app_path, uMod_APP_DIR);
+  if (!wxDir::Exists(dir)) wxDir::Make(dir);
+  dir.Printf("%ls\\%ls\\%ls", app_path, uMod_APP_DIR, uMod_CACHE_DIR);
+  if (!wxDir::Exists(dir)) wxDir::Make(dir);
+
+  // the cache is written into a temporary file first, a crash must not leave a truncated cache behind
+  wxString name = GetCacheName( file);
+  wxString temp = name;
+  temp << L".tmp";
+
+  wxFile dat;
+  dat.Open( temp, wxFile::write);
+  if (!dat.IsOpened()) {delete [] entries; return -1;}
+
+  const char padding[8] = {0};
+  unsigned int pad = (unsigned int) (index - sizeof(CacheHeaderStruct) - (header.PathLength + header.CommentLength) * sizeof(wchar_t));
+
+  bool ok = dat.Write( &header, sizeof(CacheHeaderStruct)) == sizeof(CacheHeaderStruct);
+  if (ok && header.PathLength>0) ok = dat.Write( file.wc_str(), header.PathLength * sizeof(wchar_t)) == header.PathLength * sizeof(wchar_t);
+  if (ok && header.CommentLength>0) ok = dat.Write( comment.wc_str(), header.CommentLength * sizeof(wchar_t)) == header.CommentLength * sizeof(wchar_t);
+  if (ok && pad>0) ok = dat.Write( padding, pad) == pad;
+  if (ok && tex.Num>0) ok = dat.Write( entries, tex.Num * sizeof(CacheEntryStruct)) == tex.Num * sizeof(CacheEntryStruct);
+  for (unsigned int i=0; ok && i<tex.Num; i++) ok = dat.Write( tex.Textures[i], tex.Size[i]) == tex.Size[i];
+  dat.Close();
+  delete [] entries;
+
+  if (!ok || !wxRenameFile( temp, name, true))
+  {
+    wxRemoveFile( temp);
+    return -1;
+  }
+  InterlockedExchange( &Stored, 1); // the directory is pruned once for the whole batch
+  return 0;
+}
+
+
+int uMod_Cache::GetKey( const wxString &file, unsigned long long &size, unsigned long long &time)
+{
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (!GetFileAttributesExW( file.wc_str(), GetFileExInfoStandard, &data)) return -1;
+  size = ((unsigned long long) data.nFileSizeHigh << 32) | data.nFileSizeLow;
+  time = ((unsigned long long) data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+  return 0;
+}
+
+wxString uMod_Cache::GetCacheName( const wxString &file)
+{
+  // FNV-1a of the path, the path itself is stored in the header to detect collisions
+  wxString path = file.Lower();
+  unsigned long long hash = 14695981039346656037ull;
+  for (unsigned int i=0; i<path.Len(); i++)
+  {
+    hash ^= (unsigned long long) path[i].GetValue();
+    hash *= 1099511628211ull;
+  }
+
+  wxString name;
+  name.Printf("%ls\\%08x%08x.cache", GetCacheDir().wc_str(), (unsigned int) (hash>>32), (unsigned int) hash);
+  return name;
+}
+
+wxString uMod_Cache::GetCacheDir(void)
+{
+  wxString dir;
+  dir.Printf("%ls\\%ls\\%ls", _wgetenv( L"APPDATA"), uMod_APP_DIR, uMod_CACHE_DIR);
+  return dir;
+}
+
+void uMod_Cache::Touch( const wxString &name)
+{
+  // the time of last access is not updated on most systems, thus the time of last write is used
+  HANDLE handle = CreateFileW( name.wc_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (handle==INVALID_HANDLE_VALUE) return;
+  FILETIME now;
+  GetSystemTimeAsFileTime( &now);
+  SetFileTime( handle, NULL, NULL, &now);
+  CloseHandle( handle);
+}
+
+bool uMod_Cache::IsStale( const wxString &name)
+{
+  wxFile dat;
+  dat.Open( name, wxFile::read);
+  if (!dat.IsOpened()) return false; // might be in use
+
+  CacheHeaderStruct header;
+  if (dat.Read( &header, sizeof(CacheHeaderStruct))!=sizeof(CacheHeaderStruct)) return true;
+  if (header.Magic!=uMod_CACHE_MAGIC || header.Version!=uMod_CACHE_VERSION || header.PathLength==0 || header.PathLength>32767) return true;
+
+  wchar_t *path = NULL;
+  if (GetMemory( path, header.PathLength+1)) return false;
+  bool stale = dat.Read( path, header.PathLength * sizeof(wchar_t))!=header.PathLength * sizeof(wchar_t);
+  path[header.PathLength] = 0;
+  dat.Close();
+
+  unsigned long long size, time;
+  if (!stale) stale = GetKey( wxString(path), size, time)!=0 || size!=header.FileSize || time!=header.FileTime;
+  delete [] path;
+  return stale;
+}
+
+void uMod_Cache::Prune(void)
+{
+  if (InterlockedExchange( &Pruning, 1)) return; // another sender prunes at the moment
+  if (InterlockedExchange( &Stored, 0)) PruneDirectory();
+  InterlockedExchange( &Pruning, 0);
+}
+
+void uMod_Cache::PruneDirectory(void)
+{
+  wxString dir = GetCacheDir();
+  wxString pattern = dir;
+  pattern << L"\\*";
+
+  WIN32_FIND_DATAW data;
+  HANDLE find = FindFirstFileW( pattern.wc_str(), &data);
+  if (find==INVALID_HANDLE_VALUE) return;
+
+  FILETIME file_time;
+  GetSystemTimeAsFileTime( &file_time);
+  unsigned long long now = ((unsigned long long) file_time.dwHighDateTime << 32) | file_time.dwLowDateTime;
+
+  wxArrayString names; // the remaining cache files
+  unsigned long long *sizes = NULL;
+  unsigned long long *last_use = NULL;
+  int length = 0;
+  unsigned long long total = 0ull;
+  do
+  {
+    if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+    wxString name = dir;
+    name << L"\\" << data.cFileName;
+    unsigned long long size = ((unsigned long long) data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    unsigned long long time = ((unsigned long long) data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+
+    if (name.EndsWith( L".tmp"))
+    {
+      if (now>time && now-time > uMod_CACHE_TMP_AGE*10000000ull) wxRemoveFile( name); // FILETIME counts 100 ns
+      continue;
+    }
+    if (!name.EndsWith( L".cache")) continue;
+    if (IsStale( name)) {wxRemoveFile( name); continue;}
+
+    if ((int) names.GetCount()>=length)
+    {
+      unsigned long long *temp_sizes = NULL;
+      unsigned long long *temp_times = NULL;
+      if (GetMemory( temp_sizes, length+64) || GetMemory( temp_times, length+64))
+      {
+        if (temp_sizes!=NULL) delete [] temp_sizes;
+        break;
+      }
+      for (int i=0; i<length; i++) {temp_sizes[i] = sizes[i]; temp_times[i] = last_use[i];}
+      if (sizes!=NULL) delete [] sizes;
+      if (last_use!=NULL) delete [] last_use;
+      sizes = temp_sizes;
+      last_use = temp_times;
+      length += 64;
+    }
+    sizes[names.GetCount()] = size;
+    last_use[names.GetCount()] = time;
+    names.Add( name);
+    total += size;
+  } while (FindNextFileW( find, &data));
+  FindClose( find);
+
+  // the least recently used files are deleted first, a file which is mapped by another package cannot be deleted
+  int num = names.GetCount();
+  while (total>uMod_CACHE_BUDGET)
+  {
+    int oldest = -1;
+    for (int i=0; i<num; i++) if (sizes[i]>0ull && (oldest<0 || last_use[i]<last_use[oldest])) oldest = i;
+    if (oldest<0) break;
+    if (wxRemoveFile( names[oldest])) total -= sizes[oldest];
+    sizes[oldest] = 0ull; // is not considered again
+  }
+  if (sizes!=NULL) delete [] sizes;
+  if (last_use!=NULL) delete [] last_use;
+}
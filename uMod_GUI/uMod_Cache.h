@@ -0,0 +1,107 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef uMod_CACHE_H_
+#define uMod_CACHE_H_
+
+#include "uMod_Main.h"
+
+/*
+ *  The textures of a zip or tpf package are extracted once and stored in a cache file
+ *  (%APPDATA%\uMod\Cache\). The next time the package is loaded, the cache file is mapped
+ *  into memory and the package is neither read, decrypted nor inflated.
+ *
+ *  The cache file is named after the path of the package. It is only valid as long as size and
+ *  time of last write of the package are the same as stored in the header, otherwise it is overwritten.
+ *
+ *  layout: CacheHeaderStruct, path, comment, (padding), CacheEntryStruct[Number], textures
+ *
+ *  The time of last write of a cache file is set to the time of its last use. After a batch of packages was loaded
+ *  and at least one cache file was stored (Prune()), the files of deleted or changed packages are removed and the
+ *  least recently used files are deleted until all files fit into uMod_CACHE_BUDGET.
+ */
+
+#define uMod_CACHE_DIR L"Cache"
+#define uMod_CACHE_MAGIC 0x43446D75u // "umDC"
+#define uMod_CACHE_VERSION 1u
+#define uMod_CACHE_MAX_SIZE (1u<<30) // bigger packages are not cached
+#define uMod_CACHE_BUDGET (4ull<<30) // total size of all cache files
+#define uMod_CACHE_TMP_AGE 3600ull // in s, older temporary files are left over by a crash
+
+typedef struct
+{
+  unsigned int Magic;
+  unsigned int Version;
+  unsigned long long FileSize; // size of the package
+  unsigned long long FileTime; // time of last write of the package
+  unsigned int PathLength; // number of wchar_t (without terminating zero)
+  unsigned int CommentLength; // number of wchar_t (without terminating zero)
+  unsigned int Number; // number of textures
+  unsigned int Reserved;
+} CacheHeaderStruct;
+
+typedef struct
+{
+  unsigned int Hash;
+  unsigned int Size;
+  unsigned long long Offset; // from the beginning of the cache file
+} CacheEntryStruct;
+
+
+class uMod_Cache
+{
+public:
+  uMod_Cache(void);
+  ~uMod_Cache(void);
+
+  int Open( const wxString &file); // returns 0 if an up to date cache of this package exists
+  void Close(void);
+
+  int GetComment( wxString &comment);
+  int GetContent( AddTextureClass &tex, bool add);
+
+  int Store( const wxString &file, const wxString &comment, AddTextureClass &tex); // might be called from several loader threads at once
+
+  static void Prune(void); // called from uMod_Sender::LoadPackages(), after the loader threads have finished
+
+private:
+  static int GetKey( const wxString &file, unsigned long long &size, unsigned long long &time);
+  static wxString GetCacheName( const wxString &file);
+  static wxString GetCacheDir(void);
+  static void Touch( const wxString &name); // marks the cache file as recently used
+  static bool IsStale( const wxString &name); // the package of this cache file was deleted or changed
+  static void PruneDirectory(void); // called from Prune()
+  void Unmap(void);
+
+  static volatile LONG Stored; // a cache file was stored since the last Prune()
+  static volatile LONG Pruning; // only one Prune() runs at once
+
+  wxString OpenedFile;
+  int OpenResult;
+
+  HANDLE Mapping;
+  char *View;
+  unsigned long long ViewSize;
+  CacheHeaderStruct *Header;
+  CacheEntryStruct *Entries;
+};
+
+
+#endif /* uMod_CACHE_H_ */
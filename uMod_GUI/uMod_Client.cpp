@@ -25,6 +25,8 @@ uMod_Client::uMod_Client( PipeStruct &pipe, uMod_Frame *frame) : wxThread(wxTHRE
   Pipe.In = pipe.In;
   Pipe.Out = pipe.Out;
   MainFrame = frame;
+  MappedGeneration = 0;
+  RegionFailed = 0;
 }
 
 uMod_Client::~uMod_Client(void)
@@ -46,33 +48,55 @@ uMod_Client::~uMod_Client(void)
 void* uMod_Client::Entry(void)
 {
   char buffer[SMALL_BUFSIZE];
+  uMod_MsgReader reader( SMALL_BUFSIZE); // a read might end inside a message, its bytes are kept for the next read
   while (1)
   {
     unsigned long size;
     bool ret = ReadFile(
              Pipe.In,        // handle to pipe
-             buffer,    // buffer to receive data
-             SMALL_BUFSIZE, // size of buffer
+             &buffer[reader.GetEnd()],    // buffer to receive data
+             reader.GetFree(), // size of buffer
              &size, // number of bytes read
              NULL);        // not overlapped I/O
 
     if (ret || GetLastError()==ERROR_MORE_DATA)
     {
-      unsigned int pos=0;
-      MsgStruct *commands;
-      bool update_textures = false;
-      while (pos<size-sizeof(MsgStruct))
+      reader.Received( size);
+      MsgStruct commands;
+      while (reader.Next( buffer, commands))
       {
-        commands = (MsgStruct*) &buffer[pos];
-        //unsigned int add_length = 0;
-        /*
-        switch (commands->Control)
+        switch (commands.Control)
         {
-
+        case CONTROL_REGION_MAPPED: // the sender of the game page can close the handle of the region
+        {
+          InterlockedExchange( &MappedGeneration, (LONG) commands.Value);
+          break;
+        }
+        case CONTROL_REGION_FAILED: // the game could not map the region, it fetches these textures, the next are sent over the pipe
+        {
+          InterlockedExchange( &RegionFailed, 1);
+          InterlockedExchange( &MappedGeneration, (LONG) commands.Value); // the handle is not needed anymore
+          break;
+        }
+        case CONTROL_RETAINED_MEMORY: // shown on the game page, which is owned by the main thread
+        {
+          uMod_Event event( uMod_EVENT_TYPE, ID_Retained_Memory);
+          event.SetClient(this);
+          event.SetValue(commands.Value);
+          wxPostEvent( MainFrame, event);
+          break;
+        }
+        case CONTROL_FETCH_TEXTURE: // the game needs the file content of a texture (lazy mode), the sender is owned by the main thread
+        {
+          uMod_Event event( uMod_EVENT_TYPE, ID_Fetch_Texture);
+          event.SetClient(this);
+          event.SetHash(commands.Hash);
+          wxPostEvent( MainFrame, event);
+          break;
+        }
         }
-        */
-        pos+=sizeof(MsgStruct);// + add_length;
       }
+      reader.Compact( buffer);
     }
     else
     {
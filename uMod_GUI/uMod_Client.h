@@ -35,11 +35,15 @@ public:
 
   void* Entry(void);
 
+  unsigned int GetMappedGeneration(void) {return ((unsigned int) MappedGeneration);} // last shared region which was mapped by the game
+  bool GetRegionFailed(void) {return (RegionFailed!=0);} // the game could not map a shared region, the textures must be sent over the pipe
 
   PipeStruct Pipe;
 
 private:
   uMod_Frame *MainFrame;
+  volatile LONG MappedGeneration;
+  volatile LONG RegionFailed;
 };
 
 #endif /* uMod_CLIENT_H_ */
@@ -0,0 +1,69 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef uMod_DUPLICATES_H_
+#define uMod_DUPLICATES_H_
+
+/*
+ *  duplicate[k] is true if an earlier texture in the list has the same hash, k counts the textures of all packages.
+ *  Called from uMod_Sender::SendTextures(), T is AddTextureClass (only Num and Hash are used).
+ *
+ *  It depends only on GetMemory(), thus it can be tested on its own.
+ */
+template <class T>
+int uMod_MarkDuplicates( unsigned int num, T *tex, bool* &duplicate)
+{
+  unsigned int total = 0u;
+  for (unsigned int i=0u; i<num; i++) total += tex[i].Num;
+  if (GetMemory( duplicate, total>0u ? total : 1u, false)) return -1;
+
+  // open addressing, the table is at most half full
+  unsigned int size = 16u;
+  while (size<2u*total) size <<= 1;
+  unsigned long *keys = NULL;
+  bool *used = NULL;
+  if (GetMemory( keys, size) || GetMemory( used, size, false))
+  {
+    if (keys!=NULL) delete [] keys;
+    delete [] duplicate;
+    duplicate = NULL;
+    return -1;
+  }
+
+  // the packages are swept in the order of the list, only the first texture of each hash is not a duplicate
+  unsigned int pos = 0u;
+  for (unsigned int i=0u; i<num; i++) for (unsigned int j=0u; j<tex[i].Num; j++, pos++)
+  {
+    unsigned long hash = tex[i].Hash[j];
+    unsigned int slot = ((unsigned int) hash * 2654435761u) & (size-1u);
+    while (used[slot] && keys[slot]!=hash) slot = (slot+1u) & (size-1u);
+    if (used[slot]) duplicate[pos] = true;
+    else
+    {
+      used[slot] = true;
+      keys[slot] = hash;
+    }
+  }
+  delete [] keys;
+  delete [] used;
+  return 0;
+}
+
+#endif /* uMod_DUPLICATES_H_ */
@@ -38,7 +38,7 @@ public:
 
   // You *must* copy here the data to be transported
   uMod_Event( const uMod_Event &event )
-  :  wxCommandEvent(event) { this->SetText( event.GetText()); PipeIn=((uMod_Event&)event).GetPipeIn(); PipeOut=((uMod_Event&)event).GetPipeOut(); Name=((uMod_Event&)event).GetName(); Client=((uMod_Event&)event).GetClient();}
+  :  wxCommandEvent(event) { this->SetText( event.GetText()); PipeIn=((uMod_Event&)event).GetPipeIn(); PipeOut=((uMod_Event&)event).GetPipeOut(); Name=((uMod_Event&)event).GetName(); Client=((uMod_Event&)event).GetClient(); Hash=((uMod_Event&)event).GetHash(); Value=((uMod_Event&)event).GetValue();}
 
   // Required for sending with wxPostEvent()
   wxEvent* Clone() const { return new uMod_Event(*this); }
@@ -50,11 +50,15 @@ public:
   HANDLE GetPipeIn(void) {return PipeIn;}
   HANDLE GetPipeOut(void) {return PipeOut;}
   uMod_Client * GetClient(void) {return Client;}
+  MyTypeHash GetHash(void) {return Hash;}
+  unsigned int GetValue(void) {return Value;}
 
   void SetName( wxString name) {Name=name;}
   void SetPipeIn( HANDLE pipe) {PipeIn=pipe;}
   void SetPipeOut( HANDLE pipe) {PipeOut=pipe;}
   void SetClient( uMod_Client *client) {Client=client;}
+  void SetHash( MyTypeHash hash) {Hash=hash;}
+  void SetValue( unsigned int value) {Value=value;}
 
 private:
 
@@ -62,6 +66,8 @@ private:
   HANDLE PipeIn;
   HANDLE PipeOut;
   uMod_Client *Client;
+  MyTypeHash Hash;
+  unsigned int Value;
 
   wxString m_Text;
 };
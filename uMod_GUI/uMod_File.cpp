@@ -18,6 +18,7 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 
 #include "uMod_Main.h"
 #include "unzip.h"
+#include "uMod_XOR.h"
 
 
 uMod_File::uMod_File(void)
@@ -27,6 +28,11 @@ uMod_File::uMod_File(void)
   FileInMemory=NULL;
   MemoryLength=0u;
   FileLen=0u;
+  FileSize=0u;
+  Mapping=NULL;
+  View=NULL;
+  Decrypted=false;
+  CommentRead=false;
 }
 
 uMod_File::uMod_File(const wxString &file)
@@ -36,13 +42,18 @@ uMod_File::uMod_File(const wxString &file)
   FileInMemory=NULL;
   MemoryLength=0u;
   FileLen=0u;
+  FileSize=0u;
+  Mapping=NULL;
+  View=NULL;
+  Decrypted=false;
+  CommentRead=false;
   SetFile(file);
 }
 
 
 uMod_File::~uMod_File(void)
 {
-  if (FileInMemory!=NULL) delete [] FileInMemory;
+  FreeFile();
 }
 
 
@@ -62,11 +73,17 @@ int uMod_File::GetComment( wxString &tool_tip)
   wxString file_type = FileName.AfterLast( '.');
   if (file_type == L"zip")
   {
-    if (int ret = GetCommentZip( tool_tip)) return ret;
+    if (int ret = LoadComment()) {tool_tip = Language->NoComment; return ret;}
+
+    if (Comment.Len()>0) tool_tip = Comment;
+    else tool_tip = Language->NoComment;
   }
   else if (file_type == L"tpf")
   {
-    if (int ret = GetCommentTpf( tool_tip)) return ret;
+    if (int ret = LoadComment()) return ret;
+
+    tool_tip = Comment;
+    tool_tip.Prepend( Language->Author);
   }
   else if (file_type == L"dds")
   {
@@ -76,16 +93,46 @@ int uMod_File::GetComment( wxString &tool_tip)
   return 0;
 }
 
+int uMod_File::LoadComment(void)
+{
+  if (CommentRead) return 0;
+
+  wxString file_type = FileName.AfterLast( '.');
+  if (file_type != L"zip" && file_type != L"tpf") return 0;
+
+  if (Cache.Open( FileName)==0) Cache.GetComment( Comment); // the package need not to be read
+  else if (file_type == L"zip") {if (int ret = GetCommentZip( Comment)) return ret;}
+  else if (int ret = GetCommentTpf( Comment)) return ret;
+
+  CommentRead = true;
+  return 0;
+}
+
+void uMod_File::ReleaseFile(void)
+{
+  FreeFile();
+  Loaded = false;
+  Cache.Close();
+}
+
 int uMod_File::GetContent( AddTextureClass &tex, bool add)
 {
   wxString file_type = FileName.AfterLast( '.');
-  if (file_type == L"zip")
-  {
-    AddZip( tex, add, false);
-  }
-  else if (file_type == L"tpf")
+  if (file_type == L"zip" || file_type == L"tpf")
   {
-    AddZip( tex, add, true);
+    if (Cache.Open( FileName)==0)
+    {
+      if (Cache.GetContent( tex, add)) LastError << Language->Error_Memory;
+    }
+    else
+    {
+      bool tpf = (file_type == L"tpf");
+      AddZip( tex, add, tpf);
+      if (add && LastError.Len()==0) // only complete packages are cached
+      {
+        if (LoadComment()==0) Cache.Store( FileName, Comment, tex);
+      }
+    }
   }
   else if (file_type == L"dds")
   {
@@ -104,53 +151,140 @@ int uMod_File::GetContent( AddTextureClass &tex, bool add)
   }
 }
 
-int uMod_File::ReadFile(void)
+int uMod_File::ReadFile( bool tpf)
 {
   if (Loaded) return 0;
   XORed=false;
+  Decrypted=false;
+
+  if (MapFile( tpf)==0) // if the mapping fails (e.g. no free address space) the file is read into the heap
+  {
+    Decrypted = tpf;
+    Loaded = true;
+    return 0;
+  }
+  if (View!=NULL) FreeFile();
 
-  wxFile dat;
-  if (!dat.Access(FileName, wxFile::read)) {LastError << Language->Error_FileOpen <<"\n" << FileName; return -1;}
-  dat.Open(FileName, wxFile::read);
-  if (!dat.IsOpened()) {LastError << Language->Error_FileOpen <<"\n" << FileName; return -1;}
-  FileLen = dat.Length();
-  if (FileLen==0) {LastError << Language->Error_FileOpen <<"\n" << FileName; return -1;}
+  HANDLE dat = CreateFileW( FileName.wc_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (dat==INVALID_HANDLE_VALUE) {LastError << Language->Error_FileOpen <<"\n" << FileName; return -1;}
+  LARGE_INTEGER len;
+  if (!GetFileSizeEx( dat, &len) || len.QuadPart<=0 || len.QuadPart>=0xFFFFFFFF) {CloseHandle(dat); LastError << Language->Error_FileOpen <<"\n" << FileName; return -1;}
+  FileLen = (unsigned int) len.QuadPart;
+  FileSize = FileLen;
 
   if (FileLen>=MemoryLength)
   {
     if (FileInMemory!=NULL) delete [] FileInMemory;
     try {FileInMemory = new char [FileLen+1];}
-    catch (...) {FileInMemory=NULL; MemoryLength=0; FileLen=0; LastError << Language->Error_Memory; return -1;}
+    catch (...) {CloseHandle(dat); FileInMemory=NULL; MemoryLength=0; FileLen=0; LastError << Language->Error_Memory; return -1;}
     MemoryLength = FileLen+1;
   }
-  unsigned int result = dat.Read( FileInMemory, FileLen);
-  dat.Close();
 
-  if (result != FileLen) {FileLen=0; LastError << Language->Error_FileRead<<"\n" << FileName; return -1;}
+  // fallback if the file could not be mapped:
+  // the file is read in chunks, a tpf chunk is decrypted while the next chunk is read
+  OVERLAPPED overlapped;
+  memset( &overlapped, 0, sizeof(OVERLAPPED));
+  overlapped.hEvent = CreateEvent( NULL, TRUE, FALSE, NULL);
+  if (overlapped.hEvent==NULL) {CloseHandle(dat); FileLen=0; LastError << Language->Error_FileRead<<"\n" << FileName; return -1;}
+
+  unsigned int pos = 0u;
+  unsigned int size = FileLen<uMod_READ_CHUNK ? FileLen : uMod_READ_CHUNK;
+  bool ok = ::ReadFile( dat, FileInMemory, size, NULL, &overlapped) || GetLastError()==ERROR_IO_PENDING;
+  while (ok)
+  {
+    DWORD result;
+    if (!GetOverlappedResult( dat, &overlapped, &result, TRUE) || result!=size) {ok = false; break;}
+
+    unsigned int last = pos;
+    unsigned int last_size = size;
+    pos += size;
+    if (pos<FileLen)
+    {
+      size = FileLen-pos<uMod_READ_CHUNK ? FileLen-pos : uMod_READ_CHUNK;
+      overlapped.Offset = pos;
+      overlapped.OffsetHigh = 0;
+      ResetEvent( overlapped.hEvent);
+      ok = ::ReadFile( dat, &FileInMemory[pos], size, NULL, &overlapped) || GetLastError()==ERROR_IO_PENDING;
+    }
+    if (tpf) XORBuffer( &FileInMemory[last], last_size); // the chunk is still in the cache
+    if (pos>=FileLen) break;
+  }
+  if (!ok) CancelIo( dat);
+  CloseHandle( overlapped.hEvent);
+  CloseHandle( dat);
+
+  if (!ok) {FileLen=0; LastError << Language->Error_FileRead<<"\n" << FileName; return -1;}
   FileInMemory[FileLen]=0;
 
+  Decrypted = tpf;
   Loaded = true;
   return 0;
 }
 
 
+int uMod_File::MapFile( bool tpf)
+{
+  HANDLE dat = CreateFileW( FileName.wc_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (dat==INVALID_HANDLE_VALUE) return -1;
+  LARGE_INTEGER len;
+  if (!GetFileSizeEx( dat, &len) || len.QuadPart<=0 || len.QuadPart>=0xFFFFFFFF) {CloseHandle(dat); return -1;}
+
+  // a tpf is mapped copy-on-write, it is decrypted in place and the file itself is not changed
+  HANDLE mapping = CreateFileMappingW( dat, NULL, tpf ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+  CloseHandle( dat); // the mapping keeps the file open
+  if (mapping==NULL) return -1;
+  char *view = (char*) MapViewOfFile( mapping, tpf ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+  if (view==NULL) {CloseHandle( mapping); return -1;}
+
+  FreeFile();
+  Mapping = mapping;
+  View = view;
+  FileInMemory = view;
+  FileLen = (unsigned int) len.QuadPart;
+  FileSize = FileLen;
+
+  // nothing is read until a page is touched, thus each chunk of a tpf is read by the page faults of
+  // XORBuffer() and is decrypted while it is in the cache, there is no second pass over the file
+  if (tpf) for (unsigned int pos=0u; pos<FileLen; pos+=uMod_READ_CHUNK)
+    XORBuffer( &view[pos], FileLen-pos<uMod_READ_CHUNK ? FileLen-pos : uMod_READ_CHUNK);
+  return 0;
+}
+
+void uMod_File::FreeFile(void)
+{
+  if (View!=NULL)
+  {
+    UnmapViewOfFile( View);
+    CloseHandle( Mapping);
+  }
+  else if (FileInMemory!=NULL) delete [] FileInMemory;
+  Mapping = NULL;
+  View = NULL;
+  FileInMemory = NULL;
+  MemoryLength = 0u;
+  FileLen = 0u;
+  FileSize = 0u;
+}
+
+
+/*
+ *
+ * BIG THANKS TO Tonttu
+ * (TPFcreate 1.5)
+ *
+ */
+void uMod_File::XORBuffer( char* data, unsigned int len)
+{
+  uMod_XORBuffer( data, len); // SSE2, see uMod_XOR.h
+}
 
 int uMod_File::UnXOR(void)
 {
   if (XORed) return 0;
-  /*
-   *
-   * BIG THANKS TO Tonttu
-   * (TPFcreate 1.5)
-   *
-   */
-  unsigned int *buff = (unsigned int*) FileInMemory;
-  unsigned int TPF_XOR = 0x3FA43FA4u;
-  unsigned int size = FileLen/4u;
-  for (unsigned int i=0; i<size; i++) buff[i] ^= TPF_XOR;
-  for (unsigned int i=size*4u; i<size*4u+FileLen%4u; i++) ((unsigned char*) FileInMemory)[i]^=(unsigned char) TPF_XOR;
-
+  if (!Decrypted) XORBuffer( FileInMemory, FileLen); // ReadFile( true) decrypts while reading
+  Decrypted = true;
 
+  // the comment (author) is stored behind the zip data
   unsigned int pos = FileLen-1;
   while (pos>0u && FileInMemory[pos]) pos--;
   if (pos>0u && pos<FileLen-1) FileLen = pos+1;
@@ -178,42 +312,45 @@ int uMod_File::UnXOR(void)
 
 
 
-int uMod_File::GetCommentZip( wxString &tool_tip)
+int uMod_File::GetCommentZip( wxString &comment)
 {
+  comment.Empty();
   if (int ret = ReadFile()) return ret;
 
   HZIP ZIP_Handle = OpenZip( FileInMemory, FileLen, NULL);
-  if (ZIP_Handle==NULL)  {tool_tip = Language->NoComment; LastError << Language->Error_Unzip; return -1;}
+  if (ZIP_Handle==NULL)  {LastError << Language->Error_Unzip; return -1;}
 
   ZIPENTRY ze;
   int index;
   FindZipItem( ZIP_Handle, L"Comment.txt", false, &index, &ze);
   if (index>=0) //if Comment.txt is present in the zip file
   {
-    char* comment;
+    char* buffer;
     int len = ze.unc_size;
-    try {comment=new char[len+1];}
-    catch(...) {tool_tip = Language->NoComment; LastError << Language->Error_Memory; return -1;}
-    ZRESULT zr = UnzipItem( ZIP_Handle, index, comment, len);
-
-    if (zr!=ZR_OK && zr!=ZR_MORE) {delete [] comment; tool_tip = Language->NoComment;  LastError << Language->Error_Unzip <<"\nZIP:" << L"Comment.txt"; return -1;}
-    comment[len]=0;
-    tool_tip = comment;
-    delete [] comment;
+    try {buffer=new char[len+1];}
+    catch(...) {LastError << Language->Error_Memory; return -1;}
+    ZRESULT zr = UnzipItem( ZIP_Handle, index, buffer, len);
+
+    if (zr!=ZR_OK && zr!=ZR_MORE) {delete [] buffer; LastError << Language->Error_Unzip <<"\nZIP:" << L"Comment.txt"; return -1;}
+    buffer[len]=0;
+    comment = buffer;
+    delete [] buffer;
   }
-  else tool_tip = Language->NoComment;
 
   CloseZip(ZIP_Handle);
   return 0;
 }
 
-int uMod_File::GetCommentTpf( wxString &tool_tip)
+int uMod_File::GetCommentTpf( wxString &comment)
 {
-  if (int ret = ReadFile()) return ret;
+  if (int ret = ReadFile( true)) return ret;
 
   UnXOR();
-  tool_tip = &FileInMemory[FileLen];
-  tool_tip.Prepend( Language->Author);
+  // the comment stands behind the last zero, a mapped file is not terminated with a zero
+  const char *text = &FileInMemory[FileLen];
+  unsigned int len = 0u;
+  while (FileLen+len<FileSize && text[len]) len++;
+  comment = wxString( text, len);
   return 0;
 }
 
@@ -252,7 +389,7 @@ int uMod_File::AddFile( AddTextureClass &tex, bool add)
 
 int uMod_File::AddZip( AddTextureClass &tex, bool add, bool tpf)
 {
-  if (int ret = ReadFile()) return ret;
+  if (int ret = ReadFile( tpf)) return ret;
 
   if (tpf)
   {
@@ -357,8 +494,7 @@ int uMod_File::AddContent( const char* pw, AddTextureClass &tex, bool add)
         else
         {
           LastError << Language->Error_Unzip <<"\nTPF:" << file << "\n";
-          CloseZip(ZIP_Handle); //somehow we need to close and to reopen the zip handle, otherwise the program crashes
-          ZIP_Handle = OpenZip( FileInMemory, FileLen, pw);
+          // the zip handle needs not to be reopened anymore, a miss of the name index does not change the current file
         }
       }
       else
@@ -382,28 +518,15 @@ int uMod_File::AddContent( const char* pw, AddTextureClass &tex, bool add)
     int num = ze.index;
 
     tex.SetSize(num);
+    int *items = NULL; // index of each texture in the zip file
+    if (num>0 && GetMemory( items, num)) {CloseZip(ZIP_Handle); LastError << Language->Error_Memory; return -1;}
+
+    // first pass: only the names are read, the textures are selected by their name and hash
     int count = 0;
     unsigned long temp_hash;
     for (int i=0; i<num; i++)
     {
       if (GetZipItem( ZIP_Handle, i, &ze)!=ZR_OK) continue; //ask for name and size
-      int len = ze.unc_size;
-
-      char *buffer;
-      try {buffer = new char[len+1];}
-      catch(...)
-      {
-        continue;
-      }
-
-
-      ZRESULT rz = UnzipItem( ZIP_Handle, i, buffer, len);
-      if (rz!=ZR_OK && rz!=ZR_MORE)
-      {
-        delete [] buffer;
-        buffer = NULL;
-        LastError << Language->Error_Unzip <<"\nZIP:" << file << "\n";
-      }
 
       file = ze.name;
       if (file.Len()==0) continue;
@@ -416,24 +539,51 @@ int uMod_File::AddContent( const char* pw, AddTextureClass &tex, bool add)
 
       if (!name.ToULong( &temp_hash, 16)) {LastError << Language->Error_Hash <<"\nZIP:" << file << "\n"; continue;} //if hash could not be extracted
 
-      if (add)
-      {
-        if (buffer==NULL) continue;
+      items[count] = i;
+      tex.Hash[count] = temp_hash;
+      tex.Size[count] = ze.unc_size;
+      tex.Textures[count] = NULL;
+      count++;
+    }
 
-        tex.Textures[count] = buffer;
-        tex.Hash[count] = temp_hash;
-        tex.Size[count] = len;//ze.unc_size;
-        count++;
-      }
-      else
+    if (!add) // only the hashes are needed
+    {
+      for (int i=0; i<count; i++) tex.Size[i] = 0;
+      tex.Num = count;
+    }
+    else
+    {
+      // second pass: only the selected textures are inflated
+      int loaded = 0;
+      for (int i=0; i<count; i++)
       {
-        if (buffer!=NULL) delete [] buffer;
-        tex.Hash[count] = temp_hash;
-        tex.Size[count] = 0;
-        count++;
+        int len = tex.Size[i];
+        char *buffer;
+        try {buffer = new char[len+1];}
+        catch(...)
+        {
+          LastError << Language->Error_Memory;
+          continue;
+        }
+
+        ZRESULT rz = UnzipItem( ZIP_Handle, items[i], buffer, len);
+        if (rz!=ZR_OK && rz!=ZR_MORE)
+        {
+          delete [] buffer;
+          GetZipItem( ZIP_Handle, items[i], &ze);
+          file = ze.name;
+          LastError << Language->Error_Unzip <<"\nZIP:" << file << "\n";
+          continue;
+        }
+
+        tex.Textures[loaded] = buffer;
+        tex.Hash[loaded] = tex.Hash[i];
+        tex.Size[loaded] = len;
+        loaded++;
       }
+      tex.Num = loaded;
     }
-    tex.Num = count;
+    if (items!=NULL) delete [] items;
   }
 
   CloseZip(ZIP_Handle);
@@ -21,6 +21,8 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 
 #include "uMod_Main.h"
 
+#define uMod_READ_CHUNK (1u<<20) // packages are read (and decrypted) in chunks of this size, must be a multiple of 16
+
 class uMod_File
 {
 public:
@@ -33,18 +35,26 @@ public:
   int GetComment( wxString &tool_tip);
   int GetContent( AddTextureClass &tex, bool add);
 
-  int SetFile(const wxString &file) {FileName=file;Loaded=false; return 0;}
+  // LoadComment(), GetContent() and ReleaseFile() might be called from a loader thread of uMod_Sender,
+  // only the tool tip (GetComment()) is built in the main thread
+  int LoadComment(void);
+  void ReleaseFile(void); // the file content is not needed anymore, the comment is kept
+
+  int SetFile(const wxString &file) {FileName=file;Loaded=false;CommentRead=false; return 0;}
   wxString GetFile(void) {return FileName;}
 
 
   wxString LastError;
 
 private:
-  int ReadFile(void);
+  int ReadFile( bool tpf=false); // a tpf is decrypted while it is read
+  int MapFile( bool tpf); // called from ReadFile(), the file is mapped instead of read (a tpf is decrypted as its pages are touched first)
+  void FreeFile(void);
 
-  int UnXOR(void);
-  int GetCommentZip( wxString &tool_tip);
-  int GetCommentTpf( wxString &tool_tip);
+  static void XORBuffer( char* data, unsigned int len);
+  int UnXOR(void); // decrypts the tpf (if not done in ReadFile()) and cuts off the comment
+  int GetCommentZip( wxString &comment);
+  int GetCommentTpf( wxString &comment);
 
   int AddFile( AddTextureClass &tex, bool add);
   int AddZip( AddTextureClass &tex, bool add, bool tpf);
@@ -53,9 +63,17 @@ private:
   wxString FileName;
   bool Loaded;
   bool XORed;
-  char *FileInMemory;
+  bool Decrypted;
+  char *FileInMemory; // points to View, if the file is mapped
   unsigned int MemoryLength;
   unsigned int FileLen;
+  unsigned int FileSize;
+  HANDLE Mapping;
+  char *View;
+
+  uMod_Cache Cache;
+  wxString Comment; // the raw comment of a zip or tpf, is stored in the cache
+  bool CommentRead;
 };
 
 
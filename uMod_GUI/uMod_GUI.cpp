@@ -60,6 +60,8 @@ BEGIN_EVENT_TABLE(uMod_Frame, wxFrame)
 
   EVT_COMMAND  (ID_Add_Game, uMod_EVENT_TYPE, uMod_Frame::OnAddGame)
   EVT_COMMAND  (ID_Delete_Game, uMod_EVENT_TYPE, uMod_Frame::OnDeleteGame)
+  EVT_COMMAND  (ID_Fetch_Texture, uMod_EVENT_TYPE, uMod_Frame::OnFetchTexture)
+  EVT_COMMAND  (ID_Retained_Memory, uMod_EVENT_TYPE, uMod_Frame::OnRetainedMemory)
 END_EVENT_TABLE()
 
 IMPLEMENT_APP(MyApp)
@@ -253,7 +255,7 @@ void uMod_Frame::OnAddGame( wxCommandEvent &event)
     break;
   }
 
-  uMod_GamePage *page = new uMod_GamePage( Notebook, name, save_file, client->Pipe);
+  uMod_GamePage *page = new uMod_GamePage( Notebook, name, save_file, client);
   if (page->LastError.Len()>0)
   {
     wxMessageBox(page->LastError, "ERROR", wxOK|wxICON_ERROR);
@@ -286,6 +288,28 @@ void uMod_Frame::OnDeleteGame( wxCommandEvent &event)
   }
 }
 
+void uMod_Frame::OnFetchTexture( wxCommandEvent &event)
+{
+  uMod_Client *client = ((uMod_Event&)event).GetClient();
+  for (int i=0; i<NumberOfGames; i++) if (Clients[i]==client)
+  {
+    uMod_GamePage *page = (uMod_GamePage*) Notebook->GetPage(i);
+    if (page!=NULL) page->FetchTexture( ((uMod_Event&)event).GetHash());
+    return;
+  }
+}
+
+void uMod_Frame::OnRetainedMemory( wxCommandEvent &event)
+{
+  uMod_Client *client = ((uMod_Event&)event).GetClient();
+  for (int i=0; i<NumberOfGames; i++) if (Clients[i]==client)
+  {
+    uMod_GamePage *page = (uMod_GamePage*) Notebook->GetPage(i);
+    if (page!=NULL) page->SetRetainedMemory( ((uMod_Event&)event).GetValue());
+    return;
+  }
+}
+
 
 void uMod_Frame::OnClose(wxCloseEvent& event)
 {
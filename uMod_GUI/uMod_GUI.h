@@ -34,6 +34,8 @@ public:
 
   void OnAddGame( wxCommandEvent &event);
   void OnDeleteGame( wxCommandEvent &event);
+  void OnFetchTexture( wxCommandEvent &event);
+  void OnRetainedMemory( wxCommandEvent &event);
 
   void OnClose(wxCloseEvent& WXUNUSED(event));
 
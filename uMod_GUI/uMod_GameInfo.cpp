@@ -46,6 +46,7 @@ void uMod_GameInfo::Init(void)
   KeyNext = -1;
   FontColour[0]=255;FontColour[1]=0;FontColour[2]=0;
   TextureColour[0]=0;TextureColour[1]=255;TextureColour[2]=0;
+  MemoryBudget = uMod_DEFAULT_MEMORY_BUDGET_MB;
   NumberOfChecked = 0;
   SavePath.Empty();
   OpenPath.Empty();
@@ -96,6 +97,8 @@ int uMod_GameInfo::SaveToFile( const wxString &file_name)
   file.Write( content.char_str(), content.Len());
   content.Printf( L"TextureColour:%d,%d,%d\n", TextureColour[0], TextureColour[1], TextureColour[2]);
   file.Write( content.char_str(), content.Len());
+  content.Printf( L"MemoryBudget:%d\n", MemoryBudget);
+  file.Write( content.char_str(), content.Len());
 
   int num = Files.GetCount();
 
@@ -243,6 +246,13 @@ int uMod_GameInfo::LoadFromFile( const wxString &file_name)
       if (temp.ToLong( &colour)) TextureColour[2] = colour;
       else TextureColour[2] = 0;
     }
+    else if  (command == L"MemoryBudget")
+    {
+      temp = line.AfterFirst(':');
+      long mega_bytes;
+      if (temp.ToLong( &mega_bytes) && mega_bytes>=0) MemoryBudget = mega_bytes;
+      else MemoryBudget = uMod_DEFAULT_MEMORY_BUDGET_MB;
+    }
 
 /*
     if (NumberOfChecked>=LengthOfChecked)
@@ -327,6 +337,7 @@ uMod_GameInfo& uMod_GameInfo::operator = (const  uMod_GameInfo &rhs)
 
   for (int i=0; i<3; i++) FontColour[i]=rhs.FontColour[i];
   for (int i=0; i<3; i++) TextureColour[i]=rhs.TextureColour[i];
+  MemoryBudget = rhs.MemoryBudget;
 
   return *this;
 }
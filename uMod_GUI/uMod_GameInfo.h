@@ -67,6 +67,9 @@ public:
   int SetTextureColour(const int *colour) {TextureColour[0]=colour[0];TextureColour[1]=colour[1];TextureColour[2]=colour[2];return 0;}
   int GetTextureColour(int *colour) const {colour[0]=TextureColour[0];colour[1]=TextureColour[1];colour[2]=TextureColour[2];return 0;}
 
+  int SetMemoryBudget(int mega_bytes) {MemoryBudget=mega_bytes; return 0;}
+  int GetMemoryBudget(void) const {return MemoryBudget;} // for the file content of removed textures in the game
+
   int SetOpenPath(const wxString &path) {OpenPath=path; return 0;}
   wxString GetOpenPath(void) const {return OpenPath;}
 
@@ -93,6 +96,8 @@ private:
   int FontColour[3];
   int TextureColour[3];
 
+  int MemoryBudget; // in MB
+
   wxString OpenPath;
   wxString SavePath;
 };
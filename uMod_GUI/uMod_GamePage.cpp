@@ -19,8 +19,8 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 #include "uMod_Main.h"
 
 
-uMod_GamePage::uMod_GamePage( wxNotebook *parent, const wxString &exe, const wxString &save, PipeStruct &pipe)
-  : wxScrolledWindow(parent, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxVSCROLL), Sender(pipe)
+uMod_GamePage::uMod_GamePage( wxNotebook *parent, const wxString &exe, const wxString &save, uMod_Client *client)
+  : wxScrolledWindow(parent, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxVSCROLL), Sender(client)
 {
   ExeName = exe;
   TemplateName = save;
@@ -78,8 +78,19 @@ uMod_GamePage::uMod_GamePage( wxNotebook *parent, const wxString &exe, const wxS
   for (int i=0; i<4; i++) TextureColourSizer->Add( (wxWindow*) TextureColour[i], 1, wxEXPAND, 0);
 
 
+  MemorySizer = new wxBoxSizer(wxHORIZONTAL);
+  MemoryBudget[0] = new wxTextCtrl(this, wxID_ANY, Language->MemoryBudget, wxDefaultPosition, wxDefaultSize, wxTE_READONLY);
+  MemoryBudget[1] = new wxTextCtrl(this, wxID_ANY, "", wxDefaultPosition, wxDefaultSize);
+  MemoryBudget[1]->SetValue( wxString::Format( "%d", uMod_DEFAULT_MEMORY_BUDGET_MB));
+  RetainedMemory[0] = new wxTextCtrl(this, wxID_ANY, Language->RetainedMemory, wxDefaultPosition, wxDefaultSize, wxTE_READONLY);
+  RetainedMemory[1] = new wxTextCtrl(this, wxID_ANY, "0", wxDefaultPosition, wxDefaultSize, wxTE_READONLY);
+  for (int i=0; i<2; i++) MemorySizer->Add( (wxWindow*) MemoryBudget[i], 1, wxEXPAND, 0);
+  for (int i=0; i<2; i++) MemorySizer->Add( (wxWindow*) RetainedMemory[i], 1, wxEXPAND, 0);
+
+
   MainSizer->Add( FontColourSizer, 0, wxEXPAND, 0);
   MainSizer->Add( TextureColourSizer, 0, wxEXPAND, 0);
+  MainSizer->Add( MemorySizer, 0, wxEXPAND, 0);
 
   SaveSingleTexture = new wxCheckBox( this, -1, Language->CheckBoxSaveSingleTexture);
   MainSizer->Add( (wxWindow*) SaveSingleTexture, 0, wxEXPAND, 0);
@@ -222,6 +233,12 @@ int uMod_GamePage::GetSettings(void)
   SetColour( &TextureColour[1], colour);
   Game.SetTextureColour(colour);
 
+  long mega_bytes;
+  if (!MemoryBudget[1]->GetValue().ToLong( &mega_bytes) || mega_bytes<0) mega_bytes = uMod_DEFAULT_MEMORY_BUDGET_MB;
+  else if (mega_bytes>4096) mega_bytes = 4096; // unlimited
+  MemoryBudget[1]->SetValue( wxString::Format( "%ld", mega_bytes));
+  Game.SetMemoryBudget( mega_bytes);
+
   Game.SetFiles( Files);
 
   bool *checked = NULL;
@@ -309,6 +326,7 @@ int uMod_GamePage::LoadTemplate( const wxString &file_name)
   SetColour( &FontColour[1], colour);
   Game.GetTextureColour( colour);
   SetColour( &TextureColour[1], colour);
+  MemoryBudget[1]->SetValue( wxString::Format( "%d", Game.GetMemoryBudget()));
 
   SaveSingleTexture->SetValue( Game.GetSaveSingleTexture());
   SaveAllTextures->SetValue( Game.GetSaveAllTextures());
@@ -411,6 +429,12 @@ int uMod_GamePage::SetColour( wxTextCtrl** txt, int *colour)
   return 0;
 }
 
+int uMod_GamePage::SetRetainedMemory( unsigned int kilo_bytes)
+{
+  RetainedMemory[1]->SetValue( wxString::Format( "%u", kilo_bytes));
+  return 0;
+}
+
 int uMod_GamePage::GetColour( wxTextCtrl* txt, int def)
 {
   wxString temp = txt->GetValue();
@@ -515,6 +539,8 @@ int uMod_GamePage::UpdateLanguage(void)
   TextKeyNext->SetValue( Language->KeyNext);
   FontColour[0]->SetValue( Language->FontColour);
   TextureColour[0]->SetValue( Language->TextureColour);
+  MemoryBudget[0]->SetValue( Language->MemoryBudget);
+  RetainedMemory[0]->SetValue( Language->RetainedMemory);
   SaveAllTextures->SetLabel( Language->CheckBoxSaveAllTextures);
   SaveSingleTexture->SetLabel( Language->CheckBoxSaveSingleTexture);
   wxString temp = Language->TextCtrlSavePath;
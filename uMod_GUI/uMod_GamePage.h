@@ -26,13 +26,15 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 class uMod_GamePage : public wxScrolledWindow
 {
 public:
-  uMod_GamePage( wxNotebook *parent, const wxString &exe, const wxString &save, PipeStruct &pipe);
+  uMod_GamePage( wxNotebook *parent, const wxString &exe, const wxString &save, uMod_Client *client);
   virtual ~uMod_GamePage(void);
 
   int AddTexture( const wxString &file_name);
 
   int UpdateGame(void);
   int ReloadGame(void);
+  int FetchTexture( MyTypeHash hash) {return Sender.Fetch( hash);} // called from the main frame, if the game requests a texture
+  int SetRetainedMemory( unsigned int kilo_bytes); // called from the main frame, if the game reports its retained memory
 
   int SaveTemplate( const wxString &file_name);
   int LoadTemplate( const wxString &file_name);
@@ -77,6 +79,10 @@ private:
   wxBoxSizer *TextureColourSizer;
   wxTextCtrl *TextureColour[4];
 
+  wxBoxSizer *MemorySizer;
+  wxTextCtrl *MemoryBudget[2];
+  wxTextCtrl *RetainedMemory[2];
+
   wxBoxSizer *MainSizer;
 
   wxTextCtrl *TemplateFile;
@@ -0,0 +1,343 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <string.h>
+#include "uMod_Inflate.h"
+
+
+#define uMod_LITLEN_BITS 11 // bits of the first lookup, longer codes are decoded with a second lookup
+#define uMod_DIST_BITS 9
+#define uMod_CODELEN_BITS 7 // code length codes are at most 7 bits long
+#define uMod_MAX_BITS 15
+
+#define uMod_LITLEN_SIZE ((1<<uMod_LITLEN_BITS) + 288*(1<<(uMod_MAX_BITS-uMod_LITLEN_BITS)))
+#define uMod_DIST_SIZE ((1<<uMod_DIST_BITS) + 32*(1<<(uMod_MAX_BITS-uMod_DIST_BITS)))
+#define uMod_CODELEN_SIZE (1<<uMod_CODELEN_BITS)
+
+// an entry of a lookup table: bits 0-4 length of the code, bits 5-7 kind, bits 8-15 extra bits, bits 16-31 value
+#define INF_LITERAL 0 // value is the byte (or the code length for the code length table)
+#define INF_LENGTH 1 // value is the base of the length (or of the distance for the distance table)
+#define INF_END 2
+#define INF_SUB 3 // value is the offset of the second table
+#define INF_INVALID 4
+
+#define INF_ENTRY(kind, extra, value) (((unsigned int)(value)<<16) | ((unsigned int)(extra)<<8) | ((unsigned int)(kind)<<5))
+#define INF_BITS(e) ((e)&31u)
+#define INF_KIND(e) (((e)>>5)&7u)
+#define INF_EXTRA(e) (((e)>>8)&0xFFu)
+#define INF_VALUE(e) ((e)>>16)
+
+#define INF_TABLE_LITLEN 0
+#define INF_TABLE_DIST 1
+#define INF_TABLE_CODELEN 2
+
+static const unsigned short LengthBase[29] = {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+static const unsigned char LengthExtra[29] = {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+static const unsigned short DistBase[30] = {1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577};
+static const unsigned char DistExtra[30] = {0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
+static const unsigned char CodeLengthOrder[19] = {16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15};
+
+
+static unsigned int GetEntry( int type, unsigned int sym)
+{
+  if (type==INF_TABLE_LITLEN)
+  {
+    if (sym<256u) return INF_ENTRY( INF_LITERAL, 0, sym);
+    if (sym==256u) return INF_ENTRY( INF_END, 0, 0);
+    if (sym<286u) return INF_ENTRY( INF_LENGTH, LengthExtra[sym-257u], LengthBase[sym-257u]);
+  }
+  else if (type==INF_TABLE_DIST)
+  {
+    if (sym<30u) return INF_ENTRY( INF_LENGTH, DistExtra[sym], DistBase[sym]);
+  }
+  else return INF_ENTRY( INF_LITERAL, 0, sym);
+  return INF_ENTRY( INF_INVALID, 0, 0);
+}
+
+// builds the lookup table of a canonical huffman code, codes which are longer than bits get a second table
+// (indexed by the remaining bits), unused entries of an incomplete code are invalid
+static int BuildTable( const unsigned char *lens, unsigned int num, unsigned int *table, unsigned int bits, unsigned int size, int type)
+{
+  unsigned int count[uMod_MAX_BITS+1];
+  unsigned int offset[uMod_MAX_BITS+2];
+  unsigned short sorted[288];
+
+  for (unsigned int len=0u; len<=uMod_MAX_BITS; len++) count[len] = 0u;
+  for (unsigned int sym=0u; sym<num; sym++) count[lens[sym]]++;
+  count[0] = 0u;
+
+  int left = 1;
+  for (unsigned int len=1u; len<=uMod_MAX_BITS; len++)
+  {
+    left <<= 1;
+    left -= (int) count[len];
+    if (left<0) return -1; // over-subscribed
+  }
+
+  offset[1] = 0u;
+  for (unsigned int len=1u; len<=uMod_MAX_BITS; len++) offset[len+1] = offset[len] + count[len];
+  for (unsigned int sym=0u; sym<num; sym++) if (lens[sym]>0) sorted[offset[lens[sym]]++] = (unsigned short) sym;
+
+  const unsigned int invalid = INF_ENTRY( INF_INVALID, 0, 0);
+  const unsigned int sub_bits = uMod_MAX_BITS - bits;
+  for (unsigned int i=0u; i<(1u<<bits); i++) table[i] = invalid;
+  unsigned int next_sub = 1u<<bits;
+
+  unsigned int code = 0u;
+  unsigned int pos = 0u;
+  for (unsigned int len=1u; len<=uMod_MAX_BITS; len++, code<<=1)
+  {
+    for (unsigned int i=0u; i<count[len]; i++, code++)
+    {
+      unsigned int entry = GetEntry( type, sorted[pos++]) | len;
+
+      unsigned int rev = 0u; // the bits of a code are stored in reverse order
+      for (unsigned int b=0u; b<len; b++) rev |= ((code>>b)&1u) << (len-1u-b);
+
+      if (len<=bits)
+      {
+        for (unsigned int j=rev; j<(1u<<bits); j+=1u<<len) table[j] = entry;
+      }
+      else
+      {
+        unsigned int prefix = rev & ((1u<<bits)-1u);
+        if (INF_KIND(table[prefix])!=INF_SUB)
+        {
+          if (next_sub + (1u<<sub_bits) > size) return -1;
+          table[prefix] = INF_ENTRY( INF_SUB, 0, next_sub);
+          for (unsigned int j=0u; j<(1u<<sub_bits); j++) table[next_sub+j] = invalid;
+          next_sub += 1u<<sub_bits;
+        }
+        unsigned int sub = INF_VALUE(table[prefix]);
+        for (unsigned int j=rev>>bits; j<(1u<<sub_bits); j+=1u<<(len-bits)) table[sub+j] = entry;
+      }
+    }
+  }
+  return 0;
+}
+
+
+// the bit buffer is refilled with 8 bytes at once, bytes behind the end of the input are read as zero (Overrun),
+// the bits above BitCnt are always the next bytes of the input (or zero)
+#define INF_REFILL \
+  if (in_end-in>=8) \
+  { \
+    unsigned long long word; \
+    memcpy( &word, in, 8); \
+    bit_buf |= word << bit_cnt; \
+    in += (63u-bit_cnt)>>3; \
+    bit_cnt |= 56u; \
+  } \
+  else while (bit_cnt<=56u) \
+  { \
+    if (in<in_end) bit_buf |= (unsigned long long) *in++ << bit_cnt; \
+    else overrun++; \
+    bit_cnt += 8u; \
+  }
+
+#define INF_DROP(n) {bit_buf >>= (n); bit_cnt -= (n);}
+#define INF_MASK(n) ((unsigned int) bit_buf & ((1u<<(n))-1u))
+
+
+static int Inflate( const unsigned char *src, unsigned int src_len, unsigned char *dst, unsigned int dst_len,
+    unsigned int *litlen, unsigned int *dist, unsigned int *codelen)
+{
+  const unsigned char *in = src;
+  const unsigned char *in_end = src + src_len;
+  unsigned char *out = dst;
+  unsigned char *out_end = dst + dst_len;
+  unsigned long long bit_buf = 0ull;
+  unsigned int bit_cnt = 0u;
+  unsigned int overrun = 0u;
+  unsigned char lens[288+32];
+
+  unsigned int final;
+  do
+  {
+    INF_REFILL
+    final = INF_MASK(1);
+    unsigned int type = (INF_MASK(3)>>1);
+    INF_DROP(3)
+
+    if (type==0u) // stored block
+    {
+      INF_DROP(bit_cnt&7u)
+      unsigned int bytes = bit_cnt>>3; // the whole bytes in the bit buffer are read again
+      if (overrun>bytes) return -1;
+      in -= bytes - overrun;
+      bit_buf = 0ull;
+      bit_cnt = 0u;
+      overrun = 0u;
+
+      if (in_end-in<4) return -1;
+      unsigned int len = in[0] | (in[1]<<8);
+      unsigned int nlen = in[2] | (in[3]<<8);
+      in += 4;
+      if (len!=(~nlen & 0xFFFFu)) return -1;
+      if ((unsigned int) (in_end-in)<len || (unsigned int) (out_end-out)<len) return -1;
+      memcpy( out, in, len);
+      in += len;
+      out += len;
+      continue;
+    }
+    else if (type==1u) // fixed codes
+    {
+      unsigned int i = 0u;
+      for (; i<144u; i++) lens[i] = 8;
+      for (; i<256u; i++) lens[i] = 9;
+      for (; i<280u; i++) lens[i] = 7;
+      for (; i<288u; i++) lens[i] = 8;
+      for (i=0u; i<32u; i++) lens[288+i] = 5;
+      if (BuildTable( lens, 288u, litlen, uMod_LITLEN_BITS, uMod_LITLEN_SIZE, INF_TABLE_LITLEN)) return -1;
+      if (BuildTable( lens+288, 32u, dist, uMod_DIST_BITS, uMod_DIST_SIZE, INF_TABLE_DIST)) return -1;
+    }
+    else if (type==2u) // dynamic codes
+    {
+      INF_REFILL
+      unsigned int hlit = INF_MASK(5) + 257u;
+      INF_DROP(5)
+      unsigned int hdist = INF_MASK(5) + 1u;
+      INF_DROP(5)
+      unsigned int hclen = INF_MASK(4) + 4u;
+      INF_DROP(4)
+      if (hlit>286u || hdist>30u) return -1;
+
+      unsigned char code_lens[19];
+      for (unsigned int i=0u; i<19u; i++) code_lens[i] = 0;
+      for (unsigned int i=0u; i<hclen; i++)
+      {
+        if (bit_cnt<3u) {INF_REFILL}
+        code_lens[CodeLengthOrder[i]] = (unsigned char) INF_MASK(3);
+        INF_DROP(3)
+      }
+      if (BuildTable( code_lens, 19u, codelen, uMod_CODELEN_BITS, uMod_CODELEN_SIZE, INF_TABLE_CODELEN)) return -1;
+
+      unsigned int num = hlit + hdist;
+      unsigned int i = 0u;
+      while (i<num)
+      {
+        INF_REFILL
+        unsigned int entry = codelen[INF_MASK(uMod_CODELEN_BITS)];
+        if (INF_KIND(entry)==INF_INVALID) return -1;
+        INF_DROP(INF_BITS(entry))
+        unsigned int sym = INF_VALUE(entry);
+        if (sym<16u) {lens[i++] = (unsigned char) sym; continue;}
+
+        unsigned int rep;
+        unsigned char val = 0;
+        if (sym==16u)
+        {
+          if (i==0u) return -1;
+          val = lens[i-1u];
+          rep = 3u + INF_MASK(2);
+          INF_DROP(2)
+        }
+        else if (sym==17u)
+        {
+          rep = 3u + INF_MASK(3);
+          INF_DROP(3)
+        }
+        else
+        {
+          rep = 11u + INF_MASK(7);
+          INF_DROP(7)
+        }
+        if (i+rep>num) return -1;
+        while (rep--) lens[i++] = val;
+      }
+      if (lens[256]==0) return -1; // no end of block code
+
+      if (BuildTable( lens, hlit, litlen, uMod_LITLEN_BITS, uMod_LITLEN_SIZE, INF_TABLE_LITLEN)) return -1;
+      if (BuildTable( lens+hlit, hdist, dist, uMod_DIST_BITS, uMod_DIST_SIZE, INF_TABLE_DIST)) return -1;
+    }
+    else return -1;
+
+    // after a refill at least 56 bits are in the buffer, a length (15+5 bits) and a distance (15+13 bits) need 48 bits
+    for (;;)
+    {
+      INF_REFILL
+      unsigned int entry = litlen[INF_MASK(uMod_LITLEN_BITS)];
+      if (INF_KIND(entry)==INF_SUB) entry = litlen[INF_VALUE(entry) + ((unsigned int) (bit_buf>>uMod_LITLEN_BITS) & ((1u<<(uMod_MAX_BITS-uMod_LITLEN_BITS))-1u))];
+      INF_DROP(INF_BITS(entry))
+
+      unsigned int kind = INF_KIND(entry);
+      if (kind==INF_LITERAL)
+      {
+        if (out==out_end) return -1;
+        *out++ = (unsigned char) INF_VALUE(entry);
+        continue;
+      }
+      if (kind==INF_END) break;
+      if (kind!=INF_LENGTH) return -1;
+
+      unsigned int len = INF_VALUE(entry) + INF_MASK(INF_EXTRA(entry));
+      INF_DROP(INF_EXTRA(entry))
+
+      entry = dist[INF_MASK(uMod_DIST_BITS)];
+      if (INF_KIND(entry)==INF_SUB) entry = dist[INF_VALUE(entry) + ((unsigned int) (bit_buf>>uMod_DIST_BITS) & ((1u<<(uMod_MAX_BITS-uMod_DIST_BITS))-1u))];
+      if (INF_KIND(entry)!=INF_LENGTH) return -1;
+      INF_DROP(INF_BITS(entry))
+      unsigned int d = INF_VALUE(entry) + INF_MASK(INF_EXTRA(entry));
+      INF_DROP(INF_EXTRA(entry))
+
+      if (d>(unsigned int) (out-dst) || len>(unsigned int) (out_end-out)) return -1;
+      const unsigned char *from = out - d;
+      unsigned char *end = out + len;
+      if ((unsigned int) (out_end-out)>=len+16u) // the chunks might be written behind the end of the match
+      {
+        if (d>=16u)
+        {
+          do {memcpy( out, from, 16); out += 16; from += 16;} while (out<end);
+          out = end;
+          continue;
+        }
+        if (d>=8u)
+        {
+          do {memcpy( out, from, 8); out += 8; from += 8;} while (out<end);
+          out = end;
+          continue;
+        }
+        if (d==1u)
+        {
+          memset( out, out[-1], len);
+          out = end;
+          continue;
+        }
+      }
+      while (out<end) *out++ = *from++;
+    }
+  } while (!final);
+
+  if (overrun>(bit_cnt>>3)) return -1; // more bits were used than the input has
+  return (int) (out-dst);
+}
+
+
+int uMod_Inflate( const unsigned char *src, unsigned int src_len, unsigned char *dst, unsigned int dst_len)
+{
+  if (dst_len>0x7FFFFFFFu) return -1;
+  unsigned int *tables;
+  try {tables = new unsigned int[uMod_LITLEN_SIZE + uMod_DIST_SIZE + uMod_CODELEN_SIZE];}
+  catch (...) {return -1;}
+
+  int ret = Inflate( src, src_len, dst, dst_len, tables, tables + uMod_LITLEN_SIZE, tables + uMod_LITLEN_SIZE + uMod_DIST_SIZE);
+  delete [] tables;
+  return ret;
+}
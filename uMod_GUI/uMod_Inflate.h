@@ -0,0 +1,39 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef uMod_INFLATE_H_
+#define uMod_INFLATE_H_
+
+/*
+ *  Inflates a complete raw deflate stream (as stored in a zip file) in one call.
+ *
+ *  unzReadCurrentFile() (unzip.cpp) uses this function, if the whole entry is read at once into memory,
+ *  which is the case for all textures. The entry is decrypted before (tpf), thus this function knows nothing
+ *  about the zip format. If it fails, the stream inflate of unzip.cpp is used.
+ *
+ *  In contrast to the stream inflate, the output is written directly into dst (no window), the bit buffer
+ *  is refilled with 8 bytes at once, most codes are decoded with a single table lookup and matches are copied
+ *  in chunks of 16 or 8 bytes.
+ *
+ *  returns the number of bytes written into dst or -1, if the stream is invalid or does not fit into dst
+ */
+int uMod_Inflate( const unsigned char *src, unsigned int src_len, unsigned char *dst, unsigned int dst_len);
+
+#endif /* uMod_INFLATE_H_ */
@@ -244,6 +244,8 @@ int uMod_Language::LoadLanguage(const wxString &name)
     CheckEntry( command, msg, KeyNext)
     CheckEntry( command, msg, FontColour)
     CheckEntry( command, msg, TextureColour)
+    CheckEntry( command, msg, MemoryBudget)
+    CheckEntry( command, msg, RetainedMemory)
     {}
   }
 
@@ -335,6 +337,8 @@ int uMod_Language::LoadDefault(void)
 
   FontColour = "Font colour (RGB):";
   TextureColour = "Texture colour (RGB):";
+  MemoryBudget = "Memory budget of removed textures (MB):";
+  RetainedMemory = "Retained memory (KB):";
   return 0;
 }
 
@@ -110,6 +110,8 @@ public:
 
   wxString FontColour;
   wxString TextureColour;
+  wxString MemoryBudget;
+  wxString RetainedMemory;
 
 
   wxString LastError;
@@ -68,6 +68,7 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 //#include <windows.h>
 
 #include "../uMod_GlobalDefines.h"
+#include "../uMod_MsgReader.h"
 #include "../uMod_Error.h"
 
 
@@ -98,6 +99,8 @@ enum
   ID_Menu_SetDefaultTemplate,
   ID_Add_Game,
   ID_Delete_Game,
+  ID_Fetch_Texture,
+  ID_Retained_Memory,
   ID_Button_Texture, //this entry must be the last!!
 };
 
@@ -111,6 +114,7 @@ enum
 #include "uMod_Event.h"
 #include "uMod_Client.h"
 #include "uMod_GameInfo.h"
+#include "uMod_Cache.h"
 #include "uMod_File.h"
 #include "uMod_Sender.h"
 #include "uMod_Server.h"
@@ -19,12 +19,25 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 
 
 #include "uMod_Main.h"
+#include "uMod_Duplicates.h"
 
 
-uMod_Sender::uMod_Sender(PipeStruct &pipe) : Pipe(pipe)
+uMod_Sender::uMod_Sender(uMod_Client *client) : Pipe(client->Pipe)
 {
+  Client = client;
   OldTextures = NULL;
   OldTexturesNum = 0;
+  BufferPos = 0u;
+  Regions = NULL;
+  NumberOfRegions = 0;
+  LengthOfRegions = 0;
+  Generation = 0u;
+  RegionView = NULL;
+  RegionSize = 0u;
+  RegionPos = 0u;
+  LazyTextures = NULL;
+  LazyIndex = NULL;
+  NumberOfLazy = 0;
   try {Buffer = new char[BIG_BUFSIZE];}
   catch (...) {Buffer=NULL;}
 }
@@ -33,6 +46,10 @@ uMod_Sender::~uMod_Sender(void)
 {
   if (Buffer!=NULL) delete [] Buffer;
   if (OldTextures!=NULL) delete [] OldTextures;
+  CloseRegionView();
+  ReleaseRegions( true);
+  if (Regions!=NULL) delete [] Regions;
+  ClearLazyTable();
 }
 
 
@@ -75,6 +92,8 @@ int uMod_Sender::Send( const uMod_GameInfo &game, const uMod_GameInfo &game_old,
     break;
   }
 
+  if (game.GetMemoryBudget()!=game_old.GetMemoryBudget()) SendMemoryBudget( game.GetMemoryBudget());
+
 
   if ( game.GetSaveSingleTexture() != game_old.GetSaveSingleTexture() ) SendSaveSingleTexture( game.GetSaveSingleTexture());
   if ( game.GetSaveAllTextures() != game_old.GetSaveAllTextures() ) SendSaveAllTextures(game.GetSaveAllTextures());
@@ -103,30 +122,15 @@ int uMod_Sender::Send( const uMod_GameInfo &game, const uMod_GameInfo &game_old,
 
   AddTextureClass *tex = NULL;//new AddTextureClass[num+OldTexturesNum];
   if (GetMemory( tex, num+OldTexturesNum)) {LastError << Language->Error_Memory; return -1;}
-  wxString comment;
 
   if (force || OldTexturesNum==0 || OldTextures==NULL)
   {
     //reload everything
-    for (int i=0; i<num; i++)
-    {
-      uMod_File file( files[i]);
-      if (file.GetComment(comment))
-      {
-        LastError << file.LastError;
-        file.LastError.Empty();
-      }
-      tex[i].Comment = comment;
-
-      tex[i].Add = checked[i];
-      tex[i].Force = true;
-      tex[i].File = files[i];
-      if (file.GetContent( tex[i], checked[i]))
-      {
-        LastError << file.LastError;
-        file.LastError.Empty();
-      }
-    }
+    int *load = NULL;
+    if (num>0 && GetMemory( load, num)) {LastError << Language->Error_Memory; return -1;}
+    for (int i=0; i<num; i++) load[i] = i;
+    LoadPackages( files, checked, tex, load, num);
+    if (load!=NULL) delete [] load;
 
     // append all packages, which was added but (maybe) are no longer in the list
     int append = 0;
@@ -184,30 +188,17 @@ int uMod_Sender::Send( const uMod_GameInfo &game, const uMod_GameInfo &game_old,
     }
 
     //next step, set Add to true or false and load packages, which are not loaded
+    int *load = NULL;
+    if (num>0 && GetMemory( load, num)) {LastError << Language->Error_Memory; return -1;}
+    int number = 0;
     for (int i=0; i<num; i++)
     {
       tex[i].Add = checked[i];
 
-      if (tex[i].Len==0 || (tex[i].Add && !tex[i].Loaded) )
-      {
-        uMod_File file( files[i]);
-        if (file.GetComment(comment))
-        {
-          LastError << file.LastError;
-          file.LastError.Empty();
-        }
-        tex[i].Comment = comment;
-
-        tex[i].Add = checked[i];
-        tex[i].Force = true;
-        tex[i].File = files[i];
-        if (file.GetContent( tex[i], checked[i]))
-        {
-          LastError << file.LastError;
-          file.LastError.Empty();
-        }
-      }
+      if (tex[i].Len==0 || (tex[i].Add && !tex[i].Loaded) ) load[number++] = i;
     }
+    LoadPackages( files, checked, tex, load, number);
+    if (load!=NULL) delete [] load;
 
     // append all packages, which was added but are no longer in the list
     int append = 0;
@@ -252,6 +243,77 @@ int uMod_Sender::Send( const uMod_GameInfo &game, const uMod_GameInfo &game_old,
 
 
 
+int uMod_Sender::LoadPackages( const wxArrayString &files, const bool *checked, AddTextureClass *tex, const int *index, int number)
+{
+  if (number<=0) return 0;
+
+  LoadJobStruct job;
+  job.Files = NULL;
+  try {job.Files = new uMod_File[number];}
+  catch (...) {LastError << Language->Error_Memory; return -1;}
+  job.Textures = tex;
+  job.Checked = checked;
+  job.Index = index;
+  job.Number = number;
+  job.Next = 0;
+
+  for (int k=0; k<number; k++)
+  {
+    int i = index[k];
+    job.Files[k].SetFile( files[i]);
+    tex[i].Add = checked[i];
+    tex[i].Force = true;
+    tex[i].File = files[i];
+  }
+
+  // the main thread is one of the loaders
+  SYSTEM_INFO info;
+  GetSystemInfo( &info);
+  int num = (int) info.dwNumberOfProcessors;
+  if (num>uMod_LOAD_MAX_THREADS) num = uMod_LOAD_MAX_THREADS;
+  if (num>number) num = number;
+
+  HANDLE threads[uMod_LOAD_MAX_THREADS];
+  int started = 0;
+  for (int t=1; t<num; t++)
+  {
+    threads[started] = CreateThread( NULL, 0, LoadThread, &job, 0, NULL);
+    if (threads[started]!=NULL) started++;
+  }
+  LoadThread( &job);
+  if (started>0) WaitForMultipleObjects( started, threads, TRUE, INFINITE);
+  for (int t=0; t<started; t++) CloseHandle( threads[t]);
+  uMod_Cache::Prune(); // once for the whole batch, not for each stored package
+
+  // the tool tips and the errors are collected in the order of the list
+  wxString comment;
+  for (int k=0; k<number; k++)
+  {
+    int i = index[k];
+    job.Files[k].GetComment( comment);
+    tex[i].Comment = comment;
+    LastError << job.Files[k].LastError;
+  }
+  delete [] job.Files;
+  return 0;
+}
+
+DWORD WINAPI uMod_Sender::LoadThread( LPVOID lpParam)
+{
+  LoadJobStruct *job = (LoadJobStruct*) lpParam;
+  int k;
+  while ((k = InterlockedIncrement( &job->Next) - 1) < job->Number)
+  {
+    int i = job->Index[k];
+    uMod_File &file = job->Files[k];
+    file.LoadComment();
+    file.GetContent( job->Textures[i], job->Checked[i]);
+    file.ReleaseFile(); // otherwise all packages would be kept in memory until the last one is loaded
+  }
+  return 0;
+}
+
+
 int uMod_Sender::SendSaveAllTextures(bool val)
 {
   MsgStruct msg;
@@ -260,7 +322,8 @@ int uMod_Sender::SendSaveAllTextures(bool val)
   else msg.Value = 0;
   msg.Hash = 0u;
 
-  return SendToGame( (void*)  &msg, sizeof(MsgStruct));
+  if (int ret = SendRecord( msg)) return ret;
+  return Flush();
 }
 
 int uMod_Sender::SendSaveSingleTexture(bool val)
@@ -271,79 +334,109 @@ int uMod_Sender::SendSaveSingleTexture(bool val)
   else msg.Value = 0;
   msg.Hash = 0u;
 
-  return SendToGame( (void*)  &msg, sizeof(MsgStruct));
+  if (int ret = SendRecord( msg)) return ret;
+  return Flush();
 }
 
 
 int uMod_Sender::SendTextures(unsigned int num, AddTextureClass *tex)
 {
+  ClearLazyTable(); // Send() deletes the old textures afterwards, even if we return early
   if (Buffer==NULL) return (RETURN_NO_MEMORY);
 
-  MsgStruct *msg;
-  int pos = 0;
-  for (unsigned int i=0u; i<num; i++) for (unsigned int j=0u; j<tex[i].Num; j++)
+  MsgStruct msg;
+  msg.Control = CONTROL_MORE_TEXTURES; // the game updates its textures not before CONTROL_END_TEXTURES
+  msg.Value = 0;
+  msg.Hash = 0u;
+  if (int ret = SendRecord( msg)) return ret;
+
+  ReleaseRegions();
+  // size of the file content, which might be sent (duplicated hashes are not sent)
+  unsigned long long remaining = 0u;
+  for (unsigned int i=0u; i<num; i++) if (tex[i].Add) for (unsigned int j=0u; j<tex[i].Num; j++)
+  {
+    if ((tex[i].Force || !tex[i].WasAdded[j]) && tex[i].Textures[j]!=NULL) remaining += tex[i].Size[j];
+  }
+  bool lazy = remaining>=uMod_LAZY_MIN_SIZE; // only the hashes are sent
+  bool shared = !lazy && remaining>=uMod_SHARED_MIN_SIZE && !Client->GetRegionFailed(); // else the textures are sent over the pipe
+
+  bool *duplicate = NULL;
+  if (uMod_MarkDuplicates( num, tex, duplicate)) {LastError << Language->Error_Memory; return -1;}
+
+  unsigned int pos = 0u; // of the first texture of package i in duplicate
+  for (unsigned int i=0u; i<num; pos+=tex[i].Num, i++) for (unsigned int j=0u; j<tex[i].Num; j++)
   {
     if (tex[i].Force || !tex[i].Add || !tex[i].WasAdded[j])
     // if force==true we must update
     // tex[i].Add!=true we can always remove, cause removing does cost time in the render thread
     // if tex[i].Add==true and WasAdded[j]!=true this texture was not loaded but should be loaded, so maybe we can load it now
     {
-      bool hit = false; //we send only if this has was not send before
+      if (tex[i].Add && tex[i].Textures[j]!=NULL) remaining = remaining>tex[i].Size[j] ? remaining-tex[i].Size[j] : 0u;
+      bool hit = duplicate[pos+j]; //we send only if this has was not send before
       unsigned long temp_hash = tex[i].Hash[j];
-      for (unsigned int ii=0u; ii<i && !hit; ii++) for (unsigned int jj=0u; jj<tex[ii].Num && !hit; jj++) if (temp_hash==tex[ii].Hash[jj]) hit=true;
-      for (unsigned int jj=0u; jj<j && !hit; jj++) if (temp_hash==tex[i].Hash[jj]) hit=true;
       if (hit)
       {
         tex[i].WasAdded[j]=false; //no matter what is done for this hash before, this texture is not added!
         continue;
       }
 
-      if (tex[i].Size[j]+2*sizeof(MsgStruct)+pos>BIG_BUFSIZE) //the buffer is full
-      {
-        msg = (MsgStruct*) &Buffer[pos];
-        msg->Control = CONTROL_MORE_TEXTURES; // we will send more textures
-        pos+=sizeof(MsgStruct);
-        if (int ret = SendToGame( Buffer, pos)) return ret;
-        pos = 0;
-      }
       unsigned int size = tex[i].Size[j];
-      msg = (MsgStruct*) &Buffer[pos];
-      msg->Hash = temp_hash;
-      msg->Value = size;
-      pos += sizeof(MsgStruct);
+      msg.Hash = temp_hash;
+      msg.Value = size;
 
       if (tex[i].Add)
       {
-        msg->Control = CONTROL_FORCE_RELOAD_TEXTURE_DATA; //we always force because whether force is true or not
+        msg.Control = CONTROL_FORCE_RELOAD_TEXTURE_DATA; //we always force because whether force is true or not
         //if (Add==true && WasAdded[j]!=true) the texture is loaded the first time, or in previous loads it could not be loaded
         //because an other texture was send with the same hash, in all cases forcing is the best choice (atm)
         char* temp = tex[i].Textures[j];
-        if (temp!=NULL)
+        if (temp==NULL) size = 0u;
+        if (lazy && size>0u)
         {
-          for (unsigned int l=0; l<size; l++) Buffer[pos+l] = temp[l];
-          pos+=size;
+          msg.Control = CONTROL_FORCE_RELOAD_TEXTURE_LAZY; // the game will request the file content
+          if (int ret = SendRecord( msg)) {delete [] duplicate; return ret;}
+        }
+        else
+        {
+          if (shared && size>0u && (RegionView==NULL || RegionPos+size>RegionSize))
+          {
+            // the region is sized for the remaining textures, a single texture might be bigger than uMod_SHARED_MAX_SIZE
+            unsigned int region_size = uMod_SHARED_MAX_SIZE;
+            if (remaining+size<region_size) region_size = (unsigned int) remaining+size;
+            if (region_size<size) region_size = size;
+            if (NewRegion( region_size)) shared = false; // fall back to the pipe
+          }
+          if (shared && size>0u)
+          {
+            if (int ret = AddToRegion( msg, temp, size)) {delete [] duplicate; return ret;}
+          }
+          else if (int ret = SendRecord( msg, temp, size)) {delete [] duplicate; return ret;}
         }
         tex[i].WasAdded[j] = true;
       }
       else
       {
-        msg->Control = CONTROL_REMOVE_TEXTURE;
+        msg.Control = CONTROL_REMOVE_TEXTURE;
+        if (int ret = SendRecord( msg)) {delete [] duplicate; return ret;}
         tex[i].WasAdded[j] = false;
       }
     }
     else if (tex[i].Add && tex[i].WasAdded[j]) // this texture could be removed, due to a rearranging of the list
     {
-      bool hit = false; //we send only if this has was not send before
-      unsigned long temp_hash = tex[i].Hash[j];
-      for (unsigned int ii=0u; ii<i && !hit; ii++) for (unsigned int jj=0u; jj<tex[ii].Num && !hit; jj++) if (temp_hash==tex[ii].Hash[jj]) hit=true;
-      for (unsigned int jj=0u; jj<j && !hit; jj++) if (temp_hash==tex[i].Hash[jj]) hit=true;
-      if (hit)
+      if (duplicate[pos+j]) //we send only if this has was not send before
       {
         tex[i].WasAdded[j]=false; // due to rearranging this texture is replaced by an other texture
       }
     }
   }
-  if (pos) if (int ret = SendToGame( Buffer, pos)) return ret;
+  delete [] duplicate;
+  CloseRegionView();
+  BuildLazyTable( num, tex);
+  msg.Control = CONTROL_END_TEXTURES;
+  msg.Value = 0;
+  msg.Hash = 0u;
+  if (int ret = SendRecord( msg)) return ret;
+  if (int ret = Flush()) return ret;
 
   if (LastError.Len()>0) return 1;
   else return 0;
@@ -357,7 +450,19 @@ int uMod_Sender::SendKey(int key, int ctr)
   msg.Value = key;
   msg.Hash = 0u;
 
-  return SendToGame( (void*)  &msg, sizeof(MsgStruct));
+  if (int ret = SendRecord( msg)) return ret;
+  return Flush();
+}
+
+int uMod_Sender::SendMemoryBudget(int mega_bytes)
+{
+  MsgStruct msg;
+  msg.Control = CONTROL_MEMORY_BUDGET;
+  msg.Value = mega_bytes;
+  msg.Hash = 0u;
+
+  if (int ret = SendRecord( msg)) return ret;
+  return Flush();
 }
 
 #define D3DCOLOR_ARGB(a,r,g,b) ((DWORD)((((a)&0xff)<<24)|(((r)&0xff)<<16)|(((g)&0xff)<<8)|((b)&0xff)))
@@ -369,31 +474,255 @@ int uMod_Sender::SendColour( int* colour, int ctr)
   msg.Value = D3DCOLOR_ARGB( 255, colour[0], colour[1], colour[2]);
   msg.Hash = 0u;
 
-  return SendToGame( (void*)  &msg, sizeof(MsgStruct));
+  if (int ret = SendRecord( msg)) return ret;
+  return Flush();
 }
 #undef D3DCOLOR_ARGB
 
 
 int uMod_Sender::SendPath( const wxString &path)
 {
-  MsgStruct *msg = (MsgStruct*) Buffer;
-
-  msg->Hash = 0u;
-  msg->Control = CONTROL_SET_DIR;
+  MsgStruct msg;
+  msg.Hash = 0u;
+  msg.Control = CONTROL_SET_DIR;
 
   const wchar_t *file = path.wc_str();
-  wchar_t *buff_file = (wchar_t*) &Buffer[sizeof(MsgStruct)];
-  int len = 0;
-  while (file[len] && (sizeof(MsgStruct)+len*sizeof(wchar_t))<BIG_BUFSIZE) {buff_file[len] = file[len]; len++;};
-  if ((sizeof(MsgStruct)+len*sizeof(wchar_t))<BIG_BUFSIZE) buff_file[len] = 0;
-  len++;
-
-  msg->Value = len*sizeof(wchar_t);
-  return SendToGame( Buffer, sizeof(MsgStruct)+len*sizeof(wchar_t));
+  unsigned int len = 0u;
+  while (file[len]) len++;
+  len++; //to send also the zero
+
+  msg.Value = len*sizeof(wchar_t);
+  if (int ret = SendRecord( msg, file, len*sizeof(wchar_t))) return ret;
+  return Flush();
 }
 
 
-int uMod_Sender::SendToGame( void *msg, unsigned long len)
+int uMod_Sender::SendRecord( MsgStruct &msg, const void* data, unsigned int size)
+{
+  if (Buffer==NULL) return (RETURN_NO_MEMORY);
+  if (data==NULL) size = 0u;
+  unsigned int len = sizeof(FrameHeaderStruct) + sizeof(MsgStruct) + size;
+
+  if (BufferPos+len>BIG_BUFSIZE) if (int ret = WriteBuffer()) return ret; // the buffer is full
+
+  FrameHeaderStruct *header = (FrameHeaderStruct*) &Buffer[BufferPos];
+  header->Size = sizeof(MsgStruct) + size;
+  BufferPos += sizeof(FrameHeaderStruct);
+  memcpy( &Buffer[BufferPos], &msg, sizeof(MsgStruct));
+  BufferPos += sizeof(MsgStruct);
+
+  if (len>BIG_BUFSIZE) // the data does not fit into the buffer, it is written directly behind its header
+  {
+    if (int ret = WriteBuffer()) return ret;
+    return SendToGame( data, size);
+  }
+  if (size>0u)
+  {
+    memcpy( &Buffer[BufferPos], data, size);
+    BufferPos += size;
+  }
+  return 0;
+}
+
+int uMod_Sender::WriteBuffer(void)
+{
+  if (BufferPos==0u) return 0;
+  unsigned int len = BufferPos;
+  BufferPos = 0u;
+  return SendToGame( Buffer, len);
+}
+
+int uMod_Sender::Flush(void)
+{
+  if (int ret = WriteBuffer()) return ret;
+  // we wait only at the end of a message until the game has read everything,
+  // thus the game processes the last part, while the next part is written into the pipe
+  if (Pipe.Out==INVALID_HANDLE_VALUE) {LastError << Language->Error_NoPipe; return -1;}
+  if (!FlushFileBuffers(Pipe.Out)) {LastError << Language->Error_FlushPipe; return -1;}
+  return 0;
+}
+
+static int LazyIndex_Compare( const void* elem1, const void* elem2)
+{
+  const LazyIndexStruct* a = (const LazyIndexStruct*) elem1;
+  const LazyIndexStruct* b = (const LazyIndexStruct*) elem2;
+  if (a->Hash!=b->Hash) return (a->Hash<b->Hash ? -1 : 1);
+  return (a->Index - b->Index); // the first package wins, like in SendTextures()
+}
+
+void uMod_Sender::ClearLazyTable(void)
+{
+  if (LazyTextures!=NULL) delete [] LazyTextures;
+  if (LazyIndex!=NULL) delete [] LazyIndex;
+  LazyTextures = NULL;
+  LazyIndex = NULL;
+  NumberOfLazy = 0;
+}
+
+int uMod_Sender::BuildLazyTable( unsigned int num, AddTextureClass *tex)
+{
+  ClearLazyTable();
+
+  int number = 0;
+  for (unsigned int i=0u; i<num; i++) if (tex[i].Add) for (unsigned int j=0u; j<tex[i].Num; j++)
+  {
+    if (tex[i].WasAdded[j] && tex[i].Textures[j]!=NULL) number++;
+  }
+  if (number==0) return 0;
+
+  try
+  {
+    LazyTextures = new LazyTextureStruct[number];
+    LazyIndex = new LazyIndexStruct[number];
+  }
+  catch (...)
+  {
+    if (LazyTextures!=NULL) delete [] LazyTextures;
+    LazyTextures = NULL;
+    LastError << Language->Error_Memory;
+    return -1;
+  }
+
+  for (unsigned int i=0u; i<num; i++) if (tex[i].Add) for (unsigned int j=0u; j<tex[i].Num; j++)
+  {
+    if (!tex[i].WasAdded[j] || tex[i].Textures[j]==NULL) continue;
+    LazyTextures[NumberOfLazy].Hash = tex[i].Hash[j];
+    LazyTextures[NumberOfLazy].Data = tex[i].Textures[j];
+    LazyTextures[NumberOfLazy].Size = tex[i].Size[j];
+    LazyTextures[NumberOfLazy].Package = i;
+    LazyTextures[NumberOfLazy].Fetched = false;
+    LazyIndex[NumberOfLazy].Hash = tex[i].Hash[j];
+    LazyIndex[NumberOfLazy].Index = NumberOfLazy;
+    NumberOfLazy++;
+  }
+  qsort( LazyIndex, NumberOfLazy, sizeof(LazyIndexStruct), LazyIndex_Compare);
+  return 0;
+}
+
+int uMod_Sender::Fetch( MyTypeHash hash)
+{
+  // binary search for the first entry with this hash
+  int low = 0;
+  int high = NumberOfLazy;
+  while (low<high)
+  {
+    int mid = (low+high)/2;
+    if (LazyIndex[mid].Hash<hash) low = mid+1;
+    else high = mid;
+  }
+  if (low>=NumberOfLazy || LazyIndex[low].Hash!=hash) return 0; // the texture was removed meanwhile
+
+  int index = LazyIndex[low].Index;
+  if (int ret = SendFetched( index)) return ret;
+
+  // prefetch the following textures of the same package, they are likely needed soon
+  int count = 0;
+  for (int i=index+1; i<NumberOfLazy && count<uMod_PREFETCH_NUMBER && LazyTextures[i].Package==LazyTextures[index].Package; i++)
+  {
+    if (LazyTextures[i].Fetched) continue;
+    if (int ret = SendFetched( i)) return ret;
+    count++;
+  }
+  return Flush();
+}
+
+int uMod_Sender::SendFetched( int index)
+{
+  MsgStruct msg;
+  msg.Control = CONTROL_FETCHED_TEXTURE_DATA;
+  msg.Value = LazyTextures[index].Size;
+  msg.Hash = LazyTextures[index].Hash;
+  LazyTextures[index].Fetched = true;
+  return SendRecord( msg, LazyTextures[index].Data, LazyTextures[index].Size);
+}
+
+static volatile LONG NextGeneration = 0; // the names of the regions must be unique for all senders
+
+int uMod_Sender::NewRegion( unsigned int size)
+{
+  CloseRegionView();
+  if (NumberOfRegions>=LengthOfRegions)
+  {
+    if (GetMoreMemory( Regions, LengthOfRegions, LengthOfRegions+10)) return (RETURN_NO_MEMORY);
+    LengthOfRegions += 10;
+  }
+
+  Generation = (unsigned int) InterlockedIncrement( &NextGeneration);
+  wxString name = uMod_SHARED_REGION_NAME;
+  name << GetCurrentProcessId() << "_" << Generation;
+  const wchar_t *str = name.wc_str();
+  unsigned int len = 0u;
+  while (str[len]) len++;
+  len++; //to send also the zero
+  if (len>MAX_PATH) return (RETURN_BAD_ARGUMENT);
+
+  // the pages are reserved only, they are committed while the textures are written into the region
+  HANDLE section = CreateFileMappingW( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE | SEC_RESERVE, 0, size, str);
+  if (section==NULL) return (RETURN_NO_MEMORY);
+  RegionView = (char*) MapViewOfFile( section, FILE_MAP_WRITE, 0, 0, size);
+  if (RegionView==NULL)
+  {
+    CloseHandle( section);
+    return (RETURN_NO_MEMORY);
+  }
+  RegionSize = size;
+  RegionPos = 0u;
+  Regions[NumberOfRegions].Section = section;
+  Regions[NumberOfRegions].Generation = Generation;
+  NumberOfRegions++;
+
+  MsgStruct msg;
+  msg.Control = CONTROL_SHARED_REGION;
+  msg.Value = 0;
+  msg.Hash = 0u;
+
+  char record[sizeof(SharedRegionStruct) + MAX_PATH*sizeof(wchar_t)];
+  SharedRegionStruct *region = (SharedRegionStruct*) record;
+  region->Generation = Generation;
+  region->Size = size;
+  memcpy( &record[sizeof(SharedRegionStruct)], str, len*sizeof(wchar_t));
+  return SendRecord( msg, record, sizeof(SharedRegionStruct) + len*sizeof(wchar_t));
+}
+
+int uMod_Sender::AddToRegion( MsgStruct &msg, const char* data, unsigned int size)
+{
+  if (RegionView==NULL || RegionPos+size>RegionSize) return (RETURN_BAD_ARGUMENT);
+  if (VirtualAlloc( &RegionView[RegionPos], size, MEM_COMMIT, PAGE_READWRITE)==NULL) return (RETURN_NO_MEMORY);
+  memcpy( &RegionView[RegionPos], data, size);
+
+  SharedPayloadStruct payload;
+  payload.Generation = Generation;
+  payload.Offset = RegionPos;
+  payload.Size = size;
+  RegionPos += size;
+
+  msg.Control = msg.Control==CONTROL_FORCE_RELOAD_TEXTURE_DATA ? CONTROL_FORCE_RELOAD_TEXTURE_SHARED : CONTROL_ADD_TEXTURE_SHARED;
+  return SendRecord( msg, &payload, sizeof(SharedPayloadStruct));
+}
+
+int uMod_Sender::CloseRegionView(void)
+{
+  if (RegionView!=NULL) UnmapViewOfFile( RegionView);
+  RegionView = NULL;
+  RegionSize = 0u;
+  RegionPos = 0u;
+  return 0;
+}
+
+int uMod_Sender::ReleaseRegions( bool all)
+{
+  unsigned int mapped = Client->GetMappedGeneration();
+  int pos = 0;
+  for (int i=0; i<NumberOfRegions; i++)
+  {
+    if (all || Regions[i].Generation<=mapped) CloseHandle( Regions[i].Section);
+    else Regions[pos++] = Regions[i];
+  }
+  NumberOfRegions = pos;
+  return 0;
+}
+
+int uMod_Sender::SendToGame( const void *msg, unsigned long len)
 {
   if (len==0) return (RETURN_BAD_ARGUMENT);
   unsigned long num;
@@ -401,7 +730,6 @@ int uMod_Sender::SendToGame( void *msg, unsigned long len)
   if (Pipe.Out==INVALID_HANDLE_VALUE) {LastError << Language->Error_NoPipe; return -1;}
   bool ret = WriteFile( Pipe.Out, (const void*) msg, len, &num, NULL);
   if (!ret || len!=num) {LastError << Language->Error_WritePipe; return -1;}
-  if (!FlushFileBuffers(Pipe.Out)) {LastError << Language->Error_FlushPipe; return -1;}
   return 0;
 }
 
@@ -24,14 +24,52 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 #include "uMod_Main.h"
 
 
+#define uMod_SHARED_MIN_SIZE (1u<<20) // smaller batches of textures are sent over the pipe
+#define uMod_SHARED_MAX_SIZE (1u<<28) // bigger batches are split into several regions (the address space of the game is limited)
+#define uMod_LAZY_MIN_SIZE (1u<<26) // for bigger batches only the hashes are sent, the game fetches the file content on demand
+#define uMod_PREFETCH_NUMBER 16 // number of textures of the same package, which are sent together with a fetched texture
+#define uMod_LOAD_MAX_THREADS 8 // packages are read and unpacked in parallel
+
+typedef struct
+{
+  HANDLE Section;
+  unsigned int Generation;
+} RegionHandleStruct; // the handle is closed, after the game has mapped the region
+
+typedef struct
+{
+  MyTypeHash Hash;
+  char* Data; // points into the memory of OldTextures
+  unsigned int Size;
+  int Package; // textures of the same package are prefetched together
+  bool Fetched;
+} LazyTextureStruct; // textures which might be requested by the game (lazy mode)
+
+typedef struct
+{
+  MyTypeHash Hash;
+  int Index; // in the array of LazyTextureStruct
+} LazyIndexStruct;
+
+typedef struct
+{
+  uMod_File *Files; // one for each package to be loaded
+  AddTextureClass *Textures;
+  const bool *Checked;
+  const int *Index; // of the packages to be loaded (in Textures and Checked)
+  int Number;
+  volatile LONG Next; // next package, which is taken by a loader thread
+} LoadJobStruct;
+
 // an object of this class is owned by each uMod_GamePage object. It act as sender ^^
 class uMod_Sender
 {
 public:
-  uMod_Sender(PipeStruct &pipe);
+  uMod_Sender(uMod_Client *client);
   ~uMod_Sender(void);
 
   int Send( const uMod_GameInfo &game, const uMod_GameInfo &game_old, bool force=false, wxArrayString *comments=NULL);
+  int Fetch( MyTypeHash hash); // called from the main thread, if the game requests the file content of a texture (lazy mode)
 
   wxString LastError;
 
@@ -39,6 +77,11 @@ private:
   int SendSaveAllTextures(bool val);
   int SendSaveSingleTexture(bool val);
 
+  // each package is loaded into its own AddTextureClass object, thus the result does not depend on the order,
+  // in which the loader threads finish (the first package in the list wins in SendTextures())
+  int LoadPackages( const wxArrayString &files, const bool *checked, AddTextureClass *tex, const int *index, int number);
+  static DWORD WINAPI LoadThread( LPVOID lpParam);
+
   int SendTextures(unsigned int num, AddTextureClass *tex);
 
   int SendKey(int key, int ctr);
@@ -47,8 +90,39 @@ private:
 
   int SendColour( int* colour, int ctr);
 
+  int SendMemoryBudget(int mega_bytes);
+
   char *Buffer;
-  int SendToGame( void* msg, unsigned long len);
+  unsigned int BufferPos;
+  // each record is prefixed with a FrameHeaderStruct, small records are collected in Buffer,
+  // the data of big records is written directly behind its header
+  int SendRecord( MsgStruct &msg, const void* data=NULL, unsigned int size=0u);
+  int WriteBuffer(void); // writes all records collected in Buffer into the pipe
+  int Flush(void); // writes the Buffer and waits until the game has read everything
+  int SendToGame( const void* msg, unsigned long len);
+
+  // the file content of big batches of textures is written once into a shared region (file mapping),
+  // only its position is sent over the pipe and the game reads it in place
+  int NewRegion( unsigned int size); // called from SendTextures(), the CONTROL_SHARED_REGION is sent
+  int AddToRegion( MsgStruct &msg, const char* data, unsigned int size); // called from SendTextures()
+  int CloseRegionView(void); // the handle is still kept, until the game has mapped the region
+  int ReleaseRegions( bool all=false); // closes the handles of the regions, which are mapped by the game
+
+  uMod_Client *Client;
+  RegionHandleStruct *Regions;
+  int NumberOfRegions;
+  int LengthOfRegions;
+  unsigned int Generation; // of the current region
+  char *RegionView; // view of the current region
+  unsigned int RegionSize;
+  unsigned int RegionPos;
+
+  int BuildLazyTable( unsigned int num, AddTextureClass *tex); // called from SendTextures(), all added textures can be fetched
+  void ClearLazyTable(void); // the table points into the textures of OldTextures, it must not outlive them
+  int SendFetched( int index);
+  LazyTextureStruct *LazyTextures; // in the order they were sent
+  LazyIndexStruct *LazyIndex; // sorted by the hash
+  int NumberOfLazy;
 
   int AddFile( AddTextureClass *tex, wxString file, bool add, bool force);
   int AddZip( AddTextureClass *tex, wxString file, bool add, bool force, bool tpf);
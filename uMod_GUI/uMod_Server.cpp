@@ -37,7 +37,7 @@ void* uMod_Server::Entry(void)
   bool  fConnected = false;
   HANDLE pipe_in;
   HANDLE pipe_out;
-  char buffer[SMALL_BUFSIZE];
+  char buffer[SMALL_BUFSIZE+2];
   wxString abort = ABORT_SERVER;
 
   while(1)
@@ -95,21 +95,36 @@ void* uMod_Server::Entry(void)
         if (num>2)
         {
           buffer[num]=0;
-          buffer[num-1]=0;
-          wxString name = (wchar_t*) buffer;
+          buffer[num+1]=0;
+          HandshakeStruct *handshake = (HandshakeStruct*) buffer;
+          bool valid = num>sizeof(HandshakeStruct) && handshake->Magic==uMod_PROTOCOL_MAGIC;
+          // the name of the game follows the handshake, the abort message is sent without it
+          wxString name = (wchar_t*) (valid ? &buffer[sizeof(HandshakeStruct)] : buffer);
 
-          if (name==abort) // kill this server thread
+          if (!valid && name==abort) // kill this server thread
           {
             //Beep(1200,300);
             CloseHandle(pipe_in);
+            CloseHandle(pipe_out);
             return NULL;
           }
 
+          if (!valid || handshake->Version!=uMod_PROTOCOL_VERSION) // the game uses another version of uMod
+          {
+            CloseHandle(pipe_in);
+            CloseHandle(pipe_out);
+            continue;
+          }
 
           fConnected = ConnectNamedPipe(pipe_out, NULL) ?
             true : (GetLastError() == ERROR_PIPE_CONNECTED);
           if (fConnected)
           {
+            HandshakeStruct answer;
+            answer.Magic = uMod_PROTOCOL_MAGIC;
+            answer.Version = uMod_PROTOCOL_VERSION;
+            WriteFile( pipe_out, (const void*) &answer, sizeof(HandshakeStruct), &num, NULL);
+
             uMod_Event event( uMod_EVENT_TYPE, ID_Add_Game);
             event.SetName(name);
             event.SetPipeIn(pipe_in);
@@ -0,0 +1,60 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef uMod_XOR_H_
+#define uMod_XOR_H_
+
+#include <emmintrin.h>
+
+/*
+ *  Decryption of a tpf, called from uMod_File::XORBuffer().
+ *  Each 4 bytes (counted from the beginning of the file) are XORed with TPF_XOR, the remaining bytes with the lowest byte
+ *  of TPF_XOR. data must start at a multiple of 16 bytes (from the beginning of the file), thus a file can be decrypted
+ *  chunk by chunk.
+ *
+ *  It depends only on SSE2, thus it can be tested on its own.
+ */
+inline void uMod_XORBuffer( char* data, unsigned int len)
+{
+  const unsigned int TPF_XOR = 0x3FA43FA4u;
+  const __m128i key = _mm_set1_epi32( (int) TPF_XOR);
+  unsigned int i = 0u;
+  for (; i+64u<=len; i+=64u)
+  {
+    __m128i *buff = (__m128i*) &data[i];
+    __m128i a = _mm_loadu_si128( buff);
+    __m128i b = _mm_loadu_si128( buff+1);
+    __m128i c = _mm_loadu_si128( buff+2);
+    __m128i d = _mm_loadu_si128( buff+3);
+    _mm_storeu_si128( buff, _mm_xor_si128( a, key));
+    _mm_storeu_si128( buff+1, _mm_xor_si128( b, key));
+    _mm_storeu_si128( buff+2, _mm_xor_si128( c, key));
+    _mm_storeu_si128( buff+3, _mm_xor_si128( d, key));
+  }
+  for (; i+16u<=len; i+=16u)
+  {
+    __m128i *buff = (__m128i*) &data[i];
+    _mm_storeu_si128( buff, _mm_xor_si128( _mm_loadu_si128( buff), key));
+  }
+  for (; i+4u<=len; i+=4u) *((unsigned int*) &data[i]) ^= TPF_XOR;
+  for (; i<len; i++) ((unsigned char*) data)[i] ^= (unsigned char) TPF_XOR;
+}
+
+#endif /* uMod_XOR_H_ */
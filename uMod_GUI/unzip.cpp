@@ -6,6 +6,7 @@
 //#include <wchar.h>  /*added by ROTA*/
 #include <tchar.h>
 #include "unzip.h"
+#include "uMod_Inflate.h"
 
 // THIS FILE is almost entirely based upon code by Jean-loup Gailly
 // and Mark Adler. It has been modified by Lucian Wischik.
@@ -2056,11 +2057,16 @@ z_streamp z)
             }
             else                                /* normal copy */
             {
-              *q++ = *r++;  c--;
-              *q++ = *r++;  c--;
-              do {
-                *q++ = *r++;
-              } while (--c);
+              // the source is at least d bytes behind, thus chunks of up to d bytes do not overlap
+              if (d >= 16)
+              {
+                while (c >= 16) {memcpy(q, r, 16); q += 16; r += 16; c -= 16;}
+              }
+              else if (d >= 8)
+              {
+                while (c >= 8) {memcpy(q, r, 8); q += 8; r += 8; c -= 8;}
+              }
+              while (c) {*q++ = *r++; c--;}
             }
             break;
           }
@@ -3467,6 +3473,43 @@ int unzOpenCurrentFile (unzFile file, const char *password)
 }
 
 
+//  Inflates the whole current file at once (see uMod_Inflate.h), if the zip lies in memory.
+//  return the number of bytes written or <0, if the stream inflate must be used instead
+//  (UNZ_PASSWORD is returned, if the password is wrong)
+int unzInflateAll (file_in_zip_read_info_s *info)
+{ LUFILE *f = info->file;
+  uLong pos = info->pos_in_zipfile + info->byte_before_the_zipfile;
+  uLong size = info->rest_read_compressed;
+  if (pos>f->len || size>f->len-pos) return UNZ_ERRNO;
+  const unsigned char *src = (const unsigned char*)f->buf + pos;
+
+  unsigned char *copy = NULL;
+  if (info->encrypted)
+  { if (size<12) return UNZ_ERRNO;
+    copy = (unsigned char*)zmalloc(size);
+    if (copy==NULL) return UNZ_ERRNO;
+    unsigned long keys[3] = {info->keys[0], info->keys[1], info->keys[2]};
+    for (uLong i=0; i<size; i++) copy[i]=zdecode(keys,src[i]);
+    if ((char)copy[11]!=info->crcenctest) {zfree(copy); return UNZ_PASSWORD;}
+    src = copy+12; size-=12;
+  }
+
+  int ret = uMod_Inflate(src, size, info->stream.next_out, info->stream.avail_out);
+  if (copy!=NULL) zfree(copy);
+  if (ret<0 || (uLong)ret!=info->rest_read_uncompressed) return UNZ_ERRNO;
+
+  info->crc32 = ucrc32(info->crc32,info->stream.next_out,(uInt)ret);
+  info->pos_in_zipfile += info->rest_read_compressed;
+  info->rest_read_compressed = 0;
+  info->rest_read_uncompressed = 0;
+  info->encheadleft = 0;
+  info->stream.next_out += ret;
+  info->stream.avail_out -= ret;
+  info->stream.total_out += ret;
+  return ret;
+}
+
+
 //  Read bytes from the current file.
 //  buf contain buffer where data must be copied
 //  len the size of buf.
@@ -3494,6 +3537,15 @@ int unzReadCurrentFile  (unzFile file, voidp buf, unsigned len, bool *reached_eo
   { pfile_in_zip_read_info->stream.avail_out = (uInt)pfile_in_zip_read_info->rest_read_uncompressed;
   }
 
+  // textures are read at once from memory, they are inflated without the stream
+  if (pfile_in_zip_read_info->compression_method==Z_DEFLATED && !pfile_in_zip_read_info->file->is_handle &&
+      pfile_in_zip_read_info->stream.total_out==0 && pfile_in_zip_read_info->stream.avail_in==0 &&
+      pfile_in_zip_read_info->stream.avail_out==pfile_in_zip_read_info->rest_read_uncompressed)
+  { int ret = unzInflateAll(pfile_in_zip_read_info);
+    if (ret==UNZ_PASSWORD) return UNZ_PASSWORD;
+    if (ret>=0) {if (reached_eof!=0) *reached_eof=true; return ret;}
+  }
+
   while (pfile_in_zip_read_info->stream.avail_out>0)
   { if ((pfile_in_zip_read_info->stream.avail_in==0) && (pfile_in_zip_read_info->rest_read_compressed>0))
     { uInt uReadThis = UNZ_BUFSIZE;
@@ -3752,25 +3804,152 @@ FILETIME dosdatetime2filetime(WORD dosdate,WORD dostime)
 
 
 
+// name index of the central directory, it is built with the first Find() and replaces the linear search
+// of unzLocateFile. The keys are case-insensitive and '\\' equals '/'. If the index cannot be built, LocateLinear
+// compares the names in the same way. Names, which are too long for unzLocateFile, are not indexed.
+typedef struct
+{ unsigned int hash;    // of the normalized name, 0 marks an empty slot
+  int num;              // number of the entry in the central directory
+  uLong name;           // offset of the name in TUnzip::names
+} ZIPINDEX;
+
+unsigned int zipnamehash(const char *name)
+{ unsigned int hash=2166136261u; // FNV-1a
+  for (; *name!=0; name++)
+  { char c=*name; if (c=='\\') c='/'; if (c>='A' && c<='Z') c=(char)(c-'A'+'a');
+    hash^=(unsigned char)c; hash*=16777619u;
+  }
+  return hash==0 ? 1 : hash;
+}
+
+bool zipnameequal(const char *a,const char *b,bool ic)
+{ for (;; a++,b++)
+  { char ca=*a, cb=*b;
+    if (ca=='\\') ca='/'; if (cb=='\\') cb='/';
+    if (ic) {if (ca>='A' && ca<='Z') ca=(char)(ca-'A'+'a'); if (cb>='A' && cb<='Z') cb=(char)(cb-'A'+'a');}
+    if (ca!=cb) return false;
+    if (ca==0) return true;
+  }
+}
+
+int unzGoToEntry(unzFile file,uLong num,uLong pos)
+{ unz_s *s=(unz_s*)file;
+  s->num_file=num;
+  s->pos_in_central_dir=pos;
+  int err=unzlocal_GetCurrentFileInfoInternal(file,&s->cur_file_info,&s->cur_file_info_internal,NULL,0,NULL,0,NULL,0);
+  s->current_file_ok = (err == UNZ_OK);
+  return err;
+}
+
+
 class TUnzip
 { public:
-  TUnzip(const char *pwd) : uf(0), unzbuf(0), currentfile(-1), czei(-1), password(0) {if (pwd!=0) {password=new char[strlen(pwd)+1]; strcpy(password,pwd);}}
-  ~TUnzip() {if (password!=0) delete[] password; password=0; if (unzbuf!=0) delete[] unzbuf; unzbuf=0;}
+  TUnzip(const char *pwd) : uf(0), unzbuf(0), currentfile(-1), czei(-1), password(0), nameindex(0), indexsize(0), entrypos(0), names(0), indextried(false) {if (pwd!=0) {password=new char[strlen(pwd)+1]; strcpy(password,pwd);}}
+  ~TUnzip() {if (password!=0) delete[] password; password=0; if (unzbuf!=0) delete[] unzbuf; unzbuf=0; FreeIndex();}
 
   unzFile uf; int currentfile; ZIPENTRY cze; int czei;
   char *password;
   char *unzbuf;            // lazily created and destroyed, used by Unzip
   TCHAR rootdir[MAX_PATH]; // includes a trailing slash
 
+  ZIPINDEX *nameindex; unsigned int indexsize; // open addressing, indexsize is a power of two
+  uLong *entrypos;         // position in the central directory of each entry
+  char *names;
+  bool indextried;
+
   ZRESULT Open(void *z,unsigned int len,DWORD flags);
   ZRESULT Get(int index,ZIPENTRY *ze);
   ZRESULT Find(const TCHAR *name,bool ic,int *index,ZIPENTRY *ze);
   ZRESULT Unzip(int index,void *dst,unsigned int len,DWORD flags);
   ZRESULT SetUnzipBaseDir(const TCHAR *dir);
   ZRESULT Close();
+
+  bool BuildIndex();
+  void FreeIndex();
+  int LocateIndexed(const char *name,bool ic);
+  int LocateLinear(const char *name,bool ic);
+  void GoTo(int index);    // makes index the current file
 };
 
 
+bool TUnzip::BuildIndex()
+{ uLong num=uf->gi.number_entry;
+  if (num==0) return false;
+  if (currentfile!=-1) unzCloseCurrentFile(uf); currentfile=-1;
+  unsigned int size=16; while (size<2*num) size<<=1;
+  uLong namesize=num*32, namepos=0;
+  try {
+  nameindex=new ZIPINDEX[size]; indexsize=size;
+  entrypos=new uLong[num];
+  names=new char[namesize];
+  memset(nameindex,0,sizeof(ZIPINDEX)*size);
+  //
+  int err=unzGoToFirstFile(uf);
+  for (uLong i=0; i<num && err==UNZ_OK; i++)
+  { char fn[UNZ_MAXFILENAMEINZIP+1]; fn[0]=0; unz_file_info info; info.size_filename=0;
+    unzGetCurrentFileInfo(uf,&info,fn,sizeof(fn)-1,NULL,0,NULL,0);
+    fn[UNZ_MAXFILENAMEINZIP]=0;
+    entrypos[i]=uf->pos_in_central_dir;
+    if (info.size_filename>=UNZ_MAXFILENAMEINZIP) {if (i+1<num) err=unzGoToNextFile(uf); continue;} // fn is truncated
+    uLong len=(uLong)strlen(fn)+1;
+    if (namepos+len>namesize)
+    { while (namepos+len>namesize) namesize*=2;
+      char *more=new char[namesize]; memcpy(more,names,namepos); delete[] names; names=more;
+    }
+    memcpy(names+namepos,fn,len);
+    //
+    unsigned int hash=zipnamehash(fn), slot=hash&(size-1);
+    while (nameindex[slot].hash!=0) slot=(slot+1)&(size-1); // equal names keep the order of the directory
+    nameindex[slot].hash=hash; nameindex[slot].num=(int)uf->num_file; nameindex[slot].name=namepos;
+    namepos+=len;
+    if (i+1<num) err=unzGoToNextFile(uf);
+  }
+  if (err!=UNZ_OK) {FreeIndex(); unzGoToFirstFile(uf); return false;} // the linear search is used
+  } catch (...) {FreeIndex(); unzGoToFirstFile(uf); return false;}
+  unzGoToFirstFile(uf);
+  return true;
+}
+
+void TUnzip::FreeIndex()
+{ if (nameindex!=0) delete[] nameindex; nameindex=0; indexsize=0;
+  if (entrypos!=0) delete[] entrypos; entrypos=0;
+  if (names!=0) delete[] names; names=0;
+}
+
+int TUnzip::LocateIndexed(const char *name,bool ic)
+{ unsigned int hash=zipnamehash(name), slot=hash&(indexsize-1);
+  for (; nameindex[slot].hash!=0; slot=(slot+1)&(indexsize-1))
+  { if (nameindex[slot].hash==hash && zipnameequal(names+nameindex[slot].name,name,ic))
+    { int num=nameindex[slot].num;
+      return unzGoToEntry(uf,num,entrypos[num]);
+    }
+  }
+  return UNZ_END_OF_LIST_OF_FILE; // the current file is not changed
+}
+
+int TUnzip::LocateLinear(const char *name,bool ic)
+{ if (strlen(name)>=UNZ_MAXFILENAMEINZIP) return UNZ_PARAMERROR;
+  if (!uf->current_file_ok) return UNZ_END_OF_LIST_OF_FILE;
+  uLong num=uf->num_file, pos=uf->pos_in_central_dir;
+  int err=unzGoToFirstFile(uf);
+  for (; err==UNZ_OK; err=unzGoToNextFile(uf))
+  { char fn[UNZ_MAXFILENAMEINZIP+1]; fn[0]=0; unz_file_info info; info.size_filename=0;
+    unzGetCurrentFileInfo(uf,&info,fn,sizeof(fn)-1,NULL,0,NULL,0);
+    fn[UNZ_MAXFILENAMEINZIP]=0;
+    if (info.size_filename<UNZ_MAXFILENAMEINZIP && zipnameequal(fn,name,ic)) return UNZ_OK;
+  }
+  unzGoToEntry(uf,num,pos); // the current file is not changed
+  return err;
+}
+
+void TUnzip::GoTo(int i)
+{ if (i==(int)uf->num_file) return;
+  if (entrypos!=0) {unzGoToEntry(uf,i,entrypos[i]); return;}
+  if (i<(int)uf->num_file) unzGoToFirstFile(uf);
+  while ((int)uf->num_file<i) unzGoToNextFile(uf);
+}
+
+
 ZRESULT TUnzip::Open(void *z,unsigned int len,DWORD flags)
 { if (uf!=0 || currentfile!=-1) return ZR_NOTINITED;
   //
@@ -3817,8 +3996,7 @@ ZRESULT TUnzip::Get(int index,ZIPENTRY *ze)
     ze->unc_size=0;
     return ZR_OK;
   }
-  if (index<(int)uf->num_file) unzGoToFirstFile(uf);
-  while ((int)uf->num_file<index) unzGoToNextFile(uf);
+  GoTo(index);
   unz_file_info ufi; char fn[MAX_PATH];
   unzGetCurrentFileInfo(uf,&ufi,fn,MAX_PATH,NULL,0,NULL,0);
   // now get the extra header. We do this ourselves, instead of
@@ -3932,7 +4110,10 @@ ZRESULT TUnzip::Find(const TCHAR *tname,bool ic,int *index,ZIPENTRY *ze)
 #else
   strcpy(name,tname);
 #endif
-  int res = unzLocateFile(uf,name,ic?CASE_INSENSITIVE:CASE_SENSITIVE);
+  int res;
+  if (!indextried) {indextried=true; BuildIndex();}
+  if (nameindex!=0) res = LocateIndexed(name,ic);
+  else res = LocateLinear(name,ic);
   if (res!=UNZ_OK)
   { if (index!=0) *index=-1;
     if (ze!=NULL) {ZeroMemory(ze,sizeof(ZIPENTRY)); ze->index=-1;}
@@ -3972,8 +4153,7 @@ ZRESULT TUnzip::Unzip(int index,void *dst,unsigned int len,DWORD flags)
   { if (index!=currentfile)
     { if (currentfile!=-1) unzCloseCurrentFile(uf); currentfile=-1;
       if (index>=(int)uf->gi.number_entry) return ZR_ARGS;
-      if (index<(int)uf->num_file) unzGoToFirstFile(uf);
-      while ((int)uf->num_file<index) unzGoToNextFile(uf);
+      GoTo(index);
       unzOpenCurrentFile(uf,password); currentfile=index;
     }
     bool reached_eof;
@@ -3987,8 +4167,7 @@ ZRESULT TUnzip::Unzip(int index,void *dst,unsigned int len,DWORD flags)
   // otherwise we're writing to a handle or a file
   if (currentfile!=-1) unzCloseCurrentFile(uf); currentfile=-1;
   if (index>=(int)uf->gi.number_entry) return ZR_ARGS;
-  if (index<(int)uf->num_file) unzGoToFirstFile(uf);
-  while ((int)uf->num_file<index) unzGoToNextFile(uf);
+  GoTo(index);
   ZIPENTRY ze; Get(index,&ze);
   // zipentry=directory is handled specially
   if ((ze.attr&FILE_ATTRIBUTE_DIRECTORY)!=0)
@@ -4042,6 +4221,7 @@ ZRESULT TUnzip::Unzip(int index,void *dst,unsigned int len,DWORD flags)
 
 ZRESULT TUnzip::Close()
 { if (currentfile!=-1) unzCloseCurrentFile(uf); currentfile=-1;
+  FreeIndex(); indextried=false;
   if (uf!=0) unzClose(uf); uf=0;
   return ZR_OK;
 }
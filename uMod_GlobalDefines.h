@@ -22,8 +22,8 @@ along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>
 //#define MyTypeHash DWORD64
 #define MyTypeHash DWORD32
 
-#define BIG_BUFSIZE 1<<24
-#define SMALL_BUFSIZE 1<<10
+#define BIG_BUFSIZE (1<<24)
+#define SMALL_BUFSIZE (1<<10)
 
 typedef struct
 {
@@ -39,6 +39,38 @@ typedef struct
 } PipeStruct;
 
 
+#define uMod_PROTOCOL_MAGIC 0x646F4D75u // "uMod"
+#define uMod_PROTOCOL_VERSION 6 // must be increased, if the messages sent over the pipes are changed
+
+typedef struct
+{
+  unsigned int Magic;
+  unsigned int Version;
+} HandshakeStruct; // first bytes sent in each direction (the game sends its name behind it)
+
+typedef struct
+{
+  unsigned int Size; // size of the record which follows (MsgStruct + data)
+} FrameHeaderStruct; // each record sent from uMod to the game is prefixed with this header
+
+#define uMod_MAX_RECORD_SIZE (1u<<30)
+
+typedef struct
+{
+  unsigned int Generation; // is increased with each region (unique in uMod)
+  unsigned int Size; // size of the region
+} SharedRegionStruct; // sent with CONTROL_SHARED_REGION, followed by the zero terminated name of the file mapping
+
+typedef struct
+{
+  unsigned int Generation; // of the region which holds the file content
+  unsigned int Offset;
+  unsigned int Size;
+} SharedPayloadStruct; // sent with CONTROL_ADD_TEXTURE_SHARED and CONTROL_FORCE_RELOAD_TEXTURE_SHARED
+
+#define uMod_SHARED_REGION_NAME L"Local\\uMod_Payload_" // followed by the process id of uMod and the generation
+
+
 #define uMod_APP_DX9 L"uMod_DX9.txt"
 #define uMod_APP_DIR L"uMod"
 #define uMod_VERSION L"uMod V 1.0"
@@ -51,7 +83,8 @@ typedef struct
 #define CONTROL_REMOVE_TEXTURE 3
 #define CONTROL_FORCE_RELOAD_TEXTURE_DATA 4
 #define CONTROL_ADD_TEXTURE_DATA 5
-#define CONTROL_MORE_TEXTURES 6
+#define CONTROL_MORE_TEXTURES 6 // the following textures belong to one batch, the game updates the textures after CONTROL_END_TEXTURES
+#define CONTROL_END_TEXTURES 7
 
 
 #define CONTROL_SAVE_ALL 10
@@ -65,6 +98,21 @@ typedef struct
 #define CONTROL_FONT_COLOUR 30
 #define CONTROL_TEXTURE_COLOUR 31
 
+#define CONTROL_MEMORY_BUDGET 40 // Value is the budget in MB for the file content of removed textures
+#define uMod_DEFAULT_MEMORY_BUDGET_MB 64 // budget of the game, until uMod sends CONTROL_MEMORY_BUDGET (4096 or more is unlimited)
+#define CONTROL_RETAINED_MEMORY 41 // sent from the game to uMod, Value is the size in KB of the file content of removed textures, which is still held in memory
+
+#define CONTROL_SHARED_REGION 50 // the following textures are stored in a shared memory region of uMod
+#define CONTROL_ADD_TEXTURE_SHARED 51 // the file content is not sent over the pipe, only its position in the shared region
+#define CONTROL_FORCE_RELOAD_TEXTURE_SHARED 52
+#define CONTROL_REGION_MAPPED 53 // sent from the game to uMod, Value is the generation of the region, uMod can close its handle
+#define CONTROL_REGION_FAILED 54 // sent from the game to uMod, Value is the generation of the region, which could not be mapped
+
+#define CONTROL_ADD_TEXTURE_LAZY 60 // only the hash is sent, the game fetches the file content, when it creates a texture with this hash
+#define CONTROL_FORCE_RELOAD_TEXTURE_LAZY 61
+#define CONTROL_FETCH_TEXTURE 62 // sent from the game to uMod, Hash is the texture, whose file content is needed
+#define CONTROL_FETCHED_TEXTURE_DATA 63 // the answer of uMod (also for prefetched textures)
+
 
 
 
@@ -0,0 +1,71 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef uMod_MSGREADER_H_
+#define uMod_MSGREADER_H_
+
+#include <string.h>
+
+/*
+ *  Splits the byte stream of the pipe from the game to uMod into MsgStruct.
+ *
+ *  The pipe is a byte pipe, thus a read can end inside a message (e.g. during a burst of CONTROL_FETCH_TEXTURE).
+ *  The incomplete message stays pending, Compact() moves it to the beginning of the buffer and the next bytes
+ *  are read behind GetEnd() (at most GetFree() bytes).
+ *
+ *  It depends only on uMod_GlobalDefines.h, thus it can be tested on its own.
+ */
+
+class uMod_MsgReader
+{
+public:
+  uMod_MsgReader( unsigned int size) {Size = size; Reset();}
+
+  void Reset(void) {Begin = 0u; End = 0u;}
+  void Received( unsigned int num) {End += num;}
+
+  unsigned int GetEnd(void) const {return (End);} // the next bytes must be read to this position
+  unsigned int GetFree(void) const {return (Size - End);}
+  unsigned int GetPending(void) const {return (End - Begin);}
+
+  // returns 1 if the next message is complete and copies it into msg (it might not be aligned), else 0
+  int Next( const char* buffer, MsgStruct &msg)
+  {
+    if (End - Begin < sizeof(MsgStruct)) return (0);
+    memcpy( &msg, &buffer[Begin], sizeof(MsgStruct));
+    Begin += sizeof(MsgStruct);
+    return (1);
+  }
+
+  void Compact( char* buffer) // called after all complete messages are processed
+  {
+    if (Begin==0u) return;
+    if (End>Begin) memmove( buffer, &buffer[Begin], End - Begin);
+    End -= Begin;
+    Begin = 0u;
+  }
+
+private:
+  unsigned int Size; // of the buffer, must be at least sizeof(MsgStruct)
+  unsigned int Begin;
+  unsigned int End;
+};
+
+#endif /* uMod_MSGREADER_H_ */
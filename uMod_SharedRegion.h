@@ -0,0 +1,42 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef uMod_SHAREDREGION_H_
+#define uMod_SHAREDREGION_H_
+
+/*
+ *  Checks of the shared memory regions of uMod_GUI (CONTROL_SHARED_REGION, CONTROL_ADD_TEXTURE_SHARED).
+ *
+ *  The game maps each region read only. If it cannot map a region it answers with CONTROL_REGION_FAILED
+ *  instead of CONTROL_REGION_MAPPED, the textures of this region are then added lazily (the game fetches the
+ *  file content over the pipe) and uMod_GUI sends the next textures over the pipe.
+ *
+ *  It depends only on uMod_GlobalDefines.h, thus it can be tested on its own.
+ */
+
+// true, if the payload lies inside the mapped region of this generation
+inline bool uMod_CheckPayload( const SharedPayloadStruct *payload, unsigned int generation, unsigned int region_size)
+{
+  if (payload->Generation!=generation) return (false);
+  if (payload->Offset>region_size) return (false);
+  return (payload->Size<=region_size-payload->Offset);
+}
+
+#endif /* uMod_SHAREDREGION_H_ */
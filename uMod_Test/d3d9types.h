@@ -0,0 +1,67 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+ *  Replaces the types of <d3d9types.h> of the DirectX SDK for the tests (gcc), only the formats,
+ *  which are known by uMod_DDS.cpp, are defined (with the values of the SDK).
+ */
+#ifndef uMod_TEST_D3D9TYPES_H_
+#define uMod_TEST_D3D9TYPES_H_
+
+typedef unsigned int UINT;
+
+#define MAKEFOURCC(ch0, ch1, ch2, ch3) ((DWORD)(unsigned char)(ch0) | ((DWORD)(unsigned char)(ch1) << 8) | ((DWORD)(unsigned char)(ch2) << 16) | ((DWORD)(unsigned char)(ch3) << 24 ))
+
+typedef enum
+{
+  D3DFMT_UNKNOWN = 0,
+  D3DFMT_R8G8B8 = 20,
+  D3DFMT_A8R8G8B8 = 21,
+  D3DFMT_X8R8G8B8 = 22,
+  D3DFMT_R5G6B5 = 23,
+  D3DFMT_X1R5G5B5 = 24,
+  D3DFMT_A1R5G5B5 = 25,
+  D3DFMT_A4R4G4B4 = 26,
+  D3DFMT_A8 = 28,
+  D3DFMT_X4R4G4B4 = 30,
+  D3DFMT_A2B10G10R10 = 31,
+  D3DFMT_A8B8G8R8 = 32,
+  D3DFMT_X8B8G8R8 = 33,
+  D3DFMT_G16R16 = 34,
+  D3DFMT_A2R10G10B10 = 35,
+  D3DFMT_A16B16G16R16 = 36,
+  D3DFMT_L8 = 50,
+  D3DFMT_A8L8 = 51,
+  D3DFMT_L16 = 81,
+  D3DFMT_R16F = 111,
+  D3DFMT_G16R16F = 112,
+  D3DFMT_A16B16G16R16F = 113,
+  D3DFMT_R32F = 114,
+  D3DFMT_G32R32F = 115,
+  D3DFMT_A32B32G32R32F = 116,
+  D3DFMT_DXT1 = MAKEFOURCC('D', 'X', 'T', '1'),
+  D3DFMT_DXT2 = MAKEFOURCC('D', 'X', 'T', '2'),
+  D3DFMT_DXT3 = MAKEFOURCC('D', 'X', 'T', '3'),
+  D3DFMT_DXT4 = MAKEFOURCC('D', 'X', 'T', '4'),
+  D3DFMT_DXT5 = MAKEFOURCC('D', 'X', 'T', '5'),
+  D3DFMT_FORCE_DWORD = 0x7fffffff
+} D3DFORMAT;
+
+#endif /* uMod_TEST_D3D9TYPES_H_ */
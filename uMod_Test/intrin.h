@@ -0,0 +1,38 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ *  Replaces <intrin.h> of MS Visual C for the tests (gcc), only __cpuid() is used by uMod.
+ */
+#ifndef uMod_TEST_INTRIN_H_
+#define uMod_TEST_INTRIN_H_
+
+#include <cpuid.h>
+
+static inline void uMod_cpuid( int info[4], int leaf)
+{
+  unsigned int a, b, c, d;
+  __cpuid( leaf, a, b, c, d);
+  info[0] = (int) a; info[1] = (int) b; info[2] = (int) c; info[3] = (int) d;
+}
+
+#undef __cpuid
+#define __cpuid uMod_cpuid
+
+#endif /* uMod_TEST_INTRIN_H_ */
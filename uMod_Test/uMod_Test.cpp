@@ -0,0 +1,111 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Test.h"
+
+#include <time.h>
+
+
+unsigned int gl_ErrorState = 0u;
+unsigned int TestSeed = 0x75D0F00Du;
+
+unsigned int TestRandom(void)
+{
+  TestSeed ^= TestSeed << 13;
+  TestSeed ^= TestSeed >> 17;
+  TestSeed ^= TestSeed << 5;
+  return (TestSeed);
+}
+
+void TestFill( unsigned char *buffer, unsigned int len)
+{
+  for (unsigned int i=0u; i<len; i++) buffer[i] = (unsigned char) (TestRandom() >> 11);
+}
+
+double TestTime(void)
+{
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now);
+  return (now.tv_sec + now.tv_nsec * 1e-9);
+}
+
+
+typedef struct
+{
+  const char *Name;
+  int (*Function)(void);
+  bool Benchmark; // is only run, if its name is given
+} TestStruct;
+
+static const TestStruct Tests[] =
+{
+  {"CRC32", Test_CRC32, false},
+  {"HashIndex", Test_HashIndex, false},
+  {"HashPool", Test_HashPool, false},
+  {"FrameDecoder", Test_FrameDecoder, false},
+  {"MsgReader", Test_MsgReader, false},
+  {"Duplicates", Test_Duplicates, false},
+  {"Inflate", Test_Inflate, false},
+  {"SharedRegion", Test_SharedRegion, false},
+  {"DDS", Test_DDS, false},
+  {"XOR", Test_XOR, false},
+  {"BenchCRC32", Bench_CRC32, true},
+  {"BenchHashIndex", Bench_HashIndex, true},
+  {"BenchFileHandler", Bench_FileHandler, true},
+  {"BenchFrameDecoder", Bench_FrameDecoder, true},
+  {"BenchDuplicates", Bench_Duplicates, true},
+  {"BenchXOR", Bench_XOR, true},
+  {"BenchInflate", Bench_Inflate, true},
+  {"BenchTextureType", Bench_TextureType, true},
+  {"BenchCacheModel", Bench_CacheModel, true},
+  {"BenchDDS", Bench_DDS, true},
+  {"BenchLoadModel", Bench_LoadModel, true},
+  {"BenchMergeModel", Bench_MergeModel, true},
+  {"BenchOverlappedModel", Bench_OverlappedModel, true},
+};
+
+
+/*
+ *  usage: uMod_Test [name of a test] [seed]
+ *  without a name all tests are run (but no benchmark), the name "bench" runs all benchmarks
+ */
+int main( int argc, char **argv)
+{
+  const char *name = argc>1 ? argv[1] : NULL;
+  bool bench = name!=NULL && strcmp( name, "bench")==0;
+  if (argc>2) TestSeed = (unsigned int) strtoul( argv[2], NULL, 0);
+  if (TestSeed==0u) TestSeed = 1u;
+  printf( "seed: 0x%08x\n", TestSeed);
+
+  int failed = 0;
+  int run = 0;
+  for (unsigned int i=0u; i<sizeof(Tests)/sizeof(Tests[0]); i++)
+  {
+    if (name==NULL || bench) {if (Tests[i].Benchmark!=bench) continue;}
+    else if (strcmp( name, Tests[i].Name)!=0) continue;
+    printf( "%s\n", Tests[i].Name);
+    run++;
+    if (Tests[i].Function()) failed++;
+    else printf( "  passed\n");
+  }
+  if (run==0) {printf( "unknown test: %s\n", name); return (1);}
+  printf( "%d of %d tests failed\n", failed, run);
+  return (failed>0 ? 1 : 0);
+}
@@ -0,0 +1,106 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef uMod_TEST_H_
+#define uMod_TEST_H_
+
+/*
+ *  Standalone tests of the parts of uMod which do not depend on Windows, DirectX or wxWidgets.
+ *
+ *  Each test compiles the original source file of uMod and compares its result with a plain reference
+ *  implementation (e.g. the old code) on random input. This header replaces uMod_Main.h of the dll and
+ *  of the GUI: it defines the few Windows types and helpers, which the tested code needs.
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+
+
+typedef unsigned int DWORD32;
+typedef unsigned int DWORD; // 32 bit like on Windows (e.g. the dds header)
+typedef void* HANDLE;
+#define __int64 long long
+
+#define __declspec(x) __declspec_##x
+#define __declspec_align(n) __attribute__((aligned(n)))
+
+#define Message(...)
+
+#include "../uMod_GlobalDefines.h"
+#include "../uMod_Error.h"
+
+extern unsigned int gl_ErrorState;
+
+
+template <class T>
+int GetMemory(T* &array, int num)
+{
+  if (array!=(T*)0) delete [] array;
+  try {array = new T[num];}
+  catch (...) {array = (T*) 0; return -1;}
+  return 0;
+}
+
+template <class T>
+int GetMemory(T* &array, int num, T init)
+{
+  if (array!=(T*)0) delete [] array;
+  try {array = new T[num];}
+  catch (...) {array = (T*) 0; return -1;}
+  for (int i=0; i<num; i++) array[i]=init;
+  return 0;
+}
+
+
+extern unsigned int TestSeed;
+unsigned int TestRandom(void); // xorshift, reproducible for each seed
+void TestFill( unsigned char *buffer, unsigned int len);
+double TestTime(void); // in s, for the benchmarks
+
+#define TEST_CHECK( cond, ...) if (!(cond)) {printf( "  FAILED (%s:%d): ", __FILE__, __LINE__); printf( __VA_ARGS__); printf( "\n"); return (-1);}
+
+// each test returns 0 on success
+int Test_CRC32(void);
+int Test_HashIndex(void);
+int Test_HashPool(void);
+int Test_FrameDecoder(void);
+int Test_MsgReader(void);
+int Test_Duplicates(void);
+int Test_Inflate(void);
+int Test_SharedRegion(void);
+int Test_DDS(void);
+int Test_XOR(void);
+
+int Bench_CRC32(void); // bit serial, slice-by-8 and PCLMULQDQ
+int Bench_HashIndex(void); // against the old binary search at 1k, 10k and 100k entries
+int Bench_FileHandler(void); // adding and removing the textures of a package on the server
+int Bench_FrameDecoder(void); // records over a socketpair
+int Bench_Duplicates(void); // the duplicate sweep against the old nested loops
+int Bench_XOR(void); // decryption of a tpf
+int Bench_Inflate(void); // inflating the dds entries of a package
+int Bench_TextureType(void); // SetTexture() with mock COM objects
+int Bench_CacheModel(void); // model of loading a package without and with uMod_Cache
+int Bench_DDS(void); // parsing a dds file and copying its levels
+int Bench_OverlappedModel(void); // model of reading the pipe serial and overlapped
+int Bench_LoadModel(void); // model of loading the packages with one and with several threads
+int Bench_MergeModel(void); // model of a full update and a delta update of the clients
+
+#endif /* uMod_TEST_H_ */
@@ -0,0 +1,125 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Test.h"
+
+#define uMod_MAIN_H_ // the header of the dll needs the DirectX SDK
+#include "../uMod_DX9/uMod_TextureFunction.cpp"
+
+
+/*
+ *  GetCRC32() (slice-by-8 and PCLMULQDQ folding) must return exactly the value of GetCRC32_BitSerial(),
+ *  otherwise the hashes of existing mods would not match anymore.
+ */
+int Test_CRC32(void)
+{
+  InitCRC32();
+  printf( "  PCLMULQDQ: %d\n", CRC32_UseCLMUL);
+
+  const unsigned int max_len = 1u<<16;
+  unsigned char *buffer = NULL;
+  if (GetMemory( buffer, max_len + 16)) return (-1);
+  TestFill( buffer, max_len + 16);
+
+  // all short lengths (tail handling of both paths) at all alignments
+  for (unsigned int offset=0u; offset<16u; offset++) for (unsigned int len=0u; len<=300u; len++)
+  {
+    char *data = (char*) &buffer[offset];
+    unsigned int crc = GetCRC32( data, len);
+    unsigned int ref = GetCRC32_BitSerial( data, len);
+    TEST_CHECK( crc==ref, "offset %u, length %u: %08x instead of %08x", offset, len, crc, ref);
+  }
+
+  // random lengths and offsets
+  for (int i=0; i<2000; i++)
+  {
+    unsigned int offset = TestRandom() & 15u;
+    unsigned int len = TestRandom() % (max_len + 1u);
+    char *data = (char*) &buffer[offset];
+    unsigned int crc = GetCRC32( data, len);
+    unsigned int ref = GetCRC32_BitSerial( data, len);
+    TEST_CHECK( crc==ref, "offset %u, length %u: %08x instead of %08x", offset, len, crc, ref);
+  }
+
+  // the slice-by-8 path on its own, even if the cpu supports PCLMULQDQ
+  bool clmul = CRC32_UseCLMUL;
+  CRC32_UseCLMUL = false;
+  for (int i=0; i<500; i++)
+  {
+    unsigned int offset = TestRandom() & 15u;
+    unsigned int len = TestRandom() % (max_len + 1u);
+    char *data = (char*) &buffer[offset];
+    unsigned int crc = GetCRC32( data, len);
+    unsigned int ref = GetCRC32_BitSerial( data, len);
+    TEST_CHECK( crc==ref, "slice-by-8, offset %u, length %u: %08x instead of %08x", offset, len, crc, ref);
+  }
+  CRC32_UseCLMUL = clmul;
+
+  delete [] buffer;
+  return (0);
+}
+
+
+/*
+ *  Throughput of the three crc paths (the hash of each texture a game creates is computed on the render thread).
+ *  The bit serial crc is the code before the optimization.
+ */
+static volatile unsigned int CRCSink; // the crc must be used, otherwise the compiler might drop the loops
+
+static double BenchCRC( int path, char *data, unsigned int len, unsigned int &crc)
+{
+  unsigned int runs = (1u<<26) / len; // 64 MB per path and length
+  if (path==0 && runs>16u) runs /= 16u; // the bit serial crc is slow
+  if (runs==0u) runs = 1u;
+  CRC32_UseCLMUL = path==2;
+  double start = TestTime();
+  for (unsigned int i=0u; i<runs; i++) crc += path==0 ? GetCRC32_BitSerial( data, len) : GetCRC32( data, len);
+  double time = TestTime() - start;
+  return ((double) len * runs / time / 1048576.0);
+}
+
+int Bench_CRC32(void)
+{
+  InitCRC32();
+  bool clmul = CRC32_UseCLMUL;
+  const unsigned int max_len = 4u<<20; // a 1024x1024 A8R8G8B8 texture
+  unsigned char *buffer = NULL;
+  if (GetMemory( buffer, max_len)) return (-1);
+  TestFill( buffer, max_len);
+
+  static const unsigned int lengths[] = {64u, 1u<<10, 16u<<10, 256u<<10, 4u<<20};
+  unsigned int crc = 0u;
+  printf( "  %10s %14s %14s %14s\n", "bytes", "bit serial", "slice-by-8", "PCLMULQDQ");
+  for (unsigned int i=0u; i<sizeof(lengths)/sizeof(lengths[0]); i++)
+  {
+    double serial = BenchCRC( 0, (char*) buffer, lengths[i], crc);
+    double slice = BenchCRC( 1, (char*) buffer, lengths[i], crc);
+    if (clmul)
+    {
+      double fold = BenchCRC( 2, (char*) buffer, lengths[i], crc);
+      printf( "  %10u %9.0f MB/s %9.0f MB/s %9.0f MB/s (%.0fx)\n", lengths[i], serial, slice, fold, fold/serial);
+    }
+    else printf( "  %10u %9.0f MB/s %9.0f MB/s %14s (%.0fx)\n", lengths[i], serial, slice, "-", slice/serial);
+  }
+  CRC32_UseCLMUL = clmul;
+  CRCSink = crc;
+  delete [] buffer;
+  return (0);
+}
@@ -0,0 +1,213 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Test.h"
+#include "../uMod_GUI/uMod_Inflate.h"
+
+#include <zlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/*
+ *  Loading a package without and with its cache file (uMod_Cache of the GUI).
+ *  THIS IS A MODEL, it does not run uMod_Cache and uMod_File themselves.
+ *
+ *  uMod_Cache and uMod_File need Windows and wxWidgets, thus this is a model of both paths with the same steps:
+ *  - without cache (first load): the tpf is mapped, decrypted (XOR) and each texture is inflated with uMod_Inflate()
+ *  - with cache (each further load): the cache file is mapped, the header is checked and each texture is copied
+ *  The zip directory is not parsed in the model, thus the first load is rather faster than in uMod.
+ *  Both files are in the page cache of the OS, the time to read them from the disk is not measured.
+ */
+#define BENCH_TEXTURES 64u
+#define BENCH_TEXTURE_SIZE (1u<<20) // 1 MB per texture (e.g. 512x512 A8R8G8B8)
+#define BENCH_RUNS 10
+
+typedef struct
+{
+  unsigned int Magic;
+  unsigned int Number;
+} BenchHeaderStruct;
+
+typedef struct
+{
+  unsigned int Hash;
+  unsigned int Size;
+  unsigned long long Offset;
+} BenchEntryStruct; // same as CacheEntryStruct
+
+
+static void FillTexture( unsigned char *data, unsigned int len)
+{
+  // gradients with some noise, deflate packs it to about two thirds
+  unsigned int base = TestRandom();
+  for (unsigned int i=0u; i<len; i+=4u)
+  {
+    unsigned int x = (i/4u) & 511u;
+    unsigned int y = (i/4u) >> 9;
+    data[i] = (unsigned char) (x + (base & 0xFF));
+    data[i+1] = (unsigned char) (y + (base >> 8));
+    data[i+2] = (unsigned char) ((x ^ y) + (TestRandom() & 7u));
+    data[i+3] = 0xFF;
+  }
+}
+
+static void XORBuffer( unsigned char *data, unsigned int len) // the decryption of a tpf (see uMod_File::XORBuffer())
+{
+  unsigned int i = 0u;
+  for (; i+4u<=len; i+=4u) *((unsigned int*) &data[i]) ^= 0x3FA43FA4u;
+  for (; i<len; i++) data[i] ^= 0xA4;
+}
+
+static int WriteFile( const char *name, const unsigned char *data, unsigned int len)
+{
+  FILE *file = fopen( name, "wb");
+  if (file==NULL) return (-1);
+  int ret = fwrite( data, 1, len, file)==len ? 0 : -1;
+  fclose( file);
+  return (ret);
+}
+
+static unsigned char *MapFile( const char *name, unsigned int &len, bool copy_on_write)
+{
+  int file = open( name, O_RDONLY);
+  if (file<0) return (NULL);
+  struct stat info;
+  if (fstat( file, &info)) {close( file); return (NULL);}
+  len = (unsigned int) info.st_size;
+  void *view = mmap( NULL, len, copy_on_write ? PROT_READ|PROT_WRITE : PROT_READ, copy_on_write ? MAP_PRIVATE : MAP_SHARED, file, 0);
+  close( file); // the mapping keeps the file open
+  return (view==MAP_FAILED ? NULL : (unsigned char*) view);
+}
+
+int Bench_CacheModel(void)
+{
+  char package_name[] = "/tmp/uMod_Bench_package.XXXXXX";
+  char cache_name[] = "/tmp/uMod_Bench_cache.XXXXXX";
+  int fd = mkstemp( package_name);
+  if (fd<0) return (-1);
+  close( fd);
+  fd = mkstemp( cache_name);
+  if (fd<0) {unlink( package_name); return (-1);}
+  close( fd);
+
+  // the package: BenchEntryStruct[] (Size is the packed size), deflate streams, the whole file is XORed
+  // the cache: BenchHeaderStruct, BenchEntryStruct[], textures
+  unsigned int max_packed = (unsigned int) compressBound( BENCH_TEXTURE_SIZE);
+  unsigned int package_size = BENCH_TEXTURES * (sizeof(BenchEntryStruct) + max_packed);
+  unsigned int cache_size = sizeof(BenchHeaderStruct) + BENCH_TEXTURES * (sizeof(BenchEntryStruct) + BENCH_TEXTURE_SIZE);
+  unsigned char *package = NULL;
+  unsigned char *cache = NULL;
+  unsigned char *texture = NULL;
+  if (GetMemory( package, package_size) || GetMemory( cache, cache_size) || GetMemory( texture, BENCH_TEXTURE_SIZE)) return (-1);
+
+  BenchEntryStruct *package_entries = (BenchEntryStruct*) package;
+  BenchHeaderStruct *cache_header = (BenchHeaderStruct*) cache;
+  BenchEntryStruct *cache_entries = (BenchEntryStruct*) &cache[sizeof(BenchHeaderStruct)];
+  cache_header->Magic = 0x43446D75u;
+  cache_header->Number = BENCH_TEXTURES;
+  unsigned long long package_pos = BENCH_TEXTURES * sizeof(BenchEntryStruct);
+  unsigned long long cache_pos = sizeof(BenchHeaderStruct) + BENCH_TEXTURES * sizeof(BenchEntryStruct);
+  for (unsigned int i=0u; i<BENCH_TEXTURES; i++)
+  {
+    FillTexture( texture, BENCH_TEXTURE_SIZE);
+    z_stream stream;
+    memset( &stream, 0, sizeof(stream));
+    if (deflateInit2( &stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY)!=Z_OK) return (-1);
+    stream.next_in = texture;
+    stream.avail_in = BENCH_TEXTURE_SIZE;
+    stream.next_out = &package[package_pos];
+    stream.avail_out = max_packed;
+    if (deflate( &stream, Z_FINISH)!=Z_STREAM_END) {deflateEnd( &stream); return (-1);}
+    package_entries[i].Hash = i;
+    package_entries[i].Size = (unsigned int) stream.total_out;
+    package_entries[i].Offset = package_pos;
+    package_pos += stream.total_out;
+    deflateEnd( &stream);
+
+    cache_entries[i].Hash = i;
+    cache_entries[i].Size = BENCH_TEXTURE_SIZE;
+    cache_entries[i].Offset = cache_pos;
+    memcpy( &cache[cache_pos], texture, BENCH_TEXTURE_SIZE);
+    cache_pos += BENCH_TEXTURE_SIZE;
+  }
+  XORBuffer( package, (unsigned int) package_pos);
+  if (WriteFile( package_name, package, (unsigned int) package_pos) || WriteFile( cache_name, cache, cache_size))
+  {
+    unlink( package_name);
+    unlink( cache_name);
+    return (-1);
+  }
+  delete [] package;
+  delete [] cache;
+  delete [] texture;
+  printf( "  model of uMod_Cache and uMod_File (the real classes need Windows and wxWidgets)\n");
+  printf( "  %u textures of %u KB, package %llu KB, cache file %u KB\n", BENCH_TEXTURES, BENCH_TEXTURE_SIZE>>10, package_pos>>10, cache_size>>10);
+
+  unsigned char *textures[BENCH_TEXTURES];
+  double best_cold = 1e30, best_warm = 1e30;
+  for (int run=0; run<BENCH_RUNS; run++)
+  {
+    // without cache
+    double start = TestTime();
+    unsigned int len;
+    unsigned char *view = MapFile( package_name, len, true);
+    if (view==NULL) break;
+    XORBuffer( view, len);
+    BenchEntryStruct *entries = (BenchEntryStruct*) view;
+    for (unsigned int i=0u; i<BENCH_TEXTURES; i++)
+    {
+      textures[i] = NULL;
+      if (GetMemory( textures[i], BENCH_TEXTURE_SIZE)) return (-1);
+      if (uMod_Inflate( &view[entries[i].Offset], entries[i].Size, textures[i], BENCH_TEXTURE_SIZE)!=(int) BENCH_TEXTURE_SIZE) {printf( "  inflate failed\n"); return (-1);}
+    }
+    munmap( view, len);
+    double time = TestTime() - start;
+    if (time<best_cold) best_cold = time;
+    for (unsigned int i=0u; i<BENCH_TEXTURES; i++) delete [] textures[i];
+
+    // with cache
+    start = TestTime();
+    view = MapFile( cache_name, len, false);
+    if (view==NULL) break;
+    BenchHeaderStruct *header = (BenchHeaderStruct*) view;
+    entries = (BenchEntryStruct*) &view[sizeof(BenchHeaderStruct)];
+    if (header->Magic!=0x43446D75u || header->Number!=BENCH_TEXTURES) {printf( "  invalid cache file\n"); return (-1);}
+    for (unsigned int i=0u; i<BENCH_TEXTURES; i++)
+    {
+      if (entries[i].Offset + entries[i].Size > len) {printf( "  truncated cache file\n"); return (-1);}
+      textures[i] = NULL;
+      if (GetMemory( textures[i], entries[i].Size)) return (-1);
+      memcpy( textures[i], &view[entries[i].Offset], entries[i].Size);
+    }
+    munmap( view, len);
+    time = TestTime() - start;
+    if (time<best_warm) best_warm = time;
+    for (unsigned int i=0u; i<BENCH_TEXTURES; i++) delete [] textures[i];
+  }
+  unlink( package_name);
+  unlink( cache_name);
+
+  printf( "  without cache: %8.2f ms\n", best_cold * 1e3);
+  printf( "  with cache:    %8.2f ms (%.1fx faster)\n", best_warm * 1e3, best_cold / best_warm);
+  return (0);
+}
@@ -0,0 +1,399 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Test.h"
+#include "d3d9types.h"
+
+#define uMod_MAIN_H_ // the header of the dll needs the DirectX SDK
+#include "../uMod_DX9/uMod_DDS.h"
+#include "../uMod_DX9/uMod_DDS.cpp"
+
+
+/*
+ *  uMod_ParseDDS() on dds files, which are built in memory (fixtures): all supported formats, full and partial
+ *  mipmap chains, cube and volume textures. Malformed and truncated files must be rejected, and for a file, which
+ *  is accepted, each level must lie inside the file (also if the header was damaged at random).
+ *  The generated levels are compared with a plain box filter.
+ */
+
+typedef struct
+{
+  const char *Name;
+  DWORD Flags; // of the pixel format
+  DWORD FourCC;
+  DWORD Bits;
+  DWORD Mask[4]; // r, g, b, a
+  D3DFORMAT Format; // expected result
+  unsigned int Bytes; // per pixel or per 4x4 block
+  bool Compressed;
+} FixtureFormat;
+
+static const FixtureFormat Formats[] =
+{
+  {"A8R8G8B8", DDPF_RGB | DDPF_ALPHAPIXELS, 0, 32, {0xFF0000, 0xFF00, 0xFF, 0xFF000000}, D3DFMT_A8R8G8B8, 4u, false},
+  {"X8R8G8B8", DDPF_RGB, 0, 32, {0xFF0000, 0xFF00, 0xFF, 0xFF000000}, D3DFMT_X8R8G8B8, 4u, false},
+  {"A8B8G8R8", DDPF_RGB | DDPF_ALPHAPIXELS, 0, 32, {0xFF, 0xFF00, 0xFF0000, 0xFF000000}, D3DFMT_A8B8G8R8, 4u, false},
+  {"R8G8B8", DDPF_RGB, 0, 24, {0xFF0000, 0xFF00, 0xFF, 0}, D3DFMT_R8G8B8, 3u, false},
+  {"R5G6B5", DDPF_RGB, 0, 16, {0xF800, 0x7E0, 0x1F, 0}, D3DFMT_R5G6B5, 2u, false},
+  {"A1R5G5B5", DDPF_RGB | DDPF_ALPHAPIXELS, 0, 16, {0x7C00, 0x3E0, 0x1F, 0x8000}, D3DFMT_A1R5G5B5, 2u, false},
+  {"A4R4G4B4", DDPF_RGB | DDPF_ALPHAPIXELS, 0, 16, {0xF00, 0xF0, 0xF, 0xF000}, D3DFMT_A4R4G4B4, 2u, false},
+  {"L8", DDPF_LUMINANCE, 0, 8, {0xFF, 0, 0, 0}, D3DFMT_L8, 1u, false},
+  {"A8L8", DDPF_LUMINANCE | DDPF_ALPHAPIXELS, 0, 16, {0xFF, 0, 0, 0xFF00}, D3DFMT_A8L8, 2u, false},
+  {"L16", DDPF_LUMINANCE, 0, 16, {0xFFFF, 0, 0, 0}, D3DFMT_L16, 2u, false},
+  {"A8", DDPF_ALPHA, 0, 8, {0, 0, 0, 0xFF}, D3DFMT_A8, 1u, false},
+  {"DXT1", DDPF_FOURCC, D3DFMT_DXT1, 0, {0, 0, 0, 0}, D3DFMT_DXT1, 8u, true},
+  {"DXT3", DDPF_FOURCC, D3DFMT_DXT3, 0, {0, 0, 0, 0}, D3DFMT_DXT3, 16u, true},
+  {"DXT5", DDPF_FOURCC, D3DFMT_DXT5, 0, {0, 0, 0, 0}, D3DFMT_DXT5, 16u, true},
+  {"A16B16G16R16F", DDPF_FOURCC, D3DFMT_A16B16G16R16F, 0, {0, 0, 0, 0}, D3DFMT_A16B16G16R16F, 8u, false},
+  {"R32F", DDPF_FOURCC, D3DFMT_R32F, 0, {0, 0, 0, 0}, D3DFMT_R32F, 4u, false},
+  {"A32B32G32R32F", DDPF_FOURCC, D3DFMT_A32B32G32R32F, 0, {0, 0, 0, 0}, D3DFMT_A32B32G32R32F, 16u, false},
+};
+#define NUMBER_OF_FORMATS (sizeof(Formats)/sizeof(Formats[0]))
+
+#define FIXTURE_2D 0
+#define FIXTURE_CUBE 1
+#define FIXTURE_VOLUME 2
+
+static unsigned int FullChain( UINT width, UINT height, UINT depth)
+{
+  UINT max = width>height ? width : height;
+  if (depth>max) max = depth;
+  unsigned int levels = 1u;
+  for (; max>1u; max/=2u) levels++;
+  return (levels);
+}
+
+static unsigned long long LevelSize( const FixtureFormat &format, UINT width, UINT height, UINT depth, unsigned int level)
+{
+  UINT w = width>>level, h = height>>level, d = depth>>level;
+  if (w==0u) w = 1u;
+  if (h==0u) h = 1u;
+  if (d==0u) d = 1u;
+  if (format.Compressed) return ((unsigned long long) ((w+3u)/4u) * ((h+3u)/4u) * format.Bytes * d);
+  return ((unsigned long long) w * h * d * format.Bytes);
+}
+
+// returns the size of the fixture, mip_count==0 omits DDSD_MIPMAPCOUNT, file==NULL only calculates the size
+static unsigned int MakeFixture( char *file, const FixtureFormat &format, int type, UINT width, UINT height, UINT depth, unsigned int mip_count)
+{
+  unsigned int in_file = mip_count>0u ? mip_count : 1u;
+  unsigned int levels = FullChain( width, height, type==FIXTURE_VOLUME ? depth : 1u);
+  if (in_file>levels) in_file = levels;
+  unsigned int faces = type==FIXTURE_CUBE ? 6u : 1u;
+  unsigned long long size = 4u + sizeof(uMod_DDSHeader);
+  for (unsigned int f=0u; f<faces; f++) for (unsigned int l=0u; l<in_file; l++)
+    size += LevelSize( format, width, height, type==FIXTURE_VOLUME ? depth : 1u, l);
+  if (file==NULL) return ((unsigned int) size);
+
+  memset( file, 0, 4u + sizeof(uMod_DDSHeader));
+  *(DWORD*) file = DDS_MAGIC;
+  uMod_DDSHeader *header = (uMod_DDSHeader*) (file + 4);
+  header->Size = sizeof(uMod_DDSHeader);
+  header->Flags = 0x1007; // caps, height, width, pixel format
+  if (mip_count>0u) header->Flags |= DDSD_MIPMAPCOUNT;
+  header->Width = width;
+  header->Height = height;
+  header->MipMapCount = mip_count;
+  header->PFSize = 32u;
+  header->PFFlags = format.Flags;
+  header->FourCC = format.FourCC;
+  header->RGBBitCount = format.Bits;
+  header->RBitMask = format.Mask[0];
+  header->GBitMask = format.Mask[1];
+  header->BBitMask = format.Mask[2];
+  header->ABitMask = format.Mask[3];
+  header->Caps = 0x1000;
+  if (type==FIXTURE_CUBE) header->Caps2 = DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_ALLFACES;
+  if (type==FIXTURE_VOLUME)
+  {
+    header->Flags |= DDSD_DEPTH;
+    header->Depth = depth;
+    header->Caps2 = DDSCAPS2_VOLUME;
+  }
+  TestFill( (unsigned char*) file + 4u + sizeof(uMod_DDSHeader), (unsigned int) size - 4u - sizeof(uMod_DDSHeader));
+  return ((unsigned int) size);
+}
+
+// each level of an accepted file must lie inside the file
+static bool InsideFile( const char *file, unsigned int size, const uMod_DDSLayout &layout)
+{
+  if (layout.Levels==0u || layout.Levels>uMod_DDS_MAX_LEVELS || layout.InFile==0u || layout.InFile>layout.Levels) return (false);
+  for (UINT f=0u; f<layout.Faces; f++) for (UINT l=0u; l<layout.InFile; l++)
+  {
+    unsigned long long level_size = (unsigned long long) layout.Pitch[l]*layout.Rows[l]*layout.Slices[l];
+    if (layout.Bits[f][l]<file+4u+sizeof(uMod_DDSHeader) || layout.Bits[f][l]>file+size) return (false);
+    if (level_size > (unsigned long long) (file+size-layout.Bits[f][l])) return (false);
+  }
+  return (true);
+}
+
+static int CheckLayout( const char *file, unsigned int size, const uMod_DDSLayout &layout, const FixtureFormat &format, int type, UINT width, UINT height, UINT depth, unsigned int in_file)
+{
+  UINT d = type==FIXTURE_VOLUME ? depth : 1u;
+  unsigned int faces = type==FIXTURE_CUBE ? 6u : 1u;
+  int expected_type = type==FIXTURE_CUBE ? uMod_DDS_CUBE_TEXTURE : (type==FIXTURE_VOLUME ? uMod_DDS_VOLUME_TEXTURE : uMod_DDS_TEXTURE);
+  TEST_CHECK( layout.Type==expected_type, "%s %ux%ux%u: type %d instead of %d", format.Name, width, height, d, layout.Type, expected_type);
+  TEST_CHECK( layout.Format==format.Format, "%s: format %d", format.Name, (int) layout.Format);
+  TEST_CHECK( layout.Width==width && layout.Height==height && layout.Depth==d, "%s: size %ux%ux%u", format.Name, layout.Width, layout.Height, layout.Depth);
+  TEST_CHECK( layout.Levels==FullChain( width, height, d), "%s %ux%ux%u: %u levels", format.Name, width, height, d, layout.Levels);
+  TEST_CHECK( layout.InFile==in_file, "%s: %u levels in the file instead of %u", format.Name, layout.InFile, in_file);
+  TEST_CHECK( layout.Faces==faces, "%s: %u faces", format.Name, layout.Faces);
+
+  const char *pos = file + 4u + sizeof(uMod_DDSHeader); // faces one after another, each with all its levels
+  for (unsigned int f=0u; f<faces; f++) for (unsigned int l=0u; l<layout.Levels; l++)
+  {
+    unsigned long long level_size = LevelSize( format, width, height, d, l);
+    TEST_CHECK( (unsigned long long) layout.Pitch[l]*layout.Rows[l]*layout.Slices[l]==level_size, "%s %ux%ux%u level %u: wrong size", format.Name, width, height, d, l);
+    if (l>=in_file) continue;
+    TEST_CHECK( layout.Bits[f][l]==pos, "%s %ux%ux%u face %u level %u: wrong offset", format.Name, width, height, d, f, l);
+    pos += level_size;
+  }
+  TEST_CHECK( pos==file+size, "%s: the levels do not fill the file", format.Name);
+  return (0);
+}
+
+// plain box filter (D3DX_DEFAULT) for 4 bytes per pixel, a dimension of 1 is clamped
+static void ReferenceBoxFilter( const unsigned char *src, UINT width, UINT height, unsigned char *dst)
+{
+  UINT w = width>1u ? width/2u : 1u;
+  UINT h = height>1u ? height/2u : 1u;
+  for (UINT y=0u; y<h; y++) for (UINT x=0u; x<w; x++) for (UINT c=0u; c<4u; c++)
+  {
+    UINT x0 = 2u*x < width ? 2u*x : width-1u, x1 = 2u*x+1u < width ? 2u*x+1u : width-1u;
+    UINT y0 = 2u*y < height ? 2u*y : height-1u, y1 = 2u*y+1u < height ? 2u*y+1u : height-1u;
+    unsigned int sum = src[(y0*width+x0)*4u+c] + src[(y0*width+x1)*4u+c] + src[(y1*width+x0)*4u+c] + src[(y1*width+x1)*4u+c];
+    dst[(y*w+x)*4u+c] = (unsigned char) ((sum + 2u) >> 2);
+  }
+}
+
+static int ParseFixture( char *file, unsigned int size, uMod_DDSLayout &layout)
+{
+  memset( &layout, 0, sizeof(uMod_DDSLayout));
+  return (uMod_ParseDDS( file, size, layout));
+}
+
+int Test_DDS(void)
+{
+  static const UINT sizes[][3] = {{1,1,1}, {4,2,2}, {2,8,1}, {256,64,4}, {8,512,16}, {64,64,64}};
+  const unsigned int max_size = 4u<<20;
+  char *file = NULL;
+  if (GetMemory( file, max_size)) return (-1);
+  uMod_DDSLayout layout;
+
+  // all formats with the full chain
+  for (unsigned int i=0u; i<NUMBER_OF_FORMATS; i++) for (unsigned int s=0u; s<sizeof(sizes)/sizeof(sizes[0]); s++) for (int type=FIXTURE_2D; type<=FIXTURE_VOLUME; type++)
+  {
+    const FixtureFormat &format = Formats[i];
+    UINT w = sizes[s][0], h = sizes[s][1], d = sizes[s][2];
+    if (type==FIXTURE_CUBE) h = w;
+    unsigned int levels = FullChain( w, h, type==FIXTURE_VOLUME ? d : 1u);
+    unsigned int size = MakeFixture( NULL, format, type, w, h, d, levels);
+    if (size>max_size) continue;
+    MakeFixture( file, format, type, w, h, d, levels);
+    TEST_CHECK( ParseFixture( file, size, layout)==RETURN_OK, "%s %ux%ux%u (type %d) is rejected", format.Name, w, h, d, type);
+    if (CheckLayout( file, size, layout, format, type, w, h, d, levels)) return (-1);
+
+    // more levels than the full chain are ignored, bytes behind the levels too
+    MakeFixture( file, format, type, w, h, d, levels+3u);
+    TEST_CHECK( ParseFixture( file, size+17u, layout)==RETURN_OK, "%s: a longer file is rejected", format.Name);
+    if (CheckLayout( file, size, layout, format, type, w, h, d, levels)) return (-1);
+  }
+
+  // partial chains: only 2D textures with 4 bytes per pixel (8 bits per channel) are completed
+  for (unsigned int i=0u; i<NUMBER_OF_FORMATS; i++) for (int type=FIXTURE_2D; type<=FIXTURE_VOLUME; type++)
+  {
+    const FixtureFormat &format = Formats[i];
+    UINT w = 64u, h = type==FIXTURE_CUBE ? 64u : 32u, d = 8u;
+    unsigned int levels = FullChain( w, h, type==FIXTURE_VOLUME ? d : 1u);
+    bool generated = type==FIXTURE_2D && format.Bytes==4u && !format.Compressed && format.Format!=D3DFMT_R32F;
+    for (unsigned int mip_count=0u; mip_count<levels; mip_count++)
+    {
+      unsigned int in_file = mip_count>0u ? mip_count : 1u;
+      unsigned int size = MakeFixture( file, format, type, w, h, d, mip_count);
+      int ret = ParseFixture( file, size, layout);
+      if (!generated) {TEST_CHECK( ret!=RETURN_OK, "%s (type %d) with %u of %u levels is accepted", format.Name, type, in_file, levels); continue;}
+      TEST_CHECK( ret==RETURN_OK, "%s with %u of %u levels is rejected", format.Name, in_file, levels);
+      if (CheckLayout( file, size, layout, format, type, w, h, d, in_file)) return (-1);
+
+      unsigned int staging_size = 0u;
+      for (unsigned int l=in_file; l<levels; l++) staging_size += (unsigned int) LevelSize( format, w, h, 1u, l);
+      TEST_CHECK( uMod_GetStagingSize( layout)==staging_size, "%s: staging size %u instead of %u", format.Name, uMod_GetStagingSize( layout), staging_size);
+      unsigned char *staging = NULL, *expected = NULL;
+      if (GetMemory( staging, staging_size+1u) || GetMemory( expected, w*h*4u)) return (-1);
+      uMod_GenerateMipMaps( layout, (char*) staging);
+      for (unsigned int l=in_file; l<levels; l++)
+      {
+        UINT pw = w>>(l-1u), ph = h>>(l-1u);
+        ReferenceBoxFilter( (unsigned char*) layout.Bits[0][l-1u], pw>0u ? pw : 1u, ph>0u ? ph : 1u, expected);
+        TEST_CHECK( memcmp( layout.Bits[0][l], expected, (size_t) LevelSize( format, w, h, 1u, l))==0, "%s: generated level %u differs from the box filter", format.Name, l);
+      }
+      delete [] staging;
+      delete [] expected;
+    }
+  }
+
+  // truncated files: each prefix must be rejected
+  {
+    const FixtureFormat &dxt1 = Formats[11], &argb = Formats[0], &l8 = Formats[7];
+    const FixtureFormat *format[3] = {&dxt1, &argb, &l8};
+    for (int type=FIXTURE_2D; type<=FIXTURE_VOLUME; type++)
+    {
+      unsigned int levels = FullChain( 16u, 16u, type==FIXTURE_VOLUME ? 4u : 1u);
+      unsigned int size = MakeFixture( file, *format[type], type, 16u, 16u, 4u, levels);
+      for (unsigned int len=0u; len<size; len++)
+      {
+        char *copy = NULL; // exactly len bytes, thus a read behind the end is found by valgrind or ASan
+        if (GetMemory( copy, len>0u ? len : 1u)) return (-1);
+        memcpy( copy, file, len);
+        TEST_CHECK( ParseFixture( copy, len, layout)!=RETURN_OK, "%s (type %d) truncated to %u of %u bytes is accepted", format[type]->Name, type, len, size);
+        delete [] copy;
+      }
+      TEST_CHECK( ParseFixture( file, size, layout)==RETURN_OK, "%s (type %d) is rejected", format[type]->Name, type);
+    }
+  }
+
+  // malformed headers
+  {
+    const FixtureFormat &argb = Formats[0];
+    unsigned int size = MakeFixture( file, argb, FIXTURE_2D, 16u, 16u, 1u, 5u);
+    uMod_DDSHeader *header = (uMod_DDSHeader*) (file + 4);
+    TEST_CHECK( uMod_ParseDDS( NULL, size, layout)!=RETURN_OK, "NULL is accepted");
+    TEST_CHECK( ParseFixture( file, 4u+sizeof(uMod_DDSHeader)-1u, layout)!=RETURN_OK, "a short header is accepted");
+
+    #define MALFORMED( field, value, what) \
+    { \
+      MakeFixture( file, argb, FIXTURE_2D, 16u, 16u, 1u, 5u); \
+      field = value; \
+      TEST_CHECK( ParseFixture( file, size, layout)!=RETURN_OK, "%s is accepted", what); \
+    }
+    MALFORMED( *(DWORD*) file, 0x20534443, "a wrong magic")
+    MALFORMED( header->Size, 100u, "a wrong header size")
+    MALFORMED( header->PFSize, 0u, "a wrong pixel format size")
+    MALFORMED( header->Width, 0u, "a width of 0")
+    MALFORMED( header->Height, 0u, "a height of 0")
+    MALFORMED( header->Width, 12u, "a width, which is not a power of two")
+    MALFORMED( header->Height, 17u, "a height, which is not a power of two")
+    MALFORMED( header->RBitMask, 0xFF, "an unknown bit mask")
+    MALFORMED( header->RGBBitCount, 64u, "an unknown bit count")
+    MALFORMED( header->PFFlags, 0u, "an unknown pixel format")
+    MALFORMED( header->Width, 1u<<16, "more than uMod_DDS_MAX_LEVELS levels")
+    MALFORMED( header->Caps2, DDSCAPS2_CUBEMAP | 0x0400, "a cube texture with a single face")
+    MALFORMED( header->Height, 8u; header->Caps2 = DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_ALLFACES, "a cube texture, which is not square")
+    MALFORMED( header->Flags |= DDSD_DEPTH; header->Caps2 = DDSCAPS2_VOLUME; header->Depth, 0u, "a depth of 0")
+    MALFORMED( header->Flags |= DDSD_DEPTH; header->Caps2 = DDSCAPS2_VOLUME; header->Depth, 3u, "a depth, which is not a power of two")
+    MALFORMED( header->PFFlags = DDPF_FOURCC; header->FourCC, MAKEFOURCC('A','T','I','2'), "an unknown FourCC")
+    #undef MALFORMED
+
+    // the size of level 0 exceeds 32 bits (32768 x 32768 x 4 bytes), the missing levels would be generated from it
+    MakeFixture( file, argb, FIXTURE_2D, 16u, 16u, 1u, 1u);
+    header->Width = 1u<<15;
+    header->Height = 1u<<15;
+    TEST_CHECK( ParseFixture( file, size, layout)!=RETURN_OK, "a level of 4 GB in a file of %u bytes is accepted", size);
+
+    // a volume without DDSD_DEPTH is a 2D texture
+    size = MakeFixture( file, argb, FIXTURE_VOLUME, 16u, 16u, 1u, 5u);
+    header->Flags &= ~DDSD_DEPTH;
+    TEST_CHECK( ParseFixture( file, size, layout)==RETURN_OK && layout.Type==uMod_DDS_TEXTURE, "a volume without DDSD_DEPTH is not a 2D texture");
+  }
+
+  // damaged headers: whatever is accepted must lie inside the file
+  for (int round=0; round<20000; round++)
+  {
+    const FixtureFormat &format = Formats[TestRandom() % NUMBER_OF_FORMATS];
+    int type = (int) (TestRandom() % 3u);
+    UINT w = 1u << (TestRandom() % 7u), h = type==FIXTURE_CUBE ? w : 1u << (TestRandom() % 7u), d = 1u << (TestRandom() % 4u);
+    unsigned int size = MakeFixture( file, format, type, w, h, d, TestRandom() % 9u);
+    for (int n=TestRandom() % 4u; n>=0; n--)
+    {
+      unsigned int pos = TestRandom() % (4u + sizeof(uMod_DDSHeader));
+      if (TestRandom() & 1u) file[pos] ^= (char) (1u << (TestRandom() % 8u));
+      else file[pos] = (char) TestRandom();
+    }
+    if (TestRandom() & 1u) size -= TestRandom() % (size+1u);
+    if (ParseFixture( file, size, layout)==RETURN_OK)
+    {
+      TEST_CHECK( InsideFile( file, size, layout), "round %d: a level of a damaged file lies outside of the file", round);
+    }
+  }
+
+  delete [] file;
+  return (0);
+}
+
+
+/*
+ *  A texture is created from a dds file without D3DX: the file is parsed, missing levels are generated and each level
+ *  is copied into the locked texture (uMod_CopyRows()). The locked texture is modelled by a buffer, whose pitch is
+ *  either the pitch of the file (a single memcpy per level) or padded (a memcpy per row).
+ */
+static int BenchFile( const char *name, const FixtureFormat &format, UINT size, unsigned int mip_count)
+{
+  unsigned int levels = FullChain( size, size, 1u);
+  unsigned int file_size = MakeFixture( NULL, format, FIXTURE_2D, size, size, 1u, mip_count);
+  char *file = NULL, *texture = NULL, *staging = NULL;
+  unsigned int texture_size = 0u;
+  for (unsigned int l=0u; l<levels; l++) texture_size += (unsigned int) LevelSize( format, size, size, 1u, l) + 256u*((size>>l)+1u);
+  if (GetMemory( file, file_size) || GetMemory( texture, texture_size) || GetMemory( staging, file_size)) return (-1);
+  MakeFixture( file, format, FIXTURE_2D, size, size, 1u, mip_count);
+
+  double best_parse = 1e30, best_copy[2] = {1e30, 1e30};
+  unsigned int copied = 0u;
+  for (int run=0; run<10; run++)
+  {
+    uMod_DDSLayout layout;
+    double start = TestTime();
+    if (uMod_ParseDDS( file, file_size, layout)!=RETURN_OK) {printf( "  %s is rejected\n", name); return (-1);}
+    if (uMod_GetStagingSize( layout)>file_size) {printf( "  staging is too small\n"); return (-1);}
+    if (layout.InFile<layout.Levels) uMod_GenerateMipMaps( layout, staging);
+    double time = TestTime() - start;
+    if (time<best_parse) best_parse = time;
+
+    for (int padded=0; padded<2; padded++)
+    {
+      start = TestTime();
+      char *dst = texture;
+      copied = 0u;
+      for (UINT l=0u; l<layout.Levels; l++)
+      {
+        int dst_pitch = (int) layout.Pitch[l] + (padded ? 256 : 0);
+        uMod_CopyRows( layout.Bits[0][l], layout.Pitch[l], layout.Rows[l], dst, dst_pitch);
+        dst += dst_pitch * layout.Rows[l];
+        copied += layout.Pitch[l] * layout.Rows[l];
+      }
+      time = TestTime() - start;
+      if (time<best_copy[padded]) best_copy[padded] = time;
+    }
+  }
+  printf( "  %-28s parse%s %8.3f ms, copy %8.3f ms (%6.0f MB/s), padded rows %8.3f ms (%6.0f MB/s)\n", name,
+          mip_count<levels ? "+mipmaps" : "        ", best_parse*1e3, best_copy[0]*1e3, copied/best_copy[0]/1048576.0, best_copy[1]*1e3, copied/best_copy[1]/1048576.0);
+  delete [] file;
+  delete [] texture;
+  delete [] staging;
+  return (0);
+}
+
+int Bench_DDS(void)
+{
+  if (BenchFile( "A8R8G8B8 2048x2048", Formats[0], 2048u, 12u)) return (-1);
+  if (BenchFile( "A8R8G8B8 2048x2048 level 0", Formats[0], 2048u, 1u)) return (-1);
+  if (BenchFile( "DXT5 2048x2048", Formats[13], 2048u, 12u)) return (-1);
+  if (BenchFile( "DXT1 256x256", Formats[11], 256u, 9u)) return (-1);
+  return (0);
+}
@@ -0,0 +1,126 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Test.h"
+#include "../uMod_GUI/uMod_Duplicates.h"
+
+
+/*
+ *  uMod_MarkDuplicates() replaced these nested loops in uMod_Sender::SendTextures(),
+ *  a texture is a duplicate, if the same hash is found in an earlier package or earlier in the same package.
+ */
+typedef struct
+{
+  unsigned int Num;
+  unsigned long *Hash;
+} TestPackageStruct; // the members of AddTextureClass, which are used by uMod_MarkDuplicates()
+
+static bool NestedLoops( unsigned int num, TestPackageStruct *tex, unsigned int i, unsigned int j)
+{
+  bool hit = false;
+  unsigned long temp_hash = tex[i].Hash[j];
+  for (unsigned int ii=0u; ii<i && !hit; ii++) for (unsigned int jj=0u; jj<tex[ii].Num && !hit; jj++) if (temp_hash==tex[ii].Hash[jj]) hit=true;
+  for (unsigned int jj=0u; jj<j && !hit; jj++) if (temp_hash==tex[i].Hash[jj]) hit=true;
+  return (hit);
+}
+
+int Test_Duplicates(void)
+{
+  const unsigned int max_packages = 32u;
+  TestPackageStruct tex[max_packages];
+
+  for (int round=0; round<300; round++)
+  {
+    unsigned int num = TestRandom() % (max_packages + 1u);
+    unsigned int range = 1u + (TestRandom() % 2000u); // a small range gives many duplicates
+    for (unsigned int i=0u; i<num; i++)
+    {
+      tex[i].Num = (TestRandom() % 4u)==0u ? 0u : TestRandom() % 200u; // some packages are empty
+      tex[i].Hash = NULL;
+      if (GetMemory( tex[i].Hash, tex[i].Num>0u ? tex[i].Num : 1u)) return (-1);
+      for (unsigned int j=0u; j<tex[i].Num; j++)
+      {
+        unsigned long hash = TestRandom() % range;
+        if (TestRandom() & 1u) hash <<= 20; // clustered hashes
+        tex[i].Hash[j] = hash;
+      }
+    }
+
+    bool *duplicate = NULL;
+    TEST_CHECK( uMod_MarkDuplicates( num, tex, duplicate)==0, "uMod_MarkDuplicates() failed");
+    unsigned int pos = 0u;
+    for (unsigned int i=0u; i<num; pos+=tex[i].Num, i++) for (unsigned int j=0u; j<tex[i].Num; j++)
+    {
+      bool hit = NestedLoops( num, tex, i, j);
+      TEST_CHECK( duplicate[pos+j]==hit, "package %u, texture %u (hash %lx): %d instead of %d", i, j, tex[i].Hash[j], duplicate[pos+j], hit);
+    }
+    delete [] duplicate;
+    for (unsigned int i=0u; i<num; i++) delete [] tex[i].Hash;
+  }
+  return (0);
+}
+
+
+/*
+ *  Scaling of the duplicate sweep against the nested loops of the old SendTextures(): 30 packages with 1k up to
+ *  50k textures in total, the hashes are drawn from a small range, thus about a third of the textures are duplicates.
+ */
+int Bench_Duplicates(void)
+{
+  const unsigned int packages = 30u;
+  static const unsigned int totals[] = {1000u, 5000u, 10000u, 50000u};
+  TestPackageStruct tex[packages];
+
+  for (unsigned int t=0u; t<sizeof(totals)/sizeof(totals[0]); t++)
+  {
+    unsigned int range = totals[t] * 10u / 9u;
+    for (unsigned int i=0u; i<packages; i++)
+    {
+      tex[i].Num = totals[t] / packages;
+      tex[i].Hash = NULL;
+      if (GetMemory( tex[i].Hash, tex[i].Num)) return (-1);
+      for (unsigned int j=0u; j<tex[i].Num; j++) tex[i].Hash[j] = TestRandom() % range;
+    }
+
+    double start = TestTime();
+    unsigned int old_duplicates = 0u;
+    for (unsigned int i=0u; i<packages; i++) for (unsigned int j=0u; j<tex[i].Num; j++) if (NestedLoops( packages, tex, i, j)) old_duplicates++;
+    double time_old = TestTime() - start;
+
+    double time_new = 1e30;
+    unsigned int new_duplicates = 0u;
+    for (int run=0; run<10; run++)
+    {
+      bool *duplicate = NULL;
+      start = TestTime();
+      TEST_CHECK( uMod_MarkDuplicates( packages, tex, duplicate)==0, "uMod_MarkDuplicates() failed");
+      double time = TestTime() - start;
+      if (time<time_new) time_new = time;
+      new_duplicates = 0u;
+      for (unsigned int k=0u; k<packages*(totals[t]/packages); k++) if (duplicate[k]) new_duplicates++;
+      delete [] duplicate;
+    }
+    TEST_CHECK( new_duplicates==old_duplicates, "%u duplicates instead of %u", new_duplicates, old_duplicates);
+    printf( "  %6u textures (%5u duplicates): nested loops %9.2f ms, uMod_MarkDuplicates() %6.3f ms (%.0fx faster)\n",
+            packages*(totals[t]/packages), new_duplicates, time_old*1e3, time_new*1e3, time_old/time_new);
+    for (unsigned int i=0u; i<packages; i++) delete [] tex[i].Hash;
+  }
+  return (0);
+}
@@ -0,0 +1,120 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Test.h"
+#include "uMod_Win32.h"
+
+#define uMod_MAIN_H_ // the header of the dll needs the DirectX SDK
+#define uMod_IDirect3DTexture9_H // only the pointer to IDirect3DBaseTexture9 is needed
+class IDirect3DBaseTexture9;
+#include "../uMod_DX9/uMod_ArrayHandler.h"
+#include "../uMod_DX9/uMod_ArrayHandler.cpp"
+
+
+/*
+ *  Loading, unloading and loading again a package on the server thread of the game: the steps of
+ *  uMod_TextureServer::AddFile() and RemoveFile() on CurrentMod and OldMod (uMod_FileHandler) without the pipe.
+ *  The old code searched both handlers linearly for each hash, the current code uses uMod_FileHandler::Find()
+ *  and reserves the memory of a whole batch of textures with uMod_FileHandler::Reserve().
+ *  (Add() of the old code did not insert into the hash index, thus the old way is a bit slower than it was.)
+ */
+static TextureFileStruct* LinearFind( uMod_FileHandler &handler, MyTypeHash hash)
+{
+  int num = handler.GetNumber();
+  for (int i=0; i<num; i++) if (handler[i]->Hash == hash) return (handler[i]);
+  return (NULL);
+}
+
+static int LoadPackage( TextureFileStruct *files, int number, bool linear)
+{
+  uMod_FileHandler current_mod, old_mod;
+  for (int i=0; i<number; i++) files[i].Reference = -1;
+
+  if (!linear && current_mod.Reserve( number)) return (-1); // the bulk add of MainLoop()
+  for (int i=0; i<number; i++) // AddFile()
+  {
+    MyTypeHash hash = files[i].Hash;
+    TextureFileStruct *temp = linear ? LinearFind( current_mod, hash) : current_mod.Find( hash);
+    if (temp!=NULL) continue;
+    temp = linear ? LinearFind( old_mod, hash) : old_mod.Find( hash);
+    if (temp!=NULL) {old_mod.Remove( temp); current_mod.Add( temp); continue;}
+    if (current_mod.Add( &files[i])) return (-1);
+  }
+  TEST_CHECK( current_mod.GetNumber()==number, "%d textures added instead of %d", current_mod.GetNumber(), number);
+
+  for (int i=0; i<number; i++) // RemoveFile()
+  {
+    TextureFileStruct *temp = linear ? LinearFind( current_mod, files[i].Hash) : current_mod.Find( files[i].Hash);
+    if (temp==NULL) continue;
+    current_mod.Remove( temp);
+    if (old_mod.Add( temp)) return (-1);
+  }
+  TEST_CHECK( current_mod.GetNumber()==0 && old_mod.GetNumber()==number, "%d textures removed instead of %d", old_mod.GetNumber(), number);
+
+  if (!linear && current_mod.Reserve( number)) return (-1);
+  for (int i=number-1; i>=0; i--) // AddFile() again, the files are taken from OldMod
+  {
+    MyTypeHash hash = files[i].Hash;
+    TextureFileStruct *temp = linear ? LinearFind( current_mod, hash) : current_mod.Find( hash);
+    if (temp!=NULL) continue;
+    temp = linear ? LinearFind( old_mod, hash) : old_mod.Find( hash);
+    TEST_CHECK( temp==&files[i], "texture %d is not found in OldMod", i);
+    old_mod.Remove( temp);
+    if (current_mod.Add( temp)) return (-1);
+  }
+  TEST_CHECK( current_mod.GetNumber()==number && old_mod.GetNumber()==0, "%d textures added again instead of %d", current_mod.GetNumber(), number);
+  for (int i=0; i<number; i++) TEST_CHECK( current_mod.Find( files[i].Hash)==&files[i], "texture %d is lost", i);
+  return (0);
+}
+
+int Bench_FileHandler(void)
+{
+  static const int sizes[] = {1000, 10000, 40000};
+  const int max_number = 40000;
+  TextureFileStruct *files = NULL;
+  uMod_HashIndex unique;
+  if (GetMemory( files, max_number)) return (-1);
+  memset( files, 0, sizeof(TextureFileStruct)*max_number);
+  for (int i=0; i<max_number; i++)
+  {
+    do files[i].Hash = TestRandom(); while (unique.Find( files[i].Hash)>=0); // the hashes must be unique
+    if (unique.Insert( files[i].Hash, i)) return (-1);
+  }
+
+  printf( "  load, unload and load again a package\n");
+  for (unsigned int s=0u; s<sizeof(sizes)/sizeof(sizes[0]); s++)
+  {
+    double start = TestTime();
+    if (LoadPackage( files, sizes[s], true)) return (-1);
+    double time_linear = TestTime() - start;
+    double time_index = 1e30;
+    for (int run=0; run<10; run++)
+    {
+      start = TestTime();
+      if (LoadPackage( files, sizes[s], false)) return (-1);
+      double time = TestTime() - start;
+      if (time<time_index) time_index = time;
+    }
+    printf( "  %6d textures: linear search %9.2f ms, uMod_FileHandler::Find() %7.2f ms (%.0fx faster)\n", sizes[s],
+            time_linear*1e3, time_index*1e3, time_linear/time_index);
+  }
+  delete [] files;
+  return (0);
+}
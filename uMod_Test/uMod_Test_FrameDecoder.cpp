@@ -0,0 +1,240 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Test.h"
+#include "../uMod_FrameDecoder.h"
+
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+
+/*
+ *  A stream of random records is split at random positions (down to single bytes) and fed into the decoder
+ *  like uMod_TextureServer::Mainloop() does: the bytes are read behind GetEnd(), and if the pending record
+ *  does not fit into the rest of the buffer, its bytes are moved into a new buffer with at least GetNeeded() bytes.
+ *  The decoder must return exactly the records which were written, in the same order.
+ */
+static unsigned int WriteRecord( unsigned char *stream, unsigned int size, unsigned int seed)
+{
+  stream[0] = (unsigned char) size;
+  stream[1] = (unsigned char) (size >> 8);
+  stream[2] = (unsigned char) (size >> 16);
+  stream[3] = (unsigned char) (size >> 24);
+  for (unsigned int i=0u; i<size; i++) stream[sizeof(FrameHeaderStruct)+i] = (unsigned char) (seed + i*7u);
+  return (sizeof(FrameHeaderStruct) + size);
+}
+
+int Test_FrameDecoder(void)
+{
+  const unsigned int max_stream = 1u<<20;
+  const unsigned int max_records = 4096u;
+  unsigned char *stream = NULL;
+  unsigned int *sizes = NULL;
+  unsigned int *positions = NULL;
+  if (GetMemory( stream, max_stream) || GetMemory( sizes, max_records) || GetMemory( positions, max_records)) return (-1);
+
+  for (int round=0; round<200; round++)
+  {
+    // the records, zero sized records (only a MsgStruct was sent) and records bigger than the buffer are included
+    unsigned int len = 0u;
+    unsigned int num = 0u;
+    while (num<max_records)
+    {
+      unsigned int size;
+      switch (TestRandom() % 8u)
+      {
+      case 0: size = 0u; break;
+      case 1: size = 4000u + TestRandom() % 20000u; break;
+      default: size = TestRandom() % 64u; break;
+      }
+      if (len + sizeof(FrameHeaderStruct) + size > max_stream) break;
+      positions[num] = len + sizeof(FrameHeaderStruct);
+      sizes[num] = size;
+      len += WriteRecord( &stream[len], size, num);
+      num++;
+    }
+
+    unsigned int max_chunk = 1u + (TestRandom() % 5000u); // size of the reads
+    unsigned int default_size = 1024u + (TestRandom() % 8192u); // size of a new buffer
+
+    uMod_FrameDecoder decoder;
+    char *buffer = NULL;
+    unsigned int buffer_size = 0u;
+    unsigned int read = 0u;
+    unsigned int record = 0u;
+    while (read<len)
+    {
+      // see uMod_TextureServer::PrepareSlab()
+      if (buffer==NULL || decoder.GetBegin() + decoder.GetNeeded( buffer) > buffer_size || decoder.GetEnd()>=buffer_size)
+      {
+        unsigned int needed = default_size;
+        if (buffer!=NULL && decoder.GetNeeded( buffer) > needed) needed = decoder.GetNeeded( buffer);
+        char *temp = NULL;
+        if (GetMemory( temp, (int) needed)) return (-1);
+        if (buffer!=NULL)
+        {
+          if (decoder.GetPending()>0) memcpy( temp, &buffer[decoder.GetBegin()], decoder.GetPending());
+          decoder.Rebase();
+          delete [] buffer;
+        }
+        buffer = temp;
+        buffer_size = needed;
+      }
+
+      unsigned int chunk = 1u + (TestRandom() % max_chunk);
+      if (chunk > buffer_size - decoder.GetEnd()) chunk = buffer_size - decoder.GetEnd();
+      if (chunk > len - read) chunk = len - read;
+      memcpy( &buffer[decoder.GetEnd()], &stream[read], chunk);
+      decoder.Received( chunk);
+      read += chunk;
+
+      unsigned int offset, size;
+      int result;
+      while ((result = decoder.Next( buffer, offset, size))==1)
+      {
+        TEST_CHECK( record<num, "more records than written");
+        TEST_CHECK( size==sizes[record], "record %u: size %u instead of %u", record, size, sizes[record]);
+        TEST_CHECK( offset + size <= decoder.GetEnd(), "record %u exceeds the received bytes", record);
+        TEST_CHECK( memcmp( &buffer[offset], &stream[positions[record]], size)==0, "record %u: wrong content", record);
+        record++;
+      }
+      TEST_CHECK( result==0, "Next() returned %d", result);
+    }
+    TEST_CHECK( record==num, "%u records instead of %u", record, num);
+    TEST_CHECK( decoder.GetPending()==0, "%u bytes pending at the end", decoder.GetPending());
+    if (buffer!=NULL) delete [] buffer;
+  }
+
+  // a size above uMod_MAX_RECORD_SIZE is a corrupt stream, it is reported once the header is complete
+  {
+    char header[sizeof(FrameHeaderStruct)];
+    WriteRecord( (unsigned char*) header, 0u, 0u);
+    header[3] = (char) 0x80;
+    uMod_FrameDecoder decoder;
+    unsigned int offset, size;
+    for (unsigned int i=0u; i<sizeof(FrameHeaderStruct); i++)
+    {
+      TEST_CHECK( decoder.Next( header, offset, size)==0, "incomplete header");
+      decoder.Received( 1u);
+    }
+    TEST_CHECK( decoder.Next( header, offset, size)==-1, "corrupt stream not detected");
+    TEST_CHECK( decoder.GetNeeded( header)==sizeof(FrameHeaderStruct), "GetNeeded() of a corrupt stream");
+  }
+
+  delete [] stream;
+  delete [] sizes;
+  delete [] positions;
+  return (0);
+}
+
+
+/*
+ *  Throughput of the framing: a writer thread sends records over a socketpair (the stand-in for the pipe of
+ *  uMod_Sender) and the reader splits them with uMod_FrameDecoder like Mainloop() does. The reader uses buffers of
+ *  BIG_BUFSIZE and moves a pending record into the next buffer (see PrepareSlab()), the content is not processed.
+ *  Textures (1 MB records) measure the bandwidth, control messages (MsgStruct only) the cost per record.
+ */
+typedef struct
+{
+  int Socket;
+  unsigned char *Stream;
+  unsigned int Len;
+  int Repeat;
+} BenchWriterStruct;
+
+static void* BenchWriter( void *arg)
+{
+  BenchWriterStruct *writer = (BenchWriterStruct*) arg;
+  for (int r=0; r<writer->Repeat; r++) for (unsigned int pos=0u; pos<writer->Len; )
+  {
+    unsigned int chunk = writer->Len - pos < (1u<<16) ? writer->Len - pos : (1u<<16); // like uMod_Sender::SendToGame()
+    ssize_t num = write( writer->Socket, &writer->Stream[pos], chunk);
+    if (num<=0) return (NULL);
+    pos += (unsigned int) num;
+  }
+  shutdown( writer->Socket, SHUT_WR);
+  return (NULL);
+}
+
+static int BenchStream( const char *name, unsigned int record_size, unsigned int stream_len, int repeat)
+{
+  unsigned char *stream = NULL;
+  if (GetMemory( stream, stream_len)) return (-1);
+  unsigned int len = 0u, records = 0u;
+  while (len + sizeof(FrameHeaderStruct) + record_size <= stream_len) {len += WriteRecord( &stream[len], record_size, records); records++;}
+
+  unsigned int buffer_size = BIG_BUFSIZE;
+  if (buffer_size < sizeof(FrameHeaderStruct) + record_size) buffer_size = sizeof(FrameHeaderStruct) + record_size;
+  char *buffer[2] = {NULL, NULL};
+  if (GetMemory( buffer[0], (int) buffer_size) || GetMemory( buffer[1], (int) buffer_size)) return (-1);
+
+  int sockets[2];
+  if (socketpair( AF_UNIX, SOCK_STREAM, 0, sockets)) return (-1);
+  BenchWriterStruct writer = {sockets[0], stream, len, repeat};
+  pthread_t thread;
+  double start = TestTime();
+  if (pthread_create( &thread, NULL, BenchWriter, &writer)) return (-1);
+
+  uMod_FrameDecoder decoder;
+  int current = 0;
+  unsigned long long received = 0u, found = 0u, bytes = 0u;
+  while (1)
+  {
+    if (decoder.GetBegin() + decoder.GetNeeded( buffer[current]) > buffer_size || decoder.GetEnd()>=buffer_size) // PrepareSlab()
+    {
+      int next = 1 - current;
+      if (decoder.GetPending()>0) memcpy( buffer[next], &buffer[current][decoder.GetBegin()], decoder.GetPending());
+      decoder.Rebase();
+      current = next;
+    }
+    ssize_t num = read( sockets[1], &buffer[current][decoder.GetEnd()], buffer_size - decoder.GetEnd());
+    if (num<=0) break;
+    decoder.Received( (unsigned int) num);
+    received += (unsigned long long) num;
+
+    unsigned int offset, size;
+    int result;
+    while ((result = decoder.Next( buffer[current], offset, size))==1) {found++; bytes += size;}
+    TEST_CHECK( result==0, "%s: Next() returned %d", name, result);
+  }
+  double time = TestTime() - start;
+  pthread_join( thread, NULL);
+  close( sockets[0]);
+  close( sockets[1]);
+
+  TEST_CHECK( received==(unsigned long long) len*repeat && found==(unsigned long long) records*repeat && bytes==(unsigned long long) records*record_size*repeat,
+              "%s: %llu of %llu records received", name, found, (unsigned long long) records*repeat);
+  printf( "  %-24s %8.0f MB/s %12.0f records/s\n", name, received/time/1048576.0, found/time);
+  delete [] stream;
+  delete [] buffer[0];
+  delete [] buffer[1];
+  return (0);
+}
+
+int Bench_FrameDecoder(void)
+{
+  printf( "  records over a socketpair (the stand-in for the pipe of the game)\n");
+  if (BenchStream( "textures of 1 MB", (1u<<20) + sizeof(MsgStruct), 64u<<20, 8)) return (-1);
+  if (BenchStream( "textures of 40 MB", (40u<<20) + sizeof(MsgStruct), 41u<<20, 8)) return (-1);
+  if (BenchStream( "textures of 4 KB", (4u<<10) + sizeof(MsgStruct), 64u<<20, 8)) return (-1);
+  if (BenchStream( "control messages", sizeof(MsgStruct), 16u<<20, 8)) return (-1);
+  return (0);
+}
@@ -0,0 +1,236 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Test.h"
+
+#define uMod_MAIN_H_ // the header of the dll needs the DirectX SDK
+#include "../uMod_DX9/uMod_HashIndex.h"
+#include "../uMod_DX9/uMod_HashIndex.cpp"
+
+
+/*
+ *  The old uMod_FileHandler searched its entries with a linear scan, the reference is an array of (hash, index)
+ *  pairs, which is scanned in the same way. Random operations are applied to both and each Find() must agree.
+ */
+typedef struct
+{
+  MyTypeHash Hash;
+  int Index;
+} TestPairStruct;
+
+static int LinearFind( TestPairStruct *pairs, int num, MyTypeHash hash)
+{
+  for (int i=0; i<num; i++) if (pairs[i].Hash==hash) return (i);
+  return (-1);
+}
+
+static MyTypeHash RandomHash( unsigned int range)
+{
+  // clustered hashes (multiples of 2^16) are mixed with random ones, to get long probe sequences and wrap arounds
+  if (TestRandom() & 1u) return ((MyTypeHash) (TestRandom() % range) << 16);
+  return ((MyTypeHash) (TestRandom() % range));
+}
+
+static int CompareAll( uMod_HashIndex &index, TestPairStruct *pairs, int num, unsigned int range)
+{
+  TEST_CHECK( index.GetNumber()==num, "number %d instead of %d", index.GetNumber(), num);
+  for (int i=0; i<num; i++)
+  {
+    int found = index.Find( pairs[i].Hash);
+    TEST_CHECK( found==pairs[i].Index, "hash %08x: index %d instead of %d", (unsigned int) pairs[i].Hash, found, pairs[i].Index);
+  }
+  for (int i=0; i<200; i++)
+  {
+    MyTypeHash hash = RandomHash( 2u*range);
+    int pos = LinearFind( pairs, num, hash);
+    int found = index.Find( hash);
+    TEST_CHECK( found==(pos<0 ? -1 : pairs[pos].Index), "hash %08x: index %d instead of %d", (unsigned int) hash, found, pos<0 ? -1 : pairs[pos].Index);
+  }
+  return (0);
+}
+
+int Test_HashIndex(void)
+{
+  const int max_num = 4000;
+  TestPairStruct *pairs = NULL;
+  MyTypeHash *hashes = NULL;
+  if (GetMemory( pairs, max_num) || GetMemory( hashes, max_num)) return (-1);
+
+  for (int round=0; round<20; round++)
+  {
+    unsigned int range = 64u << (round % 7); // small ranges give many hits of already indexed hashes
+    uMod_HashIndex index;
+    int num = 0;
+
+    // Build(): equal hashes keep the first entry, optionally only a subset given by an index list
+    int build = TestRandom() % 1000;
+    for (int i=0; i<build; i++) hashes[i] = RandomHash( range);
+    int *list = NULL;
+    int num_list = 0;
+    if (round & 1)
+    {
+      if (GetMemory( list, build>0 ? build : 1)) return (-1);
+      for (int i=0; i<build; i++) if (TestRandom() & 1u) list[num_list++] = i;
+    }
+    TEST_CHECK( index.Build( hashes, build, num_list, list)==RETURN_OK, "Build()");
+    int total = (list!=NULL) ? num_list : build;
+    for (int i=0; i<total; i++)
+    {
+      int k = (list!=NULL) ? list[i] : i;
+      if (LinearFind( pairs, num, hashes[k])>=0) continue;
+      pairs[num].Hash = hashes[k];
+      pairs[num].Index = k;
+      num++;
+    }
+    if (list!=NULL) delete [] list;
+    if (CompareAll( index, pairs, num, range)) return (-1);
+
+    for (int op=0; op<5000; op++)
+    {
+      MyTypeHash hash = RandomHash( range);
+      int pos = LinearFind( pairs, num, hash);
+      int value = (int) (TestRandom() & 0xFFFFu);
+      switch (TestRandom() % 8u)
+      {
+      case 0:
+      case 1:
+      case 2: // Insert() adds a new hash or changes the index of an existing one
+      {
+        if (pos<0 && num>=max_num) break;
+        TEST_CHECK( index.Insert( hash, value)==RETURN_OK, "Insert()");
+        if (pos<0) {pairs[num].Hash = hash; pos = num++;}
+        pairs[pos].Index = value;
+        break;
+      }
+      case 3:
+      case 4: // Remove() (backward shift deletion)
+      {
+        TEST_CHECK( index.Remove( hash)==RETURN_OK, "Remove()");
+        if (pos>=0) pairs[pos] = pairs[--num];
+        break;
+      }
+      case 5: // Set() only changes already indexed hashes
+      {
+        int ret = index.Set( hash, value);
+        TEST_CHECK( ret==(pos<0 ? RETURN_TEXTURE_NOT_FOUND : RETURN_OK), "Set() returned %d", ret);
+        if (pos>=0) pairs[pos].Index = value;
+        break;
+      }
+      case 6: // Reserve() rehashes into a larger table
+      {
+        if ((TestRandom() & 15u)==0u) TEST_CHECK( index.Reserve( num + (int) (TestRandom() % 2000u))==RETURN_OK, "Reserve()");
+        break;
+      }
+      case 7:
+      {
+        int found = index.Find( hash);
+        TEST_CHECK( found==(pos<0 ? -1 : pairs[pos].Index), "hash %08x: index %d instead of %d", (unsigned int) hash, found, pos<0 ? -1 : pairs[pos].Index);
+        break;
+      }
+      }
+      if ((op & 511)==0 && CompareAll( index, pairs, num, range)) return (-1);
+    }
+    if (CompareAll( index, pairs, num, range)) return (-1);
+
+    index.Clear();
+    TEST_CHECK( index.GetNumber()==0 && index.Find( pairs[0].Hash)==-1, "Clear()");
+  }
+
+  delete [] pairs;
+  delete [] hashes;
+  return (0);
+}
+
+
+/*
+ *  Look up of a texture in 1k, 10k and 100k entries to mod: the binary search over the sorted FileToMod (the code
+ *  of LookUpToMod() before uMod_HashIndex) against uMod_HashIndex::Find(). Half of the look ups are hits, in a game
+ *  most textures are not modded and thus are misses.
+ */
+typedef struct
+{
+  MyTypeHash Hash;
+  char Rest[28];
+} BenchOldEntryStruct; // the old TextureFileStruct had 32 bytes
+
+static int OldBinarySearch( BenchOldEntryStruct *files, int number, MyTypeHash hash) // the old LookUpToMod()
+{
+  if (number<=0) return (-1);
+  if (hash<files[0].Hash || hash>files[number-1].Hash) return (-1);
+  int pos = number/2;
+  int begin = 0;
+  int end = number-1;
+  while (begin+1<end)
+  {
+    if (hash > files[pos].Hash) {begin = pos+1; pos = (begin + end)/2;}
+    else if (hash < files[pos].Hash) {end = pos-1; pos = (begin + end)/2;}
+    else return (pos);
+  }
+  for (pos=begin; pos<=end; pos++) if (files[pos].Hash==hash) return (pos);
+  return (-1);
+}
+
+static int CompareOldEntry( const void *a, const void *b)
+{
+  MyTypeHash ha = ((const BenchOldEntryStruct*) a)->Hash, hb = ((const BenchOldEntryStruct*) b)->Hash;
+  return (ha<hb ? -1 : (ha>hb ? 1 : 0));
+}
+
+int Bench_HashIndex(void)
+{
+  const int lookups = 1<<22;
+  static const int sizes[] = {1000, 10000, 100000};
+  MyTypeHash *keys = NULL;
+  if (GetMemory( keys, lookups)) return (-1);
+
+  for (unsigned int s=0u; s<sizeof(sizes)/sizeof(sizes[0]); s++)
+  {
+    int number = sizes[s];
+    BenchOldEntryStruct *files = NULL;
+    MyTypeHash *hashes = NULL;
+    if (GetMemory( files, number) || GetMemory( hashes, number)) return (-1);
+    memset( files, 0, sizeof(BenchOldEntryStruct)*number);
+    for (int i=0; i<number; i++) files[i].Hash = TestRandom() | 1u; // odd hashes, the misses are even
+    qsort( files, number, sizeof(BenchOldEntryStruct), CompareOldEntry);
+    for (int i=0; i<number; i++) hashes[i] = files[i].Hash;
+    for (int i=0; i<lookups; i++) keys[i] = (TestRandom() & 1u) ? hashes[TestRandom() % number] : (TestRandom() & ~1u);
+
+    uMod_HashIndex index;
+    double start = TestTime();
+    if (index.Build( hashes, number)) return (-1);
+    double build = TestTime() - start;
+
+    int found_old = 0, found_new = 0;
+    start = TestTime();
+    for (int i=0; i<lookups; i++) if (OldBinarySearch( files, number, keys[i])>=0) found_old++;
+    double time_old = TestTime() - start;
+    start = TestTime();
+    for (int i=0; i<lookups; i++) if (index.Find( keys[i])>=0) found_new++;
+    double time_new = TestTime() - start;
+    TEST_CHECK( found_old==found_new, "%d entries: %d hits instead of %d", number, found_new, found_old);
+
+    printf( "  %6d entries: binary search %6.1f ns, uMod_HashIndex %6.1f ns per look up (%.1fx), Build() %.3f ms\n", number,
+            time_old*1e9/lookups, time_new*1e9/lookups, time_old/time_new, build*1e3);
+    delete [] files;
+    delete [] hashes;
+  }
+  delete [] keys;
+  return (0);
+}
@@ -0,0 +1,117 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Win32.h"
+
+void InitCRC32(void); // uMod_TextureFunction.cpp (compiled in uMod_Test_CRC32.cpp)
+unsigned int GetCRC32( char *pcDatabuf, unsigned int ulDatalen);
+unsigned int GetCRC32_BitSerial( char *pcDatabuf, unsigned int ulDatalen);
+
+#define uMod_MAIN_H_ // the header of the dll needs the DirectX SDK
+#include "../uMod_DX9/uMod_HashPool.h"
+#include "../uMod_DX9/uMod_HashPool.cpp"
+
+#include <sched.h>
+
+
+/*
+ *  The render thread copies synthetic texture data into jobs, the workers calculate the crc32 and the
+ *  finished jobs are collected like uMod_TextureClient::MergeHashes() does. Each job must come back exactly
+ *  once with the hash of the bit serial reference, also if its texture was released (Texture==NULL) in between.
+ *  The pool is also destroyed with jobs in flight, the workers must have exited before the lists are freed.
+ */
+int Test_HashPool(void)
+{
+  InitCRC32(); // is called from InitInstance() in the dll, before any texture client exists
+
+  const int num = 3000;
+  const unsigned int max_size = 1u<<17;
+  unsigned char *data = NULL;
+  unsigned int *expected = NULL;
+  int *collected = NULL;
+  if (GetMemory( data, max_size + 64u) || GetMemory( expected, num) || GetMemory( collected, num, 0)) return (-1);
+  TestFill( data, max_size + 64u);
+
+  Win32NumberOfProcessors = uMod_HASH_MAX_THREADS + 1u; // all workers are started, even on a single core
+  uMod_HashPool pool;
+  TEST_CHECK( pool.Start()==RETURN_OK && pool.IsRunning(), "Start()");
+
+  int finished = 0;
+  uMod_HashJob **jobs = NULL;
+  if (GetMemory( jobs, num)) return (-1);
+  for (int i=0; i<num; i++)
+  {
+    unsigned int offset = TestRandom() & 63u;
+    unsigned int size = (TestRandom() & 3u) ? TestRandom() % max_size : TestRandom() % 256u;
+    jobs[i] = pool.NewJob( (void*) (size_t) (i+1), uMod_HASH_TEXTURE);
+    TEST_CHECK( jobs[i]!=NULL, "NewJob()");
+    TEST_CHECK( uMod_HashPool::SetData( jobs[i], (char*) &data[offset], size)==RETURN_OK, "SetData()");
+    expected[i] = GetCRC32_BitSerial( (char*) &data[offset], size);
+    pool.Submit( jobs[i]);
+    if ((TestRandom() % 8u)==0u) jobs[i]->Texture = NULL; // the texture is released (CancelHashJob())
+
+    // the render thread collects the finished jobs now and then (BeginScene())
+    if ((i & 63)==0 || i==num-1) do
+    {
+      uMod_HashJob *job = pool.GetFinished();
+      while (job!=NULL)
+      {
+        uMod_HashJob *next = (uMod_HashJob*) job->Entry.Next;
+        int index = -1;
+        for (int k=0; k<=i; k++) if (jobs[k]==job) {index = k; break;}
+        TEST_CHECK( index>=0, "unknown job");
+        TEST_CHECK( collected[index]==0, "job %d is collected twice", index);
+        TEST_CHECK( job->pData==NULL, "job %d: the copy is not deleted", index);
+        TEST_CHECK( job->Hash==expected[index], "job %d: hash %08x instead of %08x", index, (unsigned int) job->Hash, expected[index]);
+        collected[index] = 1;
+        jobs[index] = NULL; // the memory of the job might be used again by a new job
+        finished++;
+        uMod_HashPool::DeleteJob( job);
+        job = next;
+      }
+      if (i==num-1 && finished<num) sched_yield();
+    } while (i==num-1 && finished<num);
+  }
+  TEST_CHECK( finished==num, "%d of %d jobs finished", finished, num);
+  delete [] jobs;
+
+  // destroy pools with jobs in flight, ~uMod_HashPool() must wait for the workers and delete the remaining jobs
+  for (int round=0; round<20; round++)
+  {
+    uMod_HashPool *temp = NULL;
+    try {temp = new uMod_HashPool;}
+    catch (...) {return (-1);}
+    TEST_CHECK( temp->Start()==RETURN_OK, "Start()");
+    for (int i=0; i<200; i++)
+    {
+      uMod_HashJob *job = temp->NewJob( NULL, uMod_HASH_TEXTURE);
+      TEST_CHECK( job!=NULL && uMod_HashPool::SetData( job, (char*) data, max_size)==RETURN_OK, "NewJob()");
+      temp->Submit( job);
+    }
+    if (round & 1) temp->Shutdown();
+    delete temp;
+  }
+
+  Win32NumberOfProcessors = 0u;
+  delete [] data;
+  delete [] expected;
+  delete [] collected;
+  return (0);
+}
@@ -0,0 +1,347 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Test.h"
+#include "../uMod_GUI/uMod_Inflate.h"
+
+#include <zlib.h>
+
+
+/*
+ *  uMod_Inflate() must give the same result as zlib for raw deflate streams (as stored in a zip file).
+ *  The streams are compressed by zlib with all levels and strategies, thus stored, fixed and dynamic blocks,
+ *  long matches and distances up to 32 KB are included.
+ */
+static void FillData( unsigned char *data, unsigned int len, int kind)
+{
+  switch (kind)
+  {
+  case 0: // incompressible (stored blocks)
+  {
+    TestFill( data, len);
+    break;
+  }
+  case 1: // runs of a single byte (distance 1, overlapping copies)
+  {
+    for (unsigned int i=0u; i<len; )
+    {
+      unsigned char value = (unsigned char) TestRandom();
+      unsigned int run = 1u + (TestRandom() % 600u);
+      for (; run>0u && i<len; run--) data[i++] = value;
+    }
+    break;
+  }
+  case 2: // text like data, few symbols and many short matches
+  {
+    static const char *words[] = {"texture", "uMod", " ", "dds", "\r\n", "hash", "0x", "mip", "level", "="};
+    for (unsigned int i=0u; i<len; )
+    {
+      const char *word = words[TestRandom() % 10u];
+      for (; *word && i<len; word++) data[i++] = (unsigned char) *word;
+    }
+    break;
+  }
+  default: // blocks like a dds: random blocks which are repeated with far distances
+  {
+    for (unsigned int i=0u; i<len; i+=16u)
+    {
+      unsigned int n = len-i<16u ? len-i : 16u;
+      unsigned int back = 16u * (1u + (TestRandom() % 2048u));
+      if (i>=back && (TestRandom() % 4u)) memmove( &data[i], &data[i-back], n);
+      else TestFill( &data[i], n);
+    }
+    break;
+  }
+  }
+}
+
+static int Deflate( const unsigned char *src, unsigned int len, unsigned char *dst, unsigned int &dst_len, int level, int strategy)
+{
+  z_stream stream;
+  memset( &stream, 0, sizeof(stream));
+  if (deflateInit2( &stream, level, Z_DEFLATED, -15, 8, strategy)!=Z_OK) return (-1); // -15: raw deflate, no zlib header
+  stream.next_in = (Bytef*) src;
+  stream.avail_in = len;
+  stream.next_out = dst;
+  stream.avail_out = dst_len;
+  int ret = deflate( &stream, Z_FINISH);
+  dst_len = (unsigned int) stream.total_out;
+  deflateEnd( &stream);
+  return (ret==Z_STREAM_END ? 0 : -1);
+}
+
+int Test_Inflate(void)
+{
+  const unsigned int max_len = 1u<<18;
+  const int strategies[] = {Z_DEFAULT_STRATEGY, Z_FILTERED, Z_HUFFMAN_ONLY, Z_RLE, Z_FIXED};
+  unsigned char *data = NULL;
+  unsigned char *packed = NULL;
+  unsigned char *result = NULL;
+  unsigned int packed_size = (unsigned int) compressBound( max_len) + 1024u;
+  if (GetMemory( data, max_len) || GetMemory( packed, packed_size) || GetMemory( result, max_len + 64u)) return (-1);
+
+  for (int round=0; round<400; round++)
+  {
+    int kind = round % 4;
+    int level = TestRandom() % 10u;
+    int strategy = strategies[TestRandom() % 5u];
+    unsigned int len = (TestRandom() & 1u) ? TestRandom() % 300u : TestRandom() % (max_len + 1u);
+    FillData( data, len, kind);
+
+    unsigned int packed_len = packed_size;
+    TEST_CHECK( Deflate( data, len, packed, packed_len, level, strategy)==0, "deflate() failed");
+
+    int ret = uMod_Inflate( packed, packed_len, result, len);
+    TEST_CHECK( ret==(int) len, "kind %d, level %d, strategy %d, length %u: returned %d", kind, level, strategy, len, ret);
+    TEST_CHECK( memcmp( result, data, len)==0, "kind %d, level %d, strategy %d, length %u: wrong content", kind, level, strategy, len);
+
+    // a bigger output buffer does not change the result
+    ret = uMod_Inflate( packed, packed_len, result, len + 64u);
+    TEST_CHECK( ret==(int) len && memcmp( result, data, len)==0, "length %u: bigger output buffer, returned %d", len, ret);
+
+    // the output does not fit
+    if (len>0u)
+    {
+      ret = uMod_Inflate( packed, packed_len, result, len - 1u);
+      TEST_CHECK( ret==-1, "length %u: too small output buffer, returned %d", len, ret);
+    }
+
+    // a truncated stream is invalid
+    if (packed_len>1u)
+    {
+      unsigned int cut = TestRandom() % packed_len;
+      ret = uMod_Inflate( packed, cut, result, len);
+      TEST_CHECK( ret==-1, "length %u: stream truncated to %u of %u bytes, returned %d", len, cut, packed_len, ret);
+    }
+  }
+
+  // random garbage must not crash, if zlib accepts it, the results must be equal
+  for (int round=0; round<2000; round++)
+  {
+    unsigned int len = 1u + TestRandom() % 512u;
+    TestFill( packed, len);
+    int ret = uMod_Inflate( packed, len, result, max_len);
+
+    z_stream stream;
+    memset( &stream, 0, sizeof(stream));
+    if (inflateInit2( &stream, -15)!=Z_OK) return (-1);
+    stream.next_in = packed;
+    stream.avail_in = len;
+    stream.next_out = data;
+    stream.avail_out = max_len;
+    int zret = inflate( &stream, Z_FINISH);
+    unsigned int zlen = (unsigned int) stream.total_out;
+    inflateEnd( &stream);
+
+    if (zret==Z_STREAM_END)
+    {
+      TEST_CHECK( ret==(int) zlen && memcmp( result, data, zlen)==0, "garbage accepted by zlib: returned %d instead of %u", ret, zlen);
+    }
+    else TEST_CHECK( ret==-1, "garbage rejected by zlib (%d): returned %d", zret, ret);
+  }
+
+  delete [] data;
+  delete [] packed;
+  delete [] result;
+  return (0);
+}
+
+
+
+/*
+ *  Inflating the textures of a package: zlib inflate() and uMod_Inflate() on a corpus of dds entries, which are
+ *  built in memory (the test has no game files), from well compressible (e.g. a user interface) to stored (noise).
+ *  The entries are deflated like in a zip (zlib, default level). The stream inflate of unzip.cpp is an old zlib,
+ *  which needs windows.h, thus the current zlib stands for it; it is rather faster than the old one.
+ */
+#define BENCH_ENTRIES 6
+
+typedef struct
+{
+  const char *Name;
+  int Kind;
+  DWORD FourCC; // 0: A8R8G8B8 or L8
+  unsigned int Size; // width and height
+  unsigned int Bytes; // per pixel or per 4x4 block
+} BenchEntryStruct;
+
+static const BenchEntryStruct BenchEntries[BENCH_ENTRIES] =
+{
+  {"A8R8G8B8 1024x1024 interface", 0, 0u, 1024u, 4u}, // flat areas
+  {"A8R8G8B8 1024x1024 photo", 1, 0u, 1024u, 4u}, // gradients with noise
+  {"DXT1 2048x2048", 2, 0x31545844u, 2048u, 8u},
+  {"DXT5 2048x2048", 3, 0x35545844u, 2048u, 16u},
+  {"DXT5 1024x1024 with alpha", 4, 0x35545844u, 1024u, 16u},
+  {"L8 1024x1024 noise", 5, 0u, 1024u, 1u},
+};
+
+static void FillColorBlock( unsigned char *block, unsigned int x, unsigned int y) // color end points follow a gradient, the indices are random
+{
+  unsigned short color0 = (unsigned short) (((x>>2) & 0x1Fu)<<11 | ((y>>1) & 0x3Fu)<<5 | ((x+y)>>3 & 0x1Fu));
+  unsigned short color1 = (unsigned short) (color0 ^ (TestRandom() & 0x0821u));
+  memcpy( block, &color0, 2);
+  memcpy( &block[2], &color1, 2);
+  unsigned int indices = (TestRandom() & 7u) ? TestRandom() : 0u;
+  memcpy( &block[4], &indices, 4);
+}
+
+static unsigned int BuildEntry( const BenchEntryStruct &entry, unsigned char *data)
+{
+  memset( data, 0, 128u);
+  memcpy( data, "DDS ", 4u); // the header: size, height, width and the FourCC of the pixel format
+  DWORD value = 124u;
+  memcpy( &data[4], &value, 4u);
+  memcpy( &data[12], &entry.Size, 4u);
+  memcpy( &data[16], &entry.Size, 4u);
+  memcpy( &data[84], &entry.FourCC, 4u);
+  unsigned int len = 128u;
+
+  for (unsigned int size=entry.Size; size>=4u; size/=2u) // mipmap chain down to 4x4
+  {
+    unsigned char *level = &data[len];
+    unsigned int blocks = size/4u;
+    switch (entry.Kind)
+    {
+    case 0:
+    {
+      for (unsigned int y=0u; y<size; y++) for (unsigned int x=0u; x<size; x++)
+      {
+        unsigned int tile = ((y/64u)*7u + (x/64u)*3u) % 5u;
+        unsigned int pixel = tile==0u ? 0x00000000u : 0xFF102030u + tile*0x00151515u;
+        memcpy( &level[(y*size + x)*4u], &pixel, 4u);
+      }
+      len += size*size*4u;
+      break;
+    }
+    case 1:
+    {
+      for (unsigned int y=0u; y<size; y++) for (unsigned int x=0u; x<size; x++)
+      {
+        unsigned char *pixel = &level[(y*size + x)*4u];
+        pixel[0] = (unsigned char) ((x*255u/size) + (TestRandom() & 3u));
+        pixel[1] = (unsigned char) ((y*255u/size) + (TestRandom() & 3u));
+        pixel[2] = (unsigned char) (((x+y)*127u/size) + (TestRandom() & 3u));
+        pixel[3] = 0xFF;
+      }
+      len += size*size*4u;
+      break;
+    }
+    case 2:
+    case 3:
+    case 4:
+    {
+      for (unsigned int y=0u; y<blocks; y++) for (unsigned int x=0u; x<blocks; x++)
+      {
+        unsigned char *block = &level[(y*blocks + x)*entry.Bytes];
+        if (entry.Bytes==16u)
+        {
+          memset( block, 0, 8u);
+          block[0] = block[1] = 0xFF; // opaque
+          if (entry.Kind==4 && ((x/8u + y/8u) & 1u)) // half of the texture has a varying alpha
+          {
+            block[0] = (unsigned char) (x*4u);
+            block[1] = (unsigned char) (y*4u);
+            for (int i=2; i<8; i++) block[i] = (unsigned char) TestRandom();
+          }
+          block += 8;
+        }
+        FillColorBlock( block, x, y);
+      }
+      len += blocks*blocks*entry.Bytes;
+      break;
+    }
+    default:
+    {
+      TestFill( level, size*size);
+      len += size*size;
+      break;
+    }
+    }
+  }
+  return (len);
+}
+
+static int InflateZlib( const unsigned char *src, unsigned int src_len, unsigned char *dst, unsigned int dst_len)
+{
+  z_stream stream;
+  memset( &stream, 0, sizeof(stream));
+  if (inflateInit2( &stream, -15)!=Z_OK) return (-1);
+  stream.next_in = (Bytef*) src;
+  stream.avail_in = src_len;
+  stream.next_out = dst;
+  stream.avail_out = dst_len;
+  int ret = inflate( &stream, Z_FINISH);
+  unsigned int len = (unsigned int) stream.total_out;
+  inflateEnd( &stream);
+  return (ret==Z_STREAM_END ? (int) len : -1);
+}
+
+int Bench_Inflate(void)
+{
+  const unsigned int max_len = 128u + (2048u*2048u/16u)*16u*4u/3u + 1024u;
+  unsigned char *data[BENCH_ENTRIES];
+  unsigned char *packed[BENCH_ENTRIES];
+  unsigned int len[BENCH_ENTRIES], packed_len[BENCH_ENTRIES];
+  unsigned char *result = NULL;
+  for (int i=0; i<BENCH_ENTRIES; i++) data[i] = packed[i] = NULL;
+  if (GetMemory( result, max_len)) return (-1);
+
+  for (int i=0; i<BENCH_ENTRIES; i++)
+  {
+    packed_len[i] = (unsigned int) compressBound( max_len);
+    if (GetMemory( data[i], max_len) || GetMemory( packed[i], packed_len[i])) return (-1);
+    len[i] = BuildEntry( BenchEntries[i], data[i]);
+    TEST_CHECK( Deflate( data[i], len[i], packed[i], packed_len[i], Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY)==0, "deflate() failed");
+  }
+
+  double total[2] = {0.0, 0.0};
+  unsigned int total_len = 0u, total_packed = 0u;
+  for (int i=0; i<BENCH_ENTRIES; i++)
+  {
+    double best[2] = {1e30, 1e30};
+    for (int run=0; run<5; run++) for (int way=0; way<2; way++)
+    {
+      memset( result, 0, len[i]);
+      double start = TestTime();
+      int ret = way==0 ? InflateZlib( packed[i], packed_len[i], result, len[i]) : uMod_Inflate( packed[i], packed_len[i], result, len[i]);
+      double time = TestTime() - start;
+      if (time<best[way]) best[way] = time;
+      if (run==0) TEST_CHECK( ret==(int) len[i] && memcmp( result, data[i], len[i])==0, "%s: %s returned %d instead of %u", BenchEntries[i].Name, way==0 ? "inflate()" : "uMod_Inflate()", ret, len[i]);
+    }
+    double mb = len[i]/1048576.0;
+    printf( "  %-30s %3u%%: zlib %5.0f MB/s, uMod_Inflate() %5.0f MB/s (%.2fx)\n", BenchEntries[i].Name, (unsigned int) (100.0*packed_len[i]/len[i]),
+        mb/best[0], mb/best[1], best[0]/best[1]);
+    total[0] += best[0];
+    total[1] += best[1];
+    total_len += len[i];
+    total_packed += packed_len[i];
+  }
+  double mb = total_len/1048576.0;
+  printf( "  %-30s %3u%%: zlib %5.0f MB/s, uMod_Inflate() %5.0f MB/s (%.2fx)\n", "all entries", (unsigned int) (100.0*total_packed/total_len),
+      mb/total[0], mb/total[1], total[0]/total[1]);
+
+  for (int i=0; i<BENCH_ENTRIES; i++)
+  {
+    delete [] data[i];
+    delete [] packed[i];
+  }
+  delete [] result;
+  return (0);
+}
@@ -0,0 +1,198 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Win32.h"
+#include "../uMod_GUI/uMod_Inflate.h"
+
+#include <zlib.h>
+
+
+/*
+ *  Loading the packages of a game before they are sent: one loader against several loaders.
+ *  THIS IS A MODEL, it does not run uMod_Sender and uMod_File themselves (they need Windows and wxWidgets).
+ *
+ *  The packages are generated in memory. Like uMod_Sender::LoadThread(), each loader takes the next package of the
+ *  list (InterlockedIncrement()), reads it (a copy stands for ReadFile()), decrypts it (XOR) and inflates each
+ *  texture with uMod_Inflate() into the slot of the package. As each package keeps its slot, the result is the same
+ *  for each number of loaders (the first package wins on duplicated hashes), this is checked.
+ */
+#define BENCH_PACKAGES 30
+#define BENCH_PACKAGE_TEXTURES 16u
+#define BENCH_TEXTURE_SIZE (128u<<10)
+#define BENCH_MAX_THREADS 8 // uMod_LOAD_MAX_THREADS
+#define BENCH_RUNS 2
+
+typedef struct
+{
+  unsigned int Size; // packed size
+  unsigned int Offset;
+} BenchLoadEntryStruct;
+
+typedef struct
+{
+  unsigned char *File; // the encrypted package
+  unsigned int Len;
+  unsigned char *Textures[BENCH_PACKAGE_TEXTURES]; // unpacked by the loader
+} BenchPackageStruct;
+
+typedef struct
+{
+  BenchPackageStruct *Packages;
+  int Number;
+  volatile LONG Next;
+  volatile LONG Failed;
+} BenchLoadJobStruct; // like LoadJobStruct of uMod_Sender
+
+
+static void XORPackage( unsigned char *data, unsigned int len) // see uMod_File::XORBuffer()
+{
+  unsigned int i = 0u;
+  for (; i+4u<=len; i+=4u) *((unsigned int*) &data[i]) ^= 0x3FA43FA4u;
+  for (; i<len; i++) data[i] ^= 0xA4;
+}
+
+static DWORD WINAPI BenchLoadThread( LPVOID parameter) // like uMod_Sender::LoadThread()
+{
+  BenchLoadJobStruct *job = (BenchLoadJobStruct*) parameter;
+  int k;
+  while ((k = InterlockedIncrement( &job->Next) - 1) < job->Number)
+  {
+    BenchPackageStruct &package = job->Packages[k];
+    unsigned char *file = NULL;
+    if (GetMemory( file, package.Len)) {InterlockedExchange( &job->Failed, 1); continue;}
+    memcpy( file, package.File, package.Len);
+    XORPackage( file, package.Len);
+    BenchLoadEntryStruct *entries = (BenchLoadEntryStruct*) file;
+    for (unsigned int i=0u; i<BENCH_PACKAGE_TEXTURES; i++)
+    {
+      package.Textures[i] = NULL;
+      if (GetMemory( package.Textures[i], BENCH_TEXTURE_SIZE)
+          || uMod_Inflate( &file[entries[i].Offset], entries[i].Size, package.Textures[i], BENCH_TEXTURE_SIZE)!=(int) BENCH_TEXTURE_SIZE)
+        InterlockedExchange( &job->Failed, 1);
+    }
+    delete [] file; // released as soon as the package is unpacked
+  }
+  return (0);
+}
+
+static double LoadPackages( BenchPackageStruct *packages, int threads)
+{
+  BenchLoadJobStruct job;
+  job.Packages = packages;
+  job.Number = BENCH_PACKAGES;
+  job.Next = 0;
+  job.Failed = 0;
+  double start = TestTime();
+  HANDLE handles[BENCH_MAX_THREADS];
+  int started = 0;
+  for (int t=1; t<threads; t++) // the main thread is one of the loaders
+  {
+    handles[started] = CreateThread( NULL, 0, BenchLoadThread, &job, 0, NULL);
+    if (handles[started]!=NULL) started++;
+  }
+  BenchLoadThread( &job);
+  for (int t=0; t<started; t++) {WaitForSingleObject( handles[t], INFINITE); CloseHandle( handles[t]);}
+  double time = TestTime() - start;
+  return (job.Failed ? -1.0 : time);
+}
+
+int Bench_LoadModel(void)
+{
+  // each package holds its own textures, the first texture of each package is the same (a duplicated hash)
+  unsigned int max_packed = (unsigned int) compressBound( BENCH_TEXTURE_SIZE);
+  unsigned char *texture = NULL;
+  unsigned char *reference[BENCH_PACKAGES][2]; // first and last texture of each package
+  BenchPackageStruct packages[BENCH_PACKAGES];
+  if (GetMemory( texture, BENCH_TEXTURE_SIZE)) return (-1);
+  unsigned long long total = 0u;
+  for (int p=0; p<BENCH_PACKAGES; p++)
+  {
+    packages[p].File = NULL;
+    if (GetMemory( packages[p].File, BENCH_PACKAGE_TEXTURES * (sizeof(BenchLoadEntryStruct) + max_packed))) return (-1);
+    BenchLoadEntryStruct *entries = (BenchLoadEntryStruct*) packages[p].File;
+    unsigned int pos = BENCH_PACKAGE_TEXTURES * sizeof(BenchLoadEntryStruct);
+    for (unsigned int i=0u; i<BENCH_PACKAGE_TEXTURES; i++)
+    {
+      unsigned int seed = TestSeed;
+      if (i==0u) TestSeed = 0x5EED5EEDu;
+      for (unsigned int j=0u; j<BENCH_TEXTURE_SIZE; j++) texture[j] = (unsigned char) (((j>>2) & 255u) + (TestRandom() & 3u)); // packs to about a third
+      if (i==0u) TestSeed = seed;
+      if (i==0u || i==BENCH_PACKAGE_TEXTURES-1u)
+      {
+        unsigned char *&ref = reference[p][i==0u ? 0 : 1];
+        ref = NULL;
+        if (GetMemory( ref, BENCH_TEXTURE_SIZE)) return (-1);
+        memcpy( ref, texture, BENCH_TEXTURE_SIZE);
+      }
+      uLongf packed = max_packed;
+      z_stream stream;
+      memset( &stream, 0, sizeof(stream));
+      if (deflateInit2( &stream, Z_BEST_SPEED, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY)!=Z_OK) return (-1);
+      stream.next_in = texture;
+      stream.avail_in = BENCH_TEXTURE_SIZE;
+      stream.next_out = &packages[p].File[pos];
+      stream.avail_out = packed;
+      if (deflate( &stream, Z_FINISH)!=Z_STREAM_END) {deflateEnd( &stream); return (-1);}
+      entries[i].Size = (unsigned int) stream.total_out;
+      entries[i].Offset = pos;
+      pos += (unsigned int) stream.total_out;
+      deflateEnd( &stream);
+    }
+    packages[p].Len = pos;
+    XORPackage( packages[p].File, pos);
+    total += pos;
+  }
+  delete [] texture;
+
+  SYSTEM_INFO info;
+  GetSystemInfo( &info);
+  printf( "  model of uMod_Sender::LoadPackages() (the real one needs Windows and wxWidgets)\n");
+  printf( "  %d packages of %u textures (%u KB), %llu KB packed, %u cpu\n", BENCH_PACKAGES, BENCH_PACKAGE_TEXTURES, BENCH_TEXTURE_SIZE>>10, total>>10, (unsigned int) info.dwNumberOfProcessors);
+  if (info.dwNumberOfProcessors<2u) printf( "  a single cpu: more loaders cannot be faster\n");
+
+  double single = 0.0;
+  for (int threads=1; threads<=BENCH_MAX_THREADS; threads*=2)
+  {
+    double best = 1e30;
+    for (int run=0; run<BENCH_RUNS; run++)
+    {
+      double time = LoadPackages( packages, threads);
+      TEST_CHECK( time>=0.0, "%d loaders: a package could not be loaded", threads);
+      if (time<best) best = time;
+      for (int p=0; p<BENCH_PACKAGES; p++)
+      {
+        TEST_CHECK( memcmp( packages[p].Textures[0], reference[p][0], BENCH_TEXTURE_SIZE)==0
+                    && memcmp( packages[p].Textures[BENCH_PACKAGE_TEXTURES-1u], reference[p][1], BENCH_TEXTURE_SIZE)==0,
+                    "%d loaders: package %d is not in its slot", threads, p);
+        for (unsigned int i=0u; i<BENCH_PACKAGE_TEXTURES; i++) delete [] packages[p].Textures[i];
+      }
+    }
+    if (threads==1) single = best;
+    printf( "  %d loader%s %8.2f ms (%.1fx)\n", threads, threads==1 ? ": " : "s:", best*1e3, single/best);
+  }
+
+  for (int p=0; p<BENCH_PACKAGES; p++)
+  {
+    delete [] packages[p].File;
+    delete [] reference[p][0];
+    delete [] reference[p][1];
+  }
+  return (0);
+}
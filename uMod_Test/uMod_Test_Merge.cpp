@@ -0,0 +1,205 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Test.h"
+
+#define uMod_MAIN_H_ // the header of the dll needs the DirectX SDK
+#include "../uMod_DX9/uMod_HashIndex.h" // uMod_HashIndex.cpp is compiled with uMod_Test_HashIndex.cpp
+
+
+/*
+ *  Toggling a package while the game is running: full update against delta update.
+ *  THIS IS A MODEL, it does not run uMod_TextureServer and uMod_TextureClient themselves (they need DirectX).
+ *
+ *  - full update (the old way): the server copies all current entries and sorts them (PrepareUpdate()), the client
+ *    walks its sorted table and the update at once and takes over the new table (MergeFullUpdate() before the deltas)
+ *  - delta update: the server copies its list of changes, the client applies each change in place on its columns
+ *    with uMod_HashIndex (MergeDelta(), AddEntry() and RemoveEntry())
+ *  The look up of the new entries in the original textures and the fake textures are the same in both ways and
+ *  are not part of the model. Each run switches the package off and on again, for a single client.
+ */
+#define BENCH_ENTRIES 30000
+#define BENCH_RUNS 10
+
+typedef struct
+{
+  bool ForceReload;
+  char* pData;
+  unsigned int Size;
+  int NumberOfTextures;
+  int Reference;
+  void **Textures;
+  MyTypeHash Hash;
+  unsigned int Generation;
+  int Version;
+  void* Slab;
+  DWORD Requested;
+} BenchFileStruct; // same layout as TextureFileStruct
+
+typedef struct
+{
+  int Type; // 1: add, 2: remove
+  BenchFileStruct File;
+} BenchChangeStruct; // same as TextureChangeStruct
+
+static int CompareHash( const void *a, const void *b)
+{
+  MyTypeHash ha = ((const BenchFileStruct*) a)->Hash, hb = ((const BenchFileStruct*) b)->Hash;
+  return (ha<hb ? -1 : (ha>hb ? 1 : 0));
+}
+
+typedef struct
+{
+  BenchFileStruct *Files;
+  MyTypeHash *Hash;
+  int Number;
+} BenchTableStruct;
+
+// the server copies and sorts its current entries, the client merges them into its sorted table
+static int FullUpdate( const BenchFileStruct *current, int number, BenchTableStruct &client)
+{
+  BenchFileStruct *update = NULL;
+  MyTypeHash *hash = NULL;
+  if (GetMemory( update, number>0 ? number : 1) || GetMemory( hash, number>0 ? number : 1)) return (-1);
+  for (int i=0; i<number; i++) update[i] = current[i];
+  qsort( update, number, sizeof(BenchFileStruct), CompareHash);
+  for (int i=0; i<number; i++) hash[i] = update[i].Hash;
+
+  int pos_old = 0, pos_new = 0, taken = 0;
+  while (pos_old<client.Number && pos_new<number)
+  {
+    if (client.Hash[pos_old] > hash[pos_new]) pos_new++; // new entry
+    else if (client.Hash[pos_old] < hash[pos_new]) pos_old++; // removed entry
+    else {update[pos_new].NumberOfTextures = client.Files[pos_old].NumberOfTextures; taken++; pos_old++; pos_new++;} // take over the fake textures
+  }
+  delete [] client.Files;
+  delete [] client.Hash;
+  client.Files = update;
+  client.Hash = hash;
+  client.Number = number;
+  return (taken);
+}
+
+// the server copies its changes, the client applies them in place (swap with the last entry on remove)
+static int DeltaUpdate( const BenchChangeStruct *changes, int number, BenchTableStruct &client, uMod_HashIndex &index)
+{
+  BenchChangeStruct *delta = NULL;
+  if (GetMemory( delta, number)) return (-1);
+  for (int i=0; i<number; i++) delta[i] = changes[i];
+
+  for (int i=0; i<number; i++)
+  {
+    int pos = index.Find( delta[i].File.Hash);
+    if (delta[i].Type==1)
+    {
+      if (pos>=0) {client.Files[pos] = delta[i].File; continue;}
+      if (index.Insert( delta[i].File.Hash, client.Number)) return (-1);
+      client.Files[client.Number] = delta[i].File;
+      client.Hash[client.Number++] = delta[i].File.Hash;
+    }
+    else if (pos>=0)
+    {
+      index.Remove( client.Hash[pos]);
+      int last = --client.Number;
+      if (pos<last)
+      {
+        client.Files[pos] = client.Files[last];
+        client.Hash[pos] = client.Hash[last];
+        index.Set( client.Hash[pos], pos);
+      }
+    }
+  }
+  delete [] delta;
+  return (0);
+}
+
+static int BenchToggle( BenchFileStruct *all, int package)
+{
+  int number = BENCH_ENTRIES, without = BENCH_ENTRIES - package; // the package are the last entries of all
+  BenchChangeStruct *off = NULL, *on = NULL;
+  if (GetMemory( off, package) || GetMemory( on, package)) return (-1);
+  for (int i=0; i<package; i++)
+  {
+    off[i].Type = 2;
+    off[i].File = all[without+i];
+    on[i].Type = 1;
+    on[i].File = all[without+i];
+  }
+
+  double best_full = 1e30, best_delta = 1e30;
+  for (int run=0; run<BENCH_RUNS; run++)
+  {
+    // full update, the client starts with all entries
+    BenchTableStruct client = {NULL, NULL, 0};
+    if (FullUpdate( all, number, client)<0) return (-1);
+    double start = TestTime();
+    if (FullUpdate( all, without, client)<0) return (-1);
+    if (FullUpdate( all, number, client)<0) return (-1);
+    double time = TestTime() - start;
+    if (time<best_full) best_full = time;
+    TEST_CHECK( client.Number==number, "full update: %d entries instead of %d", client.Number, number);
+    delete [] client.Files;
+    delete [] client.Hash;
+    client.Files = NULL;
+    client.Hash = NULL;
+
+    // delta update, the client starts with all entries (with room for the package like FileToMod)
+    if (GetMemory( client.Files, number) || GetMemory( client.Hash, number)) return (-1);
+    for (int i=0; i<number; i++) {client.Files[i] = all[i]; client.Hash[i] = all[i].Hash;}
+    client.Number = number;
+    uMod_HashIndex index;
+    if (index.Build( client.Hash, number)) return (-1);
+    start = TestTime();
+    if (DeltaUpdate( off, package, client, index)) return (-1);
+    TEST_CHECK( client.Number==without && index.Find( all[without].Hash)<0, "delta update: the package is not removed");
+    if (DeltaUpdate( on, package, client, index)) return (-1);
+    time = TestTime() - start;
+    if (time<best_delta) best_delta = time;
+    TEST_CHECK( client.Number==number, "delta update: %d entries instead of %d", client.Number, number);
+    for (int i=0; i<number; i++) TEST_CHECK( client.Hash[index.Find( all[i].Hash)]==all[i].Hash, "delta update: entry %d is lost", i);
+    delete [] client.Files;
+    delete [] client.Hash;
+  }
+  printf( "  package of %5d textures: full update %8.3f ms, delta update %8.3f ms (%.0fx faster)\n", package,
+          best_full*1e3, best_delta*1e3, best_full/best_delta);
+  delete [] off;
+  delete [] on;
+  return (0);
+}
+
+int Bench_MergeModel(void)
+{
+  printf( "  model of uMod_TextureServer and uMod_TextureClient (the real classes need DirectX)\n");
+  printf( "  %d textures, a package is switched off and on again\n", BENCH_ENTRIES);
+  BenchFileStruct *all = NULL;
+  if (GetMemory( all, BENCH_ENTRIES)) return (-1);
+  memset( all, 0, sizeof(BenchFileStruct)*BENCH_ENTRIES);
+  for (int i=0; i<BENCH_ENTRIES; i++)
+  {
+    all[i].Hash = TestRandom();
+    for (int j=0; j<i; j++) if (all[j].Hash==all[i].Hash) {i--; break;} // the hashes must be unique
+    all[i].Size = 1u<<20;
+    all[i].Generation = i;
+  }
+  static const int packages[] = {10, 100, 1000, 10000};
+  for (unsigned int i=0u; i<sizeof(packages)/sizeof(packages[0]); i++) if (BenchToggle( all, packages[i])) return (-1);
+  delete [] all;
+  return (0);
+}
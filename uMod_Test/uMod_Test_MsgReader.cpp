@@ -0,0 +1,80 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Test.h"
+#include "../uMod_MsgReader.h"
+
+
+/*
+ *  A burst of messages from the game (e.g. CONTROL_FETCH_TEXTURE) is split at random positions
+ *  and read like uMod_Client::Entry() does: at most GetFree() bytes behind GetEnd() of a SMALL_BUFSIZE buffer.
+ *  Since SMALL_BUFSIZE is not a multiple of sizeof(MsgStruct), reads end inside messages.
+ *  The reader must return exactly the messages which were written, in the same order.
+ */
+int Test_MsgReader(void)
+{
+  const unsigned int max_messages = 4000u;
+  MsgStruct *messages = NULL;
+  if (GetMemory( messages, max_messages)) return (-1);
+
+  for (int round=0; round<200; round++)
+  {
+    unsigned int num = TestRandom() % (max_messages + 1u);
+    for (unsigned int i=0u; i<num; i++)
+    {
+      messages[i].Control = TestRandom();
+      messages[i].Value = TestRandom();
+      messages[i].Hash = TestRandom();
+    }
+    const char *stream = (const char*) messages;
+    unsigned int len = num * sizeof(MsgStruct);
+    unsigned int max_chunk = 1u + (TestRandom() % (2u*SMALL_BUFSIZE)); // the pipe returns at most the free space
+
+    char buffer[SMALL_BUFSIZE];
+    uMod_MsgReader reader( SMALL_BUFSIZE);
+    unsigned int read = 0u;
+    unsigned int received = 0u;
+    while (read<len)
+    {
+      TEST_CHECK( reader.GetFree()>0u, "buffer is full, %u bytes pending", reader.GetPending());
+      unsigned int chunk = 1u + (TestRandom() % max_chunk);
+      if (chunk > reader.GetFree()) chunk = reader.GetFree();
+      if (chunk > len - read) chunk = len - read;
+      memcpy( &buffer[reader.GetEnd()], &stream[read], chunk);
+      reader.Received( chunk);
+      read += chunk;
+
+      MsgStruct msg;
+      while (reader.Next( buffer, msg))
+      {
+        TEST_CHECK( received<num, "more messages than written");
+        TEST_CHECK( memcmp( &msg, &messages[received], sizeof(MsgStruct))==0, "message %u: wrong content", received);
+        received++;
+      }
+      TEST_CHECK( reader.GetPending()<sizeof(MsgStruct), "a complete message is pending");
+      reader.Compact( buffer);
+    }
+    TEST_CHECK( received==num, "%u messages instead of %u", received, num);
+    TEST_CHECK( reader.GetPending()==0u, "%u bytes pending at the end", reader.GetPending());
+  }
+
+  delete [] messages;
+  return (0);
+}
@@ -0,0 +1,171 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Test.h"
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+
+/*
+ *  Reading the pipe of the game: serial against overlapped.
+ *  THIS IS A MODEL, it does not run uMod_TextureServer::MainLoop() (it needs Windows).
+ *
+ *  A writer thread (uMod_Sender) prepares each texture of 1 MB (e.g. it is decrypted and inflated) and writes it into
+ *  a pipe with a buffer of 64 KB. The reader processes the bytes of each read (adding the textures and updating the
+ *  clients). The work on both sides is modelled by passes over the data.
+ *  - serial (the old MainLoop()): read, process, read, ... while the reader processes, the pipe is full after
+ *    64 KB and the writer blocks instead of preparing the next texture
+ *  - overlapped (the current MainLoop()): the next read is pending while the last bytes are processed, in the model
+ *    a reader thread reads into the second buffer (like the overlapped ReadFile() into the next slab)
+ */
+#define BENCH_TOTAL (256u<<20)
+#define BENCH_TEXTURE (1u<<20)
+#define BENCH_PIPE (1u<<16) // size of the buffer of the pipe
+#define BENCH_READ (1u<<20) // size of a read
+
+static volatile unsigned long long ProcessSink;
+
+static void Process( const char *data, unsigned int len, int passes)
+{
+  unsigned long long sum = 0u;
+  for (int p=0; p<passes; p++) for (unsigned int i=0u; i<len; i++) sum = sum*31u + (unsigned char) data[i];
+  ProcessSink += sum;
+}
+
+typedef struct
+{
+  int Pipe;
+  int Passes;
+} BenchWriterStruct;
+
+static void* BenchWriter( void *arg)
+{
+  BenchWriterStruct *writer = (BenchWriterStruct*) arg;
+  char *texture = NULL;
+  if (GetMemory( texture, BENCH_TEXTURE, (char) 0x5A)) {close( writer->Pipe); return (NULL);}
+  for (unsigned int total=0u; total<BENCH_TOTAL; total+=BENCH_TEXTURE)
+  {
+    Process( texture, BENCH_TEXTURE, writer->Passes); // prepare the texture
+    for (unsigned int pos=0u; pos<BENCH_TEXTURE; )
+    {
+      ssize_t num = write( writer->Pipe, &texture[pos], BENCH_TEXTURE - pos);
+      if (num<=0) {total = BENCH_TOTAL; break;}
+      pos += (unsigned int) num;
+    }
+  }
+  close( writer->Pipe);
+  delete [] texture;
+  return (NULL);
+}
+
+typedef struct
+{
+  int Pipe;
+  char *Buffer[2];
+  int Length[2];
+  sem_t Filled[2];
+  sem_t Empty[2];
+} BenchReaderStruct;
+
+static void* BenchReader( void *arg) // stands for the pending overlapped read
+{
+  BenchReaderStruct *reader = (BenchReaderStruct*) arg;
+  for (int k=0; ; k=1-k)
+  {
+    sem_wait( &reader->Empty[k]);
+    // the pipe is drained into the buffer while the other one is processed
+    int len = 0;
+    ssize_t num = 1;
+    while (len<(int) BENCH_READ && (num = read( reader->Pipe, &reader->Buffer[k][len], BENCH_READ - len))>0) len += (int) num;
+    reader->Length[k] = len;
+    sem_post( &reader->Filled[k]);
+    if (len==0) break;
+  }
+  return (NULL);
+}
+
+static double BenchRead( bool overlapped, int prepare, int process, unsigned long long &received)
+{
+  int pipes[2];
+  if (pipe( pipes)) return (-1.0);
+  fcntl( pipes[0], F_SETPIPE_SZ, BENCH_PIPE);
+  BenchWriterStruct writer = {pipes[1], prepare};
+  BenchReaderStruct reader;
+  reader.Pipe = pipes[0];
+  reader.Buffer[0] = reader.Buffer[1] = NULL;
+  if (GetMemory( reader.Buffer[0], BENCH_READ) || GetMemory( reader.Buffer[1], BENCH_READ)) return (-1.0);
+  received = 0u;
+
+  pthread_t write_thread, read_thread;
+  double start = TestTime();
+  if (pthread_create( &write_thread, NULL, BenchWriter, &writer)) return (-1.0);
+  if (!overlapped)
+  {
+    ssize_t num;
+    while ((num = read( pipes[0], reader.Buffer[0], BENCH_READ))>0)
+    {
+      received += (unsigned long long) num;
+      Process( reader.Buffer[0], (unsigned int) num, process);
+    }
+  }
+  else
+  {
+    for (int k=0; k<2; k++) {sem_init( &reader.Filled[k], 0, 0); sem_init( &reader.Empty[k], 0, 1);}
+    if (pthread_create( &read_thread, NULL, BenchReader, &reader)) return (-1.0);
+    for (int k=0; ; k=1-k)
+    {
+      sem_wait( &reader.Filled[k]);
+      if (reader.Length[k]<=0) break;
+      received += (unsigned long long) reader.Length[k];
+      Process( reader.Buffer[k], (unsigned int) reader.Length[k], process);
+      sem_post( &reader.Empty[k]); // the buffer is free for the next read
+    }
+    pthread_join( read_thread, NULL);
+    for (int k=0; k<2; k++) {sem_destroy( &reader.Filled[k]); sem_destroy( &reader.Empty[k]);}
+  }
+  double time = TestTime() - start;
+  pthread_join( write_thread, NULL);
+  close( pipes[0]);
+  delete [] reader.Buffer[0];
+  delete [] reader.Buffer[1];
+  return (time);
+}
+
+int Bench_OverlappedModel(void)
+{
+  printf( "  model of MainLoop() (the real one needs Windows), %u MB in textures of %u MB over a pipe of %u KB\n", BENCH_TOTAL>>20, BENCH_TEXTURE>>20, BENCH_PIPE>>10);
+  long cpus = sysconf( _SC_NPROCESSORS_ONLN);
+  if (cpus<2) printf( "  only %ld cpu: the writer and the reader cannot work at the same time, overlapping gains nothing\n", cpus);
+  static const int passes[][2] = {{0, 1}, {1, 1}, {1, 2}, {2, 1}}; // of the writer and of the reader
+  for (unsigned int p=0u; p<sizeof(passes)/sizeof(passes[0]); p++)
+  {
+    unsigned long long received[2];
+    double serial = BenchRead( false, passes[p][0], passes[p][1], received[0]);
+    double overlapped = BenchRead( true, passes[p][0], passes[p][1], received[1]);
+    TEST_CHECK( serial>0.0 && overlapped>0.0, "pipe or thread could not be created");
+    TEST_CHECK( received[0]==BENCH_TOTAL && received[1]==BENCH_TOTAL, "%llu and %llu bytes received instead of %u", received[0], received[1], BENCH_TOTAL);
+    printf( "  prepare %d, process %d passes: serial %6.0f MB/s, overlapped %6.0f MB/s (%.1fx)\n", passes[p][0], passes[p][1],
+            BENCH_TOTAL/serial/1048576.0, BENCH_TOTAL/overlapped/1048576.0, serial/overlapped);
+  }
+  return (0);
+}
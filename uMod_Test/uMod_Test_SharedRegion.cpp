@@ -0,0 +1,129 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Test.h"
+#include "../uMod_SharedRegion.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+/*
+ *  The shared regions of uMod_GUI with POSIX shared memory instead of file mappings.
+ *
+ *  The writer creates a region, writes the file content of random textures into it and remembers a SharedPayloadStruct
+ *  for each (uMod_Sender::NewRegion() and AddToRegion()). The reader maps the region by its name read only
+ *  (OpenSharedSlab()), after that the writer drops its name and its view (the game sent CONTROL_REGION_MAPPED).
+ *  Each payload must be accepted by uMod_CheckPayload() and hold the written content, damaged payloads must be rejected.
+ *  A region, which does not exist, can not be mapped (the game answers with CONTROL_REGION_FAILED).
+ */
+
+static char* MapRegion( const char *name, unsigned int size) // like OpenSharedSlab()
+{
+  int fd = shm_open( name, O_RDONLY, 0);
+  if (fd<0) return (NULL);
+  void *view = mmap( NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close( fd); // the view keeps the region alive
+  if (view==MAP_FAILED) return (NULL);
+  return ((char*) view);
+}
+
+int Test_SharedRegion(void)
+{
+  const unsigned int max_payloads = 64u;
+  SharedPayloadStruct *payloads = NULL;
+  unsigned int *seeds = NULL;
+  if (GetMemory( payloads, max_payloads)) return (-1);
+  if (GetMemory( seeds, max_payloads)) return (-1);
+
+  char name[64];
+  for (unsigned int generation=1u; generation<=20u; generation++)
+  {
+    snprintf( name, 64, "/uMod_Payload_%d_%u", (int) getpid(), generation);
+    unsigned int size = (1u<<12) + TestRandom() % (1u<<20);
+
+    int fd = shm_open( name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    TEST_CHECK( fd>=0, "shm_open( %s) failed", name);
+    TEST_CHECK( ftruncate( fd, size)==0, "ftruncate( %u) failed", size);
+    char *writer = (char*) mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close( fd);
+    TEST_CHECK( writer!=MAP_FAILED, "mmap of the writer failed");
+
+    unsigned int num = 0u;
+    unsigned int pos = 0u;
+    while (num<max_payloads)
+    {
+      unsigned int len = TestRandom() % (size/8u + 1u); // empty textures are possible
+      if (pos+len>size) break;
+      seeds[num] = TestRandom();
+      unsigned int seed = TestSeed;
+      TestSeed = seeds[num] | 1u;
+      TestFill( (unsigned char*) &writer[pos], len);
+      TestSeed = seed;
+      payloads[num].Generation = generation;
+      payloads[num].Offset = pos;
+      payloads[num].Size = len;
+      pos += len;
+      num++;
+    }
+
+    char *reader = MapRegion( name, size);
+    TEST_CHECK( reader!=NULL, "region %u can not be mapped", generation);
+    munmap( writer, size); // CONTROL_REGION_MAPPED: uMod_GUI closes its handle
+    shm_unlink( name);
+
+    unsigned char *expected = NULL;
+    if (GetMemory( expected, size/8u + 1u)) return (-1);
+    for (unsigned int i=0u; i<num; i++)
+    {
+      TEST_CHECK( uMod_CheckPayload( &payloads[i], generation, size), "payload %u of region %u is rejected", i, generation);
+      unsigned int seed = TestSeed;
+      TestSeed = seeds[i] | 1u;
+      TestFill( expected, payloads[i].Size);
+      TestSeed = seed;
+      TEST_CHECK( memcmp( &reader[payloads[i].Offset], expected, payloads[i].Size)==0, "payload %u of region %u: wrong content", i, generation);
+
+      SharedPayloadStruct damaged = payloads[i];
+      damaged.Generation = generation+1u;
+      TEST_CHECK( !uMod_CheckPayload( &damaged, generation, size), "payload of an other region is accepted");
+      damaged = payloads[i];
+      damaged.Offset = size + 1u + TestRandom() % 1024u;
+      TEST_CHECK( !uMod_CheckPayload( &damaged, generation, size), "offset %u behind the region is accepted", damaged.Offset);
+      damaged = payloads[i];
+      damaged.Size = size - damaged.Offset + 1u + TestRandom() % 1024u;
+      TEST_CHECK( !uMod_CheckPayload( &damaged, generation, size), "payload %u exceeds the region", i);
+      damaged.Size = 0xFFFFFFFFu - damaged.Offset/2u; // Offset+Size would overflow
+      TEST_CHECK( !uMod_CheckPayload( &damaged, generation, size), "overflowing payload %u is accepted", i);
+    }
+    delete [] expected;
+    munmap( reader, size);
+
+    TEST_CHECK( MapRegion( name, size)==NULL, "region %u is still mapped after its name was dropped", generation);
+  }
+
+  snprintf( name, 64, "/uMod_Payload_%d_none", (int) getpid());
+  TEST_CHECK( MapRegion( name, 4096u)==NULL, "a region, which does not exist, is mapped");
+
+  delete [] payloads;
+  delete [] seeds;
+  return (0);
+}
@@ -0,0 +1,192 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+
+
+#include "uMod_Test.h"
+
+
+/*
+ *  SetTexture() of our device with mock COM objects: the type of the texture by the old virtual
+ *  QueryInterface( IID_IDirect3D9, ...) call against uMod_GetTextureType() of the dll (vtable pointer).
+ *  The mock classes have the names, the first virtual method and the static VTable of our texture classes,
+ *  thus uMod_TextureType.h is compiled unchanged. The methods are not inlined, like the calls into the
+ *  dll of the game and into d3d9.dll.
+ */
+#define NOINLINE __attribute__((noinline))
+
+typedef struct {unsigned int Data[4];} GUID;
+typedef const GUID &REFIID;
+static const GUID IID_IDirect3D9 = {{0x81BDCBCAu, 0x64D411D4u, 0x8C9B8A38u, 0x9E2D3A4Fu}};
+static const GUID IID_IUnknown = {{0u, 0u, 0xC0u, 0x46000000u}};
+#define E_NOINTERFACE 0x80004002L
+
+class IDirect3DBaseTexture9
+{
+public:
+  virtual ~IDirect3DBaseTexture9(void) {}
+  virtual long QueryInterface( REFIID riid, void** ppvObj) = 0;
+};
+
+class GameTexture : public IDirect3DBaseTexture9 // a texture of d3d9.dll
+{
+public:
+  NOINLINE long QueryInterface( REFIID riid, void** ppvObj)
+  {
+    if (memcmp( &riid, &IID_IUnknown, sizeof(GUID))==0) {*ppvObj = this; return (0L);}
+    *ppvObj = NULL;
+    return (E_NOINTERFACE);
+  }
+};
+
+#define MOCK_TEXTURE_CLASS( name, type) \
+class name : public IDirect3DBaseTexture9 \
+{ \
+public: \
+  name( IDirect3DBaseTexture9 *tex) {m_D3Dtex = tex; VTable = *(void**) this;} \
+  NOINLINE long QueryInterface( REFIID riid, void** ppvObj) \
+  { \
+    if (memcmp( &riid, &IID_IDirect3D9, sizeof(GUID))==0) {*ppvObj = this; return (type);} \
+    return (m_D3Dtex->QueryInterface( riid, ppvObj)); \
+  } \
+  IDirect3DBaseTexture9 *m_D3Dtex; \
+  static void *VTable; \
+}; \
+void *name::VTable = NULL;
+
+MOCK_TEXTURE_CLASS( uMod_IDirect3DTexture9, 0x01000000L)
+MOCK_TEXTURE_CLASS( uMod_IDirect3DVolumeTexture9, 0x01000001L)
+MOCK_TEXTURE_CLASS( uMod_IDirect3DCubeTexture9, 0x01000002L)
+
+#include "../uMod_DX9/uMod_TextureType.h"
+
+
+class GameDevice // the device of d3d9.dll
+{
+public:
+  GameDevice(void) {for (int i=0; i<16; i++) Stages[i] = NULL;}
+  virtual ~GameDevice(void) {}
+  NOINLINE virtual long SetTexture( DWORD Stage, IDirect3DBaseTexture9* pTexture) {Stages[Stage & 15u] = pTexture; return (0L);}
+  IDirect3DBaseTexture9 *Stages[16];
+};
+
+static GameDevice *BenchDevice = NULL;
+
+static NOINLINE long SetTextureOld( DWORD Stage, IDirect3DBaseTexture9* pTexture) // uMod_IDirect3DDevice9::SetTexture() before
+{
+  IDirect3DBaseTexture9 *cpy;
+  if (pTexture != NULL)
+  {
+    long int ret = pTexture->QueryInterface( IID_IDirect3D9, (void**) &cpy);
+    switch (ret)
+    {
+      case 0x01000000L:
+        pTexture = ((uMod_IDirect3DTexture9*)(pTexture))->m_D3Dtex; break;
+      case 0x01000001L:
+        pTexture = ((uMod_IDirect3DVolumeTexture9*)(pTexture))->m_D3Dtex; break;
+      case 0x01000002L:
+        pTexture = ((uMod_IDirect3DCubeTexture9*)(pTexture))->m_D3Dtex; break;
+      default:
+        break;
+    }
+  }
+  return (BenchDevice->SetTexture( Stage, pTexture));
+}
+
+static NOINLINE long SetTextureNew( DWORD Stage, IDirect3DBaseTexture9* pTexture) // uMod_IDirect3DDevice9::SetTexture()
+{
+  if (pTexture != NULL)
+  {
+    switch (uMod_GetTextureType( pTexture))
+    {
+      case uMod_TYPE_TEXTURE:
+        pTexture = ((uMod_IDirect3DTexture9*)(pTexture))->m_D3Dtex; break;
+      case uMod_TYPE_VOLUME_TEXTURE:
+        pTexture = ((uMod_IDirect3DVolumeTexture9*)(pTexture))->m_D3Dtex; break;
+      case uMod_TYPE_CUBE_TEXTURE:
+        pTexture = ((uMod_IDirect3DCubeTexture9*)(pTexture))->m_D3Dtex; break;
+      default:
+        break;
+    }
+  }
+  return (BenchDevice->SetTexture( Stage, pTexture));
+}
+
+
+/*
+ *  A frame binds textures to 8 stages for each draw call. The textures are ours and of the game
+ *  (e.g. render targets, which are not created through our device), in random order.
+ */
+#define BENCH_TEXTURES 4096
+#define BENCH_CALLS (1<<24)
+
+int Bench_TextureType(void)
+{
+  GameDevice device;
+  BenchDevice = &device;
+  GameTexture *game = NULL;
+  IDirect3DBaseTexture9 **textures = NULL, **expected = NULL;
+  unsigned short *order = NULL;
+  if (GetMemory( game, BENCH_TEXTURES) || GetMemory( textures, BENCH_TEXTURES) || GetMemory( expected, BENCH_TEXTURES)) return (-1);
+  if (GetMemory( order, BENCH_CALLS)) return (-1);
+
+  for (int i=0; i<BENCH_TEXTURES; i++)
+  {
+    expected[i] = &game[i];
+    switch (TestRandom() % 6u)
+    {
+      case 0: textures[i] = new uMod_IDirect3DVolumeTexture9( &game[i]); break;
+      case 1: textures[i] = new uMod_IDirect3DCubeTexture9( &game[i]); break;
+      case 2:
+      case 3: textures[i] = &game[i]; break; // not created by our device
+      default: textures[i] = new uMod_IDirect3DTexture9( &game[i]); break;
+    }
+  }
+  for (int i=0; i<BENCH_CALLS; i++) order[i] = (unsigned short) (TestRandom() % BENCH_TEXTURES);
+
+  for (int i=0; i<BENCH_TEXTURES; i++)
+  {
+    SetTextureOld( 0u, textures[i]);
+    TEST_CHECK( device.Stages[0]==expected[i], "texture %d: wrong texture passed with QueryInterface()", i);
+    SetTextureNew( 1u, textures[i]);
+    TEST_CHECK( device.Stages[1]==expected[i], "texture %d: wrong texture passed with uMod_GetTextureType()", i);
+  }
+
+  static const char *names[2] = {"QueryInterface( IID_IDirect3D9)", "uMod_GetTextureType()"};
+  double best[2] = {1e30, 1e30};
+  for (int run=0; run<5; run++) for (int way=0; way<2; way++)
+  {
+    double start = TestTime();
+    if (way==0) for (int i=0; i<BENCH_CALLS; i++) SetTextureOld( i & 7, textures[order[i]]);
+    else for (int i=0; i<BENCH_CALLS; i++) SetTextureNew( i & 7, textures[order[i]]);
+    double time = TestTime() - start;
+    if (time<best[way]) best[way] = time;
+  }
+  for (int way=0; way<2; way++) printf( "  SetTexture() with %-32s %5.2f ns per call\n", names[way], 1e9*best[way]/BENCH_CALLS);
+  printf( "  saving %.2f ns per call\n", 1e9*(best[0]-best[1])/BENCH_CALLS);
+
+  for (int i=0; i<BENCH_TEXTURES; i++) if (textures[i]!=expected[i]) delete textures[i];
+  delete [] game;
+  delete [] textures;
+  delete [] expected;
+  delete [] order;
+  return (0);
+}
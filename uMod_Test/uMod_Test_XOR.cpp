@@ -0,0 +1,129 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Test.h"
+#include "../uMod_GUI/uMod_XOR.h"
+
+
+/*
+ *  uMod_XORBuffer() (SSE2) must decrypt a tpf exactly like the old loop of uMod_File::ReadFile(), also if the file
+ *  is decrypted chunk by chunk while it is read (each chunk starts at a multiple of 16 bytes).
+ */
+static void OldXOR( char *data, unsigned int len) // the code before uMod_XORBuffer()
+{
+  unsigned int *buff = (unsigned int*) data;
+  unsigned int TPF_XOR = 0x3FA43FA4u;
+  unsigned int size = len/4u;
+  for (unsigned int i=0; i<size; i++) buff[i] ^= TPF_XOR;
+  for (unsigned int i=size*4u; i<size*4u+len%4u; i++) ((unsigned char*) data)[i]^=(unsigned char) TPF_XOR;
+}
+
+int Test_XOR(void)
+{
+  const unsigned int max_len = 1u<<20;
+  char *source = NULL, *expected = NULL, *buffer = NULL;
+  if (GetMemory( source, max_len) || GetMemory( expected, max_len) || GetMemory( buffer, max_len + 16)) return (-1);
+  TestFill( (unsigned char*) source, max_len);
+
+  for (int round=0; round<2000; round++)
+  {
+    unsigned int len = round<=300 ? (unsigned int) round : TestRandom() % (max_len + 1u); // all short lengths (the tails)
+    unsigned int offset = TestRandom() & 15u; // the loads and stores are unaligned
+    char *data = &buffer[offset];
+    memcpy( expected, source, len);
+    OldXOR( expected, len);
+
+    memcpy( data, source, len);
+    uMod_XORBuffer( data, len);
+    TEST_CHECK( memcmp( data, expected, len)==0, "length %u, offset %u: differs from the old loop", len, offset);
+
+    // chunk by chunk, like uMod_File::ReadFile() and MapFile()
+    unsigned int chunk = 16u * (1u + TestRandom() % 4096u);
+    memcpy( data, source, len);
+    for (unsigned int pos=0u; pos<len; pos+=chunk) uMod_XORBuffer( &data[pos], len-pos<chunk ? len-pos : chunk);
+    TEST_CHECK( memcmp( data, expected, len)==0, "length %u, chunks of %u: differs from the old loop", len, chunk);
+  }
+  delete [] source;
+  delete [] expected;
+  delete [] buffer;
+  return (0);
+}
+
+
+/*
+ *  Throughput of the decryption of a package of 256 MB: the old loop (as the compiler of the test builds it) and
+ *  uMod_XORBuffer() as a second pass after reading, and uMod_XORBuffer() on each chunk of uMod_READ_CHUNK right
+ *  after it is read (a copy stands for the read, the file is in the page cache).
+ */
+#define BENCH_LEN (256u<<20)
+#define BENCH_CHUNK (1u<<20) // uMod_READ_CHUNK
+
+static double BenchDecrypt( int way, const char *file, char *memory)
+{
+  double start = TestTime();
+  if (way<2)
+  {
+    memcpy( memory, file, BENCH_LEN); // read the whole file
+    if (way==0) OldXOR( memory, BENCH_LEN);
+    else uMod_XORBuffer( memory, BENCH_LEN);
+  }
+  else for (unsigned int pos=0u; pos<BENCH_LEN; pos+=BENCH_CHUNK)
+  {
+    memcpy( &memory[pos], &file[pos], BENCH_CHUNK);
+    uMod_XORBuffer( &memory[pos], BENCH_CHUNK); // the chunk is still in the cache
+  }
+  return (TestTime() - start);
+}
+
+int Bench_XOR(void)
+{
+  char *file = NULL, *memory = NULL;
+  if (GetMemory( file, BENCH_LEN) || GetMemory( memory, BENCH_LEN)) return (-1);
+  TestFill( (unsigned char*) file, BENCH_LEN);
+  memset( memory, 0, BENCH_LEN);
+
+  // the XOR on its own, on a buffer which is not in the cache
+  double xor_old = 1e30, xor_new = 1e30;
+  for (int run=0; run<5; run++)
+  {
+    double start = TestTime();
+    OldXOR( memory, BENCH_LEN);
+    double time = TestTime() - start;
+    if (time<xor_old) xor_old = time;
+    start = TestTime();
+    uMod_XORBuffer( memory, BENCH_LEN);
+    time = TestTime() - start;
+    if (time<xor_new) xor_new = time;
+  }
+  printf( "  XOR of %u MB: old loop %6.0f MB/s, uMod_XORBuffer() %6.0f MB/s\n", BENCH_LEN>>20, (BENCH_LEN>>20)/xor_old, (BENCH_LEN>>20)/xor_new);
+
+  static const char *names[3] = {"read, then old loop", "read, then uMod_XORBuffer()", "uMod_XORBuffer() per chunk"};
+  double best[3] = {1e30, 1e30, 1e30};
+  for (int run=0; run<5; run++) for (int way=0; way<3; way++)
+  {
+    double time = BenchDecrypt( way, file, memory);
+    if (time<best[way]) best[way] = time;
+    if (run==0) TEST_CHECK( *(unsigned int*) &memory[BENCH_LEN-4u]==(*(unsigned int*) &file[BENCH_LEN-4u] ^ 0x3FA43FA4u), "%s: not decrypted", names[way]);
+  }
+  for (int way=0; way<3; way++) printf( "  %-28s %6.0f MB/s\n", names[way], (BENCH_LEN>>20)/best[way]);
+  delete [] file;
+  delete [] memory;
+  return (0);
+}
@@ -0,0 +1,192 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "uMod_Win32.h"
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <unistd.h>
+
+
+#define WIN32_SEMAPHORE 1
+#define WIN32_THREAD 2
+
+typedef struct
+{
+  int Type;
+  sem_t Semaphore;
+} Win32SemaphoreStruct;
+
+typedef struct
+{
+  int Type;
+  pthread_t Thread;
+  LPTHREAD_START_ROUTINE Function;
+  LPVOID Parameter;
+  volatile DWORD ExitCode;
+  bool Joined;
+} Win32ThreadStruct;
+
+static pthread_mutex_t SListMutex = PTHREAD_MUTEX_INITIALIZER;
+DWORD Win32NumberOfProcessors = 0u;
+
+
+void* _aligned_malloc( size_t size, size_t alignment)
+{
+  void* memory = NULL;
+  if (posix_memalign( &memory, alignment, size)) return (NULL);
+  return (memory);
+}
+
+void _aligned_free( void* memory)
+{
+  free( memory);
+}
+
+void InitializeSListHead( PSLIST_HEADER head)
+{
+  head->First = NULL;
+}
+
+PSLIST_ENTRY InterlockedPushEntrySList( PSLIST_HEADER head, PSLIST_ENTRY entry)
+{
+  pthread_mutex_lock( &SListMutex);
+  PSLIST_ENTRY first = head->First;
+  entry->Next = first;
+  head->First = entry;
+  pthread_mutex_unlock( &SListMutex);
+  return (first);
+}
+
+PSLIST_ENTRY InterlockedPopEntrySList( PSLIST_HEADER head)
+{
+  pthread_mutex_lock( &SListMutex);
+  PSLIST_ENTRY first = head->First;
+  if (first!=NULL) head->First = first->Next;
+  pthread_mutex_unlock( &SListMutex);
+  return (first);
+}
+
+PSLIST_ENTRY InterlockedFlushSList( PSLIST_HEADER head)
+{
+  pthread_mutex_lock( &SListMutex);
+  PSLIST_ENTRY first = head->First;
+  head->First = NULL;
+  pthread_mutex_unlock( &SListMutex);
+  return (first);
+}
+
+LONG InterlockedExchange( volatile LONG* target, LONG value)
+{
+  return (__sync_lock_test_and_set( target, value));
+}
+
+LONG InterlockedIncrement( volatile LONG* target)
+{
+  return (__sync_add_and_fetch( target, 1));
+}
+
+
+HANDLE CreateSemaphore( void*, LONG initial, LONG, const char*)
+{
+  Win32SemaphoreStruct* semaphore = NULL;
+  try {semaphore = new Win32SemaphoreStruct;}
+  catch (...) {return (NULL);}
+  semaphore->Type = WIN32_SEMAPHORE;
+  if (sem_init( &semaphore->Semaphore, 0, (unsigned int) initial)) {delete semaphore; return (NULL);}
+  return ((HANDLE) semaphore);
+}
+
+BOOL ReleaseSemaphore( HANDLE handle, LONG count, LONG*)
+{
+  Win32SemaphoreStruct* semaphore = (Win32SemaphoreStruct*) handle;
+  for (LONG i=0; i<count; i++) sem_post( &semaphore->Semaphore);
+  return (TRUE);
+}
+
+static void* Win32ThreadFunction( void* parameter)
+{
+  Win32ThreadStruct* thread = (Win32ThreadStruct*) parameter;
+  DWORD code = thread->Function( thread->Parameter);
+  __sync_synchronize();
+  thread->ExitCode = code;
+  return (NULL);
+}
+
+HANDLE CreateThread( void*, size_t, LPTHREAD_START_ROUTINE function, LPVOID parameter, DWORD, DWORD*)
+{
+  Win32ThreadStruct* thread = NULL;
+  try {thread = new Win32ThreadStruct;}
+  catch (...) {return (NULL);}
+  thread->Type = WIN32_THREAD;
+  thread->Function = function;
+  thread->Parameter = parameter;
+  thread->ExitCode = STILL_ACTIVE;
+  thread->Joined = false;
+  if (pthread_create( &thread->Thread, NULL, Win32ThreadFunction, thread)) {delete thread; return (NULL);}
+  return ((HANDLE) thread);
+}
+
+BOOL GetExitCodeThread( HANDLE handle, DWORD* code)
+{
+  Win32ThreadStruct* thread = (Win32ThreadStruct*) handle;
+  *code = thread->ExitCode;
+  return (TRUE);
+}
+
+DWORD WaitForSingleObject( HANDLE handle, DWORD)
+{
+  if (*(int*) handle==WIN32_SEMAPHORE)
+  {
+    Win32SemaphoreStruct* semaphore = (Win32SemaphoreStruct*) handle;
+    while (sem_wait( &semaphore->Semaphore)) ; // interrupted by a signal
+  }
+  else
+  {
+    Win32ThreadStruct* thread = (Win32ThreadStruct*) handle;
+    if (!thread->Joined) pthread_join( thread->Thread, NULL);
+    thread->Joined = true;
+  }
+  return (0);
+}
+
+BOOL CloseHandle( HANDLE handle)
+{
+  if (*(int*) handle==WIN32_SEMAPHORE)
+  {
+    Win32SemaphoreStruct* semaphore = (Win32SemaphoreStruct*) handle;
+    sem_destroy( &semaphore->Semaphore);
+    delete semaphore;
+  }
+  else
+  {
+    Win32ThreadStruct* thread = (Win32ThreadStruct*) handle;
+    if (!thread->Joined) pthread_detach( thread->Thread);
+    delete thread;
+  }
+  return (TRUE);
+}
+
+void GetSystemInfo( SYSTEM_INFO* info)
+{
+  if (Win32NumberOfProcessors>0u) {info->dwNumberOfProcessors = Win32NumberOfProcessors; return;}
+  long num = sysconf( _SC_NPROCESSORS_ONLN);
+  info->dwNumberOfProcessors = num>0 ? (DWORD) num : 1u;
+}
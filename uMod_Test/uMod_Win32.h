@@ -0,0 +1,79 @@
+/*
+This file is part of Universal Modding Engine.
+
+
+Universal Modding Engine is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Universal Modding Engine is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Universal Modding Engine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef uMod_TEST_WIN32_H_
+#define uMod_TEST_WIN32_H_
+
+/*
+ *  Emulation of the few Win32 functions, which the worker pools of the dll use (threads, semaphores and SLIST),
+ *  thus uMod_HashPool.cpp can be compiled and tested on Linux. It is implemented with pthreads.
+ *  The SLIST functions are protected by a mutex instead of being lock-free, only their behaviour is emulated.
+ */
+
+#include "uMod_Test.h"
+
+typedef int BOOL;
+typedef long LONG;
+typedef void* LPVOID;
+typedef DWORD (*LPTHREAD_START_ROUTINE)( LPVOID);
+
+#define WINAPI
+#define TRUE 1
+#define FALSE 0
+#define INFINITE 0xFFFFFFFFu
+#define STILL_ACTIVE 259u
+#define MEMORY_ALLOCATION_ALIGNMENT 16
+
+typedef struct _SLIST_ENTRY
+{
+  struct _SLIST_ENTRY *Next;
+} SLIST_ENTRY, *PSLIST_ENTRY;
+
+typedef struct
+{
+  PSLIST_ENTRY First;
+} SLIST_HEADER, *PSLIST_HEADER;
+
+typedef struct
+{
+  DWORD dwNumberOfProcessors;
+} SYSTEM_INFO;
+
+void* _aligned_malloc( size_t size, size_t alignment);
+void _aligned_free( void* memory);
+
+void InitializeSListHead( PSLIST_HEADER head);
+PSLIST_ENTRY InterlockedPushEntrySList( PSLIST_HEADER head, PSLIST_ENTRY entry);
+PSLIST_ENTRY InterlockedPopEntrySList( PSLIST_HEADER head);
+PSLIST_ENTRY InterlockedFlushSList( PSLIST_HEADER head);
+LONG InterlockedExchange( volatile LONG* target, LONG value);
+LONG InterlockedIncrement( volatile LONG* target);
+
+HANDLE CreateSemaphore( void* attributes, LONG initial, LONG maximum, const char* name);
+BOOL ReleaseSemaphore( HANDLE semaphore, LONG count, LONG* previous);
+HANDLE CreateThread( void* attributes, size_t stack, LPTHREAD_START_ROUTINE function, LPVOID parameter, DWORD flags, DWORD* id);
+BOOL GetExitCodeThread( HANDLE thread, DWORD* code);
+DWORD WaitForSingleObject( HANDLE handle, DWORD milliseconds); // only INFINITE is supported
+BOOL CloseHandle( HANDLE handle);
+void GetSystemInfo( SYSTEM_INFO* info); // reports Win32NumberOfProcessors if it is set
+
+extern DWORD Win32NumberOfProcessors; // the pools start (number - 1) workers, thus they can be tested also on a single core
+
+#endif /* uMod_TEST_WIN32_H_ */